@@ -12,8 +12,9 @@ namespace ImGui
 	void PushStyleVarAlt(ImGuiStyleVar idx, const ImVec2& val);
 	bool BeginComboAlt(const char* label, const char* preview_value, ImGuiComboFlags flags = 0);
 
-	template<typename T>
-	bool ComboSections(const char* label, int* current_item, T* selector, const char** items, const char* skip)
+	// items is anything indexable by the selector's values that gives a const char*
+	template<typename T, typename Items>
+	bool ComboSections(const char* label, int* current_item, T* selector, const Items& items, const char* skip)
 	{
 		if (!selector[0])
 		{
@@ -45,7 +46,7 @@ namespace ImGui
 			const bool item_selected = (i == *current_item);
 			const char* item_text = items[selector[i]];
 
-			if (item_text != skip)
+			if (strcmp(item_text, skip))
 			{
 				PushID((void*)(intptr_t)i);
 				if (Selectable(item_text, item_selected))
@@ -63,8 +64,8 @@ namespace ImGui
 		return value_changed;
 	}
 
-	template<typename T>
-	bool ComboSectionsDefault(const char* label, int* current_item, T* selector, const char** items, const char* skip)
+	template<typename T, typename Items>
+	bool ComboSectionsDefault(const char* label, int* current_item, T* selector, const Items& items, const char* skip)
 	{
 		if (!selector[0])
 		{
@@ -96,7 +97,7 @@ namespace ImGui
 			const bool item_selected = (i == *current_item);
 			const char* item_text = items[selector[i]];
 
-			if (item_text != skip)
+			if (strcmp(item_text, skip))
 			{
 				PushID((void*)(intptr_t)i);
 				if (Selectable(item_text, item_selected))
@@ -0,0 +1,132 @@
+#pragma once
+
+// Relocation and import walking for inject_shellcode.cpp.
+// Everything here has to be __forceinline, since InjectShellcode gets copied
+// out as a single function. Nothing here calls into Windows except through the
+// function pointers that are passed in, so these can also be built and tested
+// on other platforms with a small shim for the PE structures.
+
+#define PE_PAGE_SIZE 0x1000
+
+#define MakePointer(t, p, offset) ((t)((PUINT8)(p) + offset))
+
+// Each IMAGE_BASE_RELOCATION block covers a single page, so every page is only
+// made writable once, instead of once for every fixup in it.
+__forceinline bool PeApplyRelocations(UINT_PTR base, PIMAGE_NT_HEADERS pImageNtHeader, decltype(VirtualProtect)* pVirtualProtect)
+{
+    // Get the delta of the real image base with the predefined
+    UINT_PTR lBaseDelta = base - pImageNtHeader->OptionalHeader.ImageBase;
+
+    // This module has been loaded to the ImageBase, no need to do relocation
+    if (0 == lBaseDelta)
+        return true;
+
+    PIMAGE_DATA_DIRECTORY pRelocDir = &pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
+    if (0 == pRelocDir->VirtualAddress || 0 == pRelocDir->Size)
+        return true;
+
+    PIMAGE_BASE_RELOCATION pImageBaseRelocation = MakePointer(PIMAGE_BASE_RELOCATION, base, pRelocDir->VirtualAddress);
+    if (NULL == pImageBaseRelocation)
+        return false;
+
+    while (0 != (pImageBaseRelocation->VirtualAddress + pImageBaseRelocation->SizeOfBlock)) {
+        PWORD pRelocationData = MakePointer(PWORD, pImageBaseRelocation, sizeof(IMAGE_BASE_RELOCATION));
+        DWORD NumberOfRelocationData = (pImageBaseRelocation->SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
+        PUINT8 pPage = (PUINT8)(base + pImageBaseRelocation->VirtualAddress);
+
+        // Blocks can be nothing but IMAGE_REL_BASED_ABSOLUTE padding, so the page
+        // only gets unprotected once there's something to write to it
+        bool unprotected = false;
+        DWORD lOldProtect;
+
+        for (DWORD i = 0; i < NumberOfRelocationData; i++) {
+            if (IMAGE_REL_BASED_HIGHLOW != (pRelocationData[i] >> 12))
+                continue;
+
+            if (!unprotected) {
+                pVirtualProtect(pPage, PE_PAGE_SIZE, PAGE_EXECUTE_READWRITE, &lOldProtect);
+                unprotected = true;
+            }
+
+            DWORD offset = pRelocationData[i] & 0x0FFF;
+            PDWORD pAddress = (PDWORD)(pPage + offset);
+            if (offset > PE_PAGE_SIZE - sizeof(DWORD)) {
+                // Straddles into the next page, which could be in a different section
+                DWORD lNextOldProtect;
+                pVirtualProtect(pPage + PE_PAGE_SIZE, 1, PAGE_EXECUTE_READWRITE, &lNextOldProtect);
+                *pAddress += (DWORD)lBaseDelta;
+                pVirtualProtect(pPage + PE_PAGE_SIZE, 1, lNextOldProtect, &lNextOldProtect);
+            } else {
+                *pAddress += (DWORD)lBaseDelta;
+            }
+        }
+
+        if (unprotected)
+            pVirtualProtect(pPage, PE_PAGE_SIZE, lOldProtect, &lOldProtect);
+
+        pImageBaseRelocation = MakePointer(PIMAGE_BASE_RELOCATION, pImageBaseRelocation, pImageBaseRelocation->SizeOfBlock);
+    }
+    return true;
+}
+
+// Every import descriptor's IAT is a contiguous array, so it's unprotected
+// once as a whole. Returns the name of the first DLL that couldn't be loaded,
+// or NULL on success.
+__forceinline PCHAR PeResolveImports(UINT_PTR base, PIMAGE_NT_HEADERS pImageNtHeader,
+    decltype(LoadLibraryA)* pLoadLibraryA, decltype(GetProcAddress)* pGetProcAddress, decltype(VirtualProtect)* pVirtualProtect)
+{
+    PIMAGE_DATA_DIRECTORY pImportDir = &pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+    if (pImportDir->VirtualAddress == 0 || pImportDir->Size == 0)
+        return NULL;
+
+    PIMAGE_IMPORT_DESCRIPTOR pImageImportDescriptor = MakePointer(PIMAGE_IMPORT_DESCRIPTOR, base, pImportDir->VirtualAddress);
+
+    for (; pImageImportDescriptor->Name; pImageImportDescriptor++) {
+        // Get the dependent module name
+        PCHAR pDllName = MakePointer(PCHAR, base, pImageImportDescriptor->Name);
+
+        // Get the dependent module handle, or load the dependent module
+        HMODULE hMod = pLoadLibraryA(pDllName);
+
+        // Failed
+        if (NULL == hMod)
+            return pDllName;
+
+        // Original thunk
+        PIMAGE_THUNK_DATA pOriginalThunk = NULL;
+        if (pImageImportDescriptor->OriginalFirstThunk)
+            pOriginalThunk = MakePointer(PIMAGE_THUNK_DATA, base, pImageImportDescriptor->OriginalFirstThunk);
+        else
+            pOriginalThunk = MakePointer(PIMAGE_THUNK_DATA, base, pImageImportDescriptor->FirstThunk);
+
+        // IAT thunk
+        PIMAGE_THUNK_DATA pIATThunk = MakePointer(PIMAGE_THUNK_DATA, base, pImageImportDescriptor->FirstThunk);
+
+        DWORD NumberOfThunks = 0;
+        while (pOriginalThunk[NumberOfThunks].u1.AddressOfData)
+            NumberOfThunks++;
+        if (!NumberOfThunks)
+            continue;
+
+        DWORD lOldProtect;
+        pVirtualProtect(pIATThunk, NumberOfThunks * sizeof(IMAGE_THUNK_DATA), PAGE_EXECUTE_READWRITE, &lOldProtect);
+
+        for (DWORD i = 0; i < NumberOfThunks; i++) {
+            FARPROC lpFunction = NULL;
+            if (IMAGE_SNAP_BY_ORDINAL(pOriginalThunk[i].u1.Ordinal)) {
+                lpFunction = pGetProcAddress(hMod, (LPCSTR)IMAGE_ORDINAL(pOriginalThunk[i].u1.Ordinal));
+            } else {
+                PIMAGE_IMPORT_BY_NAME pImageImportByName = MakePointer(
+                    PIMAGE_IMPORT_BY_NAME, base, pOriginalThunk[i].u1.AddressOfData);
+
+                lpFunction = pGetProcAddress(hMod, (LPCSTR)&(pImageImportByName->Name));
+            }
+
+            // Write into IAT
+            pIATThunk[i].u1.Function = (DWORD)lpFunction;
+        }
+
+        pVirtualProtect(pIATThunk, NumberOfThunks * sizeof(IMAGE_THUNK_DATA), lOldProtect, &lOldProtect);
+    }
+    return NULL;
+}
@@ -1,4 +1,5 @@
 #include "thprac_load_exe.h"
+#include "inject_pe.h"
 
 // BIG HEADS UP:
 // If you update this file, do the following:
@@ -8,6 +9,11 @@
 //    function into the INJECT_SHELLCODE array
 // 3) Pad the array with 0xCC until the static_assert is happy
 
+// Any other 32 bit compiler works too, as long as the function ends up position independent
+// and wchar_t is 2 bytes like it is on Windows (-fshort-wchar for gcc and clang), otherwise
+// remote_param gets a different layout. The static_asserts on remote_param catch that.
+// The relocation and import code in inject_pe.h is tested by thprac/tests/inject_pe_test.cpp.
+
 // If there's a better way to do this, please tell me
 
 typedef void PExeMain();
@@ -23,7 +29,6 @@ __forceinline void string_copy(char* out, char* in) {
     out[i] = 0;
 }
 
-#define MakePointer(t, p, offset) ((t)((PUINT8)(p) + offset))
 extern "C" __declspec(safebuffers) __declspec(dllexport) InjectResult WINAPI InjectShellcode(remote_param* param)
 {
     union // MemModule base
@@ -40,100 +45,24 @@ extern "C" __declspec(safebuffers) __declspec(dllexport) InjectResult WINAPI Inj
     auto pGetProcAddress = param->pGetProcAddress;
     auto pGetLastError = param->pGetLastError;
 
-    DWORD lOldProtect;
-
     pe.hModule = pLoadLibraryW(param->sExePath);
     if (pe.hModule == NULL)
         return { InjectResult::LoadError, (WORD)pGetLastError() };
 
+    PIMAGE_NT_HEADERS pImageNtHeader = MakePointer(PIMAGE_NT_HEADERS, pe.pImageDosHeader, pe.pImageDosHeader->e_lfanew);
+
     /*-------------------------------------------------------------------------------
 								  B A S E    R E L O C A T I O N
 		-------------------------------------------------------------------------------*/
-
-    PIMAGE_NT_HEADERS pImageNtHeader = MakePointer(PIMAGE_NT_HEADERS, pe.pImageDosHeader, pe.pImageDosHeader->e_lfanew);
-
-    // Get the delta of the real image base with the predefined
-    UINT_PTR lBaseDelta = ((PUINT8)pe.iBase - (PUINT8)pImageNtHeader->OptionalHeader.ImageBase);
-
-    // This module has been loaded to the ImageBase, no need to do relocation
-    if (0 != lBaseDelta) {
-        if (!(0 == pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress || 0 == pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size)) {
-
-            PIMAGE_BASE_RELOCATION pImageBaseRelocation = MakePointer(PIMAGE_BASE_RELOCATION, pe.lpBase,
-                pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress);
-
-            if (NULL == pImageBaseRelocation)
-                return { InjectResult::RelocationError, 0 };
-
-            while (0 != (pImageBaseRelocation->VirtualAddress + pImageBaseRelocation->SizeOfBlock)) {
-                PWORD pRelocationData = MakePointer(PWORD, pImageBaseRelocation, sizeof(IMAGE_BASE_RELOCATION));
-
-                int NumberOfRelocationData = (pImageBaseRelocation->SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(WORD);
-
-                for (int i = 0; i < NumberOfRelocationData; i++) {
-                    if (IMAGE_REL_BASED_HIGHLOW == (pRelocationData[i] >> 12)) {
-                        PDWORD pAddress = (PDWORD)(pe.iBase + pImageBaseRelocation->VirtualAddress + (pRelocationData[i] & 0x0FFF));
-
-                        pVirtualProtect(pAddress, sizeof(DWORD), PAGE_EXECUTE_READWRITE, &lOldProtect);
-                        *pAddress += (DWORD)lBaseDelta;
-                        pVirtualProtect(pAddress, sizeof(DWORD), lOldProtect, &lOldProtect);
-                    }
-                }
-
-                pImageBaseRelocation = MakePointer(PIMAGE_BASE_RELOCATION, pImageBaseRelocation, pImageBaseRelocation->SizeOfBlock);
-            }
-        }
-    }
+    if (!PeApplyRelocations(pe.iBase, pImageNtHeader, pVirtualProtect))
+        return { InjectResult::RelocationError, 0 };
 
     /*-------------------------------------------------------------------------------
 								  I M P O R T    R E S O L V E
 		-------------------------------------------------------------------------------*/
-    if (!(pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress == 0 || pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].Size == 0)) {
-
-        PIMAGE_IMPORT_DESCRIPTOR pImageImportDescriptor = MakePointer(PIMAGE_IMPORT_DESCRIPTOR, pe.lpBase,
-            pImageNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress);
-
-        for (; pImageImportDescriptor->Name; pImageImportDescriptor++) {
-            // Get the dependent module name
-            PCHAR pDllName = MakePointer(PCHAR, pe.lpBase, pImageImportDescriptor->Name);
-
-            // Get the dependent module handle, or load the dependent module
-            HMODULE hMod = pLoadLibraryA(pDllName);
-
-            // Failed
-            if (NULL == hMod) {
-                string_copy(param->sLoadErrDllName, pDllName);
-                return { InjectResult::LoadError, (WORD)pGetLastError() };
-            }
-
-            // Original thunk
-            PIMAGE_THUNK_DATA pOriginalThunk = NULL;
-            if (pImageImportDescriptor->OriginalFirstThunk)
-                pOriginalThunk = MakePointer(PIMAGE_THUNK_DATA, pe.lpBase, pImageImportDescriptor->OriginalFirstThunk);
-            else
-                pOriginalThunk = MakePointer(PIMAGE_THUNK_DATA, pe.lpBase, pImageImportDescriptor->FirstThunk);
-
-            // IAT thunk
-            PIMAGE_THUNK_DATA pIATThunk = MakePointer(PIMAGE_THUNK_DATA, pe.lpBase,
-                pImageImportDescriptor->FirstThunk);
-
-            for (; pOriginalThunk->u1.AddressOfData; pOriginalThunk++, pIATThunk++) {
-                FARPROC lpFunction = NULL;
-                if (IMAGE_SNAP_BY_ORDINAL(pOriginalThunk->u1.Ordinal)) {
-                    lpFunction = pGetProcAddress(hMod, (LPCSTR)IMAGE_ORDINAL(pOriginalThunk->u1.Ordinal));
-                } else {
-                    PIMAGE_IMPORT_BY_NAME pImageImportByName = MakePointer(
-                        PIMAGE_IMPORT_BY_NAME, pe.lpBase, pOriginalThunk->u1.AddressOfData);
-
-                    lpFunction = pGetProcAddress(hMod, (LPCSTR)&(pImageImportByName->Name));
-                }
-
-                // Write into IAT
-                pVirtualProtect(&(pIATThunk->u1.Function), sizeof(DWORD), PAGE_EXECUTE_READWRITE, &lOldProtect);
-                pIATThunk->u1.Function = (DWORD)lpFunction;
-                pVirtualProtect(&(pIATThunk->u1.Function), sizeof(DWORD), lOldProtect, &lOldProtect);
-            }
-        }
+    if (PCHAR pDllName = PeResolveImports(pe.iBase, pImageNtHeader, pLoadLibraryA, pGetProcAddress, pVirtualProtect)) {
+        string_copy(param->sLoadErrDllName, pDllName);
+        return { InjectResult::LoadError, (WORD)pGetLastError() };
     }
 
 #define GET_HEADER_DICTIONARY(m, idx) &m->OptionalHeader.DataDirectory[idx]
@@ -0,0 +1,412 @@
+#pragma once
+
+// The kernels behind th19_fast.cpp. They only use SSE2 intrinsics and the
+// standard library, so besides MSVC and clang-cl they also build with gcc and
+// clang on other platforms, where thprac/tests/th19_fast_test.cpp checks them
+// against the scalar code they replaced.
+//
+// Whoever includes this has to declare sincos(float) first, returning the sine
+// in the first lane and the cosine in the second. In the game that's the same
+// sincos TH19 calls itself, which matters: any other one gives different
+// results, and replays desync.
+
+#define elementsof(a) (sizeof(a) / sizeof(a[0]))
+
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <bit>
+
+#ifndef _MSC_VER
+#define __forceinline inline __attribute__((always_inline))
+#endif
+
+// Use the same Pi as ZUN
+constexpr const float ZUN_PI = std::bit_cast<float, uint32_t>(0x40490FDB);
+
+struct Float2 {
+    float x;
+    float y;
+};
+
+struct Float3 : public Float2 {
+    float z;
+};
+
+struct CPUCollider {
+    Float3 pos; // 0x0
+    char gapC[12]; // 0xC
+    Float2 size; // 0x18
+    float radius; // 0x20
+    char gap24[4]; // 0x24
+    float angle; // 0x28
+    char gap2C[12]; // 0x2C
+    uint32_t flags; // 0x38
+    // 0x3C
+};
+
+struct Player {
+    char gap0[8420]; // 0x0
+    int32_t unfocused_linear_speed; // 0x20E4
+    int32_t focused_linear_speed; // 0x20E8
+    int32_t unfocused_diagonal_speed; // 0x20EC
+    int32_t focused_diagonal_speed; // 0x20F0
+};
+
+struct GameSide {
+    char gap0[4]; // 0x0
+    Player* player_ptr; // 0x4
+};
+
+struct CPUHitInf {
+    void* vftable; // 0x0
+    CPUCollider colliders1[30000]; // 0x4
+    CPUCollider colliders2[30000]; // 0x1B7744
+    int32_t collider_count; // 0x36EE84
+    Float3 pos; // 0x36EE88
+    char gap36EE94[52]; // 0x36EE94
+    GameSide* game_side_ptr; // 0x36EEC8
+    // 0x36EECC
+};
+
+// Inlining this function instead of using what the game has because of calling conventions
+inline bool line_segments_intersect_2d(
+    float a1, float a2,
+    float a3, float a4,
+    float a5, float a6,
+    float a7, float a8)
+{
+    float v19 = ((a1 - a3) * (a6 - a2)) + ((a2 - a4) * (a1 - a5));
+    float v13 = ((a1 - a3) * (a8 - a2)) + ((a2 - a4) * (a1 - a7));
+
+    if ((v13 * v19) <= 0.0) {
+        if (v19 != 0.0 || v13 != 0.0)
+            return ((((a4 - a6) * (a5 - a7)) + ((a5 - a3) * (a6 - a8))) * (((a5 - a1) * (a6 - a8)) + ((a2 - a6) * (a5 - a7)))) <= 0.0;
+        if (a1 > a3) {
+            std::swap(a1, a3);
+            std::swap(a2, a4);
+        }
+        if (a5 > a7) {
+            std::swap(a5, a7);
+            std::swap(a6, a8);
+        }
+        if (a7 >= a1 && a8 >= a2 && a3 >= a5 && a4 >= a6)
+            return 1;
+    }
+    return 0;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define A(m) m.m128_f32
+#else
+#define A(m) m
+#endif
+
+// Code written by Khangaroo (https://github.com/khang06)
+//
+// The 18 probe positions are kept in structure-of-arrays form and padded to
+// 20 lanes so that every collider is tested against all of them at once with
+// SSE. Lanes 18 and 19 duplicate probe 0, and are masked off at the end.
+// Any collider hitting a probe sets the same bit that the scalar loop would,
+// so the order in which colliders are visited does not affect the result.
+constexpr size_t CHECK_POS_COUNT = 18;
+constexpr size_t CHECK_POS_VECS = (CHECK_POS_COUNT + 3) / 4;
+constexpr uint32_t CHECK_POS_MASK = (1u << CHECK_POS_COUNT) - 1;
+
+struct alignas(16) CheckPosSoA {
+    float x[CHECK_POS_VECS * 4];
+    float y[CHECK_POS_VECS * 4];
+};
+
+static __forceinline bool is_nan_bits(float val)
+{
+    // Not using isnan because fast math is allowed to assume it always returns false
+    return (std::bit_cast<uint32_t>(val) & 0x7FFFFFFF) > 0x7F800000;
+}
+
+static __forceinline uint32_t hit_mask_circle(const CheckPosSoA& probes, const CPUCollider* collider, float radius_sq)
+{
+    __m128 total_dist = _mm_set1_ps((collider->radius * collider->radius) + radius_sq);
+    __m128 col_x = _mm_set1_ps(collider->pos.x);
+    __m128 col_y = _mm_set1_ps(collider->pos.y);
+
+    uint32_t mask = 0;
+    for (size_t k = 0; k < CHECK_POS_VECS; k++) {
+        __m128 x_diff = _mm_sub_ps(_mm_load_ps(&probes.x[k * 4]), col_x);
+        __m128 y_diff = _mm_sub_ps(_mm_load_ps(&probes.y[k * 4]), col_y);
+        __m128 dist = _mm_add_ps(_mm_mul_ps(y_diff, y_diff), _mm_mul_ps(x_diff, x_diff));
+        mask |= (uint32_t)_mm_movemask_ps(_mm_cmpgt_ps(total_dist, dist)) << (k * 4);
+    }
+    return mask;
+}
+
+static __forceinline uint32_t hit_mask_rect(const CheckPosSoA& probes, const CPUCollider* collider, float radius, float radius_sq)
+{
+    auto angle_sincos = sincos(-collider->angle);
+    float half_size_x = collider->size.x * 0.5f;
+    float half_size_y = collider->size.y * 0.5f;
+
+    __m128 sin_v = _mm_set1_ps(A(angle_sincos)[0]);
+    __m128 cos_v = _mm_set1_ps(A(angle_sincos)[1]);
+    __m128 col_x = _mm_set1_ps(collider->pos.x);
+    __m128 col_y = _mm_set1_ps(collider->pos.y);
+    __m128 hx = _mm_set1_ps(half_size_x);
+    __m128 hy = _mm_set1_ps(half_size_y);
+    __m128 hx_r = _mm_set1_ps(half_size_x + radius);
+    __m128 hy_r = _mm_set1_ps(half_size_y + radius);
+    __m128 r_sq = _mm_set1_ps(radius_sq);
+    __m128 sign = _mm_set1_ps(-0.0f);
+
+    uint32_t mask = 0;
+    for (size_t k = 0; k < CHECK_POS_VECS; k++) {
+        __m128 x_diff = _mm_sub_ps(_mm_load_ps(&probes.x[k * 4]), col_x);
+        __m128 y_diff = _mm_sub_ps(_mm_load_ps(&probes.y[k * 4]), col_y);
+        __m128 rot_x = _mm_sub_ps(_mm_mul_ps(cos_v, x_diff), _mm_mul_ps(sin_v, y_diff));
+        __m128 rot_y = _mm_add_ps(_mm_mul_ps(cos_v, y_diff), _mm_mul_ps(sin_v, x_diff));
+        __m128 abs_x = _mm_andnot_ps(sign, rot_x);
+        __m128 abs_y = _mm_andnot_ps(sign, rot_y);
+
+        __m128 x1 = _mm_sub_ps(rot_x, hx);
+        __m128 x2 = _mm_add_ps(hx, rot_x);
+        __m128 y1 = _mm_sub_ps(rot_y, hy);
+        __m128 y2 = _mm_add_ps(hy, rot_y);
+        __m128 x_sq1 = _mm_mul_ps(x1, x1);
+        __m128 x_sq2 = _mm_mul_ps(x2, x2);
+        __m128 y_sq1 = _mm_mul_ps(y1, y1);
+        __m128 y_sq2 = _mm_mul_ps(y2, y2);
+
+        __m128 hit = _mm_or_ps(
+            _mm_and_ps(_mm_cmpge_ps(hx_r, abs_x), _mm_cmpge_ps(hy, abs_y)),
+            _mm_and_ps(_mm_cmpge_ps(hx, abs_x), _mm_cmpge_ps(hy_r, abs_y)));
+        hit = _mm_or_ps(hit, _mm_cmpgt_ps(r_sq, _mm_add_ps(x_sq1, y_sq1)));
+        hit = _mm_or_ps(hit, _mm_cmpgt_ps(r_sq, _mm_add_ps(x_sq2, y_sq1)));
+        hit = _mm_or_ps(hit, _mm_cmpgt_ps(r_sq, _mm_add_ps(x_sq1, y_sq2)));
+        hit = _mm_or_ps(hit, _mm_cmpgt_ps(r_sq, _mm_add_ps(x_sq2, y_sq2)));
+        mask |= (uint32_t)_mm_movemask_ps(hit) << (k * 4);
+    }
+    return mask;
+}
+
+__forceinline uint32_t* CPUHitInf_CheckColliders_impl(CPUHitInf* self, uint32_t* hit_flags_ptr, float radius)
+{
+    // Speeds are stored as fixed point with 7 fractional bits
+    __m128 temp = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)&self->game_side_ptr->player_ptr->unfocused_linear_speed)),
+        _mm_set1_ps(1.0f / 128.0f));
+    float unfocused_linear_px = A(temp)[0];
+    float focused_linear_px = A(temp)[1];
+    float unfocused_diagonal_px = A(temp)[2];
+    float focused_diagonal_px = A(temp)[3];
+
+    Float2 check_pos_list[CHECK_POS_COUNT];
+    for (size_t i = 0; i < elementsof(check_pos_list); i++)
+         check_pos_list[i] = Float2 { self->pos.x, self->pos.y };
+    // I don't feel like trying to make this more readable
+    check_pos_list[1].y = check_pos_list[1].y - unfocused_linear_px;
+    check_pos_list[2].y = check_pos_list[2].y + unfocused_linear_px;
+    check_pos_list[3].x = check_pos_list[3].x - unfocused_linear_px;
+    check_pos_list[4].x = check_pos_list[4].x + unfocused_linear_px;
+    check_pos_list[5].x = check_pos_list[5].x - unfocused_diagonal_px;
+    check_pos_list[5].y = check_pos_list[5].y - unfocused_diagonal_px;
+    check_pos_list[6].x = check_pos_list[6].x + unfocused_diagonal_px;
+    check_pos_list[6].y = check_pos_list[6].y - unfocused_diagonal_px;
+    check_pos_list[7].x = check_pos_list[7].x - unfocused_diagonal_px;
+    check_pos_list[7].y = check_pos_list[7].y + unfocused_diagonal_px;
+    check_pos_list[8].x = check_pos_list[8].x + unfocused_diagonal_px;
+    check_pos_list[8].y = check_pos_list[8].y + unfocused_diagonal_px;
+    check_pos_list[10].y = check_pos_list[10].y - focused_linear_px;
+    check_pos_list[11].y = check_pos_list[11].y + focused_linear_px;
+    check_pos_list[12].x = check_pos_list[12].x - focused_linear_px;
+    check_pos_list[13].x = check_pos_list[13].x + focused_linear_px;
+    check_pos_list[14].x = check_pos_list[14].x - focused_diagonal_px;
+    check_pos_list[14].y = check_pos_list[14].y - focused_diagonal_px;
+    check_pos_list[15].x = check_pos_list[15].x + focused_diagonal_px;
+    check_pos_list[15].y = check_pos_list[15].y - focused_diagonal_px;
+    check_pos_list[16].x = check_pos_list[16].x - focused_diagonal_px;
+    check_pos_list[16].y = check_pos_list[16].y + focused_diagonal_px;
+    check_pos_list[17].x = check_pos_list[17].x + focused_diagonal_px;
+    check_pos_list[17].y = check_pos_list[17].y + focused_diagonal_px;
+
+    // Clamping stays scalar: _mm_min_ps/_mm_max_ps treat NaN differently from std::clamp
+    CheckPosSoA probes;
+    for (size_t i = 0; i < elementsof(probes.x); i++) {
+        size_t src = i < CHECK_POS_COUNT ? i : 0;
+        probes.x[i] = std::clamp(check_pos_list[src].x, -140.0f, 140.0f);
+        probes.y[i] = std::clamp(check_pos_list[src].y, 32.0f, 448.0f - 16.0f);
+    }
+
+    // Broad phase: every probe lies within a few pixels of self->pos, so most
+    // colliders can be rejected by comparing them against the bounding box of
+    // the probes before paying for the narrow phase (and sincos).
+    //
+    // A probe that is NaN can never be hit, so it's left out of the box. NaN
+    // colliders and NaN radii can never hit either, so it doesn't matter which
+    // way the comparisons below go for them.
+    float box_min_x = FLT_MAX, box_max_x = -FLT_MAX;
+    float box_min_y = FLT_MAX, box_max_y = -FLT_MAX;
+    for (size_t i = 0; i < CHECK_POS_COUNT; i++) {
+        if (is_nan_bits(probes.x[i]) || is_nan_bits(probes.y[i]))
+            continue;
+        box_min_x = std::min(box_min_x, probes.x[i]);
+        box_max_x = std::max(box_max_x, probes.x[i]);
+        box_min_y = std::min(box_min_y, probes.y[i]);
+        box_max_y = std::max(box_max_y, probes.y[i]);
+    }
+
+    uint32_t hit_flags = 0;
+    float radius_sq = radius * radius;
+    float radius_abs = fabsf(radius);
+    for (int32_t i = 0; i < self->collider_count; i++) {
+        CPUCollider* collider = &self->colliders1[i];
+
+        // Upper bound on how far from its center a collider can register a hit.
+        // Circles: sqrt(r^2 + R^2) <= |r| + |R|. Rectangles: every hit condition
+        // implies |rot_x| + |rot_y| <= |w/2| + |h/2| + 2|R|, and rotating doesn't
+        // change the distance. The margin absorbs rounding in the narrow phase.
+        float reach = (collider->flags & 1)
+            ? fabsf(collider->radius) + radius_abs
+            : fabsf(collider->size.x * 0.5f) + fabsf(collider->size.y * 0.5f) + radius_abs * 2.0f;
+        reach += reach * (1.0f / 1024.0f) + 1.0f;
+        if (collider->pos.x < box_min_x - reach || collider->pos.x > box_max_x + reach
+            || collider->pos.y < box_min_y - reach || collider->pos.y > box_max_y + reach)
+            continue;
+
+        if (collider->flags & 1)
+            hit_flags |= hit_mask_circle(probes, collider, radius_sq);
+        else
+            hit_flags |= hit_mask_rect(probes, collider, radius, radius_sq);
+
+        // Once every probe has been hit, no further collider can change the result
+        if ((hit_flags & CHECK_POS_MASK) == CHECK_POS_MASK)
+            break;
+    }
+    *hit_flags_ptr = hit_flags & CHECK_POS_MASK;
+    return hit_flags_ptr;
+}
+// ---
+
+inline float angle_normalize(float angle)
+{
+    while (angle < -(ZUN_PI)) {
+        angle += (2 * ZUN_PI);
+    }
+    while (angle > (ZUN_PI)) {
+        angle -= (2 * ZUN_PI);
+    }
+    return angle;
+}
+
+static __forceinline __m128 select_ps(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// line_segments_intersect_2d for 4 segments (a1, a2)-(a3, a4) at once against a
+// single segment (a5, a6)-(a7, a8). Each lane evaluates the exact same
+// expressions as the scalar version, with the branches turned into masks.
+// Returns a 4 bit mask of which lanes intersect.
+static __forceinline int line_segments_intersect_2d_x4(
+    __m128 a1, __m128 a2,
+    __m128 a3, __m128 a4,
+    float a5_, float a6_,
+    float a7_, float a8_)
+{
+    __m128 a5 = _mm_set1_ps(a5_);
+    __m128 a6 = _mm_set1_ps(a6_);
+    __m128 a7 = _mm_set1_ps(a7_);
+    __m128 a8 = _mm_set1_ps(a8_);
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 d13 = _mm_sub_ps(a1, a3);
+    __m128 d24 = _mm_sub_ps(a2, a4);
+    __m128 v19 = _mm_add_ps(_mm_mul_ps(d13, _mm_sub_ps(a6, a2)), _mm_mul_ps(d24, _mm_sub_ps(a1, a5)));
+    __m128 v13 = _mm_add_ps(_mm_mul_ps(d13, _mm_sub_ps(a8, a2)), _mm_mul_ps(d24, _mm_sub_ps(a1, a7)));
+
+    __m128 straddles = _mm_cmple_ps(_mm_mul_ps(v13, v19), zero);
+    __m128 non_collinear = _mm_or_ps(_mm_cmpneq_ps(v19, zero), _mm_cmpneq_ps(v13, zero));
+
+    __m128 cross = _mm_mul_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(a4, a6), _mm_sub_ps(a5, a7)), _mm_mul_ps(_mm_sub_ps(a5, a3), _mm_sub_ps(a6, a8))),
+        _mm_add_ps(_mm_mul_ps(_mm_sub_ps(a5, a1), _mm_sub_ps(a6, a8)), _mm_mul_ps(_mm_sub_ps(a2, a6), _mm_sub_ps(a5, a7))));
+    __m128 hit = _mm_and_ps(non_collinear, _mm_cmple_ps(cross, zero));
+
+    // Collinear case: order both segments by x, then check that their bounding boxes overlap
+    if (a5_ > a7_) {
+        std::swap(a5, a7);
+        std::swap(a6, a8);
+    }
+    __m128 swap = _mm_cmpgt_ps(a1, a3);
+    __m128 lo_x = select_ps(swap, a3, a1);
+    __m128 lo_y = select_ps(swap, a4, a2);
+    __m128 hi_x = select_ps(swap, a1, a3);
+    __m128 hi_y = select_ps(swap, a2, a4);
+    __m128 overlap = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(a7, lo_x), _mm_cmpge_ps(a8, lo_y)),
+        _mm_and_ps(_mm_cmpge_ps(hi_x, a5), _mm_cmpge_ps(hi_y, a6)));
+    hit = _mm_or_ps(hit, _mm_andnot_ps(non_collinear, overlap));
+
+    return _mm_movemask_ps(_mm_and_ps(straddles, hit));
+}
+
+// The polygon is walked 4 edges at a time. The angles are still stepped and
+// normalized one by one, and sincos is still called once per vertex, because
+// the result has to match the game bit for bit: a rotation recurrence would
+// drift from ZUN's values and desync replays. What is batched is everything
+// after that, building the vertices of 4 edges and testing them with a single
+// call to line_segments_intersect_2d_x4.
+//
+// Edge i goes from vertex i to vertex i + 1, both at radius a8 for even edges
+// and a9 for odd ones, so with the sines and cosines of 5 consecutive vertices
+// in an array, the start and end points of 4 edges are 2 overlapping loads.
+__forceinline bool _RxD1E00_fast_impl (
+    int a1,
+    float a2, float a3, float a4, float a5,
+    float a6, float a7, float a8, float a9,
+    float a10)
+{
+    __m128 sincos_a10 = sincos(a10);
+
+    __m128 radius = _mm_setr_ps(a8, a9, a8, a9);
+    __m128 center_x = _mm_set1_ps(a6);
+    __m128 center_y = _mm_set1_ps(a7);
+
+    int edge_count = a1 * 2;
+    for (int base = 0; base < edge_count; base += 4) {
+        // Zeroed, since a group of 2 leaves the last 2 unset
+        alignas(16) float sin_v[5] = {}, cos_v[5] = {};
+        sin_v[0] = A(sincos_a10)[0];
+        cos_v[0] = A(sincos_a10)[1];
+
+        // The edge count is even, so a group has either 2 or 4 edges
+        int group = std::min(edge_count - base, 4);
+        for (int l = 1; l <= group; ++l) {
+            a10 = angle_normalize(a10 + ZUN_PI / a1);
+            sincos_a10 = sincos(a10);
+            sin_v[l] = A(sincos_a10)[0];
+            cos_v[l] = A(sincos_a10)[1];
+        }
+
+        __m128 sin1 = _mm_load_ps(sin_v);
+        __m128 cos1 = _mm_load_ps(cos_v);
+        __m128 sin2 = _mm_loadu_ps(sin_v + 1);
+        __m128 cos2 = _mm_loadu_ps(cos_v + 1);
+        if (group == 2) {
+            // Repeat the 2 edges in the upper lanes, where they keep their radius
+            sin1 = _mm_movelh_ps(sin1, sin1);
+            cos1 = _mm_movelh_ps(cos1, cos1);
+            sin2 = _mm_movelh_ps(sin2, sin2);
+            cos2 = _mm_movelh_ps(cos2, cos2);
+        }
+
+        if (line_segments_intersect_2d_x4(
+            _mm_add_ps(_mm_mul_ps(cos1, radius), center_x), _mm_add_ps(_mm_mul_ps(sin1, radius), center_y),
+            _mm_add_ps(_mm_mul_ps(cos2, radius), center_x), _mm_add_ps(_mm_mul_ps(sin2, radius), center_y),
+            a2, a3, a4, a5)) {
+                return true;
+            }
+    }
+    return false;
+}
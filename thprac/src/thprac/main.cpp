@@ -58,11 +58,9 @@ bool DetectGame(const wchar_t* const exe, THGameSig** sigIn) {
         return false;
     }
 
-    for (auto& sig : gGameDefs) {
-        if (sig.exeSig.textSize == exeSig.textSize && sig.exeSig.timeStamp == exeSig.timeStamp) {
-            *sigIn = &sig;
-            return true;
-        }
+    if (auto sig = FindGameDefByHeader(exeSig)) {
+        *sigIn = sig;
+        return true;
     }
 
     return false;
@@ -187,11 +185,11 @@ int WINAPI wWinMain(
         if (!Gui::LocaleInitFromCfg()) {
             Gui::LocaleAutoSet();
         }
-        LauncherSettingGet("existing_game_launch_action", launchBehavior);
-        LauncherSettingGet("dont_search_ongoing_game", dontFindOngoingGame);
-        LauncherSettingGet("thprac_admin_rights", adminRights);
-        LauncherSettingGet("check_update_timing", checkUpdateWhen);
-        LauncherSettingGet("update_without_confirmation", autoUpdate);
+        launchBehavior = LauncherSettingGet(SETTING_EXISTING_GAME_LAUNCH_ACTION);
+        dontFindOngoingGame = LauncherSettingGet(SETTING_DONT_SEARCH_ONGOING_GAME);
+        adminRights = LauncherSettingGet(SETTING_THPRAC_ADMIN_RIGHTS);
+        checkUpdateWhen = LauncherSettingGet(SETTING_CHECK_UPDATE_TIMING);
+        autoUpdate = LauncherSettingGet(SETTING_UPDATE_WITHOUT_CONFIRMATION);
         LauncherCfgClose();
     }
 
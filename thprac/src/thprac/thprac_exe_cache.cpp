@@ -0,0 +1,240 @@
+#include "thprac_exe_cache.h"
+#include "thprac_launcher_cfg.h"
+#include "thprac_utils.h"
+#include "thprac_version.h"
+#include <Windows.h>
+#include <metrohash128.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace THPrac {
+
+constexpr uint32_t EXE_CACHE_MAGIC = 0x43455054; // "TPEC"
+constexpr uint32_t EXE_CACHE_FORMAT = 1;
+constexpr size_t EXE_CACHE_MAX_ENTRIES = 8192;
+constexpr size_t EXE_CACHE_MAX_PATH = 32767;
+// A hit only updates lastUsed on disk if it's older than this, so launching a
+// game doesn't rewrite the cache every time
+constexpr uint64_t EXE_CACHE_TOUCH_INTERVAL = 24ull * 60 * 60 * 10000000;
+
+// Everything after the header is covered by checksum. Records are followed by
+// pathLen wchar_ts of path, so they're read and written with memcpy.
+struct ExeCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    int32_t version[4];
+    uint32_t sigSize;
+    uint32_t count;
+    uint32_t checksum[4];
+};
+
+struct ExeCacheRecord {
+    uint64_t fileSize;
+    uint64_t writeTime;
+    uint64_t fileIndex;
+    uint64_t lastUsed;
+    uint32_t volumeSerial;
+    uint32_t pathLen;
+    ExeSig sig;
+};
+
+struct ExeCacheEntry {
+    uint64_t fileSize;
+    uint64_t writeTime;
+    uint64_t fileIndex;
+    uint64_t lastUsed;
+    uint32_t volumeSerial;
+    ExeSig sig;
+};
+
+static std::mutex gExeCacheLock;
+static std::unordered_map<std::wstring, ExeCacheEntry> gExeCache;
+static bool gExeCacheLoaded = false;
+static bool gExeCacheDirty = false;
+
+static std::wstring ExeCachePath()
+{
+    auto dir = LauncherGetDataDir();
+    return dir.empty() ? dir : dir + L"exe_cache.bin";
+}
+
+static bool ExeCacheHeaderMatches(const ExeCacheHeader& header)
+{
+    auto version = GetVersionInt();
+    return header.magic == EXE_CACHE_MAGIC && header.format == EXE_CACHE_FORMAT
+        && header.sigSize == sizeof(ExeSig) && std::equal(version, version + 4, header.version);
+}
+
+// Anything that doesn't look exactly right throws the whole file away
+static void ExeCacheLoad()
+{
+    gExeCacheLoaded = true;
+    auto path = ExeCachePath();
+    if (path.empty())
+        return;
+    MappedFile file(path.c_str());
+    if (!file.fileMapView)
+        return;
+
+    auto data = (const uint8_t*)file.fileMapView;
+    size_t size = file.fileSize;
+    ExeCacheHeader header;
+    if (size < sizeof(header))
+        return;
+    memcpy(&header, data, sizeof(header));
+    if (!ExeCacheHeaderMatches(header) || header.count > EXE_CACHE_MAX_ENTRIES)
+        return;
+
+    uint32_t checksum[4];
+    MetroHash128::Hash(data + sizeof(header), size - sizeof(header), (uint8_t*)checksum);
+    if (memcmp(checksum, header.checksum, sizeof(checksum)))
+        return;
+
+    std::unordered_map<std::wstring, ExeCacheEntry> entries;
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.count; i++) {
+        ExeCacheRecord record;
+        if (size - offset < sizeof(record))
+            return;
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        size_t pathBytes = (size_t)record.pathLen * sizeof(wchar_t);
+        if (!record.pathLen || record.pathLen > EXE_CACHE_MAX_PATH || size - offset < pathBytes)
+            return;
+        std::wstring entryPath(record.pathLen, L'\0');
+        memcpy(entryPath.data(), data + offset, pathBytes);
+        offset += pathBytes;
+
+        entries[std::move(entryPath)] = { record.fileSize, record.writeTime, record.fileIndex, record.lastUsed, record.volumeSerial, record.sig };
+    }
+    if (offset != size)
+        return;
+
+    gExeCache = std::move(entries);
+}
+
+static uint64_t ExeCacheNow()
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    return ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+}
+
+bool ExeCacheGet(const wchar_t* path, ExeSig& exeSigOut, const std::function<bool(ExeSig&)>& compute)
+{
+    // No access rights needed to read the file's identity, so this works even
+    // while the game is running
+    HANDLE hFile = CreateFileW(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL hasInfo = GetFileInformationByHandle(hFile, &info);
+    CloseHandle(hFile);
+    if (!hasInfo)
+        return false;
+
+    DWORD fullLen = GetFullPathNameW(path, 0, nullptr, nullptr);
+    if (!fullLen)
+        return false;
+    std::wstring fullPath(fullLen, L'\0');
+    fullLen = GetFullPathNameW(path, fullLen, fullPath.data(), nullptr);
+    fullPath.resize(fullLen);
+    auto key = GetUnifiedPath(fullPath);
+
+    ExeCacheEntry entry;
+    entry.fileSize = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    entry.writeTime = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+    entry.fileIndex = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    entry.volumeSerial = info.dwVolumeSerialNumber;
+    entry.lastUsed = ExeCacheNow();
+
+    {
+        std::lock_guard<std::mutex> lock(gExeCacheLock);
+        if (!gExeCacheLoaded)
+            ExeCacheLoad();
+        auto it = gExeCache.find(key);
+        if (it != gExeCache.end()) {
+            auto& cached = it->second;
+            if (cached.fileSize == entry.fileSize && cached.writeTime == entry.writeTime
+                && cached.fileIndex == entry.fileIndex && cached.volumeSerial == entry.volumeSerial) {
+                if (entry.lastUsed - cached.lastUsed > EXE_CACHE_TOUCH_INTERVAL) {
+                    cached.lastUsed = entry.lastUsed;
+                    gExeCacheDirty = true;
+                }
+                exeSigOut = cached.sig;
+                return true;
+            }
+        }
+    }
+
+    if (!compute(entry.sig))
+        return false;
+    exeSigOut = entry.sig;
+
+    std::lock_guard<std::mutex> lock(gExeCacheLock);
+    gExeCache[std::move(key)] = entry;
+    gExeCacheDirty = true;
+    return true;
+}
+
+// Written to a temporary file first, so a crash halfway never leaves a
+// truncated cache behind
+void ExeCacheFlush()
+{
+    std::lock_guard<std::mutex> lock(gExeCacheLock);
+    if (!gExeCacheDirty)
+        return;
+    auto path = ExeCachePath();
+    if (path.empty())
+        return;
+
+    if (gExeCache.size() > EXE_CACHE_MAX_ENTRIES) {
+        std::vector<uint64_t> lastUsed;
+        for (auto& it : gExeCache)
+            lastUsed.push_back(it.second.lastUsed);
+        std::nth_element(lastUsed.begin(), lastUsed.begin() + (EXE_CACHE_MAX_ENTRIES - 1), lastUsed.end(), std::greater<uint64_t>());
+        uint64_t cutoff = lastUsed[EXE_CACHE_MAX_ENTRIES - 1];
+        std::erase_if(gExeCache, [&](auto& it) { return it.second.lastUsed < cutoff; });
+    }
+
+    ExeCacheHeader header = {};
+    header.magic = EXE_CACHE_MAGIC;
+    header.format = EXE_CACHE_FORMAT;
+    std::copy(GetVersionInt(), GetVersionInt() + 4, header.version);
+    header.sigSize = sizeof(ExeSig);
+
+    std::vector<uint8_t> buffer(sizeof(header));
+    for (auto& [entryPath, entry] : gExeCache) {
+        if (header.count == EXE_CACHE_MAX_ENTRIES || entryPath.size() > EXE_CACHE_MAX_PATH)
+            continue;
+        ExeCacheRecord record = { entry.fileSize, entry.writeTime, entry.fileIndex, entry.lastUsed, entry.volumeSerial, (uint32_t)entryPath.size(), entry.sig };
+        size_t offset = buffer.size();
+        size_t pathBytes = entryPath.size() * sizeof(wchar_t);
+        buffer.resize(offset + sizeof(record) + pathBytes);
+        memcpy(buffer.data() + offset, &record, sizeof(record));
+        memcpy(buffer.data() + offset + sizeof(record), entryPath.data(), pathBytes);
+        header.count++;
+    }
+    MetroHash128::Hash(buffer.data() + sizeof(header), buffer.size() - sizeof(header), (uint8_t*)header.checksum);
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    CreateDirectoryW(LauncherGetDataDir().c_str(), nullptr);
+    auto tmpPath = path + L".tmp";
+    HANDLE hFile = CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return;
+    DWORD bytesProcessed;
+    BOOL written = WriteFile(hFile, buffer.data(), (DWORD)buffer.size(), &bytesProcessed, nullptr) && bytesProcessed == buffer.size();
+    CloseHandle(hFile);
+    if (!written || !MoveFileExW(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tmpPath.c_str());
+        return;
+    }
+    gExeCacheDirty = false;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "thprac_launcher_games_def.h"
+#include <functional>
+
+namespace THPrac {
+
+// Persistent cache of executable signatures, kept in exe_cache.bin next to
+// thprac.json. Entries are keyed by the normalized full path, and are only used
+// while the file's size, last write time and file ID are unchanged. The whole
+// cache is dropped when thprac's version changes, since a new version can add
+// game definitions that would have been hashed differently by the scan.
+
+// Fills exeSigOut from the cache. On a miss, calls compute to fill it in
+// instead and remembers the result if compute returned true. Returns false if
+// the file couldn't be opened or compute failed. Thread safe, and compute is
+// called without holding any lock.
+bool ExeCacheGet(const wchar_t* path, ExeSig& exeSigOut, const std::function<bool(ExeSig&)>& compute);
+
+// Writes the cache back to disk if anything changed since it was loaded
+void ExeCacheFlush();
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "utils/pe_view.h"
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace THPrac {
+
+struct ExeSig {
+    uint32_t timeStamp;
+    uint32_t textSize;
+    uint32_t oepCode[10];
+    uint32_t metroHash[4];
+};
+
+// Everything but the hash, which only touches the headers and the entry point
+inline void GetExeHeaderInfo(const PeView& pe, ExeSig& exeSigOut)
+{
+    auto ntHeader = pe.nt();
+
+    exeSigOut.timeStamp = ntHeader->FileHeader.TimeDateStamp;
+    exeSigOut.textSize = 0;
+    for (auto& codeBlock : exeSigOut.oepCode) {
+        codeBlock = 0;
+    }
+    for (auto& hashBlock : exeSigOut.metroHash) {
+        hashBlock = 0;
+    }
+
+    for (auto& section : pe.sections()) {
+        if (PeView::SectionNameIs(section, ".text")) {
+            exeSigOut.textSize = section.SizeOfRawData;
+        }
+        DWORD pOepCode = ntHeader->OptionalHeader.AddressOfEntryPoint;
+        if (pOepCode >= section.VirtualAddress && pOepCode <= (section.VirtualAddress + section.Misc.VirtualSize)) {
+            pOepCode -= section.VirtualAddress;
+            pOepCode += section.PointerToRawData;
+
+            auto oepCode = pe.At<uint16_t>(pOepCode, 10);
+            if (!oepCode)
+                continue;
+
+            for (unsigned int j = 0; j < 10; ++j) {
+                exeSigOut.oepCode[j] = (uint32_t) * (oepCode + j);
+                exeSigOut.oepCode[j] ^= (j + 0x41) | ((j + 0x41) << 8);
+            }
+        }
+    }
+}
+
+// Binary search over (key, entry) pairs. If two definitions share a key, the
+// first one listed wins, and the other can't be found through the table.
+template <typename T, typename Key, size_t N>
+struct SigTable {
+    std::pair<Key, T*> entries[N];
+
+    template <typename KeyOf>
+    void Build(T (&defs)[N], KeyOf keyOf)
+    {
+        for (size_t i = 0; i < N; i++) {
+            entries[i] = { keyOf(defs[i]), &defs[i] };
+        }
+        std::stable_sort(entries, entries + N, [](auto& a, auto& b) { return a.first < b.first; });
+    }
+    T* Find(const Key& key) const
+    {
+        auto it = std::lower_bound(entries, entries + N, key, [](auto& entry, const Key& k) { return entry.first < k; });
+        return it != entries + N && it->first == key ? it->second : nullptr;
+    }
+    bool Unique() const
+    {
+        return std::adjacent_find(entries, entries + N, [](auto& a, auto& b) { return a.first == b.first; }) == entries + N;
+    }
+};
+inline uint64_t HeaderKey(const ExeSig& exeSig)
+{
+    return ((uint64_t)exeSig.timeStamp << 32) | exeSig.textSize;
+}
+inline std::array<uint32_t, 4> HashKey(const uint32_t (&hash)[4])
+{
+    return { hash[0], hash[1], hash[2], hash[3] };
+}
+
+}
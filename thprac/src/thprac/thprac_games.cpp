@@ -3,6 +3,7 @@
 #include "thprac_launcher_main.h"
 #include "thprac_licence.h"
 #include "thprac_load_exe.h"
+#include "thprac_replay.h"
 #include "thprac_gui_impl_dx8.h"
 #include "thprac_gui_impl_dx9.h"
 #include "thprac_utils.h"
@@ -268,8 +269,7 @@ void GameGuiInit(game_gui_impl impl, int device, int hwnd_addr,
     }
 
     if (LauncherCfgInit(true)) {
-        bool resizable_window;
-        if (LauncherSettingGet("resizable_window", resizable_window) && resizable_window && !Gui::ImplWin32CheckFullScreen()) {
+        if (LauncherSettingGet(SETTING_RESIZABLE_WINDOW) && !Gui::ImplWin32CheckFullScreen()) {
             RECT wndRect;
             GetClientRect(*(HWND*)hwnd_addr, &wndRect);
             auto frameSize = GetSystemMetrics(SM_CXSIZEFRAME) * 2;
@@ -280,11 +280,10 @@ void GameGuiInit(game_gui_impl impl, int device, int hwnd_addr,
                 0, 0, wndRect.right + frameSize, wndRect.bottom + frameSize + captionSize,
                 SWP_NOMOVE | SWP_NOZORDER | SWP_FRAMECHANGED);
         }
-        int theme;
-        if (LauncherSettingGet("theme", theme)) {
-            const char* userThemeName;
-            if (LauncherSettingGet("theme_user", userThemeName))
-                SetTheme(theme, utf8_to_utf16(userThemeName).c_str());
+        if (LauncherSettingIsSet(SETTING_THEME)) {
+            int theme = LauncherSettingGet(SETTING_THEME);
+            if (LauncherSettingIsSet(SETTING_THEME_USER))
+                SetTheme(theme, utf8_to_utf16(LauncherSettingGet(SETTING_THEME_USER).c_str()).c_str());
             else
                 SetTheme(theme);
         } else
@@ -682,6 +681,18 @@ bool ReplaySaveParam(const wchar_t* rep_path, const std::string& param)
     DWORD repMagic = 0, bytesRead = 0;
     if ((SetFilePointer(repFile, 0, nullptr, FILE_BEGIN) != INVALID_SET_FILE_POINTER) && (ReadFile(repFile, &repMagic, sizeof(LONG), &bytesRead, nullptr))) {
         if (repMagic == 'PR6T' || repMagic == 'PR7T') {
+            auto& fmt = repMagic == 'PR6T' ? REPLAY_PR6T_FORMAT : REPLAY_PR7T_FORMAT;
+
+            // The checksum is a plain sum, so only the header and the appended
+            // bytes are needed to update it, not the whole replay
+            uint8_t header[16];
+            auto repSize = GetFileSize(repFile, nullptr);
+            if (repSize == INVALID_FILE_SIZE || repSize < fmt.crypt_start)
+                return false;
+            SetFilePointer(repFile, 0, nullptr, FILE_BEGIN);
+            if (!ReadFile(repFile, header, fmt.crypt_start, &bytesRead, nullptr) || bytesRead != fmt.crypt_start)
+                return false;
+
             auto paramSize = param.size();
             for (paramSize++; paramSize % 4; paramSize++)
                 ;
@@ -695,31 +706,13 @@ bool ReplaySaveParam(const wchar_t* rep_path, const std::string& param)
             *(int32_t*)((int)paramBuf + paramSize + 4) = 'CARP';
 
             SetFilePointer(repFile, 0, nullptr, FILE_END);
-            WriteFile(repFile, paramBuf, paramSize + 8, &bytesRead, nullptr);
-
-            // Recalculate checksum
-            auto repSize = GetFileSize(repFile, nullptr);
-            uint8_t* repBuf = (uint8_t*)malloc(repSize - (repMagic == 'PR6T' ? 14 : 13));
-            if (!repBuf)
+            if (!WriteFile(repFile, paramBuf, paramSize + 8, &bytesRead, nullptr) || bytesRead != paramSize + 8)
                 return false;
-            defer(free(repBuf));
-            SetFilePointer(repFile, repMagic == 'PR6T' ? 14 : 13, nullptr, FILE_BEGIN);
-            if (!ReadFile(repFile, repBuf, repSize - (repMagic == 'PR6T' ? 14 : 13), &bytesRead, nullptr))
-                return false;
-
-            uint8_t key = *repBuf;
-            auto decBuf = repBuf + (repMagic == 'PR6T' ? 1 : 3);
-            for (DWORD i = 0; i < repSize - (repMagic == 'PR6T' ? 15 : 16); i++, decBuf++) {
-                *decBuf -= key;
-                key += 7;
-            }
 
-            DWORD checksum = 0x3F000318;
-            decBuf = repBuf;
-            for (DWORD i = 0; i < repSize - (repMagic == 'PR6T' ? 14 : 13); i++, decBuf++)
-                checksum += *decBuf;
+            DWORD checksum = *(DWORD*)(header + REPLAY_LEGACY_CHECKSUM_OFFSET);
+            checksum = ReplayLegacyChecksumAdd(checksum, header[fmt.sum_start], repSize, (uint8_t*)paramBuf, paramSize + 8, fmt);
 
-            SetFilePointer(repFile, 8, nullptr, FILE_BEGIN);
+            SetFilePointer(repFile, REPLAY_LEGACY_CHECKSUM_OFFSET, nullptr, FILE_BEGIN);
             WriteFile(repFile, &checksum, 4, &bytesRead, nullptr);
         } else {
             auto paramSize = param.size() + 12;
@@ -744,71 +737,14 @@ bool ReplaySaveParam(const wchar_t* rep_path, const std::string& param)
 
 bool ReplayLoadParam(const wchar_t* rep_path, std::string& param)
 {
-    DWORD repMagic = 0, bytesRead = 0;
-
-    auto repFile = CreateFileW(rep_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (repFile == INVALID_HANDLE_VALUE)
+    MappedFile file(rep_path);
+    if (!file.fileMapView)
         return false;
-    defer(CloseHandle(repFile));
-
-    SetFilePointer(repFile, 0, nullptr, FILE_BEGIN);
-    if (ReadFile(repFile, &repMagic, 4, &bytesRead, nullptr) && bytesRead == 4) {
-        if (repMagic == 'PR6T' || repMagic == 'PR7T') {
-            DWORD magic = 0, paramLength = 0;
-            DWORD repSize = GetFileSize(repFile, nullptr);
-
-            SetFilePointer(repFile, -4, nullptr, FILE_END);
-            if (ReadFile(repFile, &magic, 4, &bytesRead, nullptr) && bytesRead == 4 && magic == 'CARP') {
-                SetFilePointer(repFile, -8, nullptr, FILE_CURRENT);
-                if (!ReadFile(repFile, &paramLength, 4, &bytesRead, nullptr))
-                    return false;
-
-                if (bytesRead == 4 && paramLength > 0 && paramLength < repSize && paramLength < 512) {
-                    SetFilePointer(repFile, ~paramLength - 3, nullptr, FILE_CURRENT);
-                    char* buf = (char*)malloc(paramLength + 1);
-                    if (!buf)
-                        return false;
-                    defer(free(buf));
-                    memset(buf, 0, paramLength + 1);
-
-                    if (ReadFile(repFile, buf, paramLength, &bytesRead, nullptr) && bytesRead == paramLength)
-                        param = std::string(buf, paramLength);
-
-                    return (bytesRead == paramLength);
-                }
-            }
-        } else {
-            DWORD userPtr = 0, userMagic = 0, userLength = 0, userNo = 0;
-
-            SetFilePointer(repFile, 12, nullptr, FILE_BEGIN);
-            if (ReadFile(repFile, &userPtr, 4, &bytesRead, nullptr) && bytesRead == 4) {
-                SetFilePointer(repFile, userPtr, nullptr, FILE_BEGIN);
-                while (true) {
-                    if (!ReadFile(repFile, &userMagic, 4, &bytesRead, nullptr) || bytesRead != 4 || userMagic != 'RESU')
-                        break;
-                    if (!ReadFile(repFile, &userLength, 4, &bytesRead, nullptr) || bytesRead != 4)
-                        break;
-                    if (!ReadFile(repFile, &userNo, 4, &bytesRead, nullptr) || bytesRead != 4)
-                        break;
-
-                    if (userNo == 'CARP') {
-                        char* buf = (char*)malloc(userLength - 12 + 1);
-                        if (!buf)
-                            break;
-                        defer(free(buf));
-                        memset(buf, 0, userLength - 12 + 1);
-                        if (ReadFile(repFile, buf, userLength - 12, &bytesRead, nullptr) && bytesRead == userLength - 12)
-                            param = std::string((char*)buf, userLength - 12 + 1);
-
-                        return (bytesRead == userLength - 12);
-                    } else {
-                        SetFilePointer(repFile, userLength - 12, nullptr, FILE_CURRENT);
-                    }
-                }
-            }
-        }
-    }
-    return false;
+    auto view = ReplayFindParam((const uint8_t*)file.fileMapView, file.fileSize);
+    if (view.empty())
+        return false;
+    param.assign(view);
+    return true;
 }
 
 #pragma endregion
@@ -476,18 +476,11 @@ namespace THPrac
             if (use_widget)
                 flag |= OnWidgetUpdate();
 
-            if (flag) {
+            // If the hooks couldn't be written, the hotkey stays as it was
+            if (flag && ApplyHookSlice(mHooks, !mStatus))
                 mStatus = !mStatus;
-                if (mStatus) {
-                    for (size_t i = 0; i < mHooks.len; i++) {
-                        mHooks.ptr[i].Enable();
-                    }
-                } else {
-                    for (size_t i = 0; i < mHooks.len; i++) {
-                        mHooks.ptr[i].Disable();
-                    }
-                }
-            }       
+            else
+                flag = false;
 
             return flag;
         }
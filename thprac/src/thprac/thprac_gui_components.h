@@ -443,10 +443,10 @@ namespace Gui {
         bool operator()() {
             return (*this)(-1);
         }
-        template <typename T>
-        bool operator()(th_glossary_t new_label_ref, T* selector, const char** items = LocaleGetCurrentGlossary())
+        template <typename T, typename Items = LocaleTable>
+        bool operator()(th_glossary_t new_label_ref, T* selector, Items items = LocaleGetCurrentGlossary())
         {
-            if (selector == nullptr || items == nullptr)
+            if (selector == nullptr || !items)
                 return false;
 
             CheckComboItemNew(selector, items, 1);
@@ -494,8 +494,8 @@ namespace Gui {
 
         int mCurrent = 0;
 
-        template <typename T>
-        inline void CheckComboItemNew(T* selector, const char** items, int nav)
+        template <typename T, typename Items>
+        inline void CheckComboItemNew(T* selector, const Items& items, int nav)
         {
             const int origin = mCurrent;
             while (true) {
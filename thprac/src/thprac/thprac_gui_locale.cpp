@@ -8,116 +8,9 @@
 
 namespace THPrac {
 namespace Gui {
-#pragma region Japanese Glyph Range
-static const short offsetsFrom0x4E00[] =
-{
-	-1,0,1,3,0,0,0,0,1,0,1,0,2,1,1,0,4,2,4,3,2,4,5,0,1,0,6,0,0,2,2,1,0,0,6,0,0,0,3,0,0,17,1,10,1,1,3,1,0,1,0,1,2,0,1,0,2,0,1,0,1,2,0,1,
-	0,0,1,2,0,0,0,4,6,0,4,0,2,1,0,2,0,1,1,4,0,0,0,0,0,3,0,0,3,0,0,7,0,1,1,3,4,5,7,0,2,0,0,0,0,8,1,0,17,0,3,1,1,1,1,0,5,2,0,5,0,0,0,0,
-	1,1,1,1,0,0,0,0,0,10,5,0,2,1,0,4,0,2,3,2,1,2,1,1,1,6,2,1,2,0,9,1,0,0,5,0,8,2,0,0,5,3,0,0,0,5,0,1,0,1,1,0,0,1,0,0,8,0,3,1,2,1,10,0,
-	2,1,1,4,1,1,1,0,0,1,2,1,1,0,0,0,1,0,0,0,1,8,2,9,3,0,0,5,3,1,0,3,1,8,6,5,1,0,0,1,4,2,4,7,3,6,0,0,17,0,4,0,0,0,1,6,3,2,4,2,1,1,3,4,
-	8,1,1,5,0,6,3,1,4,0,0,1,13,1,0,2,1,3,0,1,8,7,4,2,0,0,2,0,0,1,0,0,0,0,0,0,1,0,0,0,1,3,5,1,5,2,2,1,0,0,0,3,3,0,0,0,3,3,1,2,0,2,0,1,
-	0,1,1,0,2,0,0,1,6,1,1,0,0,1,1,1,3,0,0,1,0,0,0,5,6,1,2,0,0,0,0,13,0,0,2,0,4,0,1,0,2,2,0,4,1,0,0,2,0,1,2,2,0,0,1,3,2,0,3,0,5,6,0,3,
-	0,3,1,2,2,0,0,0,0,0,7,0,2,2,0,0,0,6,0,0,0,3,1,5,0,0,4,4,0,1,0,0,0,7,1,3,3,0,4,4,0,7,3,0,2,5,0,0,5,2,4,4,2,1,1,1,1,8,2,2,0,3,0,0,
-	2,1,1,0,10,7,3,0,1,0,2,0,1,4,1,0,4,0,0,1,0,1,3,0,1,6,6,6,0,0,0,3,0,0,1,1,0,0,0,0,0,2,3,0,0,0,2,0,1,1,3,5,2,4,0,0,0,1,0,0,2,6,2,1,
-	17,1,1,4,0,4,0,1,0,3,4,0,0,6,6,0,4,0,0,0,0,0,0,5,1,0,1,1,3,1,0,0,0,0,3,0,0,0,0,0,0,0,0,0,0,2,0,0,1,6,1,0,3,0,0,0,0,0,0,0,0,0,9,1,
-	0,0,0,5,4,0,0,0,7,1,0,1,0,0,0,3,3,1,0,0,2,0,2,13,8,1,6,1,1,0,0,3,0,0,2,3,1,5,1,3,3,5,7,0,2,2,0,5,0,4,4,2,0,2,2,0,0,23,3,2,0,3,0,3,
-	7,9,1,0,6,1,5,24,1,1,4,5,1,3,1,8,3,2,5,1,4,23,0,1,1,2,0,2,1,0,0,12,0,0,1,0,0,0,7,0,0,0,0,0,1,1,5,13,0,1,1,10,5,1,2,3,0,4,15,3,0,7,1,0,
-	10,1,0,0,2,13,5,1,0,1,1,1,8,0,9,1,4,7,8,3,1,0,0,2,4,3,1,5,5,0,2,4,4,4,6,1,2,6,1,13,3,0,0,0,4,0,0,6,1,3,2,0,2,1,2,10,1,1,0,5,0,2,2,2,
-	0,6,3,2,0,1,0,1,6,7,0,4,2,15,1,2,1,2,3,0,0,0,15,2,1,2,0,12,10,8,7,8,3,1,0,0,30,2,4,2,3,0,0,7,2,0,19,0,1,1,0,1,3,1,2,0,3,0,9,3,3,3,2,5,
-	4,0,0,2,0,4,5,0,8,1,4,0,1,2,2,3,2,2,4,1,9,3,4,4,15,3,4,0,1,8,0,9,6,0,2,2,3,1,2,1,1,2,3,6,2,11,0,1,1,0,0,4,1,0,0,0,0,11,0,4,4,0,0,2,
-	0,1,5,2,1,1,0,0,1,0,2,5,6,5,2,0,0,4,0,0,0,2,0,1,2,5,1,2,1,0,1,3,4,0,3,4,3,0,0,0,5,2,5,2,2,9,1,2,3,12,1,2,7,2,1,4,0,1,0,4,2,8,0,0,
-	2,0,15,3,1,1,13,6,3,2,0,4,3,5,5,0,5,3,0,4,2,16,7,3,3,1,18,18,7,0,23,8,0,0,2,0,6,1,0,9,0,9,1,2,2,11,19,1,0,21,2,4,1,3,1,3,7,1,0,1,12,0,2,0,
-	1,0,1,1,0,1,3,0,1,2,1,4,2,1,2,1,2,2,4,1,0,0,1,0,0,1,5,1,0,0,0,0,0,0,1,2,0,0,0,0,7,1,2,0,0,0,1,0,5,2,0,0,0,0,0,4,3,1,0,0,6,1,0,0,
-	1,3,0,0,0,0,1,2,4,1,0,1,1,3,0,1,0,1,1,0,0,0,0,0,2,0,1,4,3,5,1,1,3,4,3,6,0,0,0,0,0,0,0,0,0,3,0,1,1,0,1,0,0,1,1,1,8,1,0,0,1,0,2,3,
-	2,1,7,18,3,16,6,0,2,6,4,32,6,0,6,4,1,0,5,4,1,9,6,7,0,3,13,34,3,24,2,2,20,2,3,34,11,1,0,11,1,0,0,5,2,4,1,0,2,1,1,0,0,0,2,2,2,0,0,0,0,1,3,1,
-	0,3,0,2,5,4,4,2,0,0,1,7,5,1,1,0,2,2,0,0,4,2,3,0,1,4,7,0,9,1,0,0,14,0,0,1,1,0,0,0,0,0,0,0,1,1,0,2,2,4,5,0,0,2,1,3,5,0,3,1,7,0,0,0,
-	8,0,0,4,0,0,4,0,2,6,4,0,1,0,4,0,2,7,1,0,2,0,0,2,1,2,4,0,0,0,2,0,0,1,0,0,0,0,0,2,3,5,0,0,1,3,1,1,3,1,4,0,0,11,1,1,2,1,3,1,3,3,0,3,
-	2,1,0,0,2,0,1,3,1,2,2,0,0,2,0,1,0,0,0,0,0,3,1,0,3,0,0,2,1,2,6,0,0,2,0,4,0,4,3,5,0,0,3,2,0,8,0,0,0,2,0,2,10,4,4,2,2,1,1,15,2,3,2,2,
-	0,2,0,3,1,0,0,0,0,3,1,8,8,7,1,2,1,2,3,0,4,2,0,0,0,2,0,0,0,0,0,1,0,4,14,4,1,0,0,4,1,1,3,0,3,0,2,2,0,1,0,7,1,1,1,3,0,7,1,9,6,1,1,2,
-	1,1,3,0,7,0,1,2,0,0,0,1,5,6,0,3,0,0,2,2,4,0,3,7,12,9,3,1,2,0,1,0,0,1,6,3,0,4,0,1,0,1,1,0,2,2,1,2,0,1,0,6,3,7,3,1,0,2,1,3,9,2,1,1,
-	0,1,3,3,3,3,4,3,0,0,0,5,18,2,11,3,0,0,1,1,1,1,7,1,1,0,0,1,0,0,3,3,0,2,0,2,3,3,3,0,0,1,1,3,2,3,0,0,5,0,0,1,1,5,1,2,2,2,1,2,4,5,2,4,
-	2,2,2,0,2,0,4,0,6,0,0,0,0,1,0,2,0,1,12,5,3,3,2,0,7,0,0,0,0,2,0,1,0,1,0,3,0,0,1,0,0,2,0,10,0,0,2,1,1,0,0,4,1,0,1,0,4,0,0,2,4,6,0,5,
-	8,2,3,5,4,2,0,0,9,2,0,1,0,4,1,4,8,1,0,0,4,3,4,2,0,7,4,0,2,2,2,3,1,2,3,0,0,0,0,1,1,0,0,0,1,5,1,6,7,0,1,2,5,0,1,3,3,0,5,1,10,5,1,3,
-	18,1,4,2,10,3,1,3,0,12,3,3,14,6,14,1,5,6,1,0,0,8,4,9,0,6,3,5,0,3,1,1,0,1,1,6,1,0,4,0,2,7,4,5,1,5,0,0,0,0,1,5,2,1,0,7,2,0,1,23,10,5,0,0,
-	0,2,2,1,0,1,1,1,2,0,5,7,1,1,5,1,3,4,0,2,5,3,1,1,0,1,0,9,0,3,1,4,1,0,5,1,1,0,2,1,2,0,1,3,0,0,1,0,6,1,2,0,3,3,0,4,0,2,2,4,1,1,4,1,
-	2,0,0,0,0,2,0,3,8,7,3,0,4,1,0,3,0,10,0,4,1,0,4,1,4,0,5,0,5,0,7,3,2,10,6,1,0,0,0,4,0,0,3,1,3,6,5,0,0,7,4,0,5,4,3,4,2,5,4,13,1,12,2,0,
-	1,0,2,8,6,1,0,0,3,0,2,0,0,0,0,2,4,0,1,1,6,0,1,3,1,1,6,0,0,1,0,0,0,0,2,2,1,3,2,8,2,4,0,0,0,1,2,2,2,1,0,0,0,0,2,4,2,0,0,1,1,1,1,4,
-	1,0,7,1,1,4,4,1,0,1,1,0,2,0,0,12,3,2,0,0,0,1,7,0,5,4,0,0,1,0,3,1,2,0,3,6,2,1,0,1,0,0,0,0,3,1,2,0,2,0,0,14,2,0,6,2,7,0,7,1,3,0,2,0,
-	2,0,0,0,2,1,5,1,0,1,0,4,1,0,0,1,7,3,6,1,1,0,7,1,0,0,1,9,3,0,2,0,2,1,1,0,1,0,3,0,4,1,0,0,0,0,1,0,3,0,8,3,0,0,0,1,4,2,1,0,1,4,0,2,
-	3,6,3,6,0,5,4,2,2,1,0,0,2,6,0,0,0,6,4,1,5,3,1,2,3,1,2,7,8,0,0,4,2,0,1,0,0,0,0,5,0,1,0,0,2,0,1,1,0,3,0,0,1,1,7,3,2,2,0,5,0,3,6,0,
-	5,2,0,1,6,2,2,1,3,3,0,0,2,2,4,0,13,0,4,4,2,5,1,1,2,2,5,3,2,0,3,1,3,1,1,1,5,0,0,9,2,0,0,2,6,0,1,0,0,1,12,0,5,1,0,28,0,3,4,3,0,1,6,4,
-	0,0,4,7,0,1,4,4,2,6,0,13,1,6,0,2,0,7,0,1,15,0,8,0,9,2,3,6,2,0,1,3,10,4,1,0,2,0,8,1,2,1,4,0,10,2,0,0,1,2,0,4,3,0,3,0,1,3,3,0,1,2,0,0,
-	10,11,7,2,1,1,0,0,0,0,1,2,0,0,2,0,4,5,1,0,3,1,2,0,2,3,11,0,1,0,3,20,6,0,0,1,3,11,16,0,1,0,5,1,0,0,11,1,6,2,2,0,0,0,7,1,5,1,7,2,3,1,4,3,
-	3,1,0,2,2,1,5,0,8,2,2,1,4,0,1,0,0,0,0,1,2,4,0,1,8,5,1,3,0,0,1,2,1,0,4,2,23,6,4,3,2,0,5,3,0,6,0,2,2,2,1,0,2,2,0,19,0,1,6,2,2,0,1,1,
-	5,2,0,12,1,0,3,1,5,0,3,1,0,18,2,2,2,3,3,5,4,5,0,5,0,7,4,3,0,0,4,1,1,1,1,0,0,9,1,0,0,0,0,7,1,3,0,0,3,0,0,1,1,0,2,1,0,0,1,8,1,3,4,6,
-	2,8,1,2,11,6,0,2,11,0,0,1,9,3,5,1,3,0,1,2,7,4,2,3,0,2,2,4,1,0,5,0,4,1,0,8,0,19,1,2,0,5,0,1,0,3,2,5,1,1,0,0,10,1,0,7,0,4,0,5,6,5,11,2,
-	3,2,0,2,4,8,0,1,9,6,2,1,7,8,12,5,6,1,5,6,0,1,20,2,3,0,0,2,6,3,3,2,3,3,7,2,5,1,3,2,1,0,1,0,0,6,0,4,3,13,13,4,6,18,0,2,0,7,3,0,11,0,3,3,
-	6,18,0,0,0,7,0,0,0,0,12,6,9,3,1,17,7,3,11,10,4,0,1,4,4,7,1,5,5,9,2,2,1,6,0,2,6,1,1,0,1,1,4,14,6,2,2,4,4,0,3,5,8,3,4,1,10,4,4,5,1,1,1,0,
-	1,8,4,0,0,4,0,7,3,1,0,2,6,20,12,1,1,3,1,2,0,3,0,0,0,0,0,0,5,0,0,3,5,3,1,0,1,0,0,1,1,0,4,1,8,1,4,3,0,1,1,4,10,13,1,9,2,0,5,11,1,1,7,1,
-	1,4,1,1,5,0,6,2,0,5,3,0,3,0,12,11,0,3,0,2,5,2,0,0,0,2,5,1,7,0,4,0,9,7,11,2,1,1,5,0,0,5,1,9,2,1,1,10,18,8,0,7,4,1,5,1,2,0,15,1,4,4,2,0,
-	15,4,2,2,24,2,12,0,0,0,0,3,4,1,19,3,0,0,0,1,0,0,2,6,4,3,2,7,4,2,4,18,8,3,4,12,12,4,4,7,3,1,0,0,1,2,1,2,2,0,3,12,8,0,3,3,2,1,1,1,0,3,1,0,
-	1,2,4,0,0,0,3,0,1,0,16,2,1,2,4,0,1,0,2,1,2,0,3,5,2,2,0,0,6,6,0,2,0,2,0,1,0,1,5,2,5,1,5,5,0,0,1,2,0,2,0,0,1,1,2,1,5,4,1,0,2,0,1,2,
-	3,0,0,4,6,1,0,0,5,1,1,2,9,1,11,6,0,0,1,1,0,5,2,3,6,6,3,0,0,2,0,5,3,1,3,4,0,1,2,1,0,1,0,2,1,3,1,1,0,0,0,0,1,0,2,1,0,6,1,2,5,20,1,3,
-	3,0,0,4,2,0,2,1,1,7,4,3,0,1,0,1,1,0,0,1,2,3,3,1,3,5,2,2,2,0,0,1,0,14,2,0,0,4,0,2,10,2,0,1,1,3,6,18,0,5,1,1,0,1,2,14,3,0,11,5,12,0,0,4,
-	6,0,2,2,7,0,0,1,7,5,13,0,3,1,0,1,1,1,3,0,0,3,14,9,4,0,1,0,15,0,0,8,1,1,5,10,23,10,2,0,1,0,4,7,4,5,4,0,3,1,1,1,11,3,1,5,0,9,1,1,2,3,2,1,
-	0,4,0,2,5,9,2,0,3,2,2,10,3,12,2,0,6,12,3,0,0,13,1,1,1,6,0,0,6,2,2,0,2,2,0,0,0,1,2,2,4,9,7,0,0,2,0,4,2,0,0,22,3,3,1,0,7,3,0,0,0,0,7,1,
-	5,0,2,2,6,1,1,0,1,0,1,3,2,10,4,2,4,2,1,0,5,2,2,1,2,0,12,0,3,4,3,0,0,1,0,1,3,6,0,0,7,9,0,0,7,4,3,1,2,0,2,1,1,1,0,3,9,0,1,0,0,0,6,0,
-	8,0,3,0,6,3,4,3,0,0,2,2,1,1,5,3,2,2,0,2,1,0,3,2,1,6,2,0,2,1,4,1,1,1,0,3,1,7,1,2,1,4,0,1,3,12,11,0,1,0,1,0,0,1,0,0,0,1,1,6,7,1,4,1,
-	0,5,4,11,0,3,1,1,2,1,0,1,1,2,0,3,8,2,3,2,1,1,7,0,2,1,0,1,0,0,0,2,13,2,3,0,0,2,3,5,2,0,8,6,6,2,0,0,0,2,6,0,1,1,3,2,0,7,2,0,5,0,0,0,
-	2,8,0,2,8,5,0,0,2,0,6,6,1,3,4,2,1,5,1,1,4,1,0,1,0,2,3,4,0,1,0,5,2,0,0,9,0,1,1,7,3,3,2,0,0,4,0,0,0,0,1,4,3,3,2,1,0,0,1,1,0,2,1,3,
-	0,0,0,2,0,1,2,3,0,1,0,0,0,0,4,0,0,8,0,1,0,0,1,0,5,0,6,0,0,0,1,5,1,0,0,5,4,2,2,0,0,2,1,5,2,0,2,0,2,3,11,5,3,5,0,0,0,2,2,8,0,0,0,0,
-	0,0,0,1,0,2,1,0,1,0,0,7,2,0,3,1,0,5,1,1,0,0,1,0,6,0,2,2,2,1,6,5,2,0,3,0,0,5,0,8,2,0,1,0,0,2,4,2,3,2,1,1,0,0,1,0,2,1,2,3,0,1,6,0,
-	0,2,0,2,0,2,4,0,1,1,1,2,8,1,1,4,5,4,0,0,0,1,0,0,6,0,153,3,10,6,0,0,1,3,11,7,0,0,0,2,1,1,2,1,1,8,0,1,0,0,0,1,1,1,5,2,2,2,0,5,3,0,4,0,
-	6,1,0,3,3,3,4,1,5,1,0,10,0,4,2,1,4,2,5,1,0,3,0,1,0,0,0,5,3,1,2,1,0,3,9,1,10,2,4,1,8,3,11,1,1,3,0,1,0,12,0,0,0,0,0,2,5,0,0,6,0,1,1,0,
-	6,2,1,1,0,1,3,0,2,3,0,2,1,1,0,1,5,8,0,1,5,1,7,2,0,0,1,0,2,2,0,7,1,1,2,3,3,0,4,2,0,0,0,0,0,15,0,7,5,5,1,1,5,4,6,5,2,1,0,1,0,0,9,5,
-	0,4,1,0,1,0,2,3,0,0,4,0,1,0,4,1,4,5,4,1,0,2,2,4,0,6,2,1,4,3,0,0,1,3,1,4,3,1,4,0,0,4,0,2,1,1,0,1,2,5,0,5,1,1,2,0,2,1,0,1,1,0,0,1,
-	6,0,2,0,1,0,9,0,0,0,6,1,0,0,0,0,6,6,16,0,5,4,1,1,1,0,2,0,1,0,3,0,0,0,4,8,3,1,0,3,6,3,1,5,0,4,0,0,1,1,1,3,0,0,1,1,7,11,0,0,0,2,3,0,
-	1,0,3,1,0,0,3,5,1,0,4,0,3,3,1,0,3,4,8,0,2,0,6,4,2,3,1,0,1,0,0,1,0,15,0,4,2,5,26,1,1,3,0,12,4,4,2,3,3,0,2,4,0,1,0,5,11,2,0,3,4,1,1,4,
-	2,1,3,0,1,0,8,1,3,0,0,0,1,8,5,0,7,0,0,17,8,2,4,3,2,3,0,10,0,4,8,3,0,4,1,2,2,1,0,0,1,1,3,1,1,0,9,0,10,3,4,2,2,1,11,4,1,3,2,0,2,4,1,2,
-	0,0,1,2,0,4,2,0,17,1,5,7,2,0,11,4,1,0,0,1,0,1,4,4,1,5,0,7,7,3,1,4,0,0,0,2,4,3,1,10,3,0,0,2,9,2,3,1,3,2,0,1,5,0,2,4,10,1,1,0,0,0,0,1,
-	0,9,0,6,7,1,1,1,0,4,6,0,6,0,0,2,0,12,1,0,0,3,2,3,0,2,11,0,2,3,14,17,14,1,3,0,4,1,1,0,7,3,0,2,1,7,1,14,0,0,6,1,6,6,0,4,0,0,3,0,5,10,2,1,
-	0,1,1,1,0,2,2,4,1,2,0,4,4,2,0,0,0,8,0,0,0,2,1,1,0,2,1,0,0,2,3,0,0,4,1,1,8,3,7,2,2,3,2,0,9,1,0,1,4,1,1,1,5,0,2,0,0,0,1,5,2,0,1,1,
-	1,6,2,5,4,17,0,1,8,1,1,3,6,0,1,2,3,1,0,3,2,1,1,3,8,0,11,2,2,3,0,1,1,2,4,1,0,3,2,0,0,1,2,0,0,8,2,0,3,9,4,9,3,1,5,0,4,0,3,1,1,1,3,0,
-	0,4,2,4,4,1,5,0,0,2,5,2,1,4,3,0,0,0,4,3,1,6,5,2,0,1,7,1,0,0,0,0,8,0,1,2,0,2,0,2,0,1,1,6,9,0,4,0,2,0,0,5,2,2,1,3,1,0,10,6,4,0,10,1,
-	2,5,2,0,16,7,0,0,3,1,8,2,1,2,7,1,4,0,0,1,0,3,6,0,0,1,6,5,2,4,2,0,6,2,1,0,17,7,1,0,5,2,13,11,1,0,4,1,1,1,4,3,0,2,1,1,3,1,4,2,3,1,0,1,
-	3,0,0,4,6,7,0,2,0,5,2,1,1,0,2,2,1,1,0,1,0,0,0,14,2,1,1,2,0,3,1,1,2,5,1,0,1,0,1,1,3,0,2,1,4,1,2,2,2,1,2,3,0,0,1,2,3,3,0,0,3,0,0,1,
-	1,0,3,1,0,2,1,3,0,1,3,1,0,0,1,9,1,3,2,1,0,0,1,3,4,1,2,0,6,5,7,1,5,4,0,8,1,1,2,6,4,0,3,1,1,2,8,2,6,1,1,1,1,0,2,3,156,2,4,1,4,0,0,0,
-	0,1,1,6,4,6,8,1,11,0,0,1,5,2,3,2,0,10,2,1,0,1,0,0,4,0,0,0,0,0,1,0,0,2,0,1,0,0,2,0,0,1,0,1,0,0,2,2,2,0,2,1,6,0,0,1,1,1,0,0,1,3,2,12,
-	1,0,6,0,2,2,1,1,0,2,0,1,77,1,0,3,1,2,2,0,2,13,4,24,4,10,6,3,3,3,4,0,1,0,1,4,3,0,1,1,1,1,4,1,0,3,3,1,6,12,0,4,0,12,0,1,9,5,4,12,1,2,0,0,
-	0,0,0,3,4,3,5,0,2,0,13,1,1,5,4,2,0,1,2,2,3,1,5,7,8,0,0,2,0,0,12,1,7,1,0,0,0,4,8,3,2,8,12,2,0,0,5,5,0,1,5,0,0,6,0,0,8,2,0,2,1,3,4,2,
-	2,0,2,1,0,0,2,2,0,9,7,1,0,1,54,0,1,0,3,2,1,4,0,0,0,0,0,2,0,0,2,0,0,2,2,1,0,8,2,2,5,11,3,0,1,1,0,6,0,0,0,2,2,0,1,1,0,6,1,0,0,1,0,0,
-	1,1,0,2,0,0,0,0,0,0,8,1,2,0,5,0,2,4,0,2,1,1,0,0,1,0,0,1,1,0,0,0,2,2,3,0,1,1,3,3,0,0,2,2,1,0,1,1,0,1,0,0,0,0,0,2,0,1,1,2,1,17,2,3,
-	4,8,8,8,3,18,0,5,4,7,1,5,4,22,19,2,1,22,0,0,0,0,0,3,1,1,4,6,0,1,3,0,1,8,1,0,9,4,3,1,2,1,4,4,5,1,3,1,1,2,4,0,0,1,1,1,4,4,0,0,0,2,0,0,
-	0,0,0,6,3,0,5,2,0,13,9,7,5,0,2,2,0,8,21,2,1,5,4,3,0,1,3,7,3,2,3,1,1,10,6,5,1,2,1,11,1,4,1,0,0,16,9,1,21,2,6,10,4,0,2,4,0,4,1,1,9,8,0,7,
-	1,5,1,0,2,1,2,0,1,0,2,7,0,15,1,6,6,16,1,1,4,6,1,13,7,1,0,2,12,4,1,10,0,8,4,8,4,0,0,4,3,2,3,43,3,0,0,16,9,0,1,1,9,12,0,0,6,0,2,1,1,13,4,1,
-	4,0,1,247,8,1,0,3,1,0,0,3,1,1,0,3,9,0,0,0,0,1,4,4,6,1,0,1,4,3,0,1,0,0,0,6,0,0,1,3,4,0,2,54,4,6,1,3,3,8,3,0,3,6,0,0,2,10,2,0,2,0,0,0,
-	4,1,3,2,1,0,1,1,2,7,0,1,1,0,1,0,0,4,0,1,0,0,1,0,3,2,3,0,8,2,2,1,1,0,3,0,2,0,0,0,1,1,0,0,0,2,3,0,2,1,6,0,4,1,0,4,1,3,0,1,1,4,3,1,
-	0,2,2,1,1,1,2,2,2,1,8,8,1,6,3,0,3,1,1,1,0,8,3,2,1,0,1,1,0,0,5,0,1,1,3,2,5,1,7,0,0,4,1,1,0,7,3,3,2,2,1,2,1,5,0,5,8,2,4,7,4,2,0,16,
-	0,3,0,7,3,1,0,0,1,0,1,3,2,0,0,0,0,3,0,1,6,2,7,0,2,6,0,2,0,0,8,4,0,0,0,0,4,0,0,1,1,0,2,8,3,0,3,0,1,0,51,1,4,1,4,13,22,0,2,2,6,3,0,0,
-	2,0,0,7,0,0,4,1,3,0,1,3,1,0,4,2,1,0,1,0,0,1,3,3,1,12,2,3,2,3,1,0,3,0,0,2,1,62,0,0,0,11,2,3,0,0,4,0,12,1,0,0,0,1,7,0,0,2,2,4,1,13,0,2,
-	6,2,3,14,0,2,0,5,6,7,7,6,0,5,1,12,0,6,4,0,3,2,1,0,3,0,61,4,2,5,1,3,3,3,10,1,2,3,0,8,0,6,2,0,0,1,2,2,3,10,17,1,4,2,0,1,1,0,0,4,2,0,8,0,
-	4,0,0,0,0,7,0,0,1,2,3,1,0,2,4,4,3,2,3,0,4,9,0,9,1,0,0,0,3,6,0,0,7,1,0,0,0,0,2,2,3,0,7,7,0,3,0,1,0,1,1,4,1,3,0,0,0,0,1,0,6,0,0,3,
-	2,1,11,1,0,0,1,0,2,1,0,1,0,2,4,2,1,0,0,1,1,3,0,0,0,0,4,0,1,0,0,2,8,0,6,2,0,3,0,1,0,0,0,1,0,6,0,1,0,2,1,1,2,0,1,108,1,1,6,1,0,0,1,12,
-	2,0,0,0,4,3,2,5,3,3,2,1,2,0,14,2,0,4,1,9,0,7,2,0,0,0,0,0,2,7,2,2,4,2,1,10,1,3,1,10,14,1,3,2,1,0,2,1,0,5,0,1,4,9,3,14,6,1,2,1,3,0,0,2,
-	12,15,0,2,86,2,0,2,0,1,1,5,0,2,6,0,1,1,5,0,0,5,0,1,0,0,1,0,7,2,0,0,0,2,0,4,7,0,0,0,0,1,1,4,1,0,0,0,1,4,9,4,1,6,1,8,5,4,1,10,0,10,2,9,
-	0,0,2,11,3,3,12,1,0,0,2,0,2,1,5,3,0,21,7,1,4,
-};
-
-static ImWchar baseUnicodeRanges[] =
-{
-	0x0020, 0x00FF, // Basic Latin + Latin Supplement
-	0x3000, 0x30FF, // Punctuations, Hiragana, Katakana
-	0x31F0, 0x31FF, // Katakana Phonetic Extensions
-	0xFF00, 0xFFEF, // Half-width characters
-	0x2191, 0x2191, // Upwards arrow
-	0x2193, 0x2193, // Downwards arrow
-};
-#pragma endregion
-
     locale_t __glocale_current = LOCALE_EN_US;
     bool __glocale_merge = false;
     unsigned int __glocale_disabled = 0;
-    ImWchar* __glocale_jp_glyphrange = nullptr;
 
     void LocaleSet(locale_t locale)
     {
@@ -145,8 +38,6 @@ static ImWchar baseUnicodeRanges[] =
             break;
         }
     }
-    inline const char** LocaleGetCurrentGlossary();
-    inline const char* LocaleGetStr(th_glossary_t name);
     void LocaleRotate()
     {
         switch (__glocale_current) {
@@ -165,9 +56,8 @@ static ImWchar baseUnicodeRanges[] =
     }
     bool LocaleInitFromCfg()
     {
-        int language = 0;
-        if (LauncherSettingGet("language", language) && language >= 0 && language <= 2) {
-            __glocale_current = (Gui::locale_t)language;
+        if (LauncherSettingIsSet(SETTING_LANGUAGE)) {
+            __glocale_current = (Gui::locale_t)LauncherSettingGet(SETTING_LANGUAGE);
             return true;
         }
         return false;
@@ -425,47 +315,28 @@ static ImWchar baseUnicodeRanges[] =
             0, 0, 0, 0,
             info.font_name);
     }
-    ImWchar* GetGlyphRange(int locale)
+    // Both sets come from thprac_locale_def, generated along with the strings
+    const ImWchar* GetGlyphRange(int locale)
     {
-        bool renderOnlyUsedGlyphs = false;
-        LauncherSettingGet("render_only_used_glyphs", renderOnlyUsedGlyphs);
+        static const uint16_t* const usedGlyphRanges[] = {
+            th_glyph_ranges_used_zh,
+            th_glyph_ranges_used_en,
+            th_glyph_ranges_used_ja,
+        };
+        static const uint16_t* const glyphRanges[] = {
+            th_glyph_ranges_zh,
+            th_glyph_ranges_en,
+            th_glyph_ranges_ja,
+        };
+        static_assert(sizeof(ImWchar) == sizeof(uint16_t));
 
-        auto& io = ImGui::GetIO();
-        ImWchar* glyphRange = nullptr;
-        switch (locale) {
-        case LOCALE_ZH_CN:
-            if (renderOnlyUsedGlyphs) {
-                glyphRange = (ImWchar*)__thprac_loc_range_zh;
-            } else {
-                glyphRange = (ImWchar*)io.Fonts->GetGlyphRangesChineseFull();
-            }
-            break;
-        case LOCALE_EN_US:
-            glyphRange = (ImWchar*)io.Fonts->GetGlyphRangesDefault();
-            break;
-        case LOCALE_JA_JP: {
-            if (renderOnlyUsedGlyphs) {
-                glyphRange = (ImWchar*)__thprac_loc_range_ja;
-            } else {
-                if (!__glocale_jp_glyphrange) {
-                    __glocale_jp_glyphrange = (ImWchar*)malloc((_countof(baseUnicodeRanges) + _countof(offsetsFrom0x4E00) * 2 + 1) * sizeof(ImWchar));
-                    // Unpack
-                    int codepoint = 0x4e00;
-                    memcpy(__glocale_jp_glyphrange, baseUnicodeRanges, sizeof(baseUnicodeRanges));
-                    ImWchar* dst = __glocale_jp_glyphrange + _countof(baseUnicodeRanges);
-                    for (int n = 0; n < _countof(offsetsFrom0x4E00); n++, dst += 2) {
-                        dst[0] = dst[1] = (ImWchar)(codepoint += (offsetsFrom0x4E00[n] + 1));
-                    }
-                    dst[0] = 0;
-                }
-                glyphRange = (ImWchar*)__glocale_jp_glyphrange;
-            }
-            break;
+        if (locale < LOCALE_ZH_CN || locale > LOCALE_JA_JP) {
+            return nullptr;
         }
-        default:
-            break;
+        if (LauncherSettingGet(SETTING_RENDER_ONLY_USED_GLYPHS)) {
+            return (const ImWchar*)usedGlyphRanges[locale];
         }
-        return glyphRange;
+        return (const ImWchar*)glyphRanges[locale];
     }
     typedef HFONT(CALLBACK* font_checker)(HDC hdc, font_info& info);
     font_checker fontCheckers[] = {
@@ -532,10 +403,10 @@ static ImWchar baseUnicodeRanges[] =
             fontConfig.OversampleV = 5;
 
             float fontFinalSize = font_size * info.font_scale;
-            ImWchar* glyphRange = GetGlyphRange(locale);
+            const ImWchar* glyphRange = GetGlyphRange(locale);
 
             __glocale_fonts[locale] = io.Fonts->AddFontFromMemoryTTF(fontData, fontDataSize, fontFinalSize,
-                &fontConfig, (ImWchar*)glyphRange);
+                &fontConfig, glyphRange);
         }
 
         ImGuiFreeType::BuildFontAtlas(io.Fonts, 0);
@@ -588,7 +459,7 @@ static ImWchar baseUnicodeRanges[] =
         fontConfig.FontNo = info.font_index;
         fontConfig.RasterizerMultiply = 1.25;
 
-        ImWchar* glyphRange = GetGlyphRange(locale);
+        const ImWchar* glyphRange = GetGlyphRange(locale);
         float fontFinalSize = font_size * info.font_scale;
 
         io.Fonts->AddFontFromMemoryTTF(fontData, fontDataSize, fontFinalSize, &fontConfig, glyphRange);
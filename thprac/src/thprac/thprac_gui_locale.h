@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include "thprac_locale_def.h"
+#include <stddef.h>
 
 namespace THPrac {
 namespace Gui {
@@ -17,11 +18,37 @@ namespace Gui {
     {
         return __glocale_current;
     }
-    __forceinline const char** LocaleGetCurrentGlossary() {
-        return th_glossary_str[LocaleGet()];
+
+    // One language's glossary or section names. The generated tables only hold
+    // offsets into th_locale_pool, this turns them back into strings.
+    class LocaleTable {
+    public:
+        LocaleTable(const uint32_t* offsets)
+            : mOffsets(offsets)
+        {
+        }
+        const char* operator[](size_t index) const
+        {
+            return th_locale_str(mOffsets[index]);
+        }
+        explicit operator bool() const
+        {
+            return mOffsets != nullptr;
+        }
+
+    private:
+        const uint32_t* mOffsets;
+    };
+
+    __forceinline LocaleTable LocaleGetCurrentGlossary() {
+        return th_glossary_ofs[LocaleGet()];
     };
     __forceinline const char* LocaleGetStr(th_glossary_t name) {
-        return LocaleGetCurrentGlossary()[name];
+        return th_locale_str(th_glossary_ofs[LocaleGet()][name]);
+    };
+    // For text that has to be in a language other than the current one
+    __forceinline const char* LocaleGetStr(locale_t locale, th_glossary_t name) {
+        return th_locale_str(th_glossary_ofs[locale][name]);
     };
 
     void LocaleRotate();
@@ -35,7 +62,7 @@ namespace Gui {
 // the current game's namespace being active where they're used. Fixing this
 // will require an architectural change.
 #define XCBA(stage, type) th_sections_cba[stage][type]
-#define XSSS(rank) (th_sections_str[::THPrac::Gui::LocaleGet()][rank])
+#define XSSS(rank) (::THPrac::Gui::LocaleTable(th_sections_ofs[::THPrac::Gui::LocaleGet()][rank]))
 
 }
 
@@ -1,17 +1,93 @@
 ﻿#include "thprac_hook.h"
+#include "thprac_hook_detour.h"
+#include "thprac_hook_table.h"
+#include "thprac_hook_x86.h"
 
-#include <unordered_map>
+#include <vector>
+#ifdef THPRAC_HOOK_PROFILE
+#include <intrin.h>
+#endif
 
 namespace THPrac {
-// If macros could define other macros, I would've used a macro
-char __vehHooks[sizeof(std::unordered_map<uintptr_t, HookCtx*>)];
-#define vehHooks (*(std::unordered_map<uintptr_t, HookCtx*>*)__vehHooks)
+static HookTable<HookCtx> vehHooks;
 
-LPVOID hook_page = nullptr;
-uintptr_t hook_page_offset;
+/// Hook arena
+/// ------------------
+// Codecaves and detour stubs come from a HookArena, see thprac_hook_arena.h.
+// thprac is 32 bit, so every chunk is always within rel32 reach of the game.
+class HookArenaWin32Os : public HookArenaOs {
+public:
+    uint8_t* Reserve(size_t size) override
+    {
+        return (uint8_t*)VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+    bool Seal(uint8_t* ptr, size_t size) override
+    {
+        DWORD oldProt;
+        return VirtualProtect(ptr, size, PAGE_EXECUTE_READ, &oldProt);
+    }
+    void FlushCode(uint8_t* ptr, size_t size) override
+    {
+        FlushInstructionCache(GetCurrentProcess(), ptr, size);
+    }
+};
+static HookArenaWin32Os hookArenaOs;
+static HookArena hookArena(hookArenaOs);
+
+void HookArenaBeginWrite()
+{
+    hookArena.BeginWrite();
+}
+
+void HookArenaEndWrite()
+{
+    hookArena.EndWrite();
+}
+
+uint8_t* HookArenaAlloc(size_t size)
+{
+    return hookArena.Alloc(size);
+}
+
+HookArenaStats GetHookArenaStats()
+{
+    return hookArena.Stats();
+}
+/// ------------------
 
 uintptr_t ingame_image_base = 0;
 
+// Number of bytes at addr that Enable/Disable overwrite
+size_t HookCtx::PatchSize() const
+{
+    if (callback) {
+        return detour ? 5 : 1;
+    }
+    return this->data.buffer.size;
+}
+
+// These two assume that the patched bytes are already writable
+void HookCtx::WriteEnabled()
+{
+    if (callback && detour) {
+        *(uint8_t*)this->addr = 0xE9;
+        *(uint32_t*)(this->addr + 1) = (uintptr_t)this->data.hook.trampoline - (this->addr + 5);
+    } else if (callback) {
+        *(uint8_t*)this->addr = 0xCC;
+    } else {
+        memswap((void*)this->addr, this->data.buffer.ptr, this->data.buffer.size);
+    }
+}
+
+void HookCtx::WriteDisabled()
+{
+    if (callback) {
+        memcpy((void*)this->addr, this->data.hook.orig_bytes, this->PatchSize());
+    } else {
+        memswap((void*)this->addr, this->data.buffer.ptr, this->data.buffer.size);
+    }
+}
+
 void HookCtx::PatchSwap()
 {
     DWORD oldProt;
@@ -20,27 +96,30 @@ void HookCtx::PatchSwap()
     VirtualProtect((LPVOID)this->addr, this->data.buffer.size, oldProt, &oldProt);
 }
 
-void HookCtx::Enable()
+bool HookCtx::CheckEnable()
 {
     if (!this->data.buffer.ptr) {
         MessageBoxA(NULL, "No codecave or patch buffer for hook", this->name, MB_ICONERROR);
         __debugbreak();
+        return false;
     } else if (!this->setup) {
         MessageBoxA(NULL, "Hook not setup. Note that patches work without setup, unless the addresses used are RVAs", this->name, MB_ICONWARNING);
     }
+    return true;
+}
 
-    if (this->enabled) {
+void HookCtx::Enable()
+{
+    if (!this->CheckEnable() || this->enabled) {
         return;
     }
 
-    if (callback) {
-        DWORD oldProt;
-        VirtualProtect((LPVOID)this->addr, 1, PAGE_EXECUTE_READWRITE, &oldProt);
-        *(uint8_t*)this->addr = 0xCC;
-        VirtualProtect((LPVOID)this->addr, 1, oldProt, &oldProt);
-    } else {
-        this->PatchSwap();
-    }
+    size_t len = this->PatchSize();
+    DWORD oldProt;
+    VirtualProtect((LPVOID)this->addr, len, PAGE_EXECUTE_READWRITE, &oldProt);
+    this->WriteEnabled();
+    VirtualProtect((LPVOID)this->addr, len, oldProt, &oldProt);
+    FlushInstructionCache(GetCurrentProcess(), (LPVOID)this->addr, len);
     this->enabled = true;
 }
 
@@ -49,17 +128,108 @@ void HookCtx::Disable()
     if (!this->enabled) {
         return;
     }
-    if (callback) {
-        DWORD oldProt;
-        VirtualProtect((LPVOID)this->addr, 1, PAGE_EXECUTE_READWRITE, &oldProt);
-        *(uint8_t*)this->addr = this->data.hook.orig_byte;
-        VirtualProtect((LPVOID)this->addr, 1, oldProt, &oldProt);
-    } else {
-        this->PatchSwap();
-    }
+
+    size_t len = this->PatchSize();
+    DWORD oldProt;
+    VirtualProtect((LPVOID)this->addr, len, PAGE_EXECUTE_READWRITE, &oldProt);
+    this->WriteDisabled();
+    VirtualProtect((LPVOID)this->addr, len, oldProt, &oldProt);
+    FlushInstructionCache(GetCurrentProcess(), (LPVOID)this->addr, len);
     this->enabled = false;
 }
 
+/// Batched enable/disable
+/// ------------------
+// Toggling a whole hook set one hook at a time costs two VirtualProtect calls
+// per hook, and hook sets tend to be clustered in a handful of pages. Instead,
+// every page is made writable once, all the patches are written, and then the
+// original protections are restored and the instruction cache is flushed once.
+//
+// If any page can't be made writable, the pages already flipped are restored
+// and nothing is written, so the hooks are left exactly as they were.
+constexpr uintptr_t HOOK_PROT_PAGE_SIZE = 0x1000;
+
+struct HookPageProt {
+    uintptr_t page;
+    DWORD oldProt;
+};
+
+static void HookPagesRestore(std::vector<HookPageProt>& pages)
+{
+    for (auto& p : pages) {
+        DWORD tmp;
+        VirtualProtect((LPVOID)p.page, HOOK_PROT_PAGE_SIZE, p.oldProt, &tmp);
+    }
+}
+
+bool ApplyHookSlice(HookSlice hooks, bool enable)
+{
+    std::vector<HookPageProt> pages;
+    uintptr_t flush_begin = UINTPTR_MAX;
+    uintptr_t flush_end = 0;
+
+    if (enable) {
+        for (size_t i = 0; i < hooks.len; i++) {
+            if (!hooks.ptr[i].enabled && !hooks.ptr[i].CheckEnable()) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < hooks.len; i++) {
+        HookCtx& hook = hooks.ptr[i];
+        size_t len = hook.PatchSize();
+        if (hook.enabled == enable || !len) {
+            continue;
+        }
+
+        flush_begin = std::min(flush_begin, hook.addr);
+        flush_end = std::max(flush_end, hook.addr + len);
+
+        uintptr_t last = (hook.addr + len - 1) & ~(HOOK_PROT_PAGE_SIZE - 1);
+        for (uintptr_t page = hook.addr & ~(HOOK_PROT_PAGE_SIZE - 1); page <= last; page += HOOK_PROT_PAGE_SIZE) {
+            // Hook sets only ever touch a few pages, a linear search is fine
+            bool found = false;
+            for (auto& p : pages) {
+                if (p.page == page) {
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                continue;
+            }
+
+            DWORD oldProt;
+            if (!VirtualProtect((LPVOID)page, HOOK_PROT_PAGE_SIZE, PAGE_EXECUTE_READWRITE, &oldProt)) {
+                HookPagesRestore(pages);
+                return false;
+            }
+            pages.push_back({ page, oldProt });
+        }
+    }
+
+    for (size_t i = 0; i < hooks.len; i++) {
+        HookCtx& hook = hooks.ptr[i];
+        if (hook.enabled == enable || !hook.PatchSize()) {
+            continue;
+        }
+        if (enable) {
+            hook.WriteEnabled();
+        } else {
+            hook.WriteDisabled();
+        }
+        hook.enabled = enable;
+    }
+
+    HookPagesRestore(pages);
+    if (flush_begin < flush_end) {
+        FlushInstructionCache(GetCurrentProcess(), (LPVOID)flush_begin, flush_end - flush_begin);
+    }
+    return true;
+}
+/// ------------------
+
 static inline void cave_fix(uint8_t* sourcecave, uint8_t* bp_addr, uint32_t sourcecave_size)
 {
     /// Return Jump
@@ -80,18 +250,110 @@ static inline void cave_fix(uint8_t* sourcecave, uint8_t* bp_addr, uint32_t sour
     /// ------------------
 }
 
-void* MakeCodecave(uint8_t* code, uintptr_t addr, size_t insLen)
+// Copies the instructions covering at least insLen bytes at code into the hook
+// arena, followed by a jmp back to the first instruction after them
+void* MakeCodecave(uint8_t* code, size_t insLen)
 {
-    if (!addr) {
-        addr = (uintptr_t)code;
+    // Worst case, every instruction is a 2 byte loop/jecxz that grows to 9 bytes
+    size_t stolen = X86InsnBoundary(code, insLen);
+    size_t cave_space = (stolen ? stolen : insLen) * 9 / 2 + 5;
+    uint8_t* cave = HookArenaAlloc(cave_space);
+    if (!cave) {
+        return nullptr;
     }
 
-    memcpy((uint8_t*)hook_page + hook_page_offset, code, insLen);
-    cave_fix((uint8_t*)hook_page + hook_page_offset, code, insLen);
+    size_t len = stolen ? X86Relocate(cave, cave_space - 5, code, stolen) : 0;
+    if (!len) {
+        // Couldn't decode something, copy the bytes as they are and hope for the best
+        memcpy(cave, code, insLen);
+        cave_fix(cave, code, insLen);
+        hookArena.Shrink(cave, insLen + 5);
+        return cave;
+    }
 
-    return (uint8_t*)hook_page + hook_page_offset;
+    cave[len] = 0xE9;
+    *(uint32_t*)&cave[len + 1] = (uintptr_t)(code + stolen) - (uintptr_t)(cave + len + 5);
+    hookArena.Shrink(cave, len + 5);
+    return cave;
 }
 
+/// Detour backend
+/// ------------------
+// The site is overwritten with a jmp to a per-hook stub in the hook page:
+//     push <HookCtx*>
+//     jmp DetourEntry
+// DetourEntry saves every register, builds a CONTEXT just like the one the
+// kernel would pass to VEHHandler, runs the callback, and then resumes at
+// whatever Eip the callback left (or the codecave if it left it alone). The
+// stack frames involved are described in thprac_hook_detour.h.
+
+static DetourReturnFrame* __fastcall DetourDispatch(DetourFrame* frame, uint8_t* fx_state)
+{
+    HookCtx* self = (HookCtx*)frame->self;
+
+    CONTEXT ctx = {};
+    ctx.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER | CONTEXT_EXTENDED_REGISTERS;
+    DetourLoadContext(frame, ctx);
+    ctx.Eip = self->addr;
+    memcpy(ctx.ExtendedRegisters, fx_state, sizeof(ctx.ExtendedRegisters));
+
+#ifdef THPRAC_HOOK_PROFILE
+    uint64_t start = __rdtsc();
+    self->callback(&ctx, self);
+    self->hit_count++;
+    self->cycles += __rdtsc() - start;
+#else
+    self->callback(&ctx, self);
+#endif
+
+    if (ctx.Eip == self->addr) {
+        ctx.Eip = (DWORD)self->data.hook.codecave;
+    }
+    memcpy(fx_state, ctx.ExtendedRegisters, sizeof(ctx.ExtendedRegisters));
+
+    DetourReturnFrame* ret = DetourStoreContext(frame, ctx);
+    if (!ret) {
+        // What the callback pushed past the red zone may already be
+        // overwritten, and there's no safe place left for the return frame
+        MessageBoxA(NULL, "Detour hook callback moved Esp down by more than DETOUR_RED_ZONE bytes", self->name, MB_ICONERROR);
+        __debugbreak();
+        ExitProcess(UINT_MAX);
+    }
+    return ret;
+}
+
+static __declspec(naked) void DetourEntry()
+{
+    __asm {
+        lea esp, [esp - DETOUR_RED_ZONE]
+        pushfd
+        pushad
+        mov ebx, esp
+        // x87/SSE state, saved before any C++ code gets a chance to touch it
+        sub esp, 512
+        and esp, -16
+        fxsave [esp]
+        mov ecx, ebx
+        mov edx, esp
+        call DetourDispatch
+        fxrstor [esp]
+        mov esp, eax
+        popad
+        popfd
+        ret
+    }
+}
+
+static void* MakeDetourStub(HookCtx* hook)
+{
+    uint8_t* stub = HookArenaAlloc(X86_DETOUR_STUB_LEN);
+    if (!stub) {
+        return nullptr;
+    }
+    X86EmitDetourStub(stub, X86_DETOUR_STUB_LEN, (uint32_t)hook, (uintptr_t)&DetourEntry);
+    return stub;
+}
+/// ------------------
 
 void HookCtx::Setup()
 {
@@ -99,29 +361,57 @@ void HookCtx::Setup()
         this->setup = true;
         this->addr += ingame_image_base;
         if (this->callback) {
-            vehHooks[this->addr] = this;
+            if (!this->data.hook.instr_len) {
+                size_t len = X86InsnBoundary((uint8_t*)this->addr, this->detour ? 5 : 1);
+                if (!len) {
+                    MessageBoxA(NULL, "Failed to decode the instruction at the hook address", this->name, MB_ICONERROR);
+                    return;
+                }
+                this->data.hook.instr_len = (uint8_t)len;
+            }
+            if (this->detour && this->data.hook.instr_len < 5) {
+                MessageBoxA(NULL, "Detour hooks need at least 5 bytes of instructions, falling back to int3", this->name, MB_ICONWARNING);
+                this->detour = false;
+            }
 
-            this->data.hook.codecave = MakeCodecave((uint8_t*)this->addr, this->addr, this->data.hook.instr_len);
-            hook_page_offset += this->data.hook.instr_len + 5;
+            HookArenaBeginWrite();
+            defer(HookArenaEndWrite());
 
-            this->data.hook.orig_byte = *(uint8_t*)this->addr;
+            this->data.hook.codecave = MakeCodecave((uint8_t*)this->addr, this->data.hook.instr_len);
+            if (!this->data.hook.codecave) {
+                MessageBoxA(NULL, "Ran out of hook arena memory", this->name, MB_ICONERROR);
+                return;
+            }
+
+            if (this->detour && !(this->data.hook.trampoline = MakeDetourStub(this))) {
+                MessageBoxA(NULL, "Ran out of hook arena memory, falling back to int3", this->name, MB_ICONWARNING);
+                this->detour = false;
+            }
+            if (!this->detour && !vehHooks.Insert(this->addr, this)) {
+                MessageBoxA(NULL, "Too many hooks for the breakpoint table", this->name, MB_ICONERROR);
+                // Without a codecave, Enable refuses to write the int3
+                this->data.hook.codecave = nullptr;
+                return;
+            }
+
+            memcpy(this->data.hook.orig_bytes, (void*)this->addr, this->detour ? 5 : 1);
         }
     }
 }
 
 void EnableAllHooksImpl(HookCtx* hooks, size_t num)
 {
+    HookArenaBeginWrite();
     for (size_t i = 0; i < num; i++) {
         hooks[i].Setup();
-        hooks[i].Enable();
     }
+    HookArenaEndWrite();
+    ApplyHookSlice({ hooks, num }, true);
 }
 
 void DisableAllHooksImpl(HookCtx* hooks, size_t num)
 {
-    for (size_t i = 0; i < num; i++) {
-        hooks[i].Disable();
-    }
+    ApplyHookSlice({ hooks, num }, false);
 }
 
 LONG NTAPI VEHHandler(EXCEPTION_POINTERS* ExceptionInfo)
@@ -129,26 +419,29 @@ LONG NTAPI VEHHandler(EXCEPTION_POINTERS* ExceptionInfo)
     if (ExceptionInfo->ExceptionRecord->ExceptionCode != EXCEPTION_BREAKPOINT) {
         return EXCEPTION_CONTINUE_SEARCH;
     }
-    auto hook = vehHooks.find(ExceptionInfo->ContextRecord->Eip);
-    if (hook == vehHooks.end()) {
+    HookCtx* hook = vehHooks.Find(ExceptionInfo->ContextRecord->Eip);
+    if (!hook) {
         return EXCEPTION_CONTINUE_SEARCH;
     }
 
     auto EipBak = ExceptionInfo->ContextRecord->Eip;
-    hook->second->callback(ExceptionInfo->ContextRecord, hook->second);
+#ifdef THPRAC_HOOK_PROFILE
+    uint64_t start = __rdtsc();
+    hook->callback(ExceptionInfo->ContextRecord, hook);
+    hook->hit_count++;
+    hook->cycles += __rdtsc() - start;
+#else
+    hook->callback(ExceptionInfo->ContextRecord, hook);
+#endif
 
     if (ExceptionInfo->ContextRecord->Eip == EipBak) {
-        ExceptionInfo->ContextRecord->Eip = (DWORD)hook->second->data.hook.codecave;
+        ExceptionInfo->ContextRecord->Eip = (DWORD)hook->data.hook.codecave;
     }
     return EXCEPTION_CONTINUE_EXECUTION;
 }
 
 void VEHHookInit()
 {
-    new (__vehHooks) std::unordered_map<uintptr_t, HookCtx*>;
-
-    hook_page = VirtualAlloc(nullptr, 1, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
-
     AddVectoredExceptionHandler(1, &VEHHandler);
 }
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <type_traits>
 #include <bit>
 #include "utils/utils.h"
+#include "thprac_hook_arena.h"
 
 namespace THPrac {
 extern uintptr_t ingame_image_base;
@@ -358,19 +359,22 @@ struct PatchBufferImpl {
 
 struct PatchHookImpl {
     void* codecave;
-    uint8_t orig_byte;
+    void* trampoline;
+    uint8_t orig_bytes[5];
     uint8_t instr_len;
 
     inline constexpr PatchHookImpl()
         : codecave(0)
-        , orig_byte(0)
+        , trampoline(0)
+        , orig_bytes {}
         , instr_len(0)
     {
     }
 
     inline constexpr PatchHookImpl(uint8_t _instr_size)
         : codecave(0)
-        , orig_byte(0)
+        , trampoline(0)
+        , orig_bytes {}
         , instr_len(_instr_size)
     {
     }
@@ -412,11 +416,29 @@ struct HookCtx {
 
     PatchData data;
 
+    // Hook with a jmp to a trampoline instead of int3 + VEH. Requires
+    // instr_len >= 5, and none of the overwritten bytes except the first
+    // may be a jump target.
+    bool detour = false;
+
+#ifdef THPRAC_HOOK_PROFILE
+    // How often the callback ran and the cycles it took in total, counted by
+    // VEHHandler and the detour trampoline. Define THPRAC_HOOK_PROFILE to get
+    // them, and look at them in a debugger.
+    uint32_t hit_count = 0;
+    uint64_t cycles = 0;
+#endif
+
     void PatchSwap();
     void Enable();
     void Disable();
     void Setup();
 
+    size_t PatchSize() const;
+    bool CheckEnable();
+    void WriteEnabled();
+    void WriteDisabled();
+
     void Toggle(bool status) {
         if (status) {
             this->Enable();
@@ -431,6 +453,11 @@ struct HookSlice {
     size_t len;
 };
 
+// Enables or disables every hook in the slice, changing the protection of each
+// page involved only once. Either all of the hooks are toggled, or, if a page
+// can't be made writable or a hook isn't usable, none of them are.
+bool ApplyHookSlice(HookSlice hooks, bool enable);
+
 template <HookCtx... args>
 HookSlice make_hook_array()
 {
@@ -441,6 +468,9 @@ HookSlice make_hook_array()
     return { arr, elementsof(arr) };
 }
 
+// instr_size_ is the length of the instruction(s) at the hook address, which
+// the codecave executes when the callback doesn't redirect Eip. Passing 0
+// makes HookCtx::Setup decode it instead.
 #define HOOKSET_DEFINE(name) static constinit HookCtx name[] = {
 
 #define EHOOK_DY(name_, addr_, instr_size_, ...) { .addr = addr_, .name = #name_, .callback = []([[maybe_unused]] PCONTEXT pCtx, [[maybe_unused]] HookCtx * self) __VA_ARGS__, .data = PatchHookImpl(instr_size_) },
@@ -448,6 +478,12 @@ HookSlice make_hook_array()
 
 #define HOOKSET_ENDDEF() };
 
+// Same as EHOOK_DY/EHOOK_ST, but using the jmp detour backend (see HookCtx::detour).
+// The callback can push at most DETOUR_RED_ZONE (128) bytes onto pCtx->Esp,
+// moving it down further is a fatal error.
+#define DHOOK_DY(name_, addr_, instr_size_, ...) { .addr = addr_, .name = #name_, .callback = []([[maybe_unused]] PCONTEXT pCtx, [[maybe_unused]] HookCtx * self) __VA_ARGS__, .data = PatchHookImpl(instr_size_), .detour = true },
+#define DHOOK_ST(name_, addr_, instr_size_, ...) constinit HookCtx name_ { .addr = addr_, .name = #name_, .callback = []([[maybe_unused]] PCONTEXT pCtx, [[maybe_unused]] HookCtx* self) __VA_ARGS__, .data = PatchHookImpl(instr_size_), .detour = true }
+
 #define EHOOK_ST(name_, addr_, instr_size_, ...) constinit HookCtx name_ { .addr = addr_, .name = #name_, .callback = []([[maybe_unused]] PCONTEXT pCtx, [[maybe_unused]] HookCtx* self) __VA_ARGS__, .data = PatchHookImpl(instr_size_) }
 #define PATCH_ST(name_, addr_, ...) constinit HookCtx name_ { .addr = addr_, .name = #name_, .data = PatchCode(__VA_ARGS__)}
 
@@ -460,6 +496,22 @@ void DisableAllHooksImpl(HookCtx* hooks, size_t num);
 
 void VEHHookInit();
 
+// Codecaves and detour stubs are written inside a Begin/EndWrite pair, and
+// only become executable (and stop being writable) at the outermost
+// EndWrite. The pairs nest, and HookCtx::Setup and EnableAllHooks already
+// open one, so call these yourself only to batch setup of hooks that aren't
+// in a single array.
+void HookArenaBeginWrite();
+void HookArenaEndWrite();
+
+// Executable memory for code made at runtime, such as thunks from
+// X86EmitCdeclThunk. Must be called between HookArenaBeginWrite and
+// HookArenaEndWrite, and the code can't run before HookArenaEndWrite.
+// Returns nullptr once the arena is full.
+uint8_t* HookArenaAlloc(size_t size);
+
+HookArenaStats GetHookArenaStats();
+
 enum CallType {
     Cdecl, // cdecl and CDECL are both predefined. :P
     Stdcall,
@@ -0,0 +1,75 @@
+#include "thprac_hook_arena.h"
+
+namespace THPrac {
+
+void HookArena::BeginWrite()
+{
+    mWriteDepth++;
+}
+
+void HookArena::EndWrite()
+{
+    if (--mWriteDepth != 0) {
+        return;
+    }
+    // A session can spill over into new chunks
+    for (size_t i = 0; i < mChunkCount; i++) {
+        Chunk& chunk = mChunks[i];
+        if (chunk.used == chunk.sealed) {
+            continue;
+        }
+        size_t end = (chunk.used + OS_PAGE_SIZE - 1) & ~(OS_PAGE_SIZE - 1);
+        // On failure the pages stay writable, and are retried at the next
+        // EndWrite. Until then, code in them faults instead of running.
+        if (mOs.Seal(chunk.base + chunk.sealed, end - chunk.sealed)) {
+            mOs.FlushCode(chunk.base + chunk.sealed, chunk.used - chunk.sealed);
+            chunk.used = chunk.sealed = end;
+        }
+    }
+}
+
+uint8_t* HookArena::Alloc(size_t size)
+{
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    if (size > CHUNK_SIZE) {
+        return nullptr;
+    }
+
+    if (!mChunkCount || mChunks[mChunkCount - 1].used + size > CHUNK_SIZE) {
+        if (mChunkCount == MAX_CHUNKS) {
+            return nullptr;
+        }
+        uint8_t* base = mOs.Reserve(CHUNK_SIZE);
+        if (!base) {
+            return nullptr;
+        }
+        mChunks[mChunkCount++] = { base, 0, 0 };
+    }
+
+    Chunk& chunk = mChunks[mChunkCount - 1];
+    uint8_t* ret = chunk.base + chunk.used;
+    chunk.used += size;
+    mAllocs++;
+    return ret;
+}
+
+void HookArena::Shrink(uint8_t* ptr, size_t size)
+{
+    Chunk& chunk = mChunks[mChunkCount - 1];
+    size = (size + ALIGN - 1) & ~(ALIGN - 1);
+    chunk.used = (ptr - chunk.base) + size;
+}
+
+HookArenaStats HookArena::Stats() const
+{
+    HookArenaStats stats = {};
+    stats.chunks = mChunkCount;
+    stats.allocations = mAllocs;
+    stats.bytes_reserved = mChunkCount * CHUNK_SIZE;
+    for (size_t i = 0; i < mChunkCount; i++) {
+        stats.bytes_used += mChunks[i].used;
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace THPrac {
+
+// Memory for code made at runtime: codecaves, detour stubs and thunks. It's
+// bump allocated from chunks that are never writable and executable at the
+// same time. Code is written to pages that have never been executable, and
+// HookArena::EndWrite turns every page that got something written to it
+// read + execute for good, so nothing ever has to be made writable again
+// while another thread might be running it. The cost is that every write
+// session ends on a page boundary.
+//
+// Nothing here touches Windows directly, every page goes through
+// HookArenaOs, so thprac/tests/hook_arena_test.cpp can check it against
+// mmap and mprotect.
+
+class HookArenaOs {
+public:
+    virtual ~HookArenaOs() = default;
+
+    // Committed read + write memory, aligned to HookArena::OS_PAGE_SIZE, or
+    // nullptr
+    virtual uint8_t* Reserve(size_t size) = 0;
+    // Makes whole pages read + execute
+    virtual bool Seal(uint8_t* ptr, size_t size) = 0;
+    virtual void FlushCode(uint8_t* ptr, size_t size) = 0;
+};
+
+struct HookArenaStats {
+    size_t chunks;
+    size_t allocations;
+    size_t bytes_reserved;
+    size_t bytes_used;
+};
+
+class HookArena {
+public:
+    // VirtualAlloc hands out address space in 64KB units anyway
+    static constexpr size_t CHUNK_SIZE = 0x10000;
+    static constexpr size_t MAX_CHUNKS = 64;
+    static constexpr size_t OS_PAGE_SIZE = 0x1000;
+    static constexpr size_t ALIGN = 4;
+
+    constexpr HookArena(HookArenaOs& os)
+        : mOs(os)
+    {
+    }
+
+    // Calls nest, and only the outermost EndWrite seals anything, so that
+    // setting up a whole hook set costs one protection change per chunk
+    void BeginWrite();
+    void EndWrite();
+
+    // Returns nullptr once the arena is full. The memory can be written
+    // until the matching EndWrite, and can't run before it.
+    uint8_t* Alloc(size_t size);
+    // Gives back the unused tail of the most recent allocation
+    void Shrink(uint8_t* ptr, size_t size);
+
+    HookArenaStats Stats() const;
+
+private:
+    struct Chunk {
+        uint8_t* base;
+        size_t used;
+        // Everything below this is read + execute, everything above it
+        // read + write. Always a multiple of OS_PAGE_SIZE.
+        size_t sealed;
+    };
+
+    HookArenaOs& mOs;
+    Chunk mChunks[MAX_CHUNKS] = {};
+    size_t mChunkCount = 0;
+    size_t mAllocs = 0;
+    size_t mWriteDepth = 0;
+};
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace THPrac {
+
+// Stack frames of the detour backend in thprac_hook.cpp. DetourEntry is
+// reached from a stub that pushed the HookCtx, and leaves the game's stack
+// like this, from high to low addresses:
+//
+//     game's stack            <- Esp at the hook site, and pCtx->Esp
+//     HookCtx* self
+//     red zone                   DETOUR_RED_ZONE bytes
+//     EFlags, Eax ... Edi        pushfd, pushad
+//     padding, x87/SSE state     fxsave, 16 byte aligned
+//
+// On the way out, DetourReturnFrame is built right below whatever Esp the
+// callback left, and popad, popfd, ret pick it up from there.
+//
+// Doesn't depend on Windows, so thprac/tests/hook_detour_test.cpp can check it.
+
+// Room between the game's stack and the saved registers, so that callbacks
+// can push onto pCtx->Esp. A callback can move Esp down by at most this many
+// bytes before the return frame would land on the x87/SSE state.
+#define DETOUR_RED_ZONE 128
+
+// Register state saved by DetourEntry, in the order that pushfd/pushad leave it
+struct DetourFrame {
+    uint32_t Edi, Esi, Ebp, Esp, Ebx, Edx, Ecx, Eax;
+    uint32_t EFlags;
+    uint8_t red_zone[DETOUR_RED_ZONE];
+    uint32_t self;
+};
+static_assert(offsetof(DetourFrame, self) == 9 * sizeof(uint32_t) + DETOUR_RED_ZONE);
+
+// Built on the game's stack and consumed by popad, popfd, ret
+struct DetourReturnFrame {
+    uint32_t Edi, Esi, Ebp, Esp, Ebx, Edx, Ecx, Eax;
+    uint32_t EFlags;
+    uint32_t Eip;
+};
+
+// Fills in the integer registers, flags and Esp of ctx, which is a CONTEXT
+template <typename Context>
+void DetourLoadContext(const DetourFrame* frame, Context& ctx)
+{
+    ctx.Edi = frame->Edi;
+    ctx.Esi = frame->Esi;
+    ctx.Ebp = frame->Ebp;
+    ctx.Ebx = frame->Ebx;
+    ctx.Edx = frame->Edx;
+    ctx.Ecx = frame->Ecx;
+    ctx.Eax = frame->Eax;
+    ctx.EFlags = frame->EFlags;
+    // The stub's push isn't part of the game's stack
+    ctx.Esp = (uint32_t)(uintptr_t)(&frame->self + 1);
+}
+
+// Builds the return frame for ctx, after the callback ran. Returns nullptr if
+// the callback moved Esp down by more than DETOUR_RED_ZONE, since the frame
+// would then overwrite the x87/SSE state that DetourEntry still has to
+// restore.
+template <typename Context>
+DetourReturnFrame* DetourStoreContext(DetourFrame* frame, const Context& ctx)
+{
+    uint32_t entryEsp = (uint32_t)(uintptr_t)(&frame->self + 1);
+    if (ctx.Esp < entryEsp - DETOUR_RED_ZONE) {
+        return nullptr;
+    }
+    DetourReturnFrame* ret = (DetourReturnFrame*)(uintptr_t)ctx.Esp - 1;
+    ret->Edi = ctx.Edi;
+    ret->Esi = ctx.Esi;
+    ret->Ebp = ctx.Ebp;
+    ret->Ebx = ctx.Ebx;
+    ret->Edx = ctx.Edx;
+    ret->Ecx = ctx.Ecx;
+    ret->Eax = ctx.Eax;
+    ret->EFlags = ctx.EFlags;
+    ret->Eip = ctx.Eip;
+    return ret;
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace THPrac {
+
+// Open addressing table from breakpoint address to hook, looked up by
+// VEHHandler on every int3. Slots are only ever filled in and never removed,
+// and the value is written before the address, so a lookup running
+// concurrently with an insert can never see a half-written slot.
+//
+// Doesn't depend on Windows, so thprac/tests/hook_table_test.cpp can check and
+// benchmark it. A zero-initialized table is empty.
+template <typename T, size_t Bits = 11>
+struct HookTable {
+    static constexpr size_t SLOTS = (size_t)1 << Bits;
+    // At most half full, past that linear probing chains grow fast enough
+    // that std::unordered_map wins on strided addresses
+    static constexpr size_t MAX_COUNT = SLOTS / 2;
+
+    struct Slot {
+        uintptr_t addr;
+        T* value;
+    };
+    Slot slots[SLOTS];
+    size_t count;
+
+    static size_t Index(uintptr_t addr)
+    {
+        // Fibonacci hashing, hook addresses are often close together
+        return (uint32_t)((uint32_t)addr * 0x9E3779B1u) >> (32 - Bits);
+    }
+
+    // Returns false if the table is full. addr can't be 0, which marks a free
+    // slot.
+    bool Insert(uintptr_t addr, T* value)
+    {
+        for (size_t i = Index(addr);; i = (i + 1) & (SLOTS - 1)) {
+            Slot& slot = slots[i];
+            if (slot.addr == addr) {
+                slot.value = value;
+                return true;
+            }
+            if (!slot.addr) {
+                if (count >= MAX_COUNT) {
+                    return false;
+                }
+                slot.value = value;
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.addr = addr;
+                count++;
+                return true;
+            }
+        }
+    }
+
+    T* Find(uintptr_t addr) const
+    {
+        for (size_t i = Index(addr);; i = (i + 1) & (SLOTS - 1)) {
+            const Slot& slot = slots[i];
+            if (slot.addr == addr)
+                return slot.value;
+            if (!slot.addr)
+                return nullptr;
+        }
+    }
+};
+
+}
@@ -0,0 +1,422 @@
+#include "thprac_hook_x86.h"
+
+#include <string.h>
+#include <array>
+
+namespace THPrac {
+
+namespace {
+    enum : uint8_t {
+        X_MODRM = 1 << 0,
+        X_IMM8 = 1 << 1,
+        X_IMM16 = 1 << 2,
+        X_IMMZ = 1 << 3, // 32 bits, or 16 with an operand size prefix
+        X_REL8 = 1 << 4,
+        X_RELZ = 1 << 5,
+        X_PREFIX = 1 << 6,
+        X_INVALID = 1 << 7,
+    };
+
+    constexpr std::array<uint8_t, 256> MakeOneByteTable()
+    {
+        std::array<uint8_t, 256> t {};
+
+        // ALU ops: 00-3F, every row of 8 is op r/m,r (x4), op al,ib, op eax,iz, and two misc opcodes
+        for (int row = 0; row < 0x40; row += 8) {
+            t[row + 0] = t[row + 1] = t[row + 2] = t[row + 3] = X_MODRM;
+            t[row + 4] = X_IMM8;
+            t[row + 5] = X_IMMZ;
+        }
+        t[0x26] = t[0x2E] = t[0x36] = t[0x3E] = X_PREFIX;
+
+        t[0x62] = t[0x63] = X_MODRM;
+        t[0x64] = t[0x65] = t[0x66] = t[0x67] = X_PREFIX;
+        t[0x68] = X_IMMZ;
+        t[0x69] = X_MODRM | X_IMMZ;
+        t[0x6A] = X_IMM8;
+        t[0x6B] = X_MODRM | X_IMM8;
+
+        for (int i = 0x70; i <= 0x7F; i++)
+            t[i] = X_REL8;
+
+        t[0x80] = t[0x82] = t[0x83] = X_MODRM | X_IMM8;
+        t[0x81] = X_MODRM | X_IMMZ;
+        for (int i = 0x84; i <= 0x8F; i++)
+            t[i] = X_MODRM;
+
+        t[0x9A] = X_IMMZ | X_IMM16; // call far ptr16:32
+
+        t[0xA8] = X_IMM8;
+        t[0xA9] = X_IMMZ;
+        for (int i = 0xB0; i <= 0xB7; i++)
+            t[i] = X_IMM8;
+        for (int i = 0xB8; i <= 0xBF; i++)
+            t[i] = X_IMMZ;
+
+        t[0xC0] = t[0xC1] = X_MODRM | X_IMM8;
+        t[0xC2] = X_IMM16;
+        t[0xC4] = t[0xC5] = X_MODRM; // les/lds, or VEX (handled separately)
+        t[0xC6] = X_MODRM | X_IMM8;
+        t[0xC7] = X_MODRM | X_IMMZ;
+        t[0xC8] = X_IMM16 | X_IMM8;
+        t[0xCA] = X_IMM16;
+        t[0xCD] = X_IMM8;
+
+        t[0xD0] = t[0xD1] = t[0xD2] = t[0xD3] = X_MODRM;
+        t[0xD4] = t[0xD5] = X_IMM8;
+        for (int i = 0xD8; i <= 0xDF; i++)
+            t[i] = X_MODRM;
+
+        t[0xE0] = t[0xE1] = t[0xE2] = t[0xE3] = X_REL8;
+        t[0xE4] = t[0xE5] = t[0xE6] = t[0xE7] = X_IMM8;
+        t[0xE8] = t[0xE9] = X_RELZ;
+        t[0xEA] = X_IMMZ | X_IMM16; // jmp far ptr16:32
+        t[0xEB] = X_REL8;
+
+        t[0xF0] = t[0xF2] = t[0xF3] = X_PREFIX;
+        t[0xF6] = t[0xF7] = X_MODRM; // test takes an immediate (handled separately)
+        t[0xFE] = t[0xFF] = X_MODRM;
+        return t;
+    }
+
+    constexpr std::array<uint8_t, 256> MakeTwoByteTable()
+    {
+        std::array<uint8_t, 256> t {};
+        for (int i = 0; i < 256; i++)
+            t[i] = X_MODRM;
+
+        t[0x04] = t[0x0A] = t[0x0C] = X_INVALID;
+        t[0x05] = t[0x06] = t[0x07] = t[0x08] = t[0x09] = t[0x0B] = t[0x0E] = 0;
+        t[0x0F] = X_MODRM | X_IMM8; // 3DNow! suffix
+        for (int i = 0x30; i <= 0x37; i++)
+            t[i] = 0;
+        t[0x39] = t[0x3B] = t[0x3C] = t[0x3D] = t[0x3E] = t[0x3F] = X_INVALID;
+        t[0x70] = t[0x71] = t[0x72] = t[0x73] = X_MODRM | X_IMM8;
+        t[0x77] = 0;
+        t[0x7A] = t[0x7B] = X_INVALID;
+        for (int i = 0x80; i <= 0x8F; i++)
+            t[i] = X_RELZ;
+        t[0xA0] = t[0xA1] = t[0xA2] = t[0xA8] = t[0xA9] = t[0xAA] = 0;
+        t[0xA6] = t[0xA7] = X_INVALID;
+        t[0xA4] = t[0xAC] = t[0xBA] = X_MODRM | X_IMM8;
+        t[0xC2] = t[0xC4] = t[0xC5] = t[0xC6] = X_MODRM | X_IMM8;
+        for (int i = 0xC8; i <= 0xCF; i++)
+            t[i] = 0;
+        return t;
+    }
+
+    constexpr auto one_byte_table = MakeOneByteTable();
+    constexpr auto two_byte_table = MakeTwoByteTable();
+
+    constexpr size_t X86_MAX_INSN_LEN = 15;
+
+    // Returns the number of bytes taken by the ModRM byte, SIB and displacement
+    size_t ModRMLength(const uint8_t* p, bool addr16)
+    {
+        uint8_t modrm = p[0];
+        uint8_t mod = modrm >> 6;
+        uint8_t rm = modrm & 7;
+        if (mod == 3)
+            return 1;
+
+        if (addr16) {
+            if (mod == 0)
+                return rm == 6 ? 3 : 1;
+            return mod == 1 ? 2 : 3;
+        }
+
+        size_t len = 1;
+        if (rm == 4) {
+            len++;
+            if (mod == 0 && (p[1] & 7) == 5)
+                len += 4;
+        }
+        if (mod == 0 && rm == 5)
+            len += 4;
+        else if (mod == 1)
+            len += 1;
+        else if (mod == 2)
+            len += 4;
+        return len;
+    }
+}
+
+X86Insn X86Decode(const uint8_t* code)
+{
+    X86Insn insn = {};
+    const uint8_t* p = code;
+    bool opsize16 = false;
+    bool addr16 = false;
+
+    for (; p - code < (ptrdiff_t)X86_MAX_INSN_LEN && (one_byte_table[*p] & X_PREFIX); p++) {
+        if (*p == 0x66)
+            opsize16 = true;
+        else if (*p == 0x67)
+            addr16 = true;
+    }
+
+    uint8_t op = *p++;
+    uint8_t flags;
+    size_t imm_len = 0;
+    bool modrm_reg_only = false;
+
+    if (op == 0x0F) {
+        insn.two_byte = true;
+        op = *p++;
+        flags = two_byte_table[op];
+        // mov to/from control/debug registers ignores mod
+        modrm_reg_only = op >= 0x20 && op <= 0x27;
+        if (op == 0x38) {
+            op = *p++;
+            flags = X_MODRM;
+        } else if (op == 0x3A) {
+            op = *p++;
+            flags = X_MODRM | X_IMM8;
+        }
+    } else if ((op == 0xC4 || op == 0xC5) && (*p >> 6) == 3) {
+        // VEX. In 32 bit mode, les/lds can't have a register operand, which is
+        // how the two are told apart.
+        uint8_t map = 1;
+        if (op == 0xC4) {
+            map = *p & 0x1F;
+            p += 2;
+        } else {
+            p += 1;
+        }
+        insn.two_byte = true;
+        op = *p++;
+        if (map == 1)
+            flags = two_byte_table[op] & ~X_RELZ;
+        else if (map == 2)
+            flags = X_MODRM;
+        else if (map == 3)
+            flags = X_MODRM | X_IMM8;
+        else
+            return {};
+        flags |= X_MODRM;
+    } else {
+        flags = one_byte_table[op];
+        if (op == 0xA0 || op == 0xA1 || op == 0xA2 || op == 0xA3)
+            imm_len += addr16 ? 2 : 4; // moffs
+        else if (op == 0xF6 && (*p & 0x38) <= 0x08)
+            flags |= X_IMM8;
+        else if (op == 0xF7 && (*p & 0x38) <= 0x08)
+            flags |= X_IMMZ;
+    }
+
+    if (flags & X_INVALID)
+        return {};
+
+    if (modrm_reg_only)
+        p += 1;
+    else if (flags & X_MODRM)
+        p += ModRMLength(p, addr16);
+
+    if (flags & X_IMM8)
+        imm_len += 1;
+    if (flags & X_IMM16)
+        imm_len += 2;
+    if (flags & X_IMMZ)
+        imm_len += opsize16 ? 2 : 4;
+
+    if (flags & (X_REL8 | X_RELZ)) {
+        insn.rel_offset = (uint8_t)(p - code);
+        insn.rel_size = (flags & X_REL8) ? 1 : (opsize16 ? 2 : 4);
+        imm_len += insn.rel_size;
+    }
+
+    size_t len = (p - code) + imm_len;
+    if (len > X86_MAX_INSN_LEN)
+        return {};
+
+    insn.len = (uint8_t)len;
+    insn.opcode = op;
+    return insn;
+}
+
+size_t X86InsnBoundary(const uint8_t* code, size_t min_len)
+{
+    size_t len = 0;
+    while (len < min_len) {
+        X86Insn insn = X86Decode(code + len);
+        if (!insn.len)
+            return 0;
+        len += insn.len;
+    }
+    return len;
+}
+
+size_t X86Relocate(uint8_t* dst, size_t dst_size, const uint8_t* src, size_t src_len)
+{
+    constexpr size_t MAX_INSNS = 32;
+    X86Insn insns[MAX_INSNS];
+    size_t src_offs[MAX_INSNS + 1];
+    size_t dst_offs[MAX_INSNS + 1];
+    size_t count = 0;
+
+    // Pass 1: decode, and figure out where every instruction ends up
+    size_t src_off = 0;
+    size_t dst_off = 0;
+    while (src_off < src_len) {
+        if (count == MAX_INSNS)
+            return 0;
+        X86Insn insn = X86Decode(src + src_off);
+        if (!insn.len)
+            return 0;
+
+        size_t out_len = insn.len;
+        if (insn.rel_size == 2) {
+            // rel16 branches truncate Eip to 16 bits, nothing sane uses them
+            return 0;
+        } else if (insn.rel_size == 1) {
+            if (insn.len != 2)
+                return 0;
+            if (insn.opcode >= 0x70 && insn.opcode <= 0x7F)
+                out_len = 6; // jcc rel32
+            else if (insn.opcode == 0xEB)
+                out_len = 5; // jmp rel32
+            else
+                out_len = 9; // loop/jecxz +2; jmp +5; jmp rel32
+        }
+
+        insns[count] = insn;
+        src_offs[count] = src_off;
+        dst_offs[count] = dst_off;
+        count++;
+        src_off += insn.len;
+        dst_off += out_len;
+    }
+    src_offs[count] = src_off;
+    dst_offs[count] = dst_off;
+
+    if (src_off != src_len || dst_off > dst_size)
+        return 0;
+
+    // Branch targets inside the copied range have to be redirected to the copy
+    auto translate = [&](uintptr_t target) -> uintptr_t {
+        if (target < (uintptr_t)src || target >= (uintptr_t)src + src_len)
+            return target;
+        for (size_t i = 0; i <= count; i++) {
+            if ((uintptr_t)src + src_offs[i] == target)
+                return (uintptr_t)dst + dst_offs[i];
+        }
+        return target;
+    };
+
+    // Pass 2: emit
+    for (size_t i = 0; i < count; i++) {
+        const X86Insn& insn = insns[i];
+        const uint8_t* in = src + src_offs[i];
+        uint8_t* out = dst + dst_offs[i];
+        uint8_t* out_end = dst + dst_offs[i + 1];
+
+        if (!insn.rel_size) {
+            memcpy(out, in, insn.len);
+            continue;
+        }
+
+        uintptr_t target;
+        if (insn.rel_size == 1)
+            target = (uintptr_t)(in + insn.len) + (int8_t)in[insn.rel_offset];
+        else
+            target = (uintptr_t)(in + insn.len) + *(int32_t*)&in[insn.rel_offset];
+        target = translate(target);
+
+        if (insn.rel_size == 4) {
+            memcpy(out, in, insn.len);
+            *(uint32_t*)&out[insn.rel_offset] = (uint32_t)(target - (uintptr_t)out_end);
+        } else if (insn.opcode >= 0x70 && insn.opcode <= 0x7F) {
+            out[0] = 0x0F;
+            out[1] = 0x80 | (insn.opcode & 0x0F);
+            *(uint32_t*)&out[2] = (uint32_t)(target - (uintptr_t)out_end);
+        } else if (insn.opcode == 0xEB) {
+            out[0] = 0xE9;
+            *(uint32_t*)&out[1] = (uint32_t)(target - (uintptr_t)out_end);
+        } else {
+            // loop, loope, loopne and jecxz only exist in rel8 form
+            out[0] = in[0];
+            out[1] = 0x02;
+            out[2] = 0xEB;
+            out[3] = 0x05;
+            out[4] = 0xE9;
+            *(uint32_t*)&out[5] = (uint32_t)(target - (uintptr_t)out_end);
+        }
+    }
+    return dst_off;
+}
+
+size_t X86EmitCdeclThunk(uint8_t* dst, size_t dst_size, const X86RegArgs& args, uintptr_t target)
+{
+    if (args.reg_count > 4 || args.xmm_count > 8)
+        return 0;
+    size_t frame = (args.reg_count + args.xmm_count + args.stack_count) * 4;
+    // The last stack argument is read from past the frame and the return address
+    if (frame + 4 + args.stack_count * 4 > 0x7F)
+        return 0;
+
+    uint8_t code[X86_THUNK_MAX_LEN];
+    size_t len = 0;
+    // [esp + disp] as a ModRM operand, which needs a SIB byte
+    auto esp_operand = [&](uint8_t reg, size_t disp) {
+        if (disp) {
+            code[len++] = 0x44 | reg << 3;
+            code[len++] = 0x24;
+            code[len++] = (uint8_t)disp;
+        } else {
+            code[len++] = 0x04 | reg << 3;
+            code[len++] = 0x24;
+        }
+    };
+
+    size_t slot = 0;
+    code[len++] = 0x83; // sub esp, frame
+    code[len++] = 0xEC;
+    code[len++] = (uint8_t)frame;
+    for (size_t i = 0; i < args.reg_count; i++) {
+        if (args.regs[i] == X86_ESP)
+            return 0;
+        code[len++] = 0x89; // mov [esp + slot], reg
+        esp_operand(args.regs[i], slot);
+        slot += 4;
+    }
+    for (uint8_t i = 0; i < args.xmm_count; i++) {
+        code[len++] = 0xF3; // movss [esp + slot], xmm
+        code[len++] = 0x0F;
+        code[len++] = 0x11;
+        esp_operand(i, slot);
+        slot += 4;
+    }
+    for (size_t i = 0; i < args.stack_count; i++) {
+        code[len++] = 0x8B; // mov eax, [esp + frame + return address + i * 4]
+        esp_operand(X86_EAX, frame + 4 + i * 4);
+        code[len++] = 0x89; // mov [esp + slot], eax
+        esp_operand(X86_EAX, slot);
+        slot += 4;
+    }
+    code[len++] = 0xE8; // call target
+    len += 4;
+    size_t call_end = len;
+    code[len++] = 0x83; // add esp, frame
+    code[len++] = 0xC4;
+    code[len++] = (uint8_t)frame;
+    code[len++] = 0xC3; // ret
+
+    if (len > dst_size)
+        return 0;
+    memcpy(dst, code, len);
+    *(uint32_t*)&dst[call_end - 4] = (uint32_t)(target - (uintptr_t)(dst + call_end));
+    return len;
+}
+
+size_t X86EmitDetourStub(uint8_t* dst, size_t dst_size, uint32_t arg, uintptr_t target)
+{
+    if (dst_size < X86_DETOUR_STUB_LEN)
+        return 0;
+    dst[0] = 0x68; // push arg
+    *(uint32_t*)&dst[1] = arg;
+    dst[5] = 0xE9; // jmp target
+    *(uint32_t*)&dst[6] = (uint32_t)(target - (uintptr_t)(dst + X86_DETOUR_STUB_LEN));
+    return X86_DETOUR_STUB_LEN;
+}
+
+}
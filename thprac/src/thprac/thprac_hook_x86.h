@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace THPrac {
+
+// Minimal x86-32 instruction length decoder, used to copy the instructions
+// that a hook overwrites into its codecave.
+struct X86Insn {
+    uint8_t len; // 0 if the instruction could not be decoded
+    uint8_t rel_offset; // Offset of the relative branch operand, 0 if there is none
+    uint8_t rel_size; // Size of the relative branch operand in bytes
+    uint8_t opcode; // Last opcode byte
+    bool two_byte; // Opcode was prefixed with 0F
+};
+
+X86Insn X86Decode(const uint8_t* code);
+
+// Length of the shortest run of whole instructions at code that covers at
+// least min_len bytes, or 0 if something in that range can't be decoded
+size_t X86InsnBoundary(const uint8_t* code, size_t min_len);
+
+// Copies the whole instructions in src[0, src_len) to dst, rewriting relative
+// branches so that they still reach the same targets from their new location.
+// Short branches are widened to rel32 forms, and branches that target an
+// instruction inside the copied range are pointed at its copy instead.
+// Returns the number of bytes written, or 0 on failure.
+size_t X86Relocate(uint8_t* dst, size_t dst_size, const uint8_t* src, size_t src_len);
+
+enum X86Reg : uint8_t {
+    X86_EAX,
+    X86_ECX,
+    X86_EDX,
+    X86_EBX,
+    X86_ESP,
+    X86_EBP,
+    X86_ESI,
+    X86_EDI,
+};
+
+// Arguments passed in a way that no calling convention can declare: first in
+// general purpose registers, then one float each in XMM0 and up, then dwords
+// on the stack, which the caller pops.
+struct X86RegArgs {
+    uint8_t reg_count;
+    X86Reg regs[4];
+    uint8_t xmm_count;
+    uint8_t stack_count;
+};
+
+// Enough for any frame that X86EmitCdeclThunk accepts
+constexpr size_t X86_THUNK_MAX_LEN = 160;
+
+// Writes a thunk to dst that takes arguments as described by args, copies
+// them into a cdecl frame in the same order, calls target, and returns with a
+// plain ret. The thunk runs from dst, and clobbers EAX, ECX, EDX and the XMM
+// registers just like a cdecl function would. Returns the number of bytes
+// written, or 0 if dst_size is too small or the frame doesn't fit a disp8.
+size_t X86EmitCdeclThunk(uint8_t* dst, size_t dst_size, const X86RegArgs& args, uintptr_t target);
+
+constexpr size_t X86_DETOUR_STUB_LEN = 10;
+
+// Writes push arg; jmp target to dst, which is how a detour hook site hands
+// its HookCtx to DetourEntry. Returns the number of bytes written, or 0 if
+// dst_size is too small.
+size_t X86EmitDetourStub(uint8_t* dst, size_t dst_size, uint32_t arg, uintptr_t target);
+
+}
@@ -27,17 +27,11 @@ void RemoteInit()
     if (!GetExeInfoEx((uintptr_t)GetCurrentProcess(), base, exeSig))
         THREAD_RETURN(InjectResult::Ok, 0);
 
-    for (auto& gameDef : gGameDefs) {
-        if (gameDef.catagory != CAT_MAIN && gameDef.catagory != CAT_SPINOFF_STG) {
-            continue;
+    auto gameDef = FindGameDefByHeader(exeSig);
+    if (gameDef && (gameDef->catagory == CAT_MAIN || gameDef->catagory == CAT_SPINOFF_STG)) {
+        if (gameDef->initFunc) {
+            gameDef->initFunc();
         }
-        if (gameDef.exeSig.textSize != exeSig.textSize || gameDef.exeSig.timeStamp != exeSig.timeStamp) {
-            continue;
-        }
-        if (gameDef.initFunc) {
-            gameDef.initFunc();
-        }
-        break;
     }
 
     // This has to be ExitThread, because making wWinMain return will destruct any static classes 
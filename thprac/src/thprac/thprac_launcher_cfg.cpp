@@ -1,4 +1,5 @@
 ﻿#include "thprac_launcher_cfg.h"
+#include "thprac_launcher_cfg_writer.h"
 #include "thprac_gui_locale.h"
 #include "thprac_launcher_main.h"
 #include "thprac_launcher_games.h"
@@ -10,6 +11,7 @@
 #include "..\..\resource.h"
 #include <Windows.h>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <format>
@@ -31,8 +33,15 @@ std::wstring* gCfgPath = nullptr;
 int gCfgIsLocalDir = 0;
 bool gCfgLocalBackupAvaliable = false;
 bool gCfgReadOnly = false;
-HANDLE gCfgHnd = INVALID_HANDLE_VALUE;
+bool gCfgOpen = false;
+CfgWriter* gCfgWriter = nullptr;
+int gCfgSettingsSubscriber = -1;
 rapidjson::Document gCfgJson;
+SettingRegistry gSettings;
+
+// Settings can change every frame while a slider is dragged
+constexpr auto CFG_WRITE_DEBOUNCE = std::chrono::milliseconds(300);
+constexpr auto CFG_WRITE_MAX_DELAY = std::chrono::milliseconds(2000);
 
 void LauncherAquireDataDirVar()
 {
@@ -77,22 +86,81 @@ std::wstring LauncherGetDataDir()
     return *gCfgPath;
 }
 
-bool LauncherCfgWrite()
+// Written next to the config and then renamed over it, so a crash or a
+// power cut halfway leaves either the old file or the new one, never half of
+// each. Readers open it with FILE_SHARE_DELETE so the rename can go through.
+static bool LauncherCfgWriteFile(const std::wstring& path, const std::string& data)
 {
-    if (gCfgHnd == INVALID_HANDLE_VALUE) {
+    auto tmpPath = path + L".tmp";
+    HANDLE hFile = CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
         return false;
     }
+    DWORD bytesProcessed;
+    BOOL written = WriteFile(hFile, data.data(), (DWORD)data.size(), &bytesProcessed, nullptr) && bytesProcessed == data.size() && FlushFileBuffers(hFile);
+    CloseHandle(hFile);
+    if (!written || !MoveFileExW(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileW(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
 
-    rapidjson::StringBuffer sb;
-    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
-    gCfgJson.Accept(writer);
-
-    auto jsonStr = sb.GetString();
-    auto jsonStrLen = strlen(jsonStr);
+static bool LauncherCfgReadFile(const std::wstring& path, std::string& data)
+{
+    HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    defer(CloseHandle(hFile));
+    DWORD fileSize = GetFileSize(hFile, nullptr);
+    if (fileSize == INVALID_FILE_SIZE) {
+        return false;
+    }
+    data.resize(fileSize);
     DWORD bytesProcessed;
-    SetFilePointer(gCfgHnd, 0, nullptr, FILE_BEGIN);
-    SetEndOfFile(gCfgHnd);
-    return WriteFile(gCfgHnd, jsonStr, jsonStrLen, &bytesProcessed, nullptr);
+    return !fileSize || (ReadFile(hFile, data.data(), fileSize, &bytesProcessed, nullptr) && bytesProcessed == fileSize);
+}
+
+rapidjson::Value& GetCfgSettingsJson()
+{
+    if (gCfgJson.HasMember("settings")) {
+        if (!gCfgJson["settings"].IsObject()) {
+            gCfgJson["settings"].SetObject();
+        }
+    } else {
+        rapidjson::Document settingsJson;
+        settingsJson.SetObject();
+        JsonAddMemberA(gCfgJson, "settings", settingsJson, gCfgJson.GetAllocator());
+    }
+    return gCfgJson["settings"];
+}
+
+// Only queues the write. The writer thread gets its own copy of the document,
+// so the caller can keep changing gCfgJson right away.
+bool LauncherCfgWrite()
+{
+    if (!gCfgWriter) {
+        return false;
+    }
+
+    gSettings.Save(GetCfgSettingsJson(), gCfgJson.GetAllocator());
+    auto snapshot = std::make_shared<rapidjson::Document>();
+    snapshot->CopyFrom(gCfgJson, snapshot->GetAllocator());
+    gCfgWriter->Submit([snapshot]() {
+        rapidjson::StringBuffer sb;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+        snapshot->Accept(writer);
+        return std::string(sb.GetString(), sb.GetSize());
+    });
+    return true;
+}
+// A game reads thprac.json itself once thprac is loaded into it, so this has
+// to run before anything is launched or injected, or the game would miss the
+// settings that are still queued
+bool LauncherCfgFlush()
+{
+    return gCfgWriter ? gCfgWriter->Flush() : true;
 }
 rapidjson::Document& LauncherCfgGet()
 {
@@ -100,7 +168,7 @@ rapidjson::Document& LauncherCfgGet()
 }
 bool LauncherCfgInit(bool noCreate)
 {
-    if (gCfgHnd != INVALID_HANDLE_VALUE) {
+    if (gCfgOpen) {
         return true;
     }
 
@@ -108,170 +176,125 @@ bool LauncherCfgInit(bool noCreate)
     CreateDirectoryW(dataDir.c_str(), nullptr);
     std::wstring jsonPath = dataDir + L"thprac.json";
 
-    DWORD openFlag = noCreate ? OPEN_EXISTING : OPEN_ALWAYS;
-    DWORD openAccess = noCreate ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
-    gCfgHnd = CreateFileW(jsonPath.c_str(), openAccess, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, openFlag, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (gCfgHnd == INVALID_HANDLE_VALUE) {
-        return false;
-    }
-
-    DWORD bytesProcessed;
-    auto fileSize = GetFileSize(gCfgHnd, nullptr);
-    auto fileBuffer = malloc(fileSize + 1);
-    memset(fileBuffer, 0, fileSize + 1);
-    if (!ReadFile(gCfgHnd, fileBuffer, fileSize, &bytesProcessed, nullptr)) {
+    std::string json;
+    if (!LauncherCfgReadFile(jsonPath, json) && noCreate) {
         return false;
     }
 
-    if (gCfgJson.Parse((const char*)fileBuffer, fileSize + 1).HasParseError()) {
+    bool parsed = !gCfgJson.Parse(json.data(), json.size()).HasParseError() && gCfgJson.IsObject();
+    if (!parsed) {
         gCfgJson.SetObject();
-        return LauncherCfgWrite();
     }
-
+    rapidjson::Value noSettings;
+    auto settingsJson = gCfgJson.FindMember("settings");
+    gSettings.Load(settingsJson != gCfgJson.MemberEnd() ? settingsJson->value : noSettings);
+    if (!noCreate) {
+        gCfgWriter = new CfgWriter([jsonPath](const std::string& data) { return LauncherCfgWriteFile(jsonPath, data); },
+            CFG_WRITE_DEBOUNCE, CFG_WRITE_MAX_DELAY);
+        gCfgSettingsSubscriber = gSettings.Subscribe([](SettingId) { LauncherCfgWrite(); });
+    }
+    gCfgOpen = true;
     gCfgReadOnly = noCreate;
+
+    if (!parsed) {
+        if (noCreate) {
+            LauncherCfgClose();
+            return false;
+        }
+        LauncherCfgWrite();
+        return gCfgWriter->Flush();
+    }
     return true;
 }
 void LauncherCfgClose()
 {
-    if (gCfgHnd != INVALID_HANDLE_VALUE) {
-        if (!gCfgReadOnly) {
+    if (gCfgOpen) {
+        if (gCfgWriter) {
+            gSettings.Unsubscribe(gCfgSettingsSubscriber);
+            gCfgSettingsSubscriber = -1;
             LauncherCfgWrite();
+            // Waits for every queued write to land
+            delete gCfgWriter;
+            gCfgWriter = nullptr;
         }
-        CloseHandle(gCfgHnd);
         gCfgReadOnly = false;
-        gCfgHnd = INVALID_HANDLE_VALUE;
+        gCfgOpen = false;
         delete gCfgPath;
         gCfgPath = nullptr;
     }
 }
 
-rapidjson::Value& GetCfgSettingsJson()
+/// Settings
+/// ------------------
+const SettingHandle<int> SETTING_LANGUAGE = gSettings.DeclareInt("language", 0, 0, 2);
+const SettingHandle<bool> SETTING_ALWAYS_OPEN_LAUNCHER = gSettings.DeclareBool("always_open_launcher", false);
+const SettingHandle<int> SETTING_AFTER_LAUNCH = gSettings.DeclareInt("after_launch", 0, 0, 2);
+const SettingHandle<bool> SETTING_AUTO_DEFAULT_LAUNCH = gSettings.DeclareBool("auto_default_launch", false);
+const SettingHandle<int> SETTING_APPLY_THPRAC_DEFAULT = gSettings.DeclareInt("apply_thprac_default", 0, 0, 2);
+const SettingHandle<int> SETTING_FILTER_DEFAULT = gSettings.DeclareInt("filter_default", 0, 0, 2);
+// 3 is a user theme, named by theme_user
+const SettingHandle<int> SETTING_THEME = gSettings.DeclareInt("theme", 0, 0, 3);
+const SettingHandle<std::string> SETTING_THEME_USER = gSettings.DeclareString("theme_user", "");
+const SettingHandle<bool> SETTING_USE_RELATIVE_PATH = gSettings.DeclareBool("use_relative_path", false);
+const SettingHandle<std::string> SETTING_THCRAP = gSettings.DeclareString("thcrap", "");
+const SettingHandle<bool> SETTING_CHECK_UPDATE = gSettings.DeclareBool("check_update", true);
+const SettingHandle<bool> SETTING_RESIZABLE_WINDOW = gSettings.DeclareBool("resizable_window", false);
+const SettingHandle<bool> SETTING_REFLECTIVE_LAUNCH = gSettings.DeclareBool("reflective_launch", false);
+const SettingHandle<int> SETTING_EXISTING_GAME_LAUNCH_ACTION = gSettings.DeclareInt("existing_game_launch_action", 0, 0, 2);
+const SettingHandle<bool> SETTING_DONT_SEARCH_ONGOING_GAME = gSettings.DeclareBool("dont_search_ongoing_game", false);
+const SettingHandle<bool> SETTING_THPRAC_ADMIN_RIGHTS = gSettings.DeclareBool("thprac_admin_rights", false);
+const SettingHandle<bool> SETTING_RENDER_ONLY_USED_GLYPHS = gSettings.DeclareBool("render_only_used_glyphs", false);
+const SettingHandle<int> SETTING_CHECK_UPDATE_TIMING = gSettings.DeclareInt("check_update_timing", 0, 0, 2);
+const SettingHandle<bool> SETTING_UPDATE_WITHOUT_CONFIRMATION = gSettings.DeclareBool("update_without_confirmation", false);
+const SettingHandle<int> SETTING_FILENAME_AFTER_UPDATE = gSettings.DeclareInt("filename_after_update", 0, 0, 2);
+
+bool LauncherSettingGet(SettingHandle<bool> setting)
 {
-    if (gCfgJson.HasMember("settings")) {
-        if (!gCfgJson["settings"].IsObject()) {
-            gCfgJson["settings"].SetObject();
-        }
-    } else {
-        rapidjson::Document settingsJson;
-        settingsJson.SetObject();
-        JsonAddMemberA(gCfgJson, "settings", settingsJson, gCfgJson.GetAllocator());
-    }
-    return gCfgJson["settings"];
-}
-bool LauncherSettingGet(const char* name, int& valueOut)
-{
-    if (gCfgJson.HasMember("settings") && gCfgJson["settings"].IsObject()) {
-        auto& settingsJson = gCfgJson["settings"];
-        if (settingsJson.HasMember(name) && settingsJson[name].IsInt()) {
-            valueOut = settingsJson[name].GetInt();
-            return true;
-        }
-    }
-    return false;
+    return gSettings.Get(setting);
 }
-bool LauncherSettingGet(const char* name, unsigned int& valueOut)
+int LauncherSettingGet(SettingHandle<int> setting)
 {
-    if (gCfgJson.HasMember("settings") && gCfgJson["settings"].IsObject()) {
-        auto& settingsJson = gCfgJson["settings"];
-        if (settingsJson.HasMember(name) && settingsJson[name].IsUint()) {
-            valueOut = settingsJson[name].GetUint();
-            return true;
-        }
-    }
-    return false;
+    return gSettings.Get(setting);
 }
-bool LauncherSettingGet(const char* name, bool& valueOut)
+float LauncherSettingGet(SettingHandle<float> setting)
 {
-    if (gCfgJson.HasMember("settings") && gCfgJson["settings"].IsObject()) {
-        auto& settingsJson = gCfgJson["settings"];
-        if (settingsJson.HasMember(name) && settingsJson[name].IsBool()) {
-            valueOut = settingsJson[name].GetBool();
-            return true;
-        }
-    }
-    return false;
+    return gSettings.Get(setting);
 }
-bool LauncherSettingGet(const char* name, float& valueOut)
+const std::string& LauncherSettingGet(SettingHandle<std::string> setting)
 {
-    if (gCfgJson.HasMember("settings") && gCfgJson["settings"].IsObject()) {
-        auto& settingsJson = gCfgJson["settings"];
-        if (settingsJson.HasMember(name) && settingsJson[name].IsFloat()) {
-            valueOut = settingsJson[name].GetFloat();
-            return true;
-        }
-    }
-    return false;
+    return gSettings.Get(setting);
 }
-bool LauncherSettingGet(const char* name, const char*& valueOut)
+bool LauncherSettingIsSet(SettingId setting)
 {
-    if (gCfgJson.HasMember("settings") && gCfgJson["settings"].IsObject()) {
-        auto& settingsJson = gCfgJson["settings"];
-        if (settingsJson.HasMember(name) && settingsJson[name].IsString()) {
-            valueOut = settingsJson[name].GetString();
-            return true;
-        }
-    }
-    return false;
+    return gSettings.IsSet(setting);
 }
-bool LauncherSettingGet(const char* name, std::string& valueOut)
+bool LauncherSettingSet(SettingHandle<bool> setting, bool valueIn)
 {
-    const char* _valueOut;
-    if (LauncherSettingGet(name, _valueOut)) {
-        valueOut = _valueOut;
-        return true;
-    } else {
-        return false;
-    }
+    return gSettings.Set(setting, valueIn);
 }
-void LauncherSettingSet(const char* name, int& valueIn)
+bool LauncherSettingSet(SettingHandle<int> setting, int valueIn)
 {
-    auto& settingsJson = GetCfgSettingsJson();
-    if (settingsJson.HasMember(name)) {
-        settingsJson.RemoveMember(name);
-    }
-    JsonAddMember(settingsJson, name, valueIn, gCfgJson.GetAllocator());
-    LauncherCfgWrite();
+    return gSettings.Set(setting, valueIn);
 }
-void LauncherSettingSet(const char* name, unsigned int& valueIn)
+bool LauncherSettingSet(SettingHandle<float> setting, float valueIn)
 {
-    auto& settingsJson = GetCfgSettingsJson();
-    if (settingsJson.HasMember(name)) {
-        settingsJson.RemoveMember(name);
-    }
-    JsonAddMember(settingsJson, name, valueIn, gCfgJson.GetAllocator());
-    LauncherCfgWrite();
+    return gSettings.Set(setting, valueIn);
 }
-void LauncherSettingSet(const char* name, bool& valueIn)
+bool LauncherSettingSet(SettingHandle<std::string> setting, const std::string& valueIn)
 {
-    auto& settingsJson = GetCfgSettingsJson();
-    if (settingsJson.HasMember(name)) {
-        settingsJson.RemoveMember(name);
-    }
-    JsonAddMember(settingsJson, name, valueIn, gCfgJson.GetAllocator());
-    LauncherCfgWrite();
+    return gSettings.Set(setting, valueIn);
 }
-void LauncherSettingSet(const char* name, float& valueIn)
+int LauncherSettingSubscribe(SettingRegistry::ChangeFunc onChange)
 {
-    auto& settingsJson = GetCfgSettingsJson();
-    if (settingsJson.HasMember(name)) {
-        settingsJson.RemoveMember(name);
-    }
-    JsonAddMember(settingsJson, name, valueIn, gCfgJson.GetAllocator());
-    LauncherCfgWrite();
-}
-void LauncherSettingSet(const char* name, const char* valueIn) {
-    auto& settingsJson = GetCfgSettingsJson();
-    if (settingsJson.HasMember(name)) {
-        settingsJson.RemoveMember(name);
-    }
-    JsonAddMemberA(settingsJson, name, valueIn, gCfgJson.GetAllocator());
-    LauncherCfgWrite();
+    return gSettings.Subscribe(std::move(onChange));
 }
-void LauncherSettingSet(const char* name, const std::string& valueIn)
+void LauncherSettingUnsubscribe(int id)
 {
-    LauncherSettingSet(name, valueIn.c_str());
+    gSettings.Unsubscribe(id);
 }
 
+/// ------------------
+
 bool SetTheme(int themeId, const wchar_t* userThemeName)
 {
     switch (themeId) {
@@ -399,95 +422,47 @@ bool SetTheme(int themeId, const wchar_t* userThemeName)
     return true;
 }
 
+// Reads and writes straight through the registry, so a page always shows what
+// is in the config, and nothing is looked up by name while it's drawn
 template <typename T>
 class THSetting {
 public:
     THSetting() = delete;
-    THSetting(const char* _name, T _value)
-    {
-        name = _name;
-        value = _value;
-        Init();
-    }
-    virtual void Init() final
-    {
-        if (!LauncherSettingGet(name.c_str(), value)) {
-            LauncherSettingSet(name.c_str(), value);
-        }
-    }
-    virtual T& Get()
-    {
-        return value;
-    }
-    virtual void Set(T& _value)
-    {
-        value = _value;
-        LauncherSettingSet(name.c_str(), value);
-    }
-    virtual void Set()
-    {
-        LauncherSettingSet(name.c_str(), value);
-    }
-
-protected:
-    std::string name;
-    T value;
-};
-
-template <>
-class THSetting<std::string> {
-public:
-    THSetting() = delete;
-    THSetting(const char* _name, const char* _value)
-    {
-        name = _name;
-        value = _value;
-        Init();
-    }
-    THSetting(const char* _name, std::string _value)
+    THSetting(SettingHandle<T> _setting)
+        : setting(_setting)
     {
-        name = _name;
-        value = _value;
         Init();
     }
     virtual void Init() final
     {
-        if (!LauncherSettingGet(name.c_str(), value)) {
-            LauncherSettingSet(name.c_str(), value);
+        if (!LauncherSettingIsSet(setting)) {
+            LauncherSettingSet(setting, LauncherSettingGet(setting));
         }
     }
-    virtual std::string& Get()
+    decltype(auto) Get()
     {
-        return value;
+        return LauncherSettingGet(setting);
     }
-    virtual void Set(const std::string& _value)
+    virtual void Set(const T& _value)
     {
-        value = _value;
-        LauncherSettingSet(name.c_str(), value);
-    }
-    virtual void Set()
-    {
-        LauncherSettingSet(name.c_str(), value);
+        LauncherSettingSet(setting, _value);
     }
 
 protected:
-    std::string name;
-    std::string value;
+    SettingHandle<T> setting;
 };
 
 class THCfgCheckboxEx : public THSetting<bool> {
 public:
-    THCfgCheckboxEx(const char* _name, bool _value)
-        : THSetting(_name, _value)
+    THCfgCheckboxEx(SettingHandle<bool> _setting)
+        : THSetting(_setting)
     {
     }
     bool Gui(const char* guiTxt, const char* helpTxt = nullptr)
     {
-        bool result = false;
-        if (ImGui::Checkbox(guiTxt, &value)) {
-            value = !value;
-            result = true;
-        }
+        // The click is only reported, Toggle is what changes the setting
+        bool value = Get();
+        bool result = ImGui::Checkbox(guiTxt, &value);
         if (helpTxt) {
             ImGui::SameLine();
             GuiHelpMarker(helpTxt);
@@ -496,21 +471,21 @@ public:
     }
     void Toggle()
     {
-        value = !value;
-        LauncherSettingSet(name.c_str(), value);
+        Set(!Get());
     }
 };
 
 class THCfgCheckbox : public THSetting<bool> {
 public:
-    THCfgCheckbox(const char* _name, bool _value)
-        : THSetting(_name, _value)
+    THCfgCheckbox(SettingHandle<bool> _setting)
+        : THSetting(_setting)
     {
     }
     void Gui(const char* guiTxt, const char* helpTxt = nullptr)
     {
+        bool value = Get();
         if (ImGui::Checkbox(guiTxt, &value)) {
-            LauncherSettingSet(name.c_str(), value);
+            Set(value);
         }
         if (helpTxt) {
             ImGui::SameLine();
@@ -519,25 +494,12 @@ public:
     }
 };
 
+// The options in guiCombo have to match the range the setting was declared with
 class THCfgCombo : public THSetting<int> {
 public:
-    THCfgCombo(const char* _name, int _value, int _counts)
-        : THSetting(_name, _value)
+    THCfgCombo(SettingHandle<int> _setting)
+        : THSetting(_setting)
     {
-        counts = _counts;
-        Check(_value);
-    }
-    void Check(int def = 0)
-    {
-        if (value < 0 || value >= counts) {
-            value = def;
-        }
-    }
-    virtual void Set(int& _value) override
-    {
-        value = _value;
-        LauncherSettingSet(name.c_str(), value);
-        Check();
     }
     bool Gui(const char* guiTxt, const char* guiCombo, const char* helpTxt = nullptr)
     {
@@ -546,10 +508,11 @@ public:
         std::string txtTmp = "##";
         txtTmp += guiTxt;
         ImGui::PushItemWidth(620.0f - ImGui::GetWindowSize().x);
+        int value = Get();
         auto result = ImGui::Combo(txtTmp.c_str(), &value, guiCombo);
         ImGui::PopItemWidth();
         if (result) {
-            LauncherSettingSet(name.c_str(), value);
+            Set(value);
         }
         if (helpTxt) {
             ImGui::SameLine();
@@ -557,9 +520,6 @@ public:
         }
         return result;
     }
-
-private:
-    int counts;
 };
 
 class THUpdate {
@@ -582,9 +542,7 @@ public:
 
     void PeekUpdate()
     {
-        int chkUpdate = 0;
-        LauncherSettingGet("check_update_timing", chkUpdate);
-        if (!chkUpdate && mChkUpdStatus == STATUS_RSV) {
+        if (!LauncherSettingGet(SETTING_CHECK_UPDATE_TIMING) && mChkUpdStatus == STATUS_RSV) {
             mUpdateThread.Stop();
             mUpdateThread.Start();
         }
@@ -1237,8 +1195,7 @@ public:
             }
 
             if (LauncherCfgInit()) {
-                bool useRelPath = mCfgRelativePath && gCfgIsLocalDir;
-                LauncherSettingSet("use_relative_path", useRelPath);
+                LauncherSettingSet(SETTING_USE_RELATIVE_PATH, mCfgRelativePath && gCfgIsLocalDir);
                 LauncherGamesForceReload();
                 LauncherCfgClose();
             }
@@ -1262,25 +1219,22 @@ private:
         mOriginalLanguage = mCfgLanguage.Get();
         UpdateThemesList();
 
-        if ((unsigned int)mCfgTheme.Get() > 2) {
-            // I use the fact that THCfgCombo::Set (due to how THSetting::Set works)
-            // only accepts references as an excuse to call this variable a funny
-            int Sus = 0;
+        if (mCfgTheme.Get() > 2) {
             bool configThemeExists = false;
-            const char* cur_theme = nullptr;
-            if (!LauncherSettingGet("theme_user", cur_theme)) {
-                mCfgTheme.Set(Sus);
+            if (!LauncherSettingIsSet(SETTING_THEME_USER)) {
+                mCfgTheme.Set(0);
                 return;
             }
+            auto& cur_theme = LauncherSettingGet(SETTING_THEME_USER);
             for (size_t i = 0; i < userThemes.size(); i++) {
-                if (!strcmp(userThemes[i].utf8, cur_theme)) {
+                if (cur_theme == userThemes[i].utf8) {
                     userThemeIdx = i;
                     configThemeExists = true;
                     break;
                 }
             }
             if (!configThemeExists) {
-                mCfgTheme.Set(Sus);
+                mCfgTheme.Set(0);
             }
         }
     }
@@ -1694,14 +1648,13 @@ private:
         ImGui::Separator();
         int theme_prev = mCfgTheme.Get();
         if (mCfgTheme.Gui(S(THPRAC_THEME), "Dark\0Light\0Classic\0Custom\0\0")) {
-            int Sus = 0;
             if (mCfgTheme.Get() > 2) {
                 UpdateThemesList();
-                themeIsUser = (unsigned int)theme_prev > 2;
+                themeIsUser = theme_prev > 2;
                 if (userThemes.size() == 0) {
-                    mCfgTheme.Set(themeIsUser ? Sus : theme_prev);
+                    mCfgTheme.Set(themeIsUser ? 0 : theme_prev);
                 } else if (!themeIsUser) {
-                    LauncherSettingSet("theme_user", userThemes[0].utf8);
+                    LauncherSettingSet(SETTING_THEME_USER, userThemes[0].utf8);
                     SetTheme(mCfgTheme.Get(), userThemes[userThemeIdx].utf16);
                     themeIsUser = true;
                 }
@@ -1716,7 +1669,7 @@ private:
                 if (ImGui::Selectable(userThemes[i].utf8, selected)) {
                     userThemeIdx = i;
                     SetTheme(mCfgTheme.Get(), userThemes[userThemeIdx].utf16);
-                    LauncherSettingSet("theme_user", userThemes[userThemeIdx].utf8);
+                    LauncherSettingSet(SETTING_THEME_USER, userThemes[userThemeIdx].utf8);
                 }
                 if (selected) {
                     ImGui::SetItemDefaultFocus();
@@ -1744,7 +1697,7 @@ private:
         ImGui::Separator();
         mCfgLanguage.Gui(S(THPRAC_LANGUAGE), (const char*)u8"中文\0English\0日本語\0\0");
         if (mOriginalLanguage != mCfgLanguage.Get()) {
-            ImGui::TextUnformatted(th_glossary_str[mCfgLanguage.Get()][THPRAC_LANGUAGE_HINT]);
+            ImGui::TextUnformatted(Gui::LocaleGetStr((Gui::locale_t)mCfgLanguage.Get(), THPRAC_LANGUAGE_HINT));
         }
         ImGui::NewLine();
 
@@ -1812,26 +1765,26 @@ private:
         ImGui::Text(S(TH_ABOUT_THANKS), "You!");
     }
 
-    THCfgCombo mCfgLanguage { "language", 0, 3 };
-    THCfgCheckbox mCfgAlwaysOpen { "always_open_launcher", false };
-    THCfgCombo mCfgAfterLaunch { "after_launch", 0, 3 };
-    THCfgCheckbox mAutoDefLaunch { "auto_default_launch", false };
-    THCfgCombo mCfgThpracDefault { "apply_thprac_default", 0, 3 };
-    THCfgCombo mCfgFilterDefault { "filter_default", 0, 3 };
-    THCfgCombo mCfgTheme { "theme", 0, 4 };
-    THSetting<bool> mUseRelativePath { "use_relative_path", false };
-    THSetting<std::string> mThcrap { "thcrap", "" };
-    THCfgCheckbox mCfgCheckUpdate { "check_update", true };
-
-    THCfgCheckbox mResizableWindow { "resizable_window", false };
-    THCfgCheckbox mReflectiveLaunch { "reflective_launch", false };
-    THCfgCombo mExistingGameAction { "existing_game_launch_action", 0, 3 };
-    THCfgCheckbox mDontSearchOngoingGame { "dont_search_ongoing_game", false };
-    THCfgCheckbox mAdminRights { "thprac_admin_rights", false };
-    THCfgCheckbox mRenderOnlyUsedGlyphs { "render_only_used_glyphs", false };
-    THCfgCombo mCheckUpdateTiming { "check_update_timing", 0, 3 };
-    THCfgCheckbox mUpdateWithoutConfirm { "update_without_confirmation", false };
-    THCfgCombo mFilenameAfterUpdate { "filename_after_update", 0, 3 };
+    THCfgCombo mCfgLanguage { SETTING_LANGUAGE };
+    THCfgCheckbox mCfgAlwaysOpen { SETTING_ALWAYS_OPEN_LAUNCHER };
+    THCfgCombo mCfgAfterLaunch { SETTING_AFTER_LAUNCH };
+    THCfgCheckbox mAutoDefLaunch { SETTING_AUTO_DEFAULT_LAUNCH };
+    THCfgCombo mCfgThpracDefault { SETTING_APPLY_THPRAC_DEFAULT };
+    THCfgCombo mCfgFilterDefault { SETTING_FILTER_DEFAULT };
+    THCfgCombo mCfgTheme { SETTING_THEME };
+    THSetting<bool> mUseRelativePath { SETTING_USE_RELATIVE_PATH };
+    THSetting<std::string> mThcrap { SETTING_THCRAP };
+    THCfgCheckbox mCfgCheckUpdate { SETTING_CHECK_UPDATE };
+
+    THCfgCheckbox mResizableWindow { SETTING_RESIZABLE_WINDOW };
+    THCfgCheckbox mReflectiveLaunch { SETTING_REFLECTIVE_LAUNCH };
+    THCfgCombo mExistingGameAction { SETTING_EXISTING_GAME_LAUNCH_ACTION };
+    THCfgCheckbox mDontSearchOngoingGame { SETTING_DONT_SEARCH_ONGOING_GAME };
+    THCfgCheckbox mAdminRights { SETTING_THPRAC_ADMIN_RIGHTS };
+    THCfgCheckbox mRenderOnlyUsedGlyphs { SETTING_RENDER_ONLY_USED_GLYPHS };
+    THCfgCombo mCheckUpdateTiming { SETTING_CHECK_UPDATE_TIMING };
+    THCfgCheckbox mUpdateWithoutConfirm { SETTING_UPDATE_WITHOUT_CONFIRMATION };
+    THCfgCombo mFilenameAfterUpdate { SETTING_FILENAME_AFTER_UPDATE };
     int mOriginalLanguage;
 
     std::string mThcrapHintStr;
@@ -1939,7 +1892,7 @@ bool LauncherPreUpdate(wchar_t* pCmdLine)
             std::wstring finalPath;
             int filenameAfterUpdate = 0;
             if (LauncherCfgInit(true)) {
-                LauncherSettingGet("filename_after_update", filenameAfterUpdate);
+                filenameAfterUpdate = LauncherSettingGet(SETTING_FILENAME_AFTER_UPDATE);
                 LauncherCfgClose();
             }
             switch (filenameAfterUpdate) {
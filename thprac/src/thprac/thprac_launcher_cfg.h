@@ -5,6 +5,7 @@
 #pragma warning(disable : 33010)
 #include <rapidjson/document.h>
 #pragma warning(pop)
+#include "thprac_launcher_cfg_settings.h"
 #include <string>
 
 namespace THPrac {
@@ -13,20 +14,49 @@ std::wstring LauncherGetDataDir();
 
 bool LauncherCfgInit(bool noCreate = false);
 bool LauncherCfgWrite();
+// Returns once every write queued so far is on disk
+bool LauncherCfgFlush();
 rapidjson::Document& LauncherCfgGet();
 void LauncherCfgClose();
 void LauncherCfgReset();
 
-bool LauncherSettingGet(const char* name, int& valueOut);
-bool LauncherSettingGet(const char* name, bool& valueOut);
-bool LauncherSettingGet(const char* name, float& valueOut);
-bool LauncherSettingGet(const char* name, const char*& valueOut);
-bool LauncherSettingGet(const char* name, std::string& valueOut);
-void LauncherSettingSet(const char* name, int& valueIn);
-void LauncherSettingSet(const char* name, bool& valueIn);
-void LauncherSettingSet(const char* name, float& valueIn);
-void LauncherSettingSet(const char* name, const char* valueIn);
-void LauncherSettingSet(const char* name, const std::string& valueIn);
+// Every setting the launcher knows about, see LauncherSettingGet below
+extern const SettingHandle<int> SETTING_LANGUAGE;
+extern const SettingHandle<bool> SETTING_ALWAYS_OPEN_LAUNCHER;
+extern const SettingHandle<int> SETTING_AFTER_LAUNCH;
+extern const SettingHandle<bool> SETTING_AUTO_DEFAULT_LAUNCH;
+extern const SettingHandle<int> SETTING_APPLY_THPRAC_DEFAULT;
+extern const SettingHandle<int> SETTING_FILTER_DEFAULT;
+extern const SettingHandle<int> SETTING_THEME;
+extern const SettingHandle<std::string> SETTING_THEME_USER;
+extern const SettingHandle<bool> SETTING_USE_RELATIVE_PATH;
+extern const SettingHandle<std::string> SETTING_THCRAP;
+extern const SettingHandle<bool> SETTING_CHECK_UPDATE;
+extern const SettingHandle<bool> SETTING_RESIZABLE_WINDOW;
+extern const SettingHandle<bool> SETTING_REFLECTIVE_LAUNCH;
+extern const SettingHandle<int> SETTING_EXISTING_GAME_LAUNCH_ACTION;
+extern const SettingHandle<bool> SETTING_DONT_SEARCH_ONGOING_GAME;
+extern const SettingHandle<bool> SETTING_THPRAC_ADMIN_RIGHTS;
+extern const SettingHandle<bool> SETTING_RENDER_ONLY_USED_GLYPHS;
+extern const SettingHandle<int> SETTING_CHECK_UPDATE_TIMING;
+extern const SettingHandle<bool> SETTING_UPDATE_WITHOUT_CONFIRMATION;
+extern const SettingHandle<int> SETTING_FILENAME_AFTER_UPDATE;
+
+// Values live in a registry that is filled from "settings" when the config is
+// opened and written back into it when the config is saved. A setting missing
+// from the config reads as its default, LauncherSettingIsSet tells the two
+// apart. Set ignores values out of the declared range and returns false.
+bool LauncherSettingGet(SettingHandle<bool> setting);
+int LauncherSettingGet(SettingHandle<int> setting);
+float LauncherSettingGet(SettingHandle<float> setting);
+const std::string& LauncherSettingGet(SettingHandle<std::string> setting);
+bool LauncherSettingIsSet(SettingId setting);
+bool LauncherSettingSet(SettingHandle<bool> setting, bool valueIn);
+bool LauncherSettingSet(SettingHandle<int> setting, int valueIn);
+bool LauncherSettingSet(SettingHandle<float> setting, float valueIn);
+bool LauncherSettingSet(SettingHandle<std::string> setting, const std::string& valueIn);
+int LauncherSettingSubscribe(SettingRegistry::ChangeFunc onChange);
+void LauncherSettingUnsubscribe(int id);
 
 void LauncherCfgGuiUpd();
 void LauncherChkUpdPopup();
@@ -0,0 +1,265 @@
+#include "thprac_launcher_cfg_settings.h"
+
+#include <algorithm>
+
+namespace THPrac {
+
+/// Declarations
+/// ------------------
+uint32_t SettingRegistry::Add(const char* key, SettingType type)
+{
+    auto it = mKeys.find(std::string_view(key));
+    if (it != mKeys.end()) {
+        return it->second;
+    }
+    auto index = (uint32_t)mEntries.size();
+    auto& entry = mEntries.emplace_back();
+    entry.key = key;
+    entry.type = type;
+    entry.isSet = false;
+    mKeys.emplace(key, index);
+    return index;
+}
+
+SettingHandle<bool> SettingRegistry::DeclareBool(const char* key, bool def)
+{
+    auto index = Add(key, SETTING_BOOL);
+    auto& entry = mEntries[index];
+    entry.def.b = entry.value.b = def;
+    entry.min.b = false;
+    entry.max.b = true;
+    return { index };
+}
+
+SettingHandle<int> SettingRegistry::DeclareInt(const char* key, int def, int min, int max)
+{
+    auto index = Add(key, SETTING_INT);
+    auto& entry = mEntries[index];
+    entry.def.i = entry.value.i = def;
+    entry.min.i = min;
+    entry.max.i = max;
+    return { index };
+}
+
+SettingHandle<float> SettingRegistry::DeclareFloat(const char* key, float def, float min, float max)
+{
+    auto index = Add(key, SETTING_FLOAT);
+    auto& entry = mEntries[index];
+    entry.def.f = entry.value.f = def;
+    entry.min.f = min;
+    entry.max.f = max;
+    return { index };
+}
+
+SettingHandle<std::string> SettingRegistry::DeclareString(const char* key, const char* def)
+{
+    auto index = Add(key, SETTING_STRING);
+    auto& entry = mEntries[index];
+    entry.strDef = entry.str = def;
+    return { index };
+}
+/// ------------------
+
+/// Values
+/// ------------------
+bool SettingRegistry::Accepts(const Entry& entry, Scalar value) const
+{
+    switch (entry.type) {
+    case SETTING_INT:
+        return value.i >= entry.min.i && value.i <= entry.max.i;
+    case SETTING_FLOAT:
+        // Also turns away NaN
+        return value.f >= entry.min.f && value.f <= entry.max.f;
+    default:
+        return true;
+    }
+}
+
+bool SettingRegistry::Update(uint32_t index, Scalar value)
+{
+    auto& entry = mEntries[index];
+    if (!Accepts(entry, value)) {
+        return false;
+    }
+    bool changed = !entry.isSet;
+    switch (entry.type) {
+    case SETTING_BOOL:
+        changed |= entry.value.b != value.b;
+        break;
+    case SETTING_INT:
+        changed |= entry.value.i != value.i;
+        break;
+    case SETTING_FLOAT:
+        changed |= entry.value.f != value.f;
+        break;
+    default:
+        break;
+    }
+    entry.value = value;
+    entry.isSet = true;
+    if (changed) {
+        Notify(index);
+    }
+    return true;
+}
+
+bool SettingRegistry::Set(SettingHandle<bool> setting, bool value)
+{
+    Scalar scalar;
+    scalar.b = value;
+    return Update(setting.index, scalar);
+}
+
+bool SettingRegistry::Set(SettingHandle<int> setting, int value)
+{
+    Scalar scalar;
+    scalar.i = value;
+    return Update(setting.index, scalar);
+}
+
+bool SettingRegistry::Set(SettingHandle<float> setting, float value)
+{
+    Scalar scalar;
+    scalar.f = value;
+    return Update(setting.index, scalar);
+}
+
+bool SettingRegistry::Set(SettingHandle<std::string> setting, std::string_view value)
+{
+    auto& entry = mEntries[setting.index];
+    bool changed = !entry.isSet || entry.str != value;
+    entry.str = value;
+    entry.isSet = true;
+    if (changed) {
+        Notify(setting.index);
+    }
+    return true;
+}
+/// ------------------
+
+/// Change notification
+/// ------------------
+int SettingRegistry::Subscribe(ChangeFunc onChange)
+{
+    mSubscribers.emplace_back(mNextSubscriber, std::move(onChange));
+    return mNextSubscriber++;
+}
+
+void SettingRegistry::Unsubscribe(int id)
+{
+    auto it = std::find_if(mSubscribers.begin(), mSubscribers.end(), [&](auto& s) { return s.first == id; });
+    if (it != mSubscribers.end()) {
+        mSubscribers.erase(it);
+    }
+}
+
+void SettingRegistry::Notify(uint32_t index)
+{
+    // A subscriber may unsubscribe from inside its own callback
+    auto subscribers = mSubscribers;
+    for (auto& subscriber : subscribers) {
+        subscriber.second({ index });
+    }
+}
+/// ------------------
+
+/// JSON
+/// ------------------
+void SettingRegistry::Load(const rapidjson::Value& settings)
+{
+    for (auto& entry : mEntries) {
+        entry.isSet = false;
+        entry.value = entry.def;
+        entry.str = entry.strDef;
+        if (!settings.IsObject()) {
+            continue;
+        }
+        auto member = settings.FindMember(rapidjson::StringRef(entry.key.data(), entry.key.size()));
+        if (member == settings.MemberEnd()) {
+            continue;
+        }
+
+        auto& json = member->value;
+        Scalar value;
+        switch (entry.type) {
+        case SETTING_BOOL:
+            if (!json.IsBool()) {
+                continue;
+            }
+            value.b = json.GetBool();
+            break;
+        case SETTING_INT:
+            if (!json.IsInt()) {
+                continue;
+            }
+            value.i = json.GetInt();
+            break;
+        case SETTING_FLOAT: {
+            if (!json.IsNumber()) {
+                continue;
+            }
+            // Range check while it's still a double, casting one that doesn't
+            // fit in a float is undefined
+            double d = json.GetDouble();
+            if (!(d >= entry.min.f && d <= entry.max.f)) {
+                continue;
+            }
+            value.f = (float)d;
+            break;
+        }
+        case SETTING_STRING:
+            if (!json.IsString()) {
+                continue;
+            }
+            entry.str.assign(json.GetString(), json.GetStringLength());
+            entry.isSet = true;
+            continue;
+        }
+        if (Accepts(entry, value)) {
+            entry.value = value;
+            entry.isSet = true;
+        }
+    }
+}
+
+void SettingRegistry::Save(rapidjson::Value& settings, rapidjson::Document::AllocatorType& allocator) const
+{
+    if (!settings.IsObject()) {
+        settings.SetObject();
+    }
+    for (auto& entry : mEntries) {
+        auto key = rapidjson::StringRef(entry.key.data(), entry.key.size());
+        auto member = settings.FindMember(key);
+        if (!entry.isSet) {
+            if (member != settings.MemberEnd()) {
+                settings.EraseMember(member);
+            }
+            continue;
+        }
+
+        rapidjson::Value value;
+        switch (entry.type) {
+        case SETTING_BOOL:
+            value.SetBool(entry.value.b);
+            break;
+        case SETTING_INT:
+            value.SetInt(entry.value.i);
+            break;
+        case SETTING_FLOAT:
+            value.SetFloat(entry.value.f);
+            break;
+        case SETTING_STRING:
+            value.SetString(entry.str.data(), (rapidjson::SizeType)entry.str.size(), allocator);
+            break;
+        }
+        // Assigning in place keeps the members in the order they were in
+        if (member != settings.MemberEnd()) {
+            member->value = value;
+        } else {
+            settings.AddMember(rapidjson::Value(entry.key.data(), (rapidjson::SizeType)entry.key.size(), allocator), value, allocator);
+        }
+    }
+}
+/// ------------------
+
+}
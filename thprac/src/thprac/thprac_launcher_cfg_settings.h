@@ -0,0 +1,104 @@
+#pragma once
+#pragma warning(push)
+#pragma warning(disable : 26451)
+#pragma warning(disable : 26495)
+#pragma warning(disable : 33010)
+#include <rapidjson/document.h>
+#pragma warning(pop)
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace THPrac {
+
+enum SettingType : uint8_t {
+    SETTING_BOOL,
+    SETTING_INT,
+    SETTING_FLOAT,
+    SETTING_STRING,
+};
+
+// Index of a setting in its registry, in the order they were declared
+struct SettingId {
+    uint32_t index;
+};
+// Same thing, but only the accessors for T accept it
+template <typename T>
+struct SettingHandle : SettingId {
+};
+
+// Every setting is declared once with its type, default and range. Reads and
+// writes go through the handle Declare* returned, which is just an index into
+// a flat array, so nothing is looked up by name while the UI draws. The JSON
+// is only touched by Load and Save. Not thread safe, the launcher only uses
+// settings from its main thread.
+class SettingRegistry {
+public:
+    using ChangeFunc = std::function<void(SettingId setting)>;
+
+    SettingHandle<bool> DeclareBool(const char* key, bool def);
+    SettingHandle<int> DeclareInt(const char* key, int def, int min, int max);
+    SettingHandle<float> DeclareFloat(const char* key, float def, float min, float max);
+    SettingHandle<std::string> DeclareString(const char* key, const char* def);
+
+    // A setting that isn't set reads as its default
+    bool Get(SettingHandle<bool> setting) const { return mEntries[setting.index].value.b; }
+    int Get(SettingHandle<int> setting) const { return mEntries[setting.index].value.i; }
+    float Get(SettingHandle<float> setting) const { return mEntries[setting.index].value.f; }
+    const std::string& Get(SettingHandle<std::string> setting) const { return mEntries[setting.index].str; }
+    // Whether the config has a value for it, or it was set since
+    bool IsSet(SettingId setting) const { return mEntries[setting.index].isSet; }
+
+    // Returns false and leaves the setting alone if value is out of range.
+    // Subscribers are told if the value changed or the setting wasn't set.
+    bool Set(SettingHandle<bool> setting, bool value);
+    bool Set(SettingHandle<int> setting, int value);
+    bool Set(SettingHandle<float> setting, float value);
+    bool Set(SettingHandle<std::string> setting, std::string_view value);
+
+    // Returns an id for Unsubscribe
+    int Subscribe(ChangeFunc onChange);
+    void Unsubscribe(int id);
+
+    // Takes every declared setting from the "settings" object. Missing ones,
+    // ones of the wrong type and ones out of range end up unset and at their
+    // default. Doesn't notify anyone.
+    void Load(const rapidjson::Value& settings);
+    // Writes every setting that is set into settings, turning it into an object
+    // first if needed, and removes the keys of the ones that aren't. Members
+    // nothing was declared for are kept as they are.
+    void Save(rapidjson::Value& settings, rapidjson::Document::AllocatorType& allocator) const;
+
+private:
+    union Scalar {
+        bool b;
+        int i;
+        float f;
+    };
+    struct Entry {
+        std::string key;
+        SettingType type;
+        bool isSet;
+        Scalar value;
+        Scalar def;
+        Scalar min;
+        Scalar max;
+        std::string str;
+        std::string strDef;
+    };
+
+    uint32_t Add(const char* key, SettingType type);
+    bool Accepts(const Entry& entry, Scalar value) const;
+    bool Update(uint32_t index, Scalar value);
+    void Notify(uint32_t index);
+
+    std::vector<Entry> mEntries;
+    std::map<std::string, uint32_t, std::less<>> mKeys;
+    std::vector<std::pair<int, ChangeFunc>> mSubscribers;
+    int mNextSubscriber = 0;
+};
+
+}
@@ -0,0 +1,102 @@
+#include "thprac_launcher_cfg_writer.h"
+
+#include <algorithm>
+
+namespace THPrac {
+
+CfgWriter::CfgWriter(WriteFunc write, std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay)
+    : mWrite(std::move(write))
+    , mDebounce(debounce)
+    , mMaxDelay(maxDelay)
+{
+    mThread = std::thread(&CfgWriter::WriterProc, this);
+}
+
+CfgWriter::~CfgWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStop = true;
+        mWake.notify_one();
+    }
+    mThread.join();
+}
+
+void CfgWriter::Submit(SerializeFunc serialize)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto now = Clock::now();
+    if (!mPending) {
+        mFirstSubmit = now;
+    }
+    mLastSubmit = now;
+    mPending = std::move(serialize);
+    mSubmitSeq++;
+    mStats.submits++;
+    mWake.notify_one();
+}
+
+bool CfgWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    uint64_t target = mSubmitSeq;
+    if (mWrittenSeq >= target) {
+        return mLastOk;
+    }
+    mFlushSeq = std::max(mFlushSeq, target);
+    mWake.notify_one();
+    mWritten.wait(lock, [&] { return mWrittenSeq >= target; });
+    return mLastOk;
+}
+
+CfgWriter::Stats CfgWriter::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    return mStats;
+}
+
+void CfgWriter::WriterProc()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    for (;;) {
+        if (!mPending) {
+            if (mStop) {
+                return;
+            }
+            mWake.wait(lock);
+            continue;
+        }
+        auto due = std::min(mLastSubmit + mDebounce, mFirstSubmit + mMaxDelay);
+        if (!mStop && mFlushSeq <= mWrittenSeq && Clock::now() < due) {
+            mWake.wait_until(lock, due);
+            continue;
+        }
+
+        auto serialize = std::move(mPending);
+        mPending = nullptr;
+        uint64_t seq = mSubmitSeq;
+        lock.unlock();
+        auto data = serialize();
+        bool ok = mWrite(data);
+        lock.lock();
+
+        mWrittenSeq = seq;
+        mLastOk = ok;
+        if (ok) {
+            mStats.writes++;
+            mStats.bytes += data.size();
+        } else {
+            mStats.failures++;
+            // Try again after maxDelay, unless something newer came in
+            // meanwhile. When stopping it's the last chance, so no retry.
+            if (!mPending && !mStop) {
+                mPending = std::move(serialize);
+                mFirstSubmit = Clock::now();
+                mLastSubmit = mFirstSubmit + mMaxDelay;
+            }
+        }
+        mWritten.notify_all();
+    }
+}
+
+}
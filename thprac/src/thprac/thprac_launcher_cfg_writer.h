@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace THPrac {
+
+// Coalesces config writes on a background thread. Every Submit replaces
+// whatever is still pending, and the file is only written once no new submit
+// came in for the debounce window, or maxDelay after the oldest unwritten one,
+// so dragging a slider doesn't rewrite the file every frame. Both the
+// serialization and the write happen on the writer thread. Nothing here
+// touches Windows, the actual write is up to the caller.
+class CfgWriter {
+public:
+    using SerializeFunc = std::function<std::string()>;
+    // Has to replace the file atomically, a crash halfway must leave either the
+    // old contents or the new ones
+    using WriteFunc = std::function<bool(const std::string& data)>;
+
+    struct Stats {
+        uint32_t submits;
+        uint32_t writes;
+        uint32_t failures;
+        uint64_t bytes;
+    };
+
+    CfgWriter(WriteFunc write, std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay);
+    // Writes whatever is pending, then stops the thread
+    ~CfgWriter();
+
+    // serialize has to own everything it reads, it runs later on another thread
+    void Submit(SerializeFunc serialize);
+    // Writes everything submitted so far without waiting for the debounce, and
+    // returns once it's on disk. Returns false if that write failed.
+    bool Flush();
+    Stats GetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void WriterProc();
+
+    WriteFunc mWrite;
+    std::chrono::milliseconds mDebounce;
+    std::chrono::milliseconds mMaxDelay;
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    std::condition_variable mWritten;
+    SerializeFunc mPending;
+    Clock::time_point mFirstSubmit;
+    Clock::time_point mLastSubmit;
+    // Submits are numbered, so Flush knows when everything it asked for is done
+    uint64_t mSubmitSeq = 0;
+    uint64_t mWrittenSeq = 0;
+    uint64_t mFlushSeq = 0;
+    bool mLastOk = true;
+    bool mStop = false;
+    Stats mStats = {};
+    std::thread mThread;
+};
+
+}
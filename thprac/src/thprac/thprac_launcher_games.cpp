@@ -1,19 +1,29 @@
 ﻿#define NOMINMAX
 
 #include "thprac_launcher_games.h"
+#include "thprac_exe_cache.h"
+#include "thprac_exe_sig.h"
 #include "thprac_gui_locale.h"
 #include "thprac_launcher_cfg.h"
 #include "thprac_launcher_games_def.h"
 #include "thprac_launcher_main.h"
+#include "thprac_launcher_scan.h"
+#include "thprac_launcher_scan_win32.h"
+#include "thprac_launcher_steam.h"
 #include "thprac_launcher_utils.h"
 #include "thprac_launcher_wnd.h"
 #include "thprac_load_exe.h"
 #include "thprac_main.h"
 #include "thprac_utils.h"
+#include "utils/pe_view.h"
 #include <Windows.h>
 #include <shlwapi.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <imgui.h>
 #include <metrohash128.h>
 #include <psapi.h>
@@ -41,62 +51,23 @@ inline bool OepCompare(uint32_t oepCode1[10], uint32_t opeCode2[10])
     }
     return true;
 }
-bool ReadMemory(void* buffer, void* addr, size_t size)
+static void GetExeHash(void* exeBuffer, size_t exeSize, ExeSig& exeSigOut)
 {
-    SIZE_T bytesRead = 0;
-    ReadProcessMemory(GetCurrentProcess(), addr, buffer, size, &bytesRead);
-    return bytesRead == size;
+    if (exeSize < (1 << 23)) {
+        MetroHash128::Hash((uint8_t*)exeBuffer, exeSize, (uint8_t*)exeSigOut.metroHash);
+    }
 }
 bool GetExeInfo(void* exeBuffer, size_t exeSize, ExeSig& exeSigOut)
 {
     if (exeSize < 128)
         return false;
 
-    IMAGE_DOS_HEADER dosHeader;
-    if (!ReadMemory(&dosHeader, exeBuffer, sizeof(IMAGE_DOS_HEADER)) || dosHeader.e_magic != 0x5a4d)
+    PeView pe(exeBuffer, exeSize);
+    if (!pe.valid())
         return false;
-    IMAGE_NT_HEADERS ntHeader;
-    if (!ReadMemory(&ntHeader, (void*)((DWORD)exeBuffer + dosHeader.e_lfanew), sizeof(IMAGE_NT_HEADERS)) || ntHeader.Signature != 0x00004550)
-        return false;
-
-    exeSigOut.timeStamp = ntHeader.FileHeader.TimeDateStamp;
-    exeSigOut.textSize = 0;
-    for (auto& codeBlock : exeSigOut.oepCode) {
-        codeBlock = 0;
-    }
-    for (auto& hashBlock : exeSigOut.metroHash) {
-        hashBlock = 0;
-    }
-
-    PIMAGE_SECTION_HEADER pSection = (PIMAGE_SECTION_HEADER)((ULONG_PTR)((LONG)exeBuffer + dosHeader.e_lfanew) + ((LONG)(LONG_PTR) & (((IMAGE_NT_HEADERS*)0)->OptionalHeader)) + ntHeader.FileHeader.SizeOfOptionalHeader);
-    for (int i = 0; i < ntHeader.FileHeader.NumberOfSections; i++, pSection++) {
-        IMAGE_SECTION_HEADER section;
-        if (!ReadMemory(&section, pSection, sizeof(IMAGE_SECTION_HEADER)))
-            continue;
-        if (!strcmp(".text", (char*)section.Name)) {
-            exeSigOut.textSize = section.SizeOfRawData;
-        }
-        DWORD pOepCode = ntHeader.OptionalHeader.AddressOfEntryPoint;
-        if (pOepCode >= section.VirtualAddress && pOepCode <= (section.VirtualAddress + section.Misc.VirtualSize)) {
-            pOepCode -= section.VirtualAddress;
-            pOepCode += section.PointerToRawData;
-            pOepCode += (DWORD)exeBuffer;
-
-            uint16_t oepCode[10];
-            if (!ReadMemory(&oepCode, (void*)pOepCode, sizeof(oepCode)))
-                continue;
-
-            for (unsigned int j = 0; j < 10; ++j) {
-                exeSigOut.oepCode[j] = (uint32_t) * (oepCode + j);
-                exeSigOut.oepCode[j] ^= (j + 0x41) | ((j + 0x41) << 8);
-            }
-        }
-    }
-
-    if (exeSize < (1 << 23)) {
-        MetroHash128::Hash((uint8_t*)exeBuffer, exeSize, (uint8_t*)exeSigOut.metroHash);
-    }
 
+    GetExeHeaderInfo(pe, exeSigOut);
+    GetExeHash(exeBuffer, exeSize, exeSigOut);
     return true;
 }
 bool GetExeInfoEx(uintptr_t hProcess, uintptr_t base, ExeSig& exeSigOut)
@@ -128,6 +99,41 @@ bool GetExeInfoEx(uintptr_t hProcess, uintptr_t base, ExeSig& exeSigOut)
 
     return false;
 }
+
+// Built with InitOnceExecuteOnce rather than as function local statics, since
+// this also runs inside the game, where thprac is mapped by hand and the TLS
+// that thread safe statics rely on isn't set up.
+static SigTable<THGameSig, uint64_t, elementsof(gGameDefs)> gGameHeaderTable;
+static SigTable<THGameSig, std::array<uint32_t, 4>, elementsof(gGameDefs)> gGameHashTable;
+static SigTable<THKnownGame, std::array<uint32_t, 4>, elementsof(gKnownGames)> gKnownHashTable;
+static INIT_ONCE gSigTablesOnce = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK SigTablesBuild(PINIT_ONCE, PVOID, PVOID*)
+{
+    gGameHeaderTable.Build(gGameDefs, [](THGameSig& def) { return HeaderKey(def.exeSig); });
+    gGameHashTable.Build(gGameDefs, [](THGameSig& def) { return HashKey(def.exeSig.metroHash); });
+    gKnownHashTable.Build(gKnownGames, [](THKnownGame& known) { return HashKey(known.metroHash); });
+    // The callers check the category of the definition they get back, so a
+    // definition hidden behind another one with the same header would never
+    // be found. tests/exe_prefilter_test.cpp checks this too.
+    assert(gGameHeaderTable.Unique() && gGameHashTable.Unique() && gKnownHashTable.Unique());
+    return TRUE;
+}
+THGameSig* FindGameDefByHeader(const ExeSig& exeSig)
+{
+    InitOnceExecuteOnce(&gSigTablesOnce, SigTablesBuild, nullptr, nullptr);
+    return gGameHeaderTable.Find(HeaderKey(exeSig));
+}
+THGameSig* FindGameDefByHash(const ExeSig& exeSig)
+{
+    InitOnceExecuteOnce(&gSigTablesOnce, SigTablesBuild, nullptr, nullptr);
+    return gGameHashTable.Find(HashKey(exeSig.metroHash));
+}
+THKnownGame* FindKnownGameByHash(const ExeSig& exeSig)
+{
+    InitOnceExecuteOnce(&gSigTablesOnce, SigTablesBuild, nullptr, nullptr);
+    return gKnownHashTable.Find(HashKey(exeSig.metroHash));
+}
 bool IfEndWith(const char* str, const char* subStr)
 {
     auto subStrLen = strlen(subStr);
@@ -186,19 +192,12 @@ int CheckHasSteamDRM(void* exeBuffer, size_t exeSize)
     if (exeSize < 128)
         return 0;
 
-    IMAGE_DOS_HEADER dosHeader;
-    if (!ReadMemory(&dosHeader, exeBuffer, sizeof(IMAGE_DOS_HEADER)) || dosHeader.e_magic != 0x5a4d)
-        return 0;
-    IMAGE_NT_HEADERS ntHeader;
-    if (!ReadMemory(&ntHeader, (void*)((DWORD)exeBuffer + dosHeader.e_lfanew), sizeof(IMAGE_NT_HEADERS)) || ntHeader.Signature != 0x00004550)
+    PeView pe(exeBuffer, exeSize);
+    if (!pe.valid())
         return 0;
 
-    PIMAGE_SECTION_HEADER pSection = (PIMAGE_SECTION_HEADER)((ULONG_PTR)((LONG)exeBuffer + dosHeader.e_lfanew) + ((LONG)(LONG_PTR) & (((IMAGE_NT_HEADERS*)0)->OptionalHeader)) + ntHeader.FileHeader.SizeOfOptionalHeader);
-    for (int i = 0; i < ntHeader.FileHeader.NumberOfSections; i++, pSection++) {
-        IMAGE_SECTION_HEADER section;
-        if (!ReadMemory(&section, pSection, sizeof(IMAGE_SECTION_HEADER)))
-            continue;
-        if (!strcmp(".bind", (char*)section.Name)) {
+    for (auto& section : pe.sections()) {
+        if (PeView::SectionNameIs(section, ".bind")) {
             static std::string_view ver2_0Sig("\x53\x51\x52\x56\x57\x55\x8B\xEC\x81\xEC\x00\x10\x00\x00\xBE", 15);
             static std::string_view ver2_1Sig("\x53\x51\x52\x56\x57\x55\x8B\xEC\x81\xEC\x00\x10\x00\x00\xC7", 15);
             static std::string_view ver3Sig("\xE8\x00\x00\x00\x00\x50\x53\x51\x52\x56\x57\x55\x8B\x44\x24\x1C\x2D\x05\x00\x00\x00\x8B\xCC\x83\xE4\xF0\x51\x51\x51\x50", 30);
@@ -220,11 +219,14 @@ int CheckHasSteamDRM(void* exeBuffer, size_t exeSize)
                 uint32_t headerSize = 0;
                 if (pos != std::string_view::npos) {
                     if (exeStr.find(ver3Sub1_1, pos) == pos + 9 && exeStr.find(ver3Sub1_2, pos) == pos + 15) {
-                        headerSize = *(uint32_t*)((uint32_t)exeBuffer + pos + 0x10);
+                        if (auto p = pe.At<uint32_t>(pos + 0x10))
+                            headerSize = *p;
                     } else if (exeStr.find(ver3Sub2_1, pos) == pos + 9 && exeStr.find(ver3Sub2_2, pos) == pos + 15) {
-                        headerSize = *(uint32_t*)((uint32_t)exeBuffer + pos + 0x16);
+                        if (auto p = pe.At<uint32_t>(pos + 0x16))
+                            headerSize = *p;
                     } else if (exeStr.find(ver3Sub3_1, pos) == pos + 9 && exeStr.find(ver3Sub3_2, pos) == pos + 20) {
-                        headerSize = *(uint32_t*)((uint32_t)exeBuffer + pos + 0x10);
+                        if (auto p = pe.At<uint32_t>(pos + 0x10))
+                            headerSize = *p;
                     }
                 }
                 if (headerSize == 0xb0 || headerSize == 0xd0 || headerSize == 0xf0) {
@@ -297,8 +299,7 @@ private:
     bool LoadGameCfg()
     {
         bool result = true;
-        int applyThpracDefault = 0;
-        LauncherSettingGet("apply_thprac_default", applyThpracDefault);
+        int applyThpracDefault = LauncherSettingGet(SETTING_APPLY_THPRAC_DEFAULT);
 
         auto& cfg = LauncherCfgGet();
         if (cfg.HasMember("games") && cfg["games"].IsObject()) {
@@ -439,22 +440,21 @@ public:
     {
         wchar_t currentPath[MAX_PATH];
         wchar_t cvt[MAX_PATH];
-        bool isRelative = false;
-        LauncherSettingGet("use_relative_path", isRelative);
+        bool isRelative = LauncherSettingGet(SETTING_USE_RELATIVE_PATH);
         GetModuleFileNameW(GetModuleHandleW(nullptr), currentPath, MAX_PATH);
 
         if (isRelative) {
             if (!PathIsRelativeW(mThcrapDir.c_str())) {
                 if (PathRelativePathToW(cvt, currentPath, FILE_ATTRIBUTE_DIRECTORY, mThcrapDir.c_str(), FILE_ATTRIBUTE_NORMAL)) {
                     mThcrapDir = cvt;
-                    LauncherSettingSet("thcrap", utf16_to_utf8(mThcrapDir.c_str()));
+                    LauncherSettingSet(SETTING_THCRAP, utf16_to_utf8(mThcrapDir.c_str()));
                 }
             }
         } else {
             if (PathIsRelativeW(mThcrapDir.c_str())) {
                 if (GetFullPathNameW(mThcrapDir.c_str(), MAX_PATH, cvt, nullptr)) {
                     mThcrapDir = cvt;
-                    LauncherSettingSet("thcrap", utf16_to_utf8(mThcrapDir.c_str()));
+                    LauncherSettingSet(SETTING_THCRAP, utf16_to_utf8(mThcrapDir.c_str()));
                 }
             }
         }
@@ -597,12 +597,9 @@ public:
         mThcrapCfg.clear();
         mThcrapGames.clear();
 
-        std::string thcrapDirUtf8;
-        std::wstring thcrapDir;
-        LauncherSettingGet("thcrap", thcrapDirUtf8);
-        thcrapDir = utf8_to_utf16(thcrapDirUtf8.c_str());
+        std::wstring thcrapDir = utf8_to_utf16(LauncherSettingGet(SETTING_THCRAP).c_str());
         if (!thcrapTest(thcrapDir)) {
-            LauncherSettingSet("thcrap", std::string(""));
+            LauncherSettingSet(SETTING_THCRAP, "");
             return false;
         }
         mThcrapDir = thcrapDir;
@@ -646,8 +643,7 @@ public:
     {
         wchar_t currentPath[MAX_PATH];
         wchar_t cvt[MAX_PATH];
-        bool isRelative = false;
-        LauncherSettingGet("use_relative_path", isRelative);
+        bool isRelative = LauncherSettingGet(SETTING_USE_RELATIVE_PATH);
         GetModuleFileNameW(GetModuleHandleW(nullptr), currentPath, MAX_PATH);
 
         // TODO: This variable is unused, but its assignment has a side effect.
@@ -687,8 +683,7 @@ public:
     }
     void FinalizeGameScan()
     {
-        int applyThpracDefault = 0;
-        LauncherSettingGet("apply_thprac_default", applyThpracDefault);
+        int applyThpracDefault = LauncherSettingGet(SETTING_APPLY_THPRAC_DEFAULT);
         for (auto& scan : mGameScan) {
             for (auto& gameScanned : scan) {
                 if (!gameScanned.checked) {
@@ -1002,6 +997,8 @@ public:
             }
         }
 
+        // Called from every scan thread at once
+        std::lock_guard<std::mutex> lock(game.mGameScanLock);
         switch (type) {
         case THPrac::TYPE_MALICIOUS:
             game.mGameScan[0].emplace_back(name.c_str(), path.c_str(), type, &sig, false);
@@ -1031,30 +1028,6 @@ public:
         }
         return 1;
     }
-    static DWORD WINAPI ScanSetCurrentPath(const std::wstring& dir)
-    {
-        auto& g = THGameGui::singleton();
-        auto nextIdx = (g.mScanCurrentIdx == 0) ? 1 : 0;
-        g.mScanCurrent[nextIdx] = utf16_to_utf8(dir.c_str());
-
-        // Hopefully this is an atom operation.
-        g.mScanCurrentIdx = nextIdx;
-
-        return 0;
-    }
-    static DWORD WINAPI ScanSteamappPath(const std::wstring& path)
-    {
-        for (auto& gameDef : gGameDefs) {
-            if (gameDef.steamId == nullptr) {
-                continue;
-            }
-            std::wstring checkPath = path + L"\\appmanifest_" + gameDef.steamId + L".acf";
-            if (GetFileAttributesW(checkPath.c_str()) != INVALID_FILE_ATTRIBUTES) {
-                ScanAddGame(TYPE_STEAM, "", utf16_to_utf8(path.c_str()) + "\\common\\" + gameDef.idStr + '\\' + gameDef.idStr + ".exe", gameDef);
-            }
-        }
-        return 0;
-    }
     static DWORD WINAPI ScanSteam()
     {
         if (!THGameGui::singleton().mScanOption[SCAN_OPT_STEAM]) {
@@ -1085,83 +1058,105 @@ public:
         }
         steamPath = GetCleanedPath(steamPath);
 
-        ScanSteamappPath(steamPath + L"\\steamapps");
-        auto libraryCfgPath = steamPath + L"\\steamapps\\libraryfolders.vdf";
-        auto hCfg = CreateFileW(libraryCfgPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-        if (hCfg != INVALID_HANDLE_VALUE) {
-            DWORD bytesRead;
-            auto cfgSize = GetFileSize(hCfg, nullptr);
-            auto cfgBuffer = malloc(cfgSize);
-            memset(cfgBuffer, 0, cfgSize);
-            ReadFile(hCfg, cfgBuffer, cfgSize, &bytesRead, nullptr);
-            std::string cfgStr((const char*)cfgBuffer);
-            std::string steamappsPath;
-            steamappsPath.reserve(512);
-
-            std::string::size_type searchPos = 0;
-            for (searchPos = cfgStr.find(":\\\\");
-                 searchPos != std::string::npos;
-                 searchPos = cfgStr.find(":\\\\", searchPos + 1)) {
-                if (isalpha(cfgStr[searchPos - 1]) && cfgStr[searchPos - 2] == '\"') {
-                    auto endQuotePos = cfgStr.find("\"", searchPos);
-                    if (endQuotePos != std::string::npos) {
-                        steamappsPath.clear();
-                        steamappsPath = cfgStr.substr(searchPos - 1, endQuotePos - searchPos + 1);
-                        steamappsPath = GetCleanedPath(steamappsPath);
-                        if (utf8_to_utf16(steamappsPath.c_str()) != steamPath) {
-                            ScanSteamappPath(utf8_to_utf16((steamappsPath + "\\steamapps").c_str()));
-                        }
-                    }
-                }
+        std::vector<std::string> appIds;
+        for (auto& gameDef : gGameDefs) {
+            if (gameDef.steamId) {
+                appIds.push_back(utf16_to_utf8(gameDef.steamId));
+            }
+        }
+        auto installs = SteamResolveApps(utf16_to_utf8(steamPath.c_str()), appIds, [](const std::string& path, std::string& text) {
+            MappedFile file(utf8_to_utf16(path.c_str()).c_str());
+            if (!file.fileMapView) {
+                return false;
+            }
+            text.assign((const char*)file.fileMapView, file.fileSize);
+            return true;
+        });
+        for (auto& gameDef : gGameDefs) {
+            if (!gameDef.steamId) {
+                continue;
+            }
+            auto install = installs.find(utf16_to_utf8(gameDef.steamId));
+            if (install != installs.end()) {
+                ScanAddGame(TYPE_STEAM, "", install->second + '\\' + gameDef.idStr + ".exe", gameDef);
             }
-
-            free(cfgBuffer);
-            CloseHandle(hCfg);
         }
 
         return 0;
     }
+    // A hash can only match a game in gGameDefs if the header fields do too,
+    // since they're part of the hashed bytes. gKnownGames only has hashes, of
+    // translations and patched builds whose headers and entry point code can
+    // be anything, but every one of them is a 32-bit x86 build. The exe cache
+    // makes hashing those a one time cost per file.
+    static bool ScanExeNeedsHash(const PeView& pe, const ExeSig& exeSig)
+    {
+        return FindGameDefByHeader(exeSig) || pe.nt()->FileHeader.Machine == IMAGE_FILE_MACHINE_I386;
+    }
     static DWORD WINAPI ScanExe(const std::wstring& dir, std::string name = "")
     {
         auto& games = THGameGui::singleton().mGames;
         auto utf8Dir = utf16_to_utf8(dir.c_str());
 
-        MappedFile file(dir.c_str(), 1 << 23);
-        if (!file.fileMapView)
-            return 0;
-
         ExeSig exeSig;
-        GetExeInfo(file.fileMapView, file.fileSize, exeSig);
+        bool hasSig = ExeCacheGet(dir.c_str(), exeSig, [&](ExeSig& sig) {
+            MappedFile file(dir.c_str(), 1 << 23);
+            if (!file.fileMapView)
+                return false;
+
+            // The view is only paged in where it's read, so unless the headers make
+            // the file a candidate, nothing past them is ever loaded from disk.
+            sig = {};
+            PeView pe(file.fileMapView, file.fileSize);
+            if (file.fileSize >= 128 && pe.valid()) {
+                GetExeHeaderInfo(pe, sig);
+                if (ScanExeNeedsHash(pe, sig)) {
+                    GetExeHash(file.fileMapView, file.fileSize, sig);
+                }
+            }
+            return true;
+        });
+        if (!hasSig)
+            return 0;
+        // Only needed for the rare TYPE_MALICIOUS match, which isn't worth caching
+        auto hasSteamDRM = [&]() {
+            MappedFile file(dir.c_str(), 1 << 23);
+            return file.fileMapView && CheckHasSteamDRM(file.fileMapView, file.fileSize);
+        };
         THGameSig* ifSig = nullptr;
         THGameType ifType = TYPE_UNCERTAIN;
 
-        for (int i = 0; i < IM_ARRAYSIZE(gGameDefs); ++i) {
-            auto& gameSig = gGameDefs[i];
-            auto type = CompareExeSig(exeSig, gameSig.exeSig);
-            if (gameSig.catagory != CAT_MAIN && gameSig.catagory != CAT_SPINOFF_STG) {
-                if (CheckExeName(dir, gameSig.idStr)) {
-                    ifSig = &gameSig;
-                }
+        // A matching hash implies a matching header, so the header lookup
+        // finds the only definition CompareExeSig could say anything about
+        if (auto gameSig = FindGameDefByHash(exeSig)) {
+            ScanAddGame(TYPE_ORIGINAL, name, utf8Dir, *gameSig);
+            return 0;
+        }
+        auto headerSig = FindGameDefByHeader(exeSig);
+        auto type = headerSig ? CompareExeSig(exeSig, headerSig->exeSig) : TYPE_UNCERTAIN;
+        if (type == TYPE_MODDED) {
+            ifSig = headerSig;
+            ifType = TYPE_MODDED;
+        } else {
+            if (type == TYPE_MALICIOUS && !hasSteamDRM()) {
+                ScanAddGame(type, name, utf8Dir, *headerSig);
             }
-            if (type == TYPE_MODDED) {
-                ifSig = &gameSig;
-                ifType = TYPE_MODDED;
-                break;
-            } else if (type == TYPE_MALICIOUS) {
-                if (!CheckHasSteamDRM(file.fileMapView, file.fileSize)) {
-                    ScanAddGame(type, name, utf8Dir, gameSig);
+            for (auto& gameSig : gGameDefs) {
+                if (gameSig.catagory != CAT_MAIN && gameSig.catagory != CAT_SPINOFF_STG) {
+                    if (CheckExeName(dir, gameSig.idStr)) {
+                        ifSig = &gameSig;
+                    }
                 }
-            } else if (type != TYPE_UNCERTAIN) {
-                ScanAddGame(type, name, utf8Dir, gameSig);
-                return 0;
             }
         }
 
-        for (auto& known : gKnownGames) {
-            if (HashCompare(exeSig.metroHash, known.metroHash)) {
-                ScanAddGame(known.type, name, utf8Dir, games[known.idStr].signature);
-                return 0;
+        if (auto known = FindKnownGameByHash(exeSig)) {
+            // Runs on several hashers at once, so this must never insert
+            auto game = games.find(known->idStr);
+            if (game != games.end()) {
+                ScanAddGame(known->type, name, utf8Dir, game->second.signature);
             }
+            return 0;
         }
 
         if (ifSig) {
@@ -1170,38 +1165,16 @@ public:
 
         return 0;
     }
+    static bool ScanIsExeName(const std::wstring& name)
+    {
+        return name.size() >= 4 && _wcsicmp(name.c_str() + name.size() - 4, L".exe") == 0;
+    }
     static DWORD WINAPI ScanFolder(const std::wstring& dir)
     {
-        CoInitializeEx(nullptr, COINIT_MULTITHREADED | COINIT_DISABLE_OLE1DDE);
-        // TODO: This variable is unused, but its assignment has a side effect.
-        [[maybe_unused]] auto scanLnk = THGameGui::singleton().mScanOption[SCAN_OPT_THCRAP];
-        std::wstring searchDir = dir + L"\\*";
-        WIN32_FIND_DATAW findData;
-        HANDLE searchHnd = FindFirstFileW(searchDir.c_str(), &findData);
-
-        if (searchHnd == INVALID_HANDLE_VALUE) {
-            return false;
-        }
-
-        do {
-            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                if ((!lstrcmpW(findData.cFileName, L".")) || (!lstrcmpW(findData.cFileName, L"..")))
-                    continue;
-            }
-
-            searchDir = dir + L"\\" + std::wstring(findData.cFileName);
-            if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                ScanFolder(searchDir);
-            } else {
-                ScanSetCurrentPath(searchDir);
-                if (_wcsicmp(searchDir.c_str() + searchDir.size() - 4, L".exe") == 0) {
-                    ScanExe(searchDir);
-                }
-            }
-
-        } while (FindNextFileW(searchHnd, &findData));
-        FindClose(searchHnd);
-        CoUninitialize();
+        auto& game = THGameGui::singleton();
+        ScanWin32FileSystem fs;
+        ScanWalker walker(fs, game.mScanProgress, game.mScanCancel, ScanIsExeName, [](const std::wstring& path) { ScanExe(path); });
+        walker.Run(dir);
 
         return 0;
     }
@@ -1209,10 +1182,15 @@ public:
     {
         auto& game = THGameGui::singleton();
         auto& dir = game.mScanPath;
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED | COINIT_DISABLE_OLE1DDE);
         if (game.mScanOption[SCAN_OPT_ORIGINAL] || game.mScanOption[SCAN_OPT_MODDED] || THGameGui::singleton().mScanOption[SCAN_OPT_THCRAP]) {
             ScanFolder(dir);
         }
-        ScanSteam();
+        if (!game.mScanCancel) {
+            ScanSteam();
+        }
+        ExeCacheFlush();
+        CoUninitialize();
         return 0;
     }
     static DWORD WINAPI RescanThreadFunc([[maybe_unused]] _In_ LPVOID lpParameter)
@@ -1220,10 +1198,11 @@ public:
         auto& gameGui = THGameGui::singleton();
         gameGui.thcrapSetup();
         CoInitializeEx(nullptr, COINIT_MULTITHREADED | COINIT_DISABLE_OLE1DDE);
+        auto& progress = gameGui.mScanProgress.NewWriter();
 
         for (auto& it : gameGui.mGames) {
             for (auto& gameInst : it.second.instances) {
-                ScanSetCurrentPath(utf8_to_utf16(gameInst.path.c_str()));
+                progress.Publish(utf8_to_utf16(gameInst.path.c_str()));
                 switch (gameInst.type) {
                 case THPrac::TYPE_ORIGINAL:
                 case THPrac::TYPE_MODDED:
@@ -1267,14 +1246,22 @@ public:
         }
 
         gameGui.WriteGameCfg();
+        ExeCacheFlush();
         CoUninitialize();
         return 0;
     }
-    void ScanClear()
+    void ScanStop()
     {
+        // The walker polls mScanCancel, so this never has to kill the thread
+        mScanCancel = true;
+        mScanThread.Wait();
         mScanThread.Stop();
-        mScanCurrent[0] = mScanCurrent[1] = "";
-        mScanCurrentIdx = 0;
+        mScanCancel = false;
+    }
+    void ScanClear()
+    {
+        ScanStop();
+        mScanProgress.Reset();
         mScanPath = L"";
         mScanStatus = 0;
         mScanAnm.Reset();
@@ -1306,7 +1293,13 @@ public:
     void ScanAbort()
     {
         mScanStatus = 0;
-        mScanThread.Stop();
+        ScanStop();
+    }
+    const char* ScanCurrentPath()
+    {
+        std::wstring current;
+        mScanCurrentUtf8 = mScanProgress.Current(current) ? utf16_to_utf8(current.c_str()) : "";
+        return mScanCurrentUtf8.c_str();
     }
     void GuiScanFolder()
     {
@@ -1355,7 +1348,11 @@ public:
             ImGui::TextWrapped("%s", S(THPRAC_SCAN_SCANNING));
             ImGui::SameLine(0.0f, 0.0f);
             ImGui::TextUnformatted(mScanAnm.Get().c_str());
-            GuiCenteredText(mScanCurrent[mScanCurrentIdx].c_str());
+            GuiCenteredText(ScanCurrentPath());
+            char counters[256];
+            sprintf_s(counters, S(THPRAC_SCAN_SCAN_COUNTERS),
+                mScanProgress.dirs.load(), mScanProgress.files.load(), mScanProgress.processed.load(), mScanProgress.candidates.load());
+            GuiCenteredText(counters);
 
             if (!mScanThread.IsActive()) {
                 ScanComplete();
@@ -1676,8 +1673,7 @@ public:
     static DWORD WINAPI CheckAndLoadVPatch(HANDLE hProcess, std::wstring& dir, const wchar_t* vpatchName)
     {
         auto vpatchPath = dir + vpatchName;
-        bool isRelative = false;
-        LauncherSettingGet("use_relative_path", isRelative);
+        bool isRelative = LauncherSettingGet(SETTING_USE_RELATIVE_PATH);
         if (isRelative) {
             WCHAR full_path[MAX_PATH + 1];
             GetFullPathNameW(vpatchPath.c_str(), MAX_PATH, full_path, 0);
@@ -1734,6 +1730,7 @@ public:
         PROCESS_INFORMATION proc_info;
         memset(&startup_info, 0, sizeof(STARTUPINFOW));
         startup_info.cb = sizeof(STARTUPINFOW);
+        LauncherCfgFlush();
         CreateProcessW(currentInstPath.c_str(), nullptr, nullptr, nullptr, false, CREATE_SUSPENDED, nullptr, currentInstDir.c_str(), &startup_info, &proc_info);
 
         uintptr_t base = GetGameModuleBase(proc_info.hProcess);
@@ -1780,8 +1777,9 @@ public:
         auto currentInstExePath = currentInstPath;
         auto currentInstDir = GetDirFromFullPath(currentInstPath);
         HINSTANCE executeResult = (HINSTANCE)100;
-        bool useReflectiveLaunch = false;
-        LauncherSettingGet("reflective_launch", useReflectiveLaunch);
+        bool useReflectiveLaunch = LauncherSettingGet(SETTING_REFLECTIVE_LAUNCH);
+        // Every branch below starts the game one way or another
+        LauncherCfgFlush();
 
         switch (currentInst.type) {
         case TYPE_ORIGINAL:
@@ -1930,9 +1928,7 @@ public:
                 if (!mLaunchFailed) {
                     mLaunchAnm.Reset();
                     ImGui::CloseCurrentPopup();
-                    int action = 0;
-                    LauncherSettingGet("after_launch", action);
-                    switch (action) {
+                    switch (LauncherSettingGet(SETTING_AFTER_LAUNCH)) {
                     case 1:
                         GuiLauncherMainTrigger(LAUNCHER_CLOSE);
                         break;
@@ -2277,8 +2273,7 @@ public:
 
                 auto disabled = !game.instances.size();
                 if (SelectableWrapped(S(game.signature.refStr), disabled, mSelectedGameTmp == &game)) {
-                    bool autoDefaultLaunch = false;
-                    LauncherSettingGet("auto_default_launch", autoDefaultLaunch);
+                    bool autoDefaultLaunch = LauncherSettingGet(SETTING_AUTO_DEFAULT_LAUNCH);
                     auto autoLaunch = game.defaultLaunch;
                     if (autoLaunch < 0 && autoDefaultLaunch) {
                         autoLaunch = 0;
@@ -2355,7 +2350,7 @@ public:
             ImGui::TextWrapped("%s", S(THPRAC_GAMES_RESCANNING));
             ImGui::SameLine(0.0f, 0.0f);
             ImGui::TextUnformatted(mScanAnm.Get().c_str());
-            GuiCenteredText(mScanCurrent[mScanCurrentIdx].c_str());
+            GuiCenteredText(ScanCurrentPath());
             ImGui::EndPopup();
         }
 
@@ -2397,8 +2392,10 @@ private:
     std::vector<THGameScan> mGameScan[GAME_SCAN_TYPE_CNT];
     bool mGameScanScrollReset[GAME_SCAN_TYPE_CNT] { true, true, true, true, true, true };
     bool mGameScanSelect[GAME_SCAN_TYPE_CNT] { false, true, true, true, false, false };
-    std::string mScanCurrent[2];
-    int mScanCurrentIdx = 0;
+    std::mutex mGameScanLock;
+    ScanProgress mScanProgress;
+    std::atomic<bool> mScanCancel = false;
+    std::string mScanCurrentUtf8;
     int mSteamMenuStatus = 0;
     std::vector<GameRoll> mSteamGames[4];
     bool mSteamGameTypeOpt[4];
@@ -17,6 +17,13 @@ namespace THPrac {
 bool GetExeInfo(void* exeBuffer, size_t exeSize, ExeSig& exeSigOut);
 bool GetExeInfoEx(uintptr_t hProcess, uintptr_t base, ExeSig& exeSigOut);
 
+// Identification through tables over gGameDefs and gKnownGames that are
+// sorted on first use, instead of walking the lists. Returns nullptr if
+// nothing matches.
+THGameSig* FindGameDefByHeader(const ExeSig& exeSig);
+THGameSig* FindGameDefByHash(const ExeSig& exeSig);
+THKnownGame* FindKnownGameByHash(const ExeSig& exeSig);
+
 bool LauncherGamesGuiUpd();
 void LauncherGamesGuiSwitch(const char* idStr);
 void LauncherGamesForceReload();
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "thprac_exe_sig.h"
 #include "thprac_gui_locale.h"
 #include <cstdint>
 
@@ -24,13 +25,6 @@ enum THGameType {
     TYPE_UNKNOWN = 11,
 };
 
-struct ExeSig {
-    uint32_t timeStamp;
-    uint32_t textSize;
-    uint32_t oepCode[10];
-    uint32_t metroHash[4];
-};
-
 struct THGameSig {
     const char* idStr;
     const wchar_t* steamId;
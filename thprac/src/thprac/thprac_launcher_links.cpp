@@ -110,8 +110,7 @@ private:
     bool LoadLinksCfg()
     {
         bool result = true;
-        int filterState = 0;
-        LauncherSettingGet("filter_default", filterState);
+        int filterState = LauncherSettingGet(SETTING_FILTER_DEFAULT);
 
         auto& cfg = LauncherCfgGet();
         if (!cfg.HasMember("links")) {
@@ -66,23 +66,20 @@ int GuiLauncherMain()
         return -1;
     }
 
-    int theme;
-    if (LauncherSettingGet("theme", theme)) {
-        // LauncherSettingSet doesn't take int, only int&.
-        // Passing 0 will call the overload with const char*
-        int Sus = 0;
+    if (LauncherSettingIsSet(SETTING_THEME)) {
+        int theme = LauncherSettingGet(SETTING_THEME);
         const char* theme_user = nullptr;
-        // LauncherSettingGet only accepts signed ints but I want to do an unsigned comparison
-        if ((unsigned int)theme > 2) {
-            if (LauncherSettingGet("theme_user", theme_user) && theme_user) {
+        if (theme > 2) {
+            if (LauncherSettingIsSet(SETTING_THEME_USER)) {
+                theme_user = LauncherSettingGet(SETTING_THEME_USER).c_str();
                 std::wstring theme_path = LauncherGetDataDir() + L"themes\\" + utf8_to_utf16(theme_user);
                 if (!PathFileExistsW(theme_path.c_str())) {
-                    LauncherSettingSet("theme", Sus);
-                    theme = Sus;
+                    LauncherSettingSet(SETTING_THEME, 0);
+                    theme = 0;
                 }
             } else {
-                LauncherSettingSet("theme", Sus);
-                theme = Sus;
+                LauncherSettingSet(SETTING_THEME, 0);
+                theme = 0;
             }
         }
 
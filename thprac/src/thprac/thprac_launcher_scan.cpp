@@ -0,0 +1,251 @@
+#include "thprac_launcher_scan.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace THPrac {
+
+constexpr auto SCAN_CANCEL_POLL = std::chrono::milliseconds(50);
+
+/// Progress
+/// ------------------
+void ScanProgress::Writer::Publish(const std::wstring& path)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (mPublished && now - mLast < mInterval) {
+        return;
+    }
+    mLast = now;
+
+    // The slot published last may be picked up by the reader at any time, and
+    // the one it's reading must stay as it is. With 4 slots one of the next
+    // three is always free.
+    const std::wstring* reading = mProgress.mReading.load();
+    std::wstring* slot;
+    do {
+        slot = &mSlots[mNext];
+        mNext = (mNext + 1) % SCAN_WRITER_SLOTS;
+    } while (slot == mPublished || slot == reading);
+    *slot = path;
+    mPublished = slot;
+    mProgress.mCurrent.store(slot);
+}
+
+ScanProgress::Writer& ScanProgress::NewWriter(std::chrono::steady_clock::duration interval)
+{
+    return mWriters.emplace_back(*this, interval);
+}
+
+void ScanProgress::Reset()
+{
+    mCurrent.store(nullptr);
+    mWriters.clear();
+    dirs = 0;
+    files = 0;
+    candidates = 0;
+    processed = 0;
+}
+
+// Once mReading is set and mCurrent still points at the same slot, no writer
+// can pick that slot until mReading is cleared. A writer that looked at
+// mReading before it was set had already published somewhere else, so the
+// second load of mCurrent catches it.
+bool ScanProgress::Current(std::wstring& path)
+{
+    const std::wstring* current = mCurrent.load();
+    for (;;) {
+        if (!current) {
+            return false;
+        }
+        mReading.store(current);
+        const std::wstring* check = mCurrent.load();
+        if (check == current) {
+            break;
+        }
+        current = check;
+    }
+    path = *current;
+    mReading.store(nullptr);
+    return true;
+}
+/// ------------------
+
+/// File queue
+/// ------------------
+// Waits are polled, so setting cancel is enough to get every thread out
+bool ScanWalker::FileQueue::Push(std::wstring&& path, const std::atomic<bool>& cancel)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    while (mFiles.size() >= mCapacity) {
+        if (cancel) {
+            return false;
+        }
+        mNotFull.wait_for(lock, SCAN_CANCEL_POLL);
+    }
+    mFiles.push_back(std::move(path));
+    mNotEmpty.notify_one();
+    return true;
+}
+
+bool ScanWalker::FileQueue::Pop(std::wstring& path, const std::atomic<bool>& cancel)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    while (mFiles.empty()) {
+        if (cancel || mClosed) {
+            return false;
+        }
+        mNotEmpty.wait_for(lock, SCAN_CANCEL_POLL);
+    }
+    if (cancel) {
+        return false;
+    }
+    path = std::move(mFiles.front());
+    mFiles.pop_front();
+    mNotFull.notify_one();
+    return true;
+}
+
+void ScanWalker::FileQueue::Close()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    mClosed = true;
+    mNotEmpty.notify_all();
+}
+/// ------------------
+
+/// Walker
+/// ------------------
+ScanWalker::ScanWalker(ScanFileSystem& fs, ScanProgress& progress, const std::atomic<bool>& cancel,
+    FileFilter filter, FileFunc onFile, unsigned walkers, unsigned hashers)
+    : mFs(fs)
+    , mProgress(progress)
+    , mCancel(cancel)
+    , mFilter(std::move(filter))
+    , mOnFile(std::move(onFile))
+    , mFileQueue(SCAN_FILE_QUEUE_SIZE)
+{
+    unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    mWalkerCount = walkers ? walkers : std::min(cores, 8u);
+    if (hashers == SCAN_HASHERS_INLINE) {
+        mHasherCount = 0;
+    } else {
+        mHasherCount = hashers ? hashers : std::clamp(cores / 2, 1u, 4u);
+    }
+}
+
+// Owners take the newest directory, so each worker goes depth first and
+// stays close to what it just listed. Thieves take the oldest one, which is
+// the closest to the root and likely has the most left under it.
+bool ScanWalker::PopDir(size_t self, std::wstring& dir)
+{
+    {
+        auto& own = *mQueues[self];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.dirs.empty()) {
+            dir = std::move(own.dirs.back());
+            own.dirs.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < mQueues.size(); i++) {
+        auto& victim = *mQueues[(self + i) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.dirs.empty()) {
+            dir = std::move(victim.dirs.front());
+            victim.dirs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScanWalker::WalkerProc(size_t self, ScanProgress::Writer& writer)
+{
+    auto& own = *mQueues[self];
+    unsigned idle = 0;
+    std::wstring dir;
+
+    while (!mCancel) {
+        if (!PopDir(self, dir)) {
+            if (!mPending) {
+                break;
+            }
+            // Someone is still listing a directory that might add more work
+            if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            continue;
+        }
+        idle = 0;
+
+        writer.Publish(dir);
+        mFs.List(dir, [&](const std::wstring& name, bool isDir) {
+            if (mCancel) {
+                return false;
+            }
+            auto path = mFs.Join(dir, name);
+            if (isDir) {
+                // Counted before it's visible, so mPending can't hit 0 early
+                mPending++;
+                std::lock_guard<std::mutex> lock(own.lock);
+                own.dirs.push_back(std::move(path));
+                return true;
+            }
+            mProgress.files++;
+            if (!mFilter(name)) {
+                return true;
+            }
+            mProgress.candidates++;
+            if (mHasherCount) {
+                return mFileQueue.Push(std::move(path), mCancel);
+            }
+            mOnFile(path);
+            mProgress.processed++;
+            return true;
+        });
+        mProgress.dirs++;
+        mPending--;
+    }
+}
+
+void ScanWalker::HasherProc(ScanProgress::Writer& writer)
+{
+    std::wstring path;
+    while (mFileQueue.Pop(path, mCancel)) {
+        writer.Publish(path);
+        mOnFile(path);
+        mProgress.processed++;
+    }
+}
+
+void ScanWalker::Run(const std::wstring& root)
+{
+    mQueues.clear();
+    for (unsigned i = 0; i < mWalkerCount; i++) {
+        mQueues.push_back(std::make_unique<WorkerQueue>());
+    }
+    mQueues[0]->dirs.push_back(root);
+    mPending = 1;
+
+    std::vector<std::thread> hashers;
+    for (unsigned i = 0; i < mHasherCount; i++) {
+        hashers.emplace_back(&ScanWalker::HasherProc, this, std::ref(mProgress.NewWriter()));
+    }
+    std::vector<std::thread> walkers;
+    for (unsigned i = 0; i < mWalkerCount; i++) {
+        walkers.emplace_back(&ScanWalker::WalkerProc, this, i, std::ref(mProgress.NewWriter()));
+    }
+
+    for (auto& t : walkers) {
+        t.join();
+    }
+    mFileQueue.Close();
+    for (auto& t : hashers) {
+        t.join();
+    }
+}
+/// ------------------
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace THPrac {
+
+// Folder scan engine used by the launcher's game scan. Directories are walked
+// by a pool of workers that steal from each other, and the files picked by
+// the filter are handed to a separate, smaller pool through a bounded queue,
+// since those get mapped and hashed. Nothing here touches Windows directly,
+// every directory listing goes through ScanFileSystem.
+
+class ScanFileSystem {
+public:
+    virtual ~ScanFileSystem() = default;
+
+    // Calls onEntry for every entry of dir except . and .., until it returns
+    // false. Returns false if dir couldn't be opened.
+    virtual bool List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry) = 0;
+    virtual std::wstring Join(const std::wstring& dir, const std::wstring& name)
+    {
+        return dir + L"\\" + name;
+    }
+};
+
+// Counters and the current path, for the GUI to show while a scan is running.
+// Every writer belongs to a single thread and publishes into a small ring of
+// its own, so memory doesn't grow with the length of the scan. There's only
+// one reader, which marks the slot it's copying as in use, and writers skip
+// that slot, so Current() never sees a string being rewritten.
+class ScanProgress {
+public:
+    class Writer {
+        friend class ScanProgress;
+
+        static constexpr size_t SCAN_WRITER_SLOTS = 4;
+
+        ScanProgress& mProgress;
+        std::chrono::steady_clock::duration mInterval;
+        std::wstring mSlots[SCAN_WRITER_SLOTS];
+        const std::wstring* mPublished = nullptr;
+        size_t mNext = 0;
+        std::chrono::steady_clock::time_point mLast;
+
+    public:
+        Writer(ScanProgress& progress, std::chrono::steady_clock::duration interval)
+            : mProgress(progress)
+            , mInterval(interval)
+        {
+        }
+
+        // Only keeps a path every interval, nobody can read faster than the
+        // GUI redraws anyway
+        void Publish(const std::wstring& path);
+    };
+
+    static constexpr auto SCAN_PUBLISH_INTERVAL = std::chrono::milliseconds(30);
+
+    std::atomic<uint32_t> dirs = 0;
+    std::atomic<uint32_t> files = 0;
+    std::atomic<uint32_t> candidates = 0;
+    std::atomic<uint32_t> processed = 0;
+
+    // Not thread safe, call before handing the writer to its thread
+    Writer& NewWriter(std::chrono::steady_clock::duration interval = SCAN_PUBLISH_INTERVAL);
+    // Not thread safe, no writer may be in use
+    void Reset();
+
+    // Copies the last published path into path, returns false if there's
+    // none. Only one thread may call it.
+    bool Current(std::wstring& path);
+
+private:
+    std::atomic<const std::wstring*> mCurrent = nullptr;
+    // The slot Current() is copying from
+    std::atomic<const std::wstring*> mReading = nullptr;
+    std::list<Writer> mWriters;
+};
+
+class ScanWalker {
+public:
+    using FileFilter = std::function<bool(const std::wstring& name)>;
+    using FileFunc = std::function<void(const std::wstring& path)>;
+
+    // walkers and hashers of 0 pick a count from the number of cores. With
+    // hashers set to SCAN_HASHERS_INLINE, onFile is called by the walkers.
+    static constexpr unsigned SCAN_HASHERS_INLINE = UINT32_MAX;
+    // Candidates waiting for a hasher, past that the walkers block
+    static constexpr size_t SCAN_FILE_QUEUE_SIZE = 64;
+
+    ScanWalker(ScanFileSystem& fs, ScanProgress& progress, const std::atomic<bool>& cancel,
+        FileFilter filter, FileFunc onFile, unsigned walkers = 0, unsigned hashers = 0);
+
+    // Blocks until every directory under root has been walked and every
+    // candidate processed, or until cancel is set. onFile can be called from
+    // several threads at once.
+    void Run(const std::wstring& root);
+
+private:
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<std::wstring> dirs;
+    };
+
+    class FileQueue {
+        std::mutex mLock;
+        std::condition_variable mNotFull;
+        std::condition_variable mNotEmpty;
+        std::deque<std::wstring> mFiles;
+        size_t mCapacity;
+        bool mClosed = false;
+
+    public:
+        FileQueue(size_t capacity)
+            : mCapacity(capacity)
+        {
+        }
+        bool Push(std::wstring&& path, const std::atomic<bool>& cancel);
+        bool Pop(std::wstring& path, const std::atomic<bool>& cancel);
+        void Close();
+    };
+
+    bool PopDir(size_t self, std::wstring& dir);
+    void WalkerProc(size_t self, ScanProgress::Writer& writer);
+    void HasherProc(ScanProgress::Writer& writer);
+
+    ScanFileSystem& mFs;
+    ScanProgress& mProgress;
+    const std::atomic<bool>& mCancel;
+    FileFilter mFilter;
+    FileFunc mOnFile;
+    unsigned mWalkerCount;
+    unsigned mHasherCount;
+
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+    // Directories that are queued or being listed, the walk is over at 0
+    std::atomic<size_t> mPending = 0;
+    FileQueue mFileQueue;
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "thprac_launcher_scan.h"
+#include <Windows.h>
+
+namespace THPrac {
+
+// ScanFileSystem::List over FindFirstFileEx, shared by the game scan and the
+// replay library
+inline bool ScanWin32List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry)
+{
+    WIN32_FIND_DATAW findData;
+    HANDLE searchHnd = FindFirstFileExW((dir + L"\\*").c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (searchHnd == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    do {
+        bool isDir = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (isDir && ((!lstrcmpW(findData.cFileName, L".")) || (!lstrcmpW(findData.cFileName, L".."))))
+            continue;
+        if (!onEntry(findData.cFileName, isDir))
+            break;
+    } while (FindNextFileW(searchHnd, &findData));
+    FindClose(searchHnd);
+
+    return true;
+}
+
+class ScanWin32FileSystem : public ScanFileSystem {
+public:
+    bool List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry) override
+    {
+        return ScanWin32List(dir, onEntry);
+    }
+};
+
+}
@@ -0,0 +1,379 @@
+#include "thprac_launcher_steam.h"
+
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+
+namespace THPrac {
+
+/// KeyValues
+/// ------------------
+VdfReader::VdfReader(std::string_view text)
+    : mText(text)
+{
+    if (mText.size() >= 3 && !memcmp(mText.data(), "\xEF\xBB\xBF", 3)) {
+        mPos = 3;
+    }
+}
+
+void VdfReader::SkipSpace()
+{
+    while (mPos < mText.size()) {
+        char c = mText[mPos];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            mPos++;
+        } else if (c == '/' && mPos + 1 < mText.size() && mText[mPos + 1] == '/') {
+            auto eol = mText.find('\n', mPos);
+            mPos = eol == std::string_view::npos ? mText.size() : eol + 1;
+        } else {
+            break;
+        }
+    }
+}
+
+VdfReader::Lexeme VdfReader::Lex(std::string& out)
+{
+    SkipSpace();
+    if (mPos >= mText.size()) {
+        return LEX_EOF;
+    }
+    char c = mText[mPos];
+    if (c == '{') {
+        mPos++;
+        return LEX_OPEN;
+    }
+    if (c == '}') {
+        mPos++;
+        return LEX_CLOSE;
+    }
+
+    out.clear();
+    if (c != '"') {
+        // The terminator of delimiters is searched too, so a NUL ends the
+        // token. Nothing else skips a NUL, so without the check below a NUL
+        // would be an empty token that never moves past it.
+        static const char delimiters[] = " \t\r\n{}\"";
+        size_t start = mPos;
+        while (mPos < mText.size() && !memchr(delimiters, mText[mPos], sizeof(delimiters))) {
+            mPos++;
+        }
+        if (mPos == start) {
+            return LEX_ERROR;
+        }
+        out.assign(mText.data() + start, mPos - start);
+        return LEX_STRING;
+    }
+
+    // Steam only escapes these four, anything else keeps its backslash
+    for (mPos++; mPos < mText.size(); mPos++) {
+        c = mText[mPos];
+        if (c == '"') {
+            mPos++;
+            return LEX_STRING;
+        }
+        if (c == '\\' && mPos + 1 < mText.size()) {
+            switch (mText[mPos + 1]) {
+            case '\\':
+                c = '\\';
+                break;
+            case '"':
+                c = '"';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            default:
+                out += c;
+                continue;
+            }
+            mPos++;
+        }
+        out += c;
+    }
+    return LEX_ERROR;
+}
+
+VdfReader::Token VdfReader::Next()
+{
+    if (mDone != VDF_VALUE) {
+        return mDone;
+    }
+
+    switch (Lex(mKey)) {
+    case LEX_EOF:
+        return mDone = mDepth ? VDF_ERROR : VDF_EOF;
+    case LEX_CLOSE:
+        if (!mDepth) {
+            return mDone = VDF_ERROR;
+        }
+        mDepth--;
+        return VDF_END;
+    case LEX_STRING:
+        break;
+    default:
+        return mDone = VDF_ERROR;
+    }
+
+    switch (Lex(mValue)) {
+    case LEX_OPEN:
+        mDepth++;
+        return VDF_BEGIN;
+    case LEX_STRING:
+        break;
+    default:
+        return mDone = VDF_ERROR;
+    }
+
+    // A conditional can follow the value, as in "key" "value" [$WIN32]
+    SkipSpace();
+    if (mPos < mText.size() && mText[mPos] == '[') {
+        auto end = mText.find(']', mPos);
+        if (end == std::string_view::npos) {
+            return mDone = VDF_ERROR;
+        }
+        mPos = end + 1;
+    }
+    return VDF_VALUE;
+}
+
+bool VdfReader::SkipSection()
+{
+    size_t depth = mDepth;
+    while (mDepth >= depth) {
+        auto token = Next();
+        if (token == VDF_EOF || token == VDF_ERROR) {
+            return false;
+        }
+    }
+    return true;
+}
+/// ------------------
+
+/// Steam library
+/// ------------------
+static bool EqualsNoCase(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return (x >= 'A' && x <= 'Z' ? x | 0x20 : x) == (y >= 'A' && y <= 'Z' ? y | 0x20 : y);
+    });
+}
+
+static bool IsNumber(std::string_view str)
+{
+    return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// Same result as GetCleanedPath, minus the trailing backslash
+static std::string CleanLibraryPath(std::string_view path)
+{
+    std::string result;
+    for (char c : path) {
+        if (c == '/' || c == '\\') {
+            if (!result.empty() && result.back() == '\\') {
+                continue;
+            }
+            c = '\\';
+        }
+        result += c;
+    }
+    if (!result.empty() && result.back() == '\\') {
+        result.pop_back();
+    }
+    return result;
+}
+
+// "apps" maps each appid to its size on disk, the keys are all that matter
+static bool ReadLibraryApps(VdfReader& reader, SteamLibrary& library)
+{
+    size_t depth = reader.depth();
+    library.listsApps = true;
+    for (;;) {
+        switch (reader.Next()) {
+        case VdfReader::VDF_VALUE:
+            if (IsNumber(reader.key())) {
+                library.apps.push_back(reader.key());
+            }
+            break;
+        case VdfReader::VDF_BEGIN:
+            if (!reader.SkipSection()) {
+                return false;
+            }
+            break;
+        case VdfReader::VDF_END:
+            if (reader.depth() < depth) {
+                return true;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+}
+
+static bool ReadLibrary(VdfReader& reader, SteamLibrary& library)
+{
+    size_t depth = reader.depth();
+    for (;;) {
+        switch (reader.Next()) {
+        case VdfReader::VDF_VALUE:
+            if (EqualsNoCase(reader.key(), "path")) {
+                library.path = CleanLibraryPath(reader.value());
+            }
+            break;
+        case VdfReader::VDF_BEGIN:
+            if (EqualsNoCase(reader.key(), "apps") ? !ReadLibraryApps(reader, library) : !reader.SkipSection()) {
+                return false;
+            }
+            break;
+        case VdfReader::VDF_END:
+            if (reader.depth() < depth) {
+                return true;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+}
+
+// Up to 2021 libraries were "1" "D:\\SteamLibrary", with the Steam folder
+// itself left out. Since then every library is a section with its path and
+// its apps, including the Steam folder as "0".
+bool SteamParseLibraryFolders(std::string_view text, std::vector<SteamLibrary>& libraries)
+{
+    VdfReader reader(text);
+    if (reader.Next() != VdfReader::VDF_BEGIN || !EqualsNoCase(reader.key(), "libraryfolders")) {
+        return false;
+    }
+    for (;;) {
+        switch (reader.Next()) {
+        case VdfReader::VDF_VALUE:
+            if (reader.depth() == 1 && IsNumber(reader.key()) && !reader.value().empty()) {
+                libraries.emplace_back().path = CleanLibraryPath(reader.value());
+            }
+            break;
+        case VdfReader::VDF_BEGIN: {
+            if (reader.depth() != 2 || !IsNumber(reader.key())) {
+                if (!reader.SkipSection()) {
+                    return true;
+                }
+                break;
+            }
+            SteamLibrary library;
+            bool complete = ReadLibrary(reader, library);
+            if (!library.path.empty()) {
+                libraries.push_back(std::move(library));
+            }
+            if (!complete) {
+                return true;
+            }
+            break;
+        }
+        case VdfReader::VDF_END:
+            break;
+        default:
+            return true;
+        }
+    }
+}
+
+// Only the top level of AppState matters, so this stops as soon as both are in
+bool SteamParseAppManifest(std::string_view text, std::string& appId, std::string& installDir)
+{
+    appId.clear();
+    installDir.clear();
+    VdfReader reader(text);
+    if (reader.Next() != VdfReader::VDF_BEGIN || !EqualsNoCase(reader.key(), "AppState")) {
+        return false;
+    }
+    for (;;) {
+        switch (reader.Next()) {
+        case VdfReader::VDF_VALUE:
+            if (EqualsNoCase(reader.key(), "appid")) {
+                appId = reader.value();
+            } else if (EqualsNoCase(reader.key(), "installdir")) {
+                installDir = reader.value();
+            }
+            if (!appId.empty() && !installDir.empty()) {
+                return true;
+            }
+            break;
+        case VdfReader::VDF_BEGIN:
+            if (!reader.SkipSection()) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+}
+
+std::unordered_map<std::string, std::string> SteamResolveApps(const std::string& steamPath, const std::vector<std::string>& appIds, const SteamReadFile& readFile)
+{
+    std::unordered_map<std::string, std::string> installs;
+    auto steamDir = CleanLibraryPath(steamPath);
+    if (steamDir.empty()) {
+        return installs;
+    }
+
+    std::vector<SteamLibrary> parsed;
+    std::string text;
+    if (readFile(steamDir + "\\steamapps\\libraryfolders.vdf", text)) {
+        SteamParseLibraryFolders(text, parsed);
+    }
+
+    // The Steam folder goes first, as the old format doesn't list it
+    std::vector<SteamLibrary> libraries;
+    libraries.emplace_back().path = steamDir;
+    for (auto& library : parsed) {
+        auto it = std::find_if(libraries.begin(), libraries.end(), [&](auto& l) { return EqualsNoCase(l.path, library.path); });
+        if (it == libraries.end()) {
+            libraries.push_back(std::move(library));
+        } else if (!it->listsApps) {
+            it->apps = std::move(library.apps);
+            it->listsApps = library.listsApps;
+        }
+    }
+
+    // Only libraries that list their apps can rule themselves out
+    std::unordered_map<std::string, std::vector<size_t>> listedIn;
+    std::vector<size_t> unlisted;
+    std::unordered_set<std::string> wanted(appIds.begin(), appIds.end());
+    for (size_t i = 0; i < libraries.size(); i++) {
+        if (!libraries[i].listsApps) {
+            unlisted.push_back(i);
+        }
+        for (auto& app : libraries[i].apps) {
+            if (wanted.count(app)) {
+                listedIn[app].push_back(i);
+            }
+        }
+    }
+
+    std::string appId, installDir;
+    for (auto& wantedId : appIds) {
+        auto candidates = unlisted;
+        auto listed = listedIn.find(wantedId);
+        if (listed != listedIn.end()) {
+            candidates.insert(candidates.begin(), listed->second.begin(), listed->second.end());
+        }
+        for (auto i : candidates) {
+            auto& library = libraries[i].path;
+            if (!readFile(library + "\\steamapps\\appmanifest_" + wantedId + ".acf", text)) {
+                continue;
+            }
+            if (SteamParseAppManifest(text, appId, installDir) && appId == wantedId) {
+                installs[wantedId] = library + "\\steamapps\\common\\" + installDir;
+                break;
+            }
+        }
+    }
+    return installs;
+}
+/// ------------------
+
+}
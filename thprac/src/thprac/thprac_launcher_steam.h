@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace THPrac {
+
+// Valve KeyValues text, the format of libraryfolders.vdf and the
+// appmanifest_*.acf files. Read one token at a time straight from the text,
+// nothing is built in memory except the current key and value. Quoted strings
+// are unescaped, comments and [$PLATFORM] conditionals are skipped.
+class VdfReader {
+public:
+    enum Token {
+        VDF_EOF,
+        VDF_ERROR,
+        VDF_VALUE, // key() and value() are set
+        VDF_BEGIN, // key() is the name of the section
+        VDF_END,
+    };
+
+    VdfReader(std::string_view text);
+
+    // Once VDF_EOF or VDF_ERROR is returned, every later call returns it too.
+    // A file cut off inside a section is an error.
+    Token Next();
+    // Call right after VDF_BEGIN to skip everything up to the matching end.
+    // Returns false on an error.
+    bool SkipSection();
+
+    const std::string& key() const { return mKey; }
+    const std::string& value() const { return mValue; }
+    // Number of sections the reader is currently in
+    size_t depth() const { return mDepth; }
+
+private:
+    enum Lexeme {
+        LEX_EOF,
+        LEX_ERROR,
+        LEX_STRING,
+        LEX_OPEN,
+        LEX_CLOSE,
+    };
+    Lexeme Lex(std::string& out);
+    void SkipSpace();
+
+    std::string_view mText;
+    size_t mPos = 0;
+    size_t mDepth = 0;
+    // VDF_EOF or VDF_ERROR once either was returned
+    Token mDone = VDF_VALUE;
+    std::string mKey;
+    std::string mValue;
+};
+
+struct SteamLibrary {
+    std::string path;
+    // Apps installed in this library. libraryfolders.vdf only has them from
+    // 2021 onwards, older ones list the paths and nothing else.
+    std::vector<std::string> apps;
+    bool listsApps = false;
+};
+
+// Both layouts of libraryfolders.vdf. Paths come out with single backslashes
+// and no trailing one. Returns false if text isn't a libraryfolders file, one
+// that breaks off halfway still gives the libraries before that point.
+bool SteamParseLibraryFolders(std::string_view text, std::vector<SteamLibrary>& libraries);
+
+// appid and installdir of an appmanifest_*.acf. Returns false if either is
+// missing.
+bool SteamParseAppManifest(std::string_view text, std::string& appId, std::string& installDir);
+
+// Returns the contents of a file, or false if it can't be read
+using SteamReadFile = std::function<bool(const std::string& path, std::string& text)>;
+
+// Maps every appid in appIds that's installed to its install directory, under
+// the steamapps\common of whichever library has it. Libraries that list their
+// apps are only asked about those, so a manifest is only read for games that
+// are actually there. Paths are UTF-8, steamPath is Steam's install folder.
+std::unordered_map<std::string, std::string> SteamResolveApps(const std::string& steamPath, const std::vector<std::string>& appIds, const SteamReadFile& readFile);
+
+}
@@ -169,7 +169,7 @@ int LauncherWndInit(unsigned int width, unsigned int height, unsigned int maxWid
     __thprac_lc_mutex = CreateMutex(nullptr, TRUE, L"thprac launcher mutex");
     if (__thprac_lc_mutex == nullptr || GetLastError() == ERROR_ALREADY_EXISTS) {
         for (int i = 0; i < 3; ++i) {
-            auto tmpTitle = utf8_to_utf16(th_glossary_str[i][THPRAC_LAUNCHER]);
+            auto tmpTitle = utf8_to_utf16(Gui::LocaleGetStr((Gui::locale_t)i, THPRAC_LAUNCHER));
             HWND existingApp = FindWindowW(0, tmpTitle.c_str());
             if (existingApp) {
                 ShowWindow(existingApp, SW_RESTORE);
@@ -6,54 +6,52 @@ namespace THPrac {
 
 // This array is generated by compiling inject_shellcode.cpp. Check the comment at the top of that file for more info.
 unsigned char INJECT_SHELLCODE[] = {
-    0x55, 0x53, 0x57, 0x56, 0x83, 0xEC, 0x38, 0x8B, 0x4C, 0x24, 0x4C, 0x8B, 0x41, 0x08, 0x8B, 0x51,
-    0x0C, 0x89, 0x54, 0x24, 0x34, 0x8B, 0x51, 0x10, 0x89, 0x54, 0x24, 0x24, 0x8B, 0x51, 0x14, 0x89,
-    0x54, 0x24, 0x20, 0x8B, 0x71, 0x18, 0x83, 0xC1, 0x1C, 0x51, 0xFF, 0xD0, 0x85, 0xC0, 0x0F, 0x84,
-    0xA1, 0x02, 0x00, 0x00, 0x89, 0xC3, 0x8B, 0x40, 0x3C, 0x89, 0xD9, 0x89, 0x44, 0x24, 0x0C, 0x2B,
-    0x4C, 0x03, 0x34, 0x89, 0x4C, 0x24, 0x04, 0x89, 0x5C, 0x24, 0x10, 0x89, 0x74, 0x24, 0x30, 0x0F,
-    0x84, 0xDE, 0x00, 0x00, 0x00, 0x8B, 0x44, 0x24, 0x0C, 0x8B, 0x8C, 0x03, 0xA0, 0x00, 0x00, 0x00,
-    0x85, 0xC9, 0x0F, 0x84, 0xCB, 0x00, 0x00, 0x00, 0x8B, 0x44, 0x24, 0x0C, 0x83, 0xBC, 0x03, 0xA4,
-    0x00, 0x00, 0x00, 0x00, 0x0F, 0x84, 0xB9, 0x00, 0x00, 0x00, 0x8B, 0x44, 0x0B, 0x04, 0x8B, 0x14,
-    0x0B, 0x01, 0xC2, 0x0F, 0x84, 0xAA, 0x00, 0x00, 0x00, 0x8D, 0x2C, 0x0B, 0x8D, 0x34, 0x0B, 0x83,
-    0xC6, 0x04, 0x8D, 0x48, 0xF8, 0x83, 0xF9, 0x02, 0x0F, 0x82, 0x80, 0x00, 0x00, 0x00, 0x89, 0x34,
-    0x24, 0xD1, 0xE9, 0x31, 0xFF, 0x89, 0x6C, 0x24, 0x18, 0x89, 0x4C, 0x24, 0x08, 0x0F, 0xB7, 0x5C,
-    0x7D, 0x08, 0x89, 0xD8, 0x25, 0x00, 0xF0, 0x00, 0x00, 0x3D, 0x00, 0x30, 0x00, 0x00, 0x75, 0x50,
-    0x8B, 0x44, 0x24, 0x18, 0x8B, 0x28, 0x81, 0xE3, 0xFF, 0x0F, 0x00, 0x00, 0x03, 0x5C, 0x24, 0x10,
-    0x8D, 0x14, 0x2B, 0x89, 0x54, 0x24, 0x14, 0x8D, 0x44, 0x24, 0x1C, 0x50, 0x6A, 0x40, 0xB8, 0x04,
-    0x00, 0x00, 0x00, 0x50, 0x52, 0x8B, 0x74, 0x24, 0x34, 0xFF, 0xD6, 0x8B, 0x44, 0x24, 0x04, 0x01,
-    0x44, 0x1D, 0x00, 0x8B, 0x6C, 0x24, 0x18, 0x8D, 0x44, 0x24, 0x1C, 0x50, 0xFF, 0x74, 0x24, 0x20,
-    0xB8, 0x04, 0x00, 0x00, 0x00, 0x50, 0xFF, 0x74, 0x24, 0x20, 0xFF, 0xD6, 0x8B, 0x4C, 0x24, 0x08,
-    0x47, 0x39, 0xF9, 0x75, 0x98, 0x8B, 0x04, 0x24, 0x8B, 0x00, 0x8B, 0x5C, 0x24, 0x10, 0x8D, 0x34,
-    0x28, 0x83, 0xC6, 0x04, 0x01, 0xC5, 0x8B, 0x06, 0x8B, 0x56, 0xFC, 0x01, 0xC2, 0x0F, 0x85, 0x5F,
-    0xFF, 0xFF, 0xFF, 0x8B, 0x44, 0x24, 0x0C, 0x8B, 0x8C, 0x03, 0x80, 0x00, 0x00, 0x00, 0x89, 0xC8,
-    0x89, 0x4C, 0x24, 0x08, 0x85, 0xC9, 0x0F, 0x84, 0x2C, 0x01, 0x00, 0x00, 0x8B, 0x44, 0x24, 0x0C,
-    0x83, 0xBC, 0x03, 0x84, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x84, 0x1A, 0x01, 0x00, 0x00, 0x8B, 0x44,
-    0x24, 0x08, 0x8B, 0x7C, 0x03, 0x0C, 0x85, 0xFF, 0x0F, 0x84, 0x0A, 0x01, 0x00, 0x00, 0x01, 0x5C,
-    0x24, 0x08, 0x8D, 0x43, 0x04, 0x89, 0x44, 0x24, 0x2C, 0x8D, 0x43, 0x01, 0x89, 0x44, 0x24, 0x28,
-    0x66, 0xB8, 0x02, 0x00, 0x89, 0x44, 0x24, 0x04, 0xC7, 0x04, 0x24, 0x00, 0x00, 0x00, 0x00, 0x8B,
-    0x74, 0x24, 0x24, 0x89, 0xDD, 0x01, 0xFB, 0x53, 0xFF, 0x54, 0x24, 0x38, 0x89, 0x44, 0x24, 0x14,
-    0x85, 0xC0, 0x74, 0x6E, 0x8B, 0x44, 0x24, 0x08, 0x8B, 0x18, 0x8B, 0x78, 0x10, 0x85, 0xDB, 0x0F,
-    0x44, 0xDF, 0x8B, 0x44, 0x1D, 0x00, 0x85, 0xC0, 0x74, 0x7D, 0x01, 0xEF, 0x03, 0x5C, 0x24, 0x2C,
-    0x85, 0xC0, 0x78, 0x0B, 0x8B, 0x4C, 0x24, 0x10, 0x01, 0xC8, 0x83, 0xC0, 0x02, 0xEB, 0x03, 0x0F,
-    0xB7, 0xC0, 0x50, 0xFF, 0x74, 0x24, 0x18, 0xFF, 0x54, 0x24, 0x28, 0x89, 0x44, 0x24, 0x18, 0x8D,
-    0x44, 0x24, 0x1C, 0x50, 0x6A, 0x40, 0xBD, 0x04, 0x00, 0x00, 0x00, 0x55, 0x57, 0xFF, 0xD6, 0x8B,
-    0x44, 0x24, 0x18, 0x89, 0x07, 0x8D, 0x44, 0x24, 0x1C, 0x50, 0xFF, 0x74, 0x24, 0x20, 0x55, 0x57,
-    0xFF, 0xD6, 0x01, 0xEF, 0x8B, 0x03, 0x01, 0xEB, 0x85, 0xC0, 0x75, 0xB4, 0x8B, 0x5C, 0x24, 0x10,
-    0xEB, 0x49, 0x8A, 0x03, 0x84, 0xC0, 0x74, 0x23, 0x03, 0x7C, 0x24, 0x28, 0x31, 0xC9, 0x8B, 0x54,
-    0x24, 0x4C, 0x8B, 0x5C, 0x24, 0x10, 0x88, 0x84, 0x0A, 0x24, 0x02, 0x00, 0x00, 0x8A, 0x04, 0x0F,
-    0x41, 0x84, 0xC0, 0x75, 0xF1, 0xEB, 0x0E, 0x89, 0xEB, 0xEB, 0x27, 0x31, 0xC9, 0x8B, 0x54, 0x24,
-    0x4C, 0x8B, 0x5C, 0x24, 0x10, 0xC6, 0x84, 0x0A, 0x24, 0x02, 0x00, 0x00, 0x00, 0xFF, 0x54, 0x24,
-    0x30, 0x89, 0x04, 0x24, 0x31, 0xC0, 0x40, 0x89, 0x44, 0x24, 0x04, 0x83, 0x7C, 0x24, 0x14, 0x00,
-    0x74, 0x7F, 0x8B, 0x44, 0x24, 0x08, 0x8B, 0x78, 0x20, 0x83, 0xC0, 0x14, 0x89, 0x44, 0x24, 0x08,
-    0x85, 0xFF, 0x0F, 0x85, 0x1B, 0xFF, 0xFF, 0xFF, 0x8B, 0x44, 0x24, 0x0C, 0x8B, 0x84, 0x03, 0xC0,
-    0x00, 0x00, 0x00, 0x85, 0xC0, 0x74, 0x3D, 0x8B, 0x74, 0x03, 0x0C, 0x85, 0xF6, 0x74, 0x19, 0x8B,
-    0x06, 0x85, 0xC0, 0x74, 0x13, 0x83, 0xC6, 0x04, 0x6A, 0x00, 0x6A, 0x01, 0x53, 0xFF, 0xD0, 0x8B,
-    0x06, 0x83, 0xC6, 0x04, 0x85, 0xC0, 0x75, 0xF0, 0x8B, 0x4C, 0x24, 0x4C, 0x8B, 0x01, 0x85, 0xC0,
-    0x74, 0x06, 0x8B, 0x49, 0x04, 0x89, 0x04, 0x19, 0x8B, 0x44, 0x24, 0x0C, 0x8B, 0x44, 0x03, 0x28,
-    0x01, 0xD8, 0xFF, 0xD0, 0xC7, 0x44, 0x24, 0x04, 0x00, 0x00, 0x00, 0x00, 0xC7, 0x04, 0x24, 0x00,
-    0x00, 0x00, 0x00, 0xEB, 0x0C, 0xFF, 0xD6, 0x89, 0x04, 0x24, 0x31, 0xC0, 0x40, 0x89, 0x44, 0x24,
-    0x04, 0x8B, 0x0C, 0x24, 0xC1, 0xE1, 0x10, 0x0F, 0xB7, 0x44, 0x24, 0x04, 0x09, 0xC8, 0x83, 0xC4,
-    0x38, 0x5E, 0x5F, 0x5B, 0x5D, 0xC2, 0x04, 0x00, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
+    0x55, 0x89, 0xE5, 0x57, 0x56, 0x53, 0x83, 0xEC, 0x58, 0x8B, 0x45, 0x08, 0x8B, 0x40, 0x0C, 0x89,
+    0x45, 0xB4, 0x8B, 0x45, 0x08, 0x8B, 0x40, 0x10, 0x89, 0x45, 0xD0, 0x8B, 0x45, 0x08, 0x8B, 0x40,
+    0x14, 0x89, 0x45, 0xBC, 0x8B, 0x45, 0x08, 0x8B, 0x40, 0x18, 0x89, 0x45, 0xB8, 0x8B, 0x45, 0x08,
+    0x83, 0xC0, 0x1C, 0x50, 0x8B, 0x45, 0x08, 0xFF, 0x50, 0x08, 0x83, 0xC4, 0x0C, 0x85, 0xC0, 0x0F,
+    0x84, 0x27, 0x02, 0x00, 0x00, 0x89, 0xC7, 0x8B, 0x40, 0x3C, 0x01, 0xF8, 0x89, 0xC1, 0x89, 0x45,
+    0xD4, 0x89, 0xF8, 0x2B, 0x41, 0x34, 0x89, 0x45, 0xC8, 0x75, 0x16, 0x8B, 0x45, 0xD4, 0x8B, 0x80,
+    0x80, 0x00, 0x00, 0x00, 0x85, 0xC0, 0x0F, 0x85, 0x08, 0x01, 0x00, 0x00, 0xE9, 0x07, 0x02, 0x00,
+    0x00, 0x8B, 0x45, 0xD4, 0x8B, 0x98, 0xA0, 0x00, 0x00, 0x00, 0x85, 0xDB, 0x74, 0xDD, 0x83, 0xB8,
+    0xA4, 0x00, 0x00, 0x00, 0x00, 0x74, 0xD4, 0x01, 0xFB, 0x0F, 0x84, 0xD6, 0x00, 0x00, 0x00, 0x8B,
+    0x43, 0x04, 0x8B, 0x13, 0x89, 0xC1, 0x01, 0xD1, 0x74, 0xC1, 0x83, 0xE8, 0x08, 0x8D, 0x0C, 0x17,
+    0x83, 0xE0, 0xFE, 0x89, 0x4D, 0xCC, 0x89, 0xD9, 0x01, 0xD8, 0x89, 0x45, 0xC4, 0x31, 0xC0, 0x39,
+    0x4D, 0xC4, 0x0F, 0x84, 0x8D, 0x00, 0x00, 0x00, 0x66, 0x8B, 0x51, 0x08, 0x66, 0xC1, 0xEA, 0x0C,
+    0x66, 0x83, 0xFA, 0x03, 0x75, 0x77, 0x84, 0xC0, 0x75, 0x19, 0x8D, 0x45, 0xE0, 0x89, 0x4D, 0xC0,
+    0x50, 0x8B, 0x45, 0xD0, 0x6A, 0x40, 0x68, 0x00, 0x10, 0x00, 0x00, 0xFF, 0x75, 0xCC, 0xFF, 0xD0,
+    0x8B, 0x4D, 0xC0, 0x66, 0x8B, 0x71, 0x08, 0x8B, 0x55, 0xCC, 0x89, 0xF0, 0x81, 0xE6, 0xFF, 0x0F,
+    0x00, 0x00, 0x66, 0x25, 0xFF, 0x0F, 0x01, 0xD6, 0x66, 0x3D, 0xFC, 0x0F, 0x76, 0x38, 0x8D, 0x92,
+    0x00, 0x10, 0x00, 0x00, 0x8D, 0x45, 0xE4, 0x89, 0x4D, 0xB0, 0x50, 0x8B, 0x45, 0xD0, 0x6A, 0x40,
+    0x6A, 0x01, 0x52, 0x89, 0x55, 0xC0, 0xFF, 0xD0, 0x8B, 0x55, 0xC0, 0x8B, 0x45, 0xC8, 0x01, 0x06,
+    0x8D, 0x45, 0xE4, 0x50, 0x8B, 0x45, 0xD0, 0xFF, 0x75, 0xE4, 0x6A, 0x01, 0x52, 0xFF, 0xD0, 0x8B,
+    0x4D, 0xB0, 0xB0, 0x01, 0xEB, 0x07, 0x8B, 0x45, 0xC8, 0x01, 0x06, 0xEB, 0xF5, 0x83, 0xC1, 0x02,
+    0xE9, 0x6A, 0xFF, 0xFF, 0xFF, 0x84, 0xC0, 0x74, 0x14, 0x8D, 0x45, 0xE0, 0x50, 0x8B, 0x45, 0xD0,
+    0xFF, 0x75, 0xE0, 0x68, 0x00, 0x10, 0x00, 0x00, 0xFF, 0x75, 0xCC, 0xFF, 0xD0, 0x03, 0x5B, 0x04,
+    0xE9, 0x2A, 0xFF, 0xFF, 0xFF, 0xB8, 0x02, 0x00, 0x00, 0x00, 0x0F, 0xB7, 0xD8, 0x31, 0xC0, 0xE9,
+    0x58, 0x01, 0x00, 0x00, 0x8B, 0x4D, 0xD4, 0x83, 0xB9, 0x84, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x84,
+    0xF4, 0x00, 0x00, 0x00, 0x01, 0xF8, 0x89, 0x45, 0xCC, 0x8B, 0x45, 0xCC, 0x8B, 0x58, 0x0C, 0x85,
+    0xDB, 0x0F, 0x84, 0xE1, 0x00, 0x00, 0x00, 0x83, 0xEC, 0x0C, 0x01, 0xFB, 0x8B, 0x45, 0xB4, 0x53,
+    0xFF, 0xD0, 0x89, 0x45, 0xC8, 0x83, 0xC4, 0x0C, 0x85, 0xC0, 0x75, 0x12, 0xB8, 0x24, 0x02, 0x00,
+    0x00, 0x85, 0xDB, 0x0F, 0x85, 0x9B, 0x00, 0x00, 0x00, 0xE9, 0xBA, 0x00, 0x00, 0x00, 0x8B, 0x4D,
+    0xCC, 0x8B, 0x45, 0xCC, 0x8B, 0x71, 0x10, 0x8B, 0x00, 0x01, 0xFE, 0x89, 0x75, 0xC4, 0x85, 0xC0,
+    0x74, 0x05, 0x01, 0xF8, 0x89, 0x45, 0xC4, 0x31, 0xDB, 0x8B, 0x45, 0xC4, 0x83, 0x3C, 0x98, 0x00,
+    0x74, 0x03, 0x43, 0xEB, 0xF4, 0x85, 0xDB, 0x74, 0x62, 0x8D, 0x04, 0x9D, 0x00, 0x00, 0x00, 0x00,
+    0x89, 0xF3, 0x89, 0x45, 0xC0, 0x8D, 0x45, 0xE4, 0x50, 0x8B, 0x45, 0xD0, 0x6A, 0x40, 0xFF, 0x75,
+    0xC0, 0x56, 0xFF, 0xD0, 0x8B, 0x45, 0xC0, 0x01, 0xF0, 0x89, 0x45, 0xB0, 0x8B, 0x45, 0xC4, 0x29,
+    0xF0, 0x8B, 0x04, 0x18, 0x85, 0xC0, 0x79, 0x07, 0x0F, 0xB7, 0xC0, 0x51, 0x51, 0xEB, 0x06, 0x52,
+    0x8D, 0x44, 0x07, 0x02, 0x52, 0x50, 0x8B, 0x45, 0xBC, 0x83, 0xC3, 0x04, 0xFF, 0x75, 0xC8, 0xFF,
+    0xD0, 0x5A, 0x59, 0x89, 0x43, 0xFC, 0x39, 0x5D, 0xB0, 0x75, 0xD1, 0x8D, 0x45, 0xE4, 0x50, 0x8B,
+    0x45, 0xD0, 0xFF, 0x75, 0xE4, 0xFF, 0x75, 0xC0, 0x56, 0xFF, 0xD0, 0x83, 0x45, 0xCC, 0x14, 0xE9,
+    0x35, 0xFF, 0xFF, 0xFF, 0x8A, 0x94, 0x03, 0xDC, 0xFD, 0xFF, 0xFF, 0x8B, 0x7D, 0x08, 0x84, 0xD2,
+    0x74, 0x06, 0x88, 0x14, 0x07, 0x40, 0xEB, 0xEC, 0xC6, 0x04, 0x07, 0x00, 0x8B, 0x45, 0xB8, 0xBB,
+    0x01, 0x00, 0x00, 0x00, 0xFF, 0xD0, 0xEB, 0x54, 0x8B, 0x45, 0xD4, 0x8B, 0x90, 0xC0, 0x00, 0x00,
+    0x00, 0x31, 0xC0, 0x85, 0xD2, 0x0F, 0x84, 0xDF, 0xFE, 0xFF, 0xFF, 0x8B, 0x5C, 0x17, 0x0C, 0x85,
+    0xDB, 0x75, 0x14, 0x8B, 0x45, 0x08, 0x8B, 0x00, 0x85, 0xC0, 0x74, 0x1F, 0x8B, 0x4D, 0x08, 0x8B,
+    0x51, 0x04, 0x89, 0x04, 0x3A, 0xEB, 0x14, 0x8B, 0x03, 0x85, 0xC0, 0x74, 0xE6, 0x52, 0x83, 0xC3,
+    0x04, 0x6A, 0x00, 0x6A, 0x01, 0x57, 0xFF, 0xD0, 0x59, 0xEB, 0xEC, 0x8B, 0x75, 0xD4, 0x8B, 0x46,
+    0x28, 0x01, 0xF8, 0xFF, 0xD0, 0x31, 0xC0, 0xE9, 0x9E, 0xFE, 0xFF, 0xFF, 0x8D, 0x65, 0xF4, 0xC1,
+    0xE0, 0x10, 0x09, 0xD8, 0x5B, 0x5E, 0x5F, 0x5D, 0xC2, 0x04, 0x00, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC,
 };
 
 static_assert(sizeof(INJECT_SHELLCODE) % 16 == 0);
@@ -125,19 +123,14 @@ THGameSig* CheckOngoingGameByPID(DWORD pid, uintptr_t* base, HANDLE* pOutHandle)
 
     ExeSig sig;
     if (GetExeInfoEx((size_t)hProc, *base, sig)) {
-        for (auto& gameDef : gGameDefs) {
-            if (gameDef.catagory != CAT_MAIN && gameDef.catagory != CAT_SPINOFF_STG) {
-                continue;
-            }
-            if (gameDef.exeSig.textSize != sig.textSize || gameDef.exeSig.timeStamp != sig.timeStamp) {
-                continue;
-            }
+        auto gameDef = FindGameDefByHeader(sig);
+        if (gameDef && (gameDef->catagory == CAT_MAIN || gameDef->catagory == CAT_SPINOFF_STG)) {
             if (pOutHandle) {
                 *pOutHandle = hProc;
             } else {
                 CloseHandle(hProc);
             }
-            return &gameDef;
+            return gameDef;
         }
     }
     // I should not have to do this...
@@ -24,6 +24,12 @@ struct remote_param {
     char sLoadErrDllName[MAX_PATH];
 };
 
+// INJECT_SHELLCODE has these offsets baked in. wchar_t has to be 2 bytes wide
+// in whatever inject_shellcode.cpp is compiled with.
+static_assert(offsetof(remote_param, sExePath) == 0x1C);
+static_assert(offsetof(remote_param, sLoadErrDllName) == 0x224);
+static_assert(sizeof(remote_param) == 0x328);
+
 // GetLastError return value + an additional error code packed in a 32 bit integer
 // Return value of InjectShellcode in inject_shellcode.cpp
 struct InjectResult {
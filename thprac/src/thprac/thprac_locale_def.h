@@ -1,7 +1,6 @@
 // THIS FILE IS AUTOGENERATED
 // If you want to edit this file, edit thprac_games_def.json
-// Then, use the thprac devtools to regenerate this file
-// https://github.com/touhouworldcup/thprac_utils/
+// Then, use thprac/tools/thprac_locale_gen to regenerate this file
 
 #pragma once
 #include <cstdint>
@@ -785,6 +784,7 @@ enum th_glossary_t
     THPRAC_SCAN_SCANNING,
     THPRAC_SCAN_SCAN_ABORT_TEXT,
     THPRAC_SCAN_SCAN_ABORT_TITLE,
+    THPRAC_SCAN_SCAN_COUNTERS,
     THPRAC_SCAN_SCAN_FINISHED,
     THPRAC_SCAN_SCAN_FOR,
     THPRAC_SCAN_SCAN_RESULT_C1,
@@ -1031,7 +1031,15 @@ enum th_glossary_t
     TH_WARP,
 };
 
-extern const char* th_glossary_str[3][1019];
+constexpr uint32_t TH_LOCALE_POOL_ROW = 0x4000;
+extern const char th_locale_pool[11][TH_LOCALE_POOL_ROW];
+
+inline const char* th_locale_str(uint32_t offset)
+{
+    return &th_locale_pool[offset / TH_LOCALE_POOL_ROW][offset % TH_LOCALE_POOL_ROW];
+}
+
+extern const uint32_t th_glossary_ofs[3][1020];
 
 extern const th_glossary_t TH_TYPE_SELECT[13];
 
@@ -1168,7 +1176,7 @@ enum th_sections_t : uint8_t
     TH06_ST4_MB_BOSS7,
 };
 
-extern const char* th_sections_str[3][4][107];
+extern const uint32_t th_sections_ofs[3][4][107];
 
 extern const uint8_t th_sections_bgm[107];
 
@@ -1290,7 +1298,7 @@ enum th_sections_t : uint8_t
     TH07_ST8_END_S11,
 };
 
-extern const char* th_sections_str[3][4][104];
+extern const uint32_t th_sections_ofs[3][4][104];
 
 extern const uint8_t th_sections_bgm[104];
 
@@ -1413,7 +1421,7 @@ enum th_sections_t : uint8_t
     TH08_ST7_END_LS,
 };
 
-extern const char* th_sections_str[3][4][105];
+extern const uint32_t th_sections_ofs[3][4][105];
 
 extern const uint8_t th_sections_bgm[105];
 
@@ -1432,7 +1440,7 @@ enum th_sections_t : uint8_t
     A0000ERROR,
 };
 
-extern const char* th_sections_str[3][4][1];
+extern const uint32_t th_sections_ofs[3][4][1];
 
 extern const uint8_t th_sections_bgm[1];
 
@@ -1517,7 +1525,7 @@ enum th_sections_t : uint8_t
     TH10_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][69];
+extern const uint32_t th_sections_ofs[3][4][69];
 
 extern const uint8_t th_sections_bgm[69];
 
@@ -1552,7 +1560,7 @@ enum th_sections_t : uint8_t
     ALCOSTG_ST3_BOSS9,
 };
 
-extern const char* th_sections_str[3][4][19];
+extern const uint32_t th_sections_ofs[3][4][19];
 
 extern const uint8_t th_sections_bgm[19];
 
@@ -1661,7 +1669,7 @@ enum th_sections_t : uint8_t
     TH11_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][89];
+extern const uint32_t th_sections_ofs[3][4][89];
 
 extern const uint8_t th_sections_bgm[89];
 
@@ -1753,7 +1761,7 @@ enum th_sections_t : uint8_t
     TH12_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][72];
+extern const uint32_t th_sections_ofs[3][4][72];
 
 extern const uint8_t th_sections_bgm[72];
 
@@ -1772,7 +1780,7 @@ enum th_sections_t : uint8_t
     A0000ERROR,
 };
 
-extern const char* th_sections_str[3][4][1];
+extern const uint32_t th_sections_ofs[3][4][1];
 
 extern const uint8_t th_sections_bgm[1];
 
@@ -1945,7 +1953,7 @@ enum th_sections_t : uint8_t
     TH128_EX_END_S10,
 };
 
-extern const char* th_sections_str[3][4][157];
+extern const uint32_t th_sections_ofs[3][4][157];
 
 extern const uint8_t th_sections_bgm[157];
 
@@ -2044,7 +2052,7 @@ enum th_sections_t : uint8_t
     TH13_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][73];
+extern const uint32_t th_sections_ofs[3][4][73];
 
 extern const uint8_t th_sections_bgm[73];
 
@@ -2149,7 +2157,7 @@ enum th_sections_t : uint8_t
     TH14_ST4B_BOSS6,
 };
 
-extern const char* th_sections_str[3][4][89];
+extern const uint32_t th_sections_ofs[3][4][89];
 
 extern const uint8_t th_sections_bgm[89];
 
@@ -2249,7 +2257,7 @@ enum th_sections_t : uint8_t
     TH15_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][74];
+extern const uint32_t th_sections_ofs[3][4][74];
 
 extern const uint8_t th_sections_bgm[74];
 
@@ -2342,7 +2350,7 @@ enum th_sections_t : uint8_t
     TH16_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][73];
+extern const uint32_t th_sections_ofs[3][4][73];
 
 extern const uint8_t th_sections_bgm[73];
 
@@ -2429,7 +2437,7 @@ enum th_sections_t : uint8_t
     TH17_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][67];
+extern const uint32_t th_sections_ofs[3][4][67];
 
 extern const uint8_t th_sections_bgm[67];
 
@@ -2517,7 +2525,7 @@ enum th_sections_t : uint8_t
     TH18_ST7_END_S10,
 };
 
-extern const char* th_sections_str[3][4][66];
+extern const uint32_t th_sections_ofs[3][4][66];
 
 extern const uint8_t th_sections_bgm[66];
 
@@ -2536,7 +2544,7 @@ enum th_sections_t : uint8_t
     A0000ERROR,
 };
 
-extern const char* th_sections_str[3][4][1];
+extern const uint32_t th_sections_ofs[3][4][1];
 
 extern const uint8_t th_sections_bgm[1];
 
@@ -2555,7 +2563,7 @@ enum th_sections_t : uint8_t
     A0000ERROR,
 };
 
-extern const char* th_sections_str[3][4][1];
+extern const uint32_t th_sections_ofs[3][4][1];
 
 extern const uint8_t th_sections_bgm[1];
 
@@ -2565,10 +2573,16 @@ extern const th_sections_t th_sections_cbt[1][2][1];
 
 }
 
-extern const wchar_t __thprac_loc_range_zh[3237];
+extern const uint16_t th_glyph_ranges_used_zh[2723];
+
+extern const uint16_t th_glyph_ranges_used_en[31];
+
+extern const uint16_t th_glyph_ranges_used_ja[2209];
+
+extern const uint16_t th_glyph_ranges_zh[13];
 
-extern const wchar_t __thprac_loc_range_en[35];
+extern const uint16_t th_glyph_ranges_en[31];
 
-extern const wchar_t __thprac_loc_range_ja[2737];
+extern const uint16_t th_glyph_ranges_ja[7685];
 
 }
@@ -1,4 +1,5 @@
 ﻿#include "thprac_main.h"
+#include "thprac_exe_cache.h"
 #include "thprac_games.h"
 #include "thprac_gui_locale.h"
 #include "thprac_launcher_wnd.h"
@@ -129,12 +130,14 @@ THGameSig* CheckOngoingGame(PROCESSENTRY32W& proc, uintptr_t* base, HANDLE* pOut
 
 bool CheckIfGameExistEx(THGameSig& gameSig, const wchar_t* name)
 {
-    MappedFile file(name);
-    if (!file.fileMapView)
+    ExeSig exeSig;
+    bool hasSig = ExeCacheGet(name, exeSig, [&](ExeSig& sig) {
+        MappedFile file(name);
+        return file.fileMapView && GetExeInfo(file.fileMapView, file.fileSize, sig);
+    });
+    if (!hasSig)
         return false;
 
-    ExeSig exeSig;
-    GetExeInfo(file.fileMapView, file.fileSize, exeSig);
     for (int i = 0; i < 4; ++i) {
         if (exeSig.metroHash[i] != gameSig.exeSig.metroHash[i]) {
             return false;
@@ -177,6 +180,7 @@ bool RunGameWithTHPrac(THGameSig& gameSig, const wchar_t* const name, bool withV
     PROCESS_INFORMATION proc_info;
     memset(&startup_info, 0, sizeof(startup_info));
     startup_info.cb = sizeof(startup_info);
+    LauncherCfgFlush();
     CreateProcessW(name, nullptr, nullptr, nullptr, false, CREATE_SUSPENDED, nullptr, nullptr, &startup_info, &proc_info);
     uintptr_t base = GetGameModuleBase(proc_info.hProcess);
 
@@ -222,6 +226,7 @@ bool FindOngoingGame(bool prompt_if_no_game, bool prompt_if_yes_game)
                 if (prompt_if_yes_game) {
                     if(!PromptUser(PR_ASK_IF_ATTACH, gameSig)) continue;
                 }
+                LauncherCfgFlush();
                 if (WriteTHPracSig(hProc, base) && LoadSelf(hProc)) {
                     if (prompt_if_yes_game) {
                         PromptUser(PR_INFO_ATTACHED);
@@ -247,6 +252,7 @@ bool FindOngoingGame(bool prompt_if_no_game, bool prompt_if_yes_game)
 
 bool FindAndRunGame(bool prompt)
 {
+    defer(ExeCacheFlush());
     std::wstring name;
     for (auto& sig : gGameDefs) {
         if (CheckIfGameExist(sig, name)) {
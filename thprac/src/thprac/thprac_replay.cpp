@@ -0,0 +1,511 @@
+#include "thprac_replay.h"
+
+#include <string.h>
+#include <algorithm>
+#include <memory>
+
+// SSE2 is always there on the x86 builds
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define REPLAY_LEGACY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace THPrac {
+
+/// Block cipher
+/// ------------------
+// Each block is split in two halves, which are interleaved backwards: the
+// first half of the ciphertext holds the odd bytes from the end of the block,
+// and the second half the even ones. Every byte is xored with a key that grows
+// by step after each byte, and carries over from one block to the next.
+
+// Number of bytes from the start that are actually encrypted. A trailing
+// partial block shorter than a quarter block is left as is, and so is the last
+// byte of an odd sized buffer.
+static size_t CipherEnd(size_t size, uint32_t block, size_t limit)
+{
+    size_t n = std::min(size, limit);
+    size_t rem = n % block;
+    size_t end = n - (rem < block / 4 ? rem : 0);
+    size_t odd = n & 1;
+    return end > odd ? end - odd : 0;
+}
+
+static void EncryptBlock(const uint8_t* in, uint8_t* out, size_t bs, uint8_t& key, uint8_t step)
+{
+    size_t half = (bs + 1) / 2;
+    for (size_t i = 0; i < half; i++) {
+        out[i] = in[bs - 1 - 2 * i] ^ key;
+        key += step;
+    }
+    for (size_t i = 0; i < bs / 2; i++) {
+        out[half + i] = in[bs - 2 - 2 * i] ^ key;
+        key += step;
+    }
+}
+
+static void DecryptBlock(const uint8_t* in, uint8_t* out, size_t bs, uint8_t& key, uint8_t step)
+{
+    size_t half = (bs + 1) / 2;
+    for (size_t i = 0; i < half; i++) {
+        out[bs - 1 - 2 * i] = in[i] ^ key;
+        key += step;
+    }
+    for (size_t i = 0; i < bs / 2; i++) {
+        out[bs - 2 - 2 * i] = in[half + i] ^ key;
+        key += step;
+    }
+}
+
+void ReplayEncrypt(uint8_t* data, size_t size, uint8_t key, uint8_t step, uint32_t block, size_t limit)
+{
+    size_t end = CipherEnd(size, block, limit);
+    std::vector<uint8_t> tmp(std::min<size_t>(block, end));
+    for (size_t p = 0; p < end; p += block) {
+        size_t bs = std::min<size_t>(block, end - p);
+        memcpy(tmp.data(), data + p, bs);
+        EncryptBlock(tmp.data(), data + p, bs, key, step);
+    }
+}
+
+void ReplayDecrypt(uint8_t* data, size_t size, uint8_t key, uint8_t step, uint32_t block, size_t limit)
+{
+    size_t end = CipherEnd(size, block, limit);
+    std::vector<uint8_t> tmp(std::min<size_t>(block, end));
+    for (size_t p = 0; p < end; p += block) {
+        size_t bs = std::min<size_t>(block, end - p);
+        memcpy(tmp.data(), data + p, bs);
+        DecryptBlock(tmp.data(), data + p, bs, key, step);
+    }
+}
+/// ------------------
+
+/// LZSS
+/// ------------------
+// Bits are read MSB first. A 1 bit is followed by a literal byte, a 0 bit by
+// a 13 bit dictionary offset and a 4 bit length, biased by 3. Offset 0 marks
+// the end of the stream, which is why the dictionary is filled starting at 1.
+constexpr size_t LZSS_DICT_SIZE = 0x2000;
+constexpr size_t LZSS_DICT_MASK = LZSS_DICT_SIZE - 1;
+constexpr size_t LZSS_MIN_MATCH = 3;
+constexpr size_t LZSS_MAX_MATCH = 18;
+
+template <typename Source>
+static size_t UnlzssImpl(Source& src, uint8_t* out, size_t out_size)
+{
+    uint8_t dict[LZSS_DICT_SIZE] = {};
+    size_t head = 1;
+    size_t written = 0;
+
+    uint32_t bits = 0;
+    uint32_t bit_count = 0;
+    auto get_bits = [&](uint32_t n, uint32_t& v) -> bool {
+        while (bit_count < n) {
+            int c = src.Next();
+            if (c < 0) {
+                return false;
+            }
+            bits = (bits << 8) | (uint32_t)c;
+            bit_count += 8;
+        }
+        bit_count -= n;
+        v = (bits >> bit_count) & ((1u << n) - 1);
+        return true;
+    };
+
+    while (written < out_size) {
+        uint32_t flag, v;
+        if (!get_bits(1, flag)) {
+            break;
+        }
+        if (flag) {
+            if (!get_bits(8, v)) {
+                break;
+            }
+            out[written++] = (uint8_t)v;
+            dict[head] = (uint8_t)v;
+            head = (head + 1) & LZSS_DICT_MASK;
+            continue;
+        }
+
+        uint32_t offset, len;
+        if (!get_bits(13, offset) || !offset || !get_bits(4, len)) {
+            break;
+        }
+        len += LZSS_MIN_MATCH;
+        for (uint32_t i = 0; i < len && written < out_size; i++) {
+            uint8_t c = dict[(offset + i) & LZSS_DICT_MASK];
+            out[written++] = c;
+            dict[head] = c;
+            head = (head + 1) & LZSS_DICT_MASK;
+        }
+    }
+    return written;
+}
+
+struct MemorySource {
+    const uint8_t* cur;
+    const uint8_t* end;
+
+    int Next()
+    {
+        return cur < end ? *cur++ : -1;
+    }
+};
+
+size_t ReplayUnlzss(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size)
+{
+    MemorySource src = { in, in + in_size };
+    return UnlzssImpl(src, out, out_size);
+}
+
+struct BitWriter {
+    std::vector<uint8_t>& out;
+    uint32_t cur = 0;
+    uint32_t count = 0;
+
+    void Put(uint32_t v, uint32_t n)
+    {
+        cur = (cur << n) | (v & ((1u << n) - 1));
+        count += n;
+        while (count >= 8) {
+            count -= 8;
+            out.push_back((uint8_t)(cur >> count));
+        }
+    }
+    void Flush()
+    {
+        if (count) {
+            out.push_back((uint8_t)(cur << (8 - count)));
+            count = 0;
+        }
+    }
+};
+
+// Greedy matching with hash chains over the input. Matches are kept far enough
+// back that the decoder never overwrites a dictionary byte before reading it.
+std::vector<uint8_t> ReplayLzss(const uint8_t* in, size_t in_size)
+{
+    constexpr size_t HASH_BITS = 13;
+    constexpr size_t MAX_DISTANCE = LZSS_DICT_SIZE - LZSS_MAX_MATCH;
+    constexpr size_t MAX_CHAIN = 256;
+
+    std::vector<uint8_t> ret;
+    ret.reserve(in_size / 2 + 16);
+    BitWriter writer = { ret };
+
+    // Input positions + 1, 0 is the end of a chain
+    std::vector<uint32_t> hash_head(1 << HASH_BITS);
+    std::vector<uint32_t> hash_prev(LZSS_DICT_SIZE);
+    auto hash = [&](size_t i) {
+        uint32_t v = in[i] | (in[i + 1] << 8) | (in[i + 2] << 16);
+        return (v * 0x9E3779B1u) >> (32 - HASH_BITS);
+    };
+    auto insert = [&](size_t i) {
+        if (i + LZSS_MIN_MATCH <= in_size) {
+            uint32_t h = hash(i);
+            hash_prev[i & LZSS_DICT_MASK] = hash_head[h];
+            hash_head[h] = (uint32_t)i + 1;
+        }
+    };
+
+    for (size_t i = 0; i < in_size;) {
+        size_t best_len = 0;
+        size_t best_pos = 0;
+        size_t max_len = std::min(LZSS_MAX_MATCH, in_size - i);
+
+        if (max_len >= LZSS_MIN_MATCH) {
+            size_t chain = MAX_CHAIN;
+            for (uint32_t cand = hash_head[hash(i)]; cand && chain; chain--) {
+                size_t j = cand - 1;
+                if (i - j > MAX_DISTANCE) {
+                    break;
+                }
+                // The dictionary slot of input byte j is j + 1, and slot 0 can't be referenced
+                if (((j + 1) & LZSS_DICT_MASK) != 0) {
+                    size_t len = 0;
+                    while (len < max_len && in[j + len] == in[i + len]) {
+                        len++;
+                    }
+                    if (len > best_len) {
+                        best_len = len;
+                        best_pos = j;
+                        if (len == max_len) {
+                            break;
+                        }
+                    }
+                }
+                cand = hash_prev[j & LZSS_DICT_MASK];
+            }
+        }
+
+        if (best_len >= LZSS_MIN_MATCH) {
+            writer.Put(0, 1);
+            writer.Put((uint32_t)((best_pos + 1) & LZSS_DICT_MASK), 13);
+            writer.Put((uint32_t)(best_len - LZSS_MIN_MATCH), 4);
+            for (size_t k = 0; k < best_len; k++) {
+                insert(i + k);
+            }
+            i += best_len;
+        } else {
+            writer.Put(1, 1);
+            writer.Put(in[i], 8);
+            insert(i);
+            i++;
+        }
+    }
+
+    // End marker
+    writer.Put(0, 1);
+    writer.Put(0, 13);
+    writer.Flush();
+    return ret;
+}
+/// ------------------
+
+/// Streaming decode
+/// ------------------
+// Runs every cipher layer over one chunk at a time into a pair of small
+// buffers, and feeds the result to the LZSS decoder. The chunk is the largest
+// block size, and since blocks start at multiples of their size from the start
+// of the data, no block ever straddles two chunks.
+constexpr size_t REPLAY_MAX_LAYERS = 4;
+
+class ReplayDecryptSource {
+    struct Layer {
+        uint8_t key;
+        uint8_t step;
+        uint32_t block;
+        size_t end;
+    };
+
+    const uint8_t* mSrc;
+    size_t mSrcSize;
+    size_t mPos = 0;
+    size_t mChunk = 1;
+    Layer mLayers[REPLAY_MAX_LAYERS];
+    size_t mLayerCount;
+    const uint8_t* mCur = nullptr;
+    const uint8_t* mEnd = nullptr;
+    uint8_t mBuf[2][REPLAY_CIPHER_MAX_BLOCK];
+
+    void DecryptChunk(const uint8_t* in, uint8_t* out, size_t n, Layer& l)
+    {
+        for (size_t off = 0; off < n;) {
+            size_t g = mPos + off;
+            if (g >= l.end) {
+                memcpy(out + off, in + off, n - off);
+                break;
+            }
+            size_t bs = std::min<size_t>(l.block, l.end - g);
+            DecryptBlock(in + off, out + off, bs, l.key, l.step);
+            off += bs;
+        }
+    }
+
+    bool Refill()
+    {
+        if (mPos >= mSrcSize) {
+            return false;
+        }
+        size_t n = std::min(mChunk, mSrcSize - mPos);
+        const uint8_t* in = mSrc + mPos;
+        for (size_t i = 0; i < mLayerCount; i++) {
+            uint8_t* out = mBuf[i & 1];
+            DecryptChunk(in, out, n, mLayers[i]);
+            in = out;
+        }
+        mCur = in;
+        mEnd = in + n;
+        mPos += n;
+        return true;
+    }
+
+public:
+    bool valid = true;
+
+    ReplayDecryptSource(const uint8_t* src, size_t src_size, const ReplayCipherLayer* layers, size_t layer_count)
+        : mSrc(src)
+        , mSrcSize(src_size)
+        , mLayerCount(layer_count)
+    {
+        if (layer_count > REPLAY_MAX_LAYERS) {
+            valid = false;
+            return;
+        }
+        for (size_t i = 0; i < layer_count; i++) {
+            if (!layers[i].block || layers[i].block > REPLAY_CIPHER_MAX_BLOCK) {
+                valid = false;
+                return;
+            }
+            mChunk = std::max<size_t>(mChunk, layers[i].block);
+            mLayers[i] = { layers[i].key, layers[i].step, layers[i].block, CipherEnd(src_size, layers[i].block, src_size) };
+        }
+        for (size_t i = 0; i < layer_count; i++) {
+            if (mChunk % layers[i].block) {
+                valid = false;
+                return;
+            }
+        }
+        if (!layer_count) {
+            mChunk = REPLAY_CIPHER_MAX_BLOCK;
+        }
+    }
+
+    int Next()
+    {
+        if (mCur == mEnd && !Refill()) {
+            return -1;
+        }
+        return *mCur++;
+    }
+};
+
+bool ReplayDecodeStream(const uint8_t* src, size_t src_size, const ReplayCipherLayer* layers, size_t layer_count, uint8_t* out, size_t out_size)
+{
+    // About 8KB of buffers, keep it off the stack
+    auto source = std::make_unique<ReplayDecryptSource>(src, src_size, layers, layer_count);
+    if (!source->valid) {
+        return false;
+    }
+    return UnlzssImpl(*source, out, out_size) == out_size;
+}
+/// ------------------
+
+/// PR6T/PR7T cipher
+/// ------------------
+// The keystream only depends on the position, so it's generated 16 bytes at a
+// time: every vector is the previous one plus 16 * 7. Without SSE2 only the
+// scalar loops are left.
+#ifdef REPLAY_LEGACY_SSE2
+static __m128i LegacyKeystream(uint8_t key)
+{
+    const __m128i ramp = _mm_setr_epi8(0, 7, 14, 21, 28, 35, 42, 49, 56, 63, 70, 77, 84, 91, 98, 105);
+    return _mm_add_epi8(_mm_set1_epi8((char)key), ramp);
+}
+#endif
+
+void ReplayLegacyDecrypt(uint8_t* data, size_t size, uint8_t key)
+{
+    size_t i = 0;
+#ifdef REPLAY_LEGACY_SSE2
+    const __m128i step = _mm_set1_epi8(16 * 7);
+    __m128i ks = LegacyKeystream(key);
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_sub_epi8(v, ks));
+        ks = _mm_add_epi8(ks, step);
+    }
+    key += (uint8_t)(7 * i);
+#endif
+    for (; i < size; i++) {
+        data[i] -= key;
+        key += 7;
+    }
+}
+
+// Sum of the decrypted bytes, without writing them anywhere. _mm_sad_epu8
+// against zero adds up each half of a vector into a 64 bit lane.
+static uint32_t LegacySumDecrypted(const uint8_t* data, size_t size, uint8_t key)
+{
+    uint32_t sum = 0;
+    size_t i = 0;
+#ifdef REPLAY_LEGACY_SSE2
+    const __m128i step = _mm_set1_epi8(16 * 7);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i ks = LegacyKeystream(key);
+    __m128i acc = zero;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_sub_epi8(v, ks), zero));
+        ks = _mm_add_epi8(ks, step);
+    }
+    sum = (uint32_t)_mm_cvtsi128_si32(acc) + (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    key += (uint8_t)(7 * i);
+#endif
+    for (; i < size; i++) {
+        sum += (uint8_t)(data[i] - key);
+        key += 7;
+    }
+    return sum;
+}
+
+uint32_t ReplayLegacyChecksumAdd(uint32_t checksum, uint8_t key, size_t offset, const uint8_t* data, size_t size, const ReplayLegacyFormat& fmt)
+{
+    size_t i = 0;
+    if (offset < fmt.sum_start) {
+        i = std::min(size, fmt.sum_start - offset);
+    }
+    for (; i < size && offset + i < fmt.crypt_start; i++) {
+        checksum += data[i];
+    }
+    if (i < size) {
+        checksum += LegacySumDecrypted(data + i, size - i, (uint8_t)(key + 7 * (offset + i - fmt.crypt_start)));
+    }
+    return checksum;
+}
+/// ------------------
+
+
+/// Param block
+/// ------------------
+constexpr size_t REPLAY_USER_PTR_OFFSET = 12;
+constexpr size_t REPLAY_USER_HEADER_SIZE = 12;
+// Same limit the old loader had, nothing thprac writes comes close
+constexpr size_t REPLAY_LEGACY_PARAM_MAX = 512;
+
+static uint32_t ReadU32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// JSON never contains a NUL, so anything from the first one on is padding
+static std::string_view ParamView(const uint8_t* data, size_t size)
+{
+    auto end = (const uint8_t*)memchr(data, 0, size);
+    return std::string_view((const char*)data, end ? end - data : size);
+}
+
+std::span<const uint8_t> ReplayFindUserChunk(const uint8_t* rep, size_t size, uint32_t type)
+{
+    if (!rep || size < REPLAY_USER_PTR_OFFSET + 4)
+        return {};
+    // Every chunk is at least a header long, so this always moves forward
+    size_t offset = ReadU32(rep + REPLAY_USER_PTR_OFFSET);
+    while (offset <= size && size - offset >= REPLAY_USER_HEADER_SIZE) {
+        if (ReadU32(rep + offset) != REPLAY_MAGIC_USER)
+            break;
+        size_t length = ReadU32(rep + offset + 4);
+        if (length < REPLAY_USER_HEADER_SIZE || length > size - offset)
+            break;
+        if (ReadU32(rep + offset + 8) == type)
+            return { rep + offset + REPLAY_USER_HEADER_SIZE, length - REPLAY_USER_HEADER_SIZE };
+        offset += length;
+    }
+    return {};
+}
+
+std::string_view ReplayFindParam(const uint8_t* rep, size_t size)
+{
+    if (!rep || size < 4)
+        return {};
+    uint32_t magic = ReadU32(rep);
+
+    if (magic == REPLAY_MAGIC_PR6T || magic == REPLAY_MAGIC_PR7T) {
+        if (size < 8 || ReadU32(rep + size - 4) != REPLAY_USER_PARAM)
+            return {};
+        size_t length = ReadU32(rep + size - 8);
+        // The param can't overlap the magic at the start either
+        if (!length || length >= REPLAY_LEGACY_PARAM_MAX || length > size - 12)
+            return {};
+        return ParamView(rep + size - 8 - length, length);
+    }
+
+    auto chunk = ReplayFindUserChunk(rep, size, REPLAY_USER_PARAM);
+    return chunk.empty() ? std::string_view() : ParamView(chunk.data(), chunk.size());
+}
+/// ------------------
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace THPrac {
+
+// Replay codec used by TH10 onwards (T8RP and later magics). The replay body
+// is LZSS compressed and then run through the block cipher below two times.
+// None of this depends on a running game or on Windows.
+
+// One pass of the block cipher, with the parameters the game passes to its
+// encrypt/decrypt functions. TH18 for example uses { 0x5c, 0xe1, 0x400 } and
+// { 0x7d, 0x3a, 0x100 }.
+struct ReplayCipherLayer {
+    uint8_t key;
+    uint8_t step;
+    uint32_t block;
+};
+
+// Largest block size supported by ReplayDecodeStream
+constexpr uint32_t REPLAY_CIPHER_MAX_BLOCK = 0x1000;
+
+// In place, exactly like the game's functions. limit caps how many bytes from
+// the start of data take part in the cipher, the games always pass size.
+void ReplayEncrypt(uint8_t* data, size_t size, uint8_t key, uint8_t step, uint32_t block, size_t limit);
+void ReplayDecrypt(uint8_t* data, size_t size, uint8_t key, uint8_t step, uint32_t block, size_t limit);
+
+// Decompresses until the end marker, the end of the input or out_size bytes,
+// whichever comes first. Returns the number of bytes written to out.
+size_t ReplayUnlzss(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size);
+
+// The output is decodable by the game, but isn't byte for byte identical to
+// what the game produces, since match finding differs.
+std::vector<uint8_t> ReplayLzss(const uint8_t* in, size_t in_size);
+
+// Decrypts with every layer in order (the reverse of the order they were
+// encrypted in) and decompresses in one pass, reading straight from src,
+// which can be a read-only file mapping. Returns false if a layer's block is
+// unsupported, or if fewer than out_size bytes could be decoded.
+bool ReplayDecodeStream(const uint8_t* src, size_t src_size, const ReplayCipherLayer* layers, size_t layer_count, uint8_t* out, size_t out_size);
+
+// TH06 and TH07 replays (PR6T and PR7T magics) use a different scheme. Every
+// byte from crypt_start on is stored plus a key, which starts at the byte at
+// sum_start and grows by 7 per byte. The checksum at offset 8 is the seed plus
+// the sum of every decrypted byte from sum_start to the end of the file.
+struct ReplayLegacyFormat {
+    size_t sum_start;
+    size_t crypt_start;
+};
+
+constexpr ReplayLegacyFormat REPLAY_PR6T_FORMAT = { 14, 15 };
+constexpr ReplayLegacyFormat REPLAY_PR7T_FORMAT = { 13, 16 };
+constexpr size_t REPLAY_LEGACY_CHECKSUM_OFFSET = 8;
+constexpr uint32_t REPLAY_LEGACY_CHECKSUM_SEED = 0x3F000318;
+
+// In place, data starting at fmt.crypt_start, with key being the byte at
+// fmt.sum_start. Done 16 bytes at a time where SSE2 is available. thprac
+// never encrypts, ReplaySaveParam appends its param as plain bytes.
+void ReplayLegacyDecrypt(uint8_t* data, size_t size, uint8_t key);
+
+// Adds data, which sits at file offset offset, to checksum. key is the byte at
+// fmt.sum_start. Since the checksum is a plain sum, appending to a replay only
+// needs the old checksum, the key and the new bytes.
+uint32_t ReplayLegacyChecksumAdd(uint32_t checksum, uint8_t key, size_t offset, const uint8_t* data, size_t size, const ReplayLegacyFormat& fmt);
+
+// Magics at the start of a replay. TH10 onwards aren't listed, they're only
+// told apart by the game that wrote them.
+constexpr uint32_t REPLAY_MAGIC_PR6T = 0x50523654; // "T6RP"
+constexpr uint32_t REPLAY_MAGIC_PR7T = 0x50523754; // "T7RP"
+
+// Since TH08, replays end with a chain of "USER" chunks, starting at the
+// offset stored at byte 12. Each one has a 12 byte header: the magic, the
+// length of the chunk including the header, and its type. Type 0 is the text
+// shown in the game's replay info, and thprac adds one of type "PRAC".
+constexpr uint32_t REPLAY_MAGIC_USER = 0x52455355; // "USER"
+constexpr uint32_t REPLAY_USER_INFO = 0;
+constexpr uint32_t REPLAY_USER_PARAM = 0x43415250; // "PRAC"
+
+// Body of the first USER chunk of that type, or an empty span if there's none.
+// The chain is walked with every offset checked against size, so a truncated
+// or malformed replay just comes back empty.
+std::span<const uint8_t> ReplayFindUserChunk(const uint8_t* rep, size_t size, uint32_t type);
+
+// Parameters thprac appends to a replay when saving it, see ReplaySaveParam.
+// TH06 and TH07 replays end with the JSON, its padded length and "PRAC".
+// Later ones get a USER chunk of type REPLAY_USER_PARAM. Returns a view into
+// rep without the NUL padding, or an empty one if there's nothing there.
+std::string_view ReplayFindParam(const uint8_t* rep, size_t size);
+
+}
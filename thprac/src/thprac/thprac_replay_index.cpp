@@ -0,0 +1,494 @@
+#include "thprac_replay_index.h"
+#include "thprac_replay.h"
+#include <metrohash128.h>
+#include <rapidjson/document.h>
+
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace THPrac {
+
+constexpr uint32_t REPLAY_CATALOG_MAGIC = 0x43525054; // "TPRC"
+constexpr uint32_t REPLAY_CATALOG_FORMAT = 1;
+// Keeps every offset in a ReplayCatalogStr valid
+constexpr size_t REPLAY_CATALOG_MAX_POOL = UINT32_MAX;
+
+// Everything after the header is covered by checksum
+struct ReplayCatalogHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t recordSize;
+    uint32_t count;
+    uint32_t poolSize;
+    uint32_t reserved;
+    uint32_t checksum[4];
+};
+static_assert(sizeof(ReplayCatalogHeader) % alignof(ReplayCatalogRecord) == 0);
+static_assert(sizeof(ReplayCatalogRecord) % alignof(ReplayCatalogRecord) == 0);
+
+std::string ReplayPathToUtf8(std::wstring_view path)
+{
+    std::string out;
+    out.reserve(path.size());
+    for (size_t i = 0; i < path.size(); i++) {
+        uint32_t c = (uint32_t)path[i];
+        if constexpr (sizeof(wchar_t) == 2) {
+            if (c >= 0xD800 && c < 0xDC00 && i + 1 < path.size() && path[i + 1] >= 0xDC00 && path[i + 1] < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)path[i + 1] - 0xDC00);
+                i++;
+            }
+        }
+        if (c < 0x80) {
+            out += (char)c;
+        } else if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        } else {
+            out += (char)(0xF0 | ((c >> 18) & 0x07));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
+}
+
+/// Replay info
+/// ------------------
+struct ReplayMagicGame {
+    char magic[5];
+    const char* game;
+};
+
+// TH14 reuses TH13's magic, see ReplayGameFromName
+static const ReplayMagicGame REPLAY_MAGIC_GAMES[] = {
+    { "T6RP", "th06" }, { "T7RP", "th07" }, { "T8RP", "th08" }, { "T9RP", "th09" },
+    { "t95r", "th095" }, { "t10r", "th10" }, { "t11r", "th11" }, { "t12r", "th12" },
+    { "t125", "th125" }, { "128r", "th128" }, { "t13r", "th13" }, { "t143", "th143" },
+    { "t15r", "th15" }, { "t16r", "th16" }, { "t156", "th165" }, { "t17r", "th17" },
+    { "t18r", "th18" }, { "t185", "th185" }, { "t19r", "th19" },
+};
+
+static const char* const TH06_SHOTS[] = { "ReimuA", "ReimuB", "MarisaA", "MarisaB" };
+static const char* const TH06_DIFFICULTIES[] = { "Easy", "Normal", "Hard", "Lunatic", "Extra" };
+// Decrypted TH06 header: date and name are NUL padded, score is the final one
+constexpr size_t TH06_SHOT_OFFSET = 6;
+constexpr size_t TH06_DIFFICULTY_OFFSET = 7;
+constexpr size_t TH06_DATE_OFFSET = 0x10;
+constexpr size_t TH06_NAME_OFFSET = 0x19;
+constexpr size_t TH06_SCORE_OFFSET = 0x24;
+constexpr size_t TH06_HEADER_SIZE = 0x28;
+
+static const char* const TH07_SHOTS[] = { "ReimuA", "ReimuB", "MarisaA", "MarisaB", "SakuyaA", "SakuyaB" };
+static const char* const TH07_DIFFICULTIES[] = { "Easy", "Normal", "Hard", "Lunatic", "Extra", "Phantasm" };
+// TH07 encrypts like TH06, but everything from TH07_DATA_OFFSET on is LZSS
+// compressed too. The header is at the start of the decompressed data, with
+// the score in tens like the game keeps it.
+constexpr size_t TH07_DATA_OFFSET = 0x54;
+constexpr size_t TH07_SHOT_OFFSET = 2;
+constexpr size_t TH07_DIFFICULTY_OFFSET = 3;
+constexpr size_t TH07_DATE_OFFSET = 4;
+constexpr size_t TH07_DATE_SIZE = 6;
+constexpr size_t TH07_NAME_OFFSET = 0xA;
+constexpr size_t TH07_NAME_SIZE = 9;
+constexpr size_t TH07_SCORE_OFFSET = 0x1C;
+constexpr size_t TH07_HEADER_SIZE = 0x20;
+// A literal takes 9 bits, nothing takes more
+constexpr size_t TH07_HEADER_MAX_PACKED = TH07_HEADER_SIZE * 9 / 8 + 1;
+
+// Games save replays as thXX_01.rpy or thXX_udXXXX.rpy, and players rarely
+// touch the prefix
+static std::string ReplayGameFromName(std::wstring_view fileName)
+{
+    if (fileName.size() < 3 || (fileName[0] | 0x20) != L't' || (fileName[1] | 0x20) != L'h')
+        return {};
+    std::string game = "th";
+    size_t i = 2;
+    for (; i < fileName.size() && i < 6 && fileName[i] >= L'0' && fileName[i] <= L'9'; i++)
+        game += (char)fileName[i];
+    if (game.size() == 2 || i == fileName.size() || fileName[i] != L'_')
+        return {};
+    return game;
+}
+
+static std::string CString(const uint8_t* data, size_t max)
+{
+    auto end = (const uint8_t*)memchr(data, 0, max);
+    return std::string((const char*)data, end ? end - data : max);
+}
+
+static void ReadTh06Header(const uint8_t* rep, size_t size, ReplayInfo& info)
+{
+    if (size < TH06_HEADER_SIZE)
+        return;
+    uint8_t header[TH06_HEADER_SIZE];
+    memcpy(header, rep, sizeof(header));
+    auto& fmt = REPLAY_PR6T_FORMAT;
+    ReplayLegacyDecrypt(header + fmt.crypt_start, sizeof(header) - fmt.crypt_start, header[fmt.sum_start]);
+
+    if (header[TH06_SHOT_OFFSET] < std::size(TH06_SHOTS))
+        info.shot = TH06_SHOTS[header[TH06_SHOT_OFFSET]];
+    if (header[TH06_DIFFICULTY_OFFSET] < std::size(TH06_DIFFICULTIES))
+        info.difficulty = TH06_DIFFICULTIES[header[TH06_DIFFICULTY_OFFSET]];
+    info.date = CString(header + TH06_DATE_OFFSET, TH06_NAME_OFFSET - TH06_DATE_OFFSET);
+    info.name = CString(header + TH06_NAME_OFFSET, TH06_SCORE_OFFSET - TH06_NAME_OFFSET);
+    uint32_t score;
+    memcpy(&score, header + TH06_SCORE_OFFSET, sizeof(score));
+    info.score = score;
+}
+
+// Only the bytes the header can be compressed into are decrypted, not the
+// whole replay
+static void ReadTh07Header(const uint8_t* rep, size_t size, ReplayInfo& info)
+{
+    if (size <= TH07_DATA_OFFSET)
+        return;
+    uint8_t packed[TH07_DATA_OFFSET + TH07_HEADER_MAX_PACKED];
+    size_t packedSize = std::min(size, sizeof(packed));
+    memcpy(packed, rep, packedSize);
+    auto& fmt = REPLAY_PR7T_FORMAT;
+    ReplayLegacyDecrypt(packed + fmt.crypt_start, packedSize - fmt.crypt_start, packed[fmt.sum_start]);
+
+    uint8_t header[TH07_HEADER_SIZE];
+    if (ReplayUnlzss(packed + TH07_DATA_OFFSET, packedSize - TH07_DATA_OFFSET, header, sizeof(header)) != sizeof(header))
+        return;
+
+    if (header[TH07_SHOT_OFFSET] < std::size(TH07_SHOTS))
+        info.shot = TH07_SHOTS[header[TH07_SHOT_OFFSET]];
+    if (header[TH07_DIFFICULTY_OFFSET] < std::size(TH07_DIFFICULTIES))
+        info.difficulty = TH07_DIFFICULTIES[header[TH07_DIFFICULTY_OFFSET]];
+    info.date = CString(header + TH07_DATE_OFFSET, TH07_DATE_SIZE);
+    info.name = CString(header + TH07_NAME_OFFSET, TH07_NAME_SIZE);
+    uint32_t score;
+    memcpy(&score, header + TH07_SCORE_OFFSET, sizeof(score));
+    info.score = (uint64_t)score * 10;
+}
+
+// The info chunk is what the game shows in its replay menu, one "Key value"
+// per line. The first line is the game's title, which matches no key.
+static void ReadUserInfo(std::span<const uint8_t> chunk, ReplayInfo& info)
+{
+    std::string_view text((const char*)chunk.data(), chunk.size());
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\0'))
+            line.remove_suffix(1);
+
+        size_t sep = line.find_first_of(" \t");
+        if (sep == std::string_view::npos)
+            continue;
+        auto key = line.substr(0, sep);
+        auto value = line.substr(sep);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+
+        if (key == "Name") {
+            info.name = value;
+        } else if (key == "Date") {
+            info.date = value;
+        } else if (key == "Chara") {
+            info.shot = value;
+        } else if (key == "Rank") {
+            info.difficulty = value;
+        } else if (key == "Stage") {
+            info.stage = value;
+        } else if (key == "Score") {
+            uint64_t score = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9')
+                    break;
+                score = score * 10 + (c - '0');
+            }
+            info.score = score;
+        }
+    }
+}
+
+static void ReadParam(std::string_view param, ReplayInfo& info)
+{
+    rapidjson::Document doc;
+    if (doc.Parse(param.data(), param.size()).HasParseError() || !doc.IsObject())
+        return;
+    info.param = param;
+    auto getInt = [&](const char* name, int32_t& out) {
+        auto it = doc.FindMember(name);
+        if (it != doc.MemberEnd() && it->value.IsNumber() && it->value.GetDouble() >= INT32_MIN && it->value.GetDouble() <= INT32_MAX)
+            out = (int32_t)it->value.GetDouble();
+    };
+    getInt("mode", info.mode);
+    getInt("stage", info.paramStage);
+    getInt("section", info.section);
+    getInt("phase", info.phase);
+    auto game = doc.FindMember("game");
+    if (game != doc.MemberEnd() && game->value.IsString())
+        info.game = game->value.GetString();
+}
+
+bool ReplayReadInfo(const uint8_t* rep, size_t size, std::wstring_view fileName, ReplayInfo& info)
+{
+    info = ReplayInfo();
+    if (!rep || size < 16)
+        return false;
+
+    const char* magicGame = nullptr;
+    for (auto& entry : REPLAY_MAGIC_GAMES) {
+        if (!memcmp(rep, entry.magic, 4)) {
+            magicGame = entry.game;
+            break;
+        }
+    }
+    auto nameGame = ReplayGameFromName(fileName);
+    auto infoChunk = ReplayFindUserChunk(rep, size, REPLAY_USER_INFO);
+    // A magic we don't know is fine as long as the file is laid out like a
+    // replay, newer games keep the same chunks
+    if (!magicGame && (nameGame.empty() || infoChunk.empty()))
+        return false;
+    info.game = magicGame && (nameGame.empty() || strcmp(magicGame, "th13")) ? magicGame : nameGame;
+
+    uint32_t magic;
+    memcpy(&magic, rep, sizeof(magic));
+    if (magic == REPLAY_MAGIC_PR6T)
+        ReadTh06Header(rep, size, info);
+    else if (magic == REPLAY_MAGIC_PR7T)
+        ReadTh07Header(rep, size, info);
+    else if (!infoChunk.empty())
+        ReadUserInfo(infoChunk, info);
+
+    // The param was written by thprac for a specific game, so it wins
+    auto param = ReplayFindParam(rep, size);
+    if (!param.empty())
+        ReadParam(param, info);
+    return true;
+}
+/// ------------------
+
+/// Catalog
+/// ------------------
+bool ReplayCatalog::Attach(const uint8_t* data, size_t size)
+{
+    *this = ReplayCatalog();
+    ReplayCatalogHeader header;
+    if (!data || size < sizeof(header) || (uintptr_t)data % alignof(ReplayCatalogRecord))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    size_t body = size - sizeof(header);
+    if (header.magic != REPLAY_CATALOG_MAGIC || header.format != REPLAY_CATALOG_FORMAT || header.recordSize != sizeof(ReplayCatalogRecord))
+        return false;
+    // Not covered by the checksum, and left for a later format to use
+    if (header.reserved)
+        return false;
+    if (header.count > body / sizeof(ReplayCatalogRecord) || body - header.count * sizeof(ReplayCatalogRecord) != header.poolSize)
+        return false;
+
+    uint32_t checksum[4];
+    MetroHash128::Hash(data + sizeof(header), body, (uint8_t*)checksum);
+    if (memcmp(checksum, header.checksum, sizeof(checksum)))
+        return false;
+
+    auto records = (const ReplayCatalogRecord*)(data + sizeof(header));
+    for (size_t i = 0; i < header.count; i++) {
+        auto& r = records[i];
+        for (auto str : { r.path, r.game, r.name, r.date, r.shot, r.difficulty, r.stage, r.param }) {
+            if (str.offset > header.poolSize || str.size > header.poolSize - str.offset)
+                return false;
+        }
+    }
+
+    mRecords = records;
+    mCount = header.count;
+    mPool = (const char*)(records + header.count);
+    return true;
+}
+
+const ReplayCatalogRecord* ReplayCatalog::Find(std::string_view path) const
+{
+    auto end = mRecords + mCount;
+    auto it = std::lower_bound(mRecords, end, path, [&](const ReplayCatalogRecord& r, std::string_view p) { return Str(r.path) < p; });
+    return it != end && Str(it->path) == path ? it : nullptr;
+}
+
+void ReplayCatalog::Query(const ReplayQuery& query, const std::function<bool(const ReplayCatalogRecord&)>& onMatch) const
+{
+    for (size_t i = 0; i < mCount; i++) {
+        auto& r = mRecords[i];
+        if (!r.game.size)
+            continue;
+        if (!query.game.empty() && Str(r.game) != query.game)
+            continue;
+        if (query.paramStage >= 0 && r.paramStage != query.paramStage)
+            continue;
+        if (query.section >= 0 && r.section != query.section)
+            continue;
+        if (r.score < query.minScore || r.score > query.maxScore)
+            continue;
+        if (query.withParamOnly && !r.param.size)
+            continue;
+        if (!onMatch(r))
+            return;
+    }
+}
+/// ------------------
+
+/// Indexer
+/// ------------------
+struct ReplayIndexEntry {
+    std::string path;
+    uint64_t fileSize;
+    uint64_t writeTime;
+    ReplayInfo info;
+};
+
+static void InfoFromRecord(const ReplayCatalog& catalog, const ReplayCatalogRecord& r, ReplayInfo& info)
+{
+    info.game = catalog.Str(r.game);
+    info.name = catalog.Str(r.name);
+    info.date = catalog.Str(r.date);
+    info.shot = catalog.Str(r.shot);
+    info.difficulty = catalog.Str(r.difficulty);
+    info.stage = catalog.Str(r.stage);
+    info.score = r.score;
+    info.param = catalog.Str(r.param);
+    info.mode = r.mode;
+    info.paramStage = r.paramStage;
+    info.section = r.section;
+    info.phase = r.phase;
+}
+
+// Identical strings are only stored once, most games, shots and difficulties
+// repeat across thousands of replays
+class ReplayCatalogWriter {
+    std::vector<uint8_t> mRecords;
+    std::vector<char> mPool;
+    std::unordered_map<std::string, ReplayCatalogStr> mStrings;
+    uint32_t mCount = 0;
+
+public:
+    bool Add(const ReplayIndexEntry& entry)
+    {
+        ReplayCatalogRecord r = {};
+        r.fileSize = entry.fileSize;
+        r.writeTime = entry.writeTime;
+        r.score = entry.info.score;
+        r.mode = entry.info.mode;
+        r.paramStage = entry.info.paramStage;
+        r.section = entry.info.section;
+        r.phase = entry.info.phase;
+        if (!Intern(entry.path, r.path) || !Intern(entry.info.game, r.game) || !Intern(entry.info.name, r.name)
+            || !Intern(entry.info.date, r.date) || !Intern(entry.info.shot, r.shot) || !Intern(entry.info.difficulty, r.difficulty)
+            || !Intern(entry.info.stage, r.stage) || !Intern(entry.info.param, r.param))
+            return false;
+        size_t offset = mRecords.size();
+        mRecords.resize(offset + sizeof(r));
+        memcpy(mRecords.data() + offset, &r, sizeof(r));
+        mCount++;
+        return true;
+    }
+
+    std::vector<uint8_t> Finish()
+    {
+        ReplayCatalogHeader header = {};
+        header.magic = REPLAY_CATALOG_MAGIC;
+        header.format = REPLAY_CATALOG_FORMAT;
+        header.recordSize = sizeof(ReplayCatalogRecord);
+        header.count = mCount;
+        header.poolSize = (uint32_t)mPool.size();
+
+        std::vector<uint8_t> out(sizeof(header) + mRecords.size() + mPool.size());
+        if (!mRecords.empty())
+            memcpy(out.data() + sizeof(header), mRecords.data(), mRecords.size());
+        if (!mPool.empty())
+            memcpy(out.data() + sizeof(header) + mRecords.size(), mPool.data(), mPool.size());
+        MetroHash128::Hash(out.data() + sizeof(header), out.size() - sizeof(header), (uint8_t*)header.checksum);
+        memcpy(out.data(), &header, sizeof(header));
+        return out;
+    }
+
+private:
+    bool Intern(const std::string& str, ReplayCatalogStr& out)
+    {
+        if (str.empty()) {
+            out = {};
+            return true;
+        }
+        auto it = mStrings.find(str);
+        if (it != mStrings.end()) {
+            out = it->second;
+            return true;
+        }
+        if (str.size() > REPLAY_CATALOG_MAX_POOL - mPool.size())
+            return false;
+        out = { (uint32_t)mPool.size(), (uint32_t)str.size() };
+        mPool.insert(mPool.end(), str.begin(), str.end());
+        mStrings.emplace(str, out);
+        return true;
+    }
+};
+
+static bool ReplayIsRpyName(const std::wstring& name)
+{
+    if (name.size() < 4)
+        return false;
+    auto ext = name.data() + name.size() - 4;
+    return ext[0] == L'.' && (ext[1] | 0x20) == L'r' && (ext[2] | 0x20) == L'p' && (ext[3] | 0x20) == L'y';
+}
+
+std::vector<uint8_t> ReplayIndexBuild(ReplayFileSystem& fs, ScanProgress& progress, const std::atomic<bool>& cancel,
+    const std::vector<std::wstring>& roots, const ReplayCatalog& old)
+{
+    std::mutex entriesLock;
+    std::vector<ReplayIndexEntry> entries;
+
+    auto onFile = [&](const std::wstring& path) {
+        ReplayIndexEntry entry;
+        if (!fs.Stat(path, entry.fileSize, entry.writeTime))
+            return;
+        entry.path = ReplayPathToUtf8(path);
+
+        auto cached = old.Find(entry.path);
+        if (cached && cached->fileSize == entry.fileSize && cached->writeTime == entry.writeTime) {
+            InfoFromRecord(old, *cached, entry.info);
+        } else {
+            size_t sep = path.find_last_of(L"\\/");
+            std::wstring_view fileName = sep == std::wstring::npos ? path : std::wstring_view(path).substr(sep + 1);
+            // Files that turn out not to be replays are kept too, without a
+            // game, so they aren't read again next time
+            bool isReplay = false;
+            if (!fs.Read(path, [&](const uint8_t* data, size_t size) { isReplay = ReplayReadInfo(data, size, fileName, entry.info); }))
+                return;
+            if (!isReplay)
+                entry.info = ReplayInfo();
+        }
+        std::lock_guard<std::mutex> lock(entriesLock);
+        entries.push_back(std::move(entry));
+    };
+
+    for (auto& root : roots) {
+        ScanWalker walker(fs, progress, cancel, ReplayIsRpyName, onFile);
+        walker.Run(root);
+        if (cancel)
+            return {};
+    }
+
+    // Overlapping roots find the same replay more than once
+    std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.path < b.path; });
+    entries.erase(std::unique(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.path == b.path; }), entries.end());
+
+    ReplayCatalogWriter writer;
+    for (auto& entry : entries) {
+        if (!writer.Add(entry))
+            break;
+    }
+    return writer.Finish();
+}
+/// ------------------
+
+}
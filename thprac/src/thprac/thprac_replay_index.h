@@ -0,0 +1,123 @@
+#pragma once
+#include "thprac_launcher_scan.h"
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace THPrac {
+
+// Replay library. Every .rpy under a set of folders is indexed into a
+// catalog, with what the replay header says about the run and the param
+// thprac saved into it, if any. The catalog is a single flat buffer that's
+// queried in place, so it can be mapped straight from disk, and rebuilding it
+// only rereads the replays that changed. Nothing here touches Windows, every
+// file goes through ReplayFileSystem. ReplayLibrary in
+// thprac_replay_library.h is what keeps the catalog on disk.
+
+class ReplayFileSystem : public ScanFileSystem {
+public:
+    // writeTime can be in any unit, it's only ever compared for equality
+    virtual bool Stat(const std::wstring& path, uint64_t& size, uint64_t& writeTime) = 0;
+    // data only has to stay valid during the call
+    virtual bool Read(const std::wstring& path, const std::function<void(const uint8_t* data, size_t size)>& onData) = 0;
+};
+
+// Strings are copied from the replay as they are. TH10 onwards only use ASCII
+// in these, older games may have Shift-JIS.
+struct ReplayInfo {
+    std::string game; // "th06", "th128" and so on
+    std::string name;
+    std::string date;
+    std::string shot;
+    std::string difficulty;
+    std::string stage;
+    uint64_t score = 0;
+
+    // From the param, -1 where the replay has none
+    std::string param;
+    int32_t mode = -1;
+    int32_t paramStage = -1;
+    int32_t section = -1;
+    int32_t phase = -1;
+};
+
+// Reads the info of a replay in memory. fileName is used when the game can't
+// be told from the contents alone, TH13 and TH14 share a magic for example.
+// Returns false if the game couldn't be identified at all.
+bool ReplayReadInfo(const uint8_t* rep, size_t size, std::wstring_view fileName, ReplayInfo& info);
+
+struct ReplayCatalogStr {
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Stored as is in the catalog, after the header. Strings point into the pool
+// that follows the records, paths are UTF-8. Files that aren't replays have a
+// record with an empty game, and never match a query.
+struct ReplayCatalogRecord {
+    uint64_t fileSize;
+    uint64_t writeTime;
+    uint64_t score;
+    int32_t mode;
+    int32_t paramStage;
+    int32_t section;
+    int32_t phase;
+    ReplayCatalogStr path;
+    ReplayCatalogStr game;
+    ReplayCatalogStr name;
+    ReplayCatalogStr date;
+    ReplayCatalogStr shot;
+    ReplayCatalogStr difficulty;
+    ReplayCatalogStr stage;
+    ReplayCatalogStr param;
+};
+
+// Fields left at their defaults match anything
+struct ReplayQuery {
+    std::string_view game;
+    int32_t paramStage = -1;
+    int32_t section = -1;
+    uint64_t minScore = 0;
+    uint64_t maxScore = UINT64_MAX;
+    bool withParamOnly = false;
+};
+
+class ReplayCatalog {
+public:
+    // Doesn't copy anything, data has to outlive the catalog. The whole buffer
+    // is checked here, so nothing read from it afterwards can be out of bounds.
+    // Returns false and leaves the catalog empty if data isn't a valid catalog.
+    bool Attach(const uint8_t* data, size_t size);
+
+    size_t size() const { return mCount; }
+    const ReplayCatalogRecord& operator[](size_t i) const { return mRecords[i]; }
+    std::string_view Str(const ReplayCatalogStr& str) const
+    {
+        return std::string_view(mPool + str.offset, str.size);
+    }
+
+    // Records are sorted by path
+    const ReplayCatalogRecord* Find(std::string_view path) const;
+    // Calls onMatch for every matching record, until it returns false
+    void Query(const ReplayQuery& query, const std::function<bool(const ReplayCatalogRecord&)>& onMatch) const;
+
+private:
+    const ReplayCatalogRecord* mRecords = nullptr;
+    size_t mCount = 0;
+    const char* mPool = nullptr;
+};
+
+// Walks every root and returns a new catalog. Replays whose size and write
+// time match their record in old are copied over without being read. Returns
+// an empty vector if cancel was set before the walk finished.
+std::vector<uint8_t> ReplayIndexBuild(ReplayFileSystem& fs, ScanProgress& progress, const std::atomic<bool>& cancel,
+    const std::vector<std::wstring>& roots, const ReplayCatalog& old);
+
+// Catalog paths are UTF-8 whatever the size of wchar_t, so the same catalog
+// works on every platform. Unpaired surrogates are kept as WTF-8.
+std::string ReplayPathToUtf8(std::wstring_view path);
+
+}
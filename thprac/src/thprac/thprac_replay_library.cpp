@@ -0,0 +1,96 @@
+#include "thprac_replay_library.h"
+#include "thprac_launcher_cfg.h"
+#include "thprac_launcher_scan_win32.h"
+#include "thprac_utils.h"
+#include <Windows.h>
+
+namespace THPrac {
+
+class ReplayWin32FileSystem : public ReplayFileSystem {
+public:
+    bool List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry) override
+    {
+        return ScanWin32List(dir, onEntry);
+    }
+
+    bool Stat(const std::wstring& path, uint64_t& size, uint64_t& writeTime) override
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attr))
+            return false;
+        size = ((uint64_t)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+        writeTime = ((uint64_t)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    bool Read(const std::wstring& path, const std::function<void(const uint8_t* data, size_t size)>& onData) override
+    {
+        MappedFile file(path.c_str());
+        if (!file.fileMapView) {
+            // An empty file can't be mapped, but it's still a file to record
+            if (file.fileSize || GetFileAttributesW(path.c_str()) == INVALID_FILE_ATTRIBUTES)
+                return false;
+            onData(nullptr, 0);
+            return true;
+        }
+        onData((const uint8_t*)file.fileMapView, file.fileSize);
+        return true;
+    }
+};
+
+static std::wstring ReplayCatalogPath()
+{
+    auto dir = LauncherGetDataDir();
+    return dir.empty() ? dir : dir + L"replay_catalog.bin";
+}
+
+ReplayLibrary::ReplayLibrary() = default;
+ReplayLibrary::~ReplayLibrary() = default;
+
+bool ReplayLibrary::Load()
+{
+    mCatalog = ReplayCatalog();
+    mFile.reset();
+    auto path = ReplayCatalogPath();
+    if (path.empty())
+        return false;
+    auto file = std::make_unique<MappedFile>(path.c_str());
+    if (!file->fileMapView || !mCatalog.Attach((const uint8_t*)file->fileMapView, file->fileSize))
+        return false;
+    mFile = std::move(file);
+    return true;
+}
+
+// Written to a temporary file first, so a crash halfway never leaves a
+// truncated catalog behind. The old one has to be unmapped before it can be
+// replaced, so it's only mapped again afterwards.
+bool ReplayLibrary::Update(const std::vector<std::wstring>& roots, ScanProgress& progress, const std::atomic<bool>& cancel)
+{
+    auto path = ReplayCatalogPath();
+    if (path.empty())
+        return false;
+
+    ReplayWin32FileSystem fs;
+    auto data = ReplayIndexBuild(fs, progress, cancel, roots, mCatalog);
+    if (data.empty())
+        return false;
+
+    mCatalog = ReplayCatalog();
+    mFile.reset();
+
+    CreateDirectoryW(LauncherGetDataDir().c_str(), nullptr);
+    auto tmpPath = path + L".tmp";
+    HANDLE hFile = CreateFileW(tmpPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    bool written = false;
+    if (hFile != INVALID_HANDLE_VALUE) {
+        DWORD bytesProcessed;
+        written = WriteFile(hFile, data.data(), (DWORD)data.size(), &bytesProcessed, nullptr) && bytesProcessed == data.size();
+        CloseHandle(hFile);
+        written = written && MoveFileExW(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+        if (!written)
+            DeleteFileW(tmpPath.c_str());
+    }
+    return Load() && written;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "thprac_replay_index.h"
+#include <memory>
+
+namespace THPrac {
+
+struct MappedFile;
+
+// The replay catalog of ReplayIndexBuild, kept in replay_catalog.bin next to
+// thprac.json and mapped straight from there. Each Update walks the folders
+// again, only rereads the replays whose size or write time changed, and
+// replaces the file. Not thread safe, a single thread should own it.
+class ReplayLibrary {
+public:
+    ReplayLibrary();
+    ~ReplayLibrary();
+
+    // Maps the catalog from disk. Returns false and leaves the library empty
+    // if there's none, or if it doesn't pass ReplayCatalog::Attach.
+    bool Load();
+
+    // Rebuilds the catalog from roots on top of the loaded one, writes it and
+    // maps the result. Returns false if cancel was set or the file couldn't be
+    // written, leaving the loaded catalog as it was in the first case.
+    bool Update(const std::vector<std::wstring>& roots, ScanProgress& progress, const std::atomic<bool>& cancel);
+
+    // Only valid until the next Load or Update
+    const ReplayCatalog& Catalog() const { return mCatalog; }
+
+private:
+    std::unique_ptr<MappedFile> mFile;
+    ReplayCatalog mCatalog;
+};
+
+}
@@ -441,7 +441,7 @@ namespace TH06 {
             case 3: // Mid boss & End boss
                 if (mSection(TH_WARP_SELECT_FRAME[*mWarp],
                     th_sections_cba[*mStage + st][*mWarp - 2],
-                    th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                    XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cba[*mStage][*mWarp - 2][*mSection]))
                     mDlg();
@@ -450,7 +450,7 @@ namespace TH06 {
             case 5: // Non-spell & Spellcard
                 if (mSection(TH_WARP_SELECT_FRAME[*mWarp],
                     th_sections_cbt[*mStage + st][*mWarp - 4],
-                    th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                    XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cbt[*mStage][*mWarp - 4][*mSection]))
                     mDlg();
@@ -377,7 +377,7 @@ namespace TH08 {
             case 3: // Mid boss & End boss
                 if (mSection(TH_WARP_SELECT_FRAME[*mWarp],
                         th_sections_cba[*mStage][*mWarp - 2],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cba[*mStage][*mWarp - 2][*mSection]))
                     mDlg();
@@ -386,7 +386,7 @@ namespace TH08 {
             case 5: // Non-spell & Spellcard
                 if (mSection(TH_WARP_SELECT_FRAME[*mWarp],
                         th_sections_cbt[*mStage][*mWarp - 4],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cbt[*mStage][*mWarp - 4][*mSection]))
                     mDlg();
@@ -263,14 +263,29 @@ namespace TH15 {
                 return false;
             }
         }
+        // The section names are const, so the easter egg renames ST5_MID1 on
+        // the way to the combo instead
+        struct MorbiusSections {
+            Gui::LocaleTable names;
+            bool morbin;
+
+            const char* operator[](size_t section) const
+            {
+                return morbin && section == TH15_ST5_MID1 ? "it's morbin time" : names[section];
+            }
+            explicit operator bool() const
+            {
+                return (bool)names;
+            }
+        };
+
         void SectionWidget()
         {
             static int Morbius = 0;
             const char _MorbStr[] = "MORBIUS";
             if (Morbius < 7 && Gui::KeyboardInputUpdate(_MorbStr[Morbius]))
                 Morbius++;
-            else
-                th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty][TH15_ST5_MID1] = "it's morbin time";
+            MorbiusSections sections { XSSS(mDiffculty), Morbius == 7 };
 
             static char chapterStr[256] {};
             auto& chapterCounts = mChapterSetup[*mStage];
@@ -293,7 +308,7 @@ namespace TH15 {
             case 3: // Mid boss & End boss
                 if (mSection(TH_WARP_SELECT[*mWarp],
                         th_sections_cba[*mStage][*mWarp - 2],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        sections))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cba[*mStage][*mWarp - 2][*mSection]))
                     mDlg();
@@ -302,7 +317,7 @@ namespace TH15 {
             case 5: // Non-spell & Spellcard
                 if (mSection(TH_WARP_SELECT[*mWarp],
                         th_sections_cbt[*mStage][*mWarp - 4],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        sections))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cbt[*mStage][*mWarp - 4][*mSection]))
                     mDlg();
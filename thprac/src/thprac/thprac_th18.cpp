@@ -1,5 +1,6 @@
 ﻿#include "thprac_games.h"
 #include "thprac_utils.h"
+#include "thprac_replay.h"
 #include <metrohash128.h>
 
 namespace THPrac {
@@ -501,7 +502,7 @@ namespace TH18 {
             case 3: // Mid boss & End boss
                 if (mSection(TH_WARP_SELECT[*mWarp],
                         th_sections_cba[*mStage][*mWarp - 2],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cba[*mStage][*mWarp - 2][*mSection]))
                     mDlg();
@@ -510,7 +511,7 @@ namespace TH18 {
             case 5: // Non-spell & Spellcard
                 if (mSection(TH_WARP_SELECT[*mWarp],
                         th_sections_cbt[*mStage][*mWarp - 4],
-                        th_sections_str[::THPrac::Gui::LocaleGet()][mDiffculty]))
+                        XSSS(mDiffculty)))
                     *mPhase = 0;
                 if (SectionHasDlg(th_sections_cbt[*mStage][*mWarp - 4][*mSection]))
                     mDlg();
@@ -1259,11 +1260,11 @@ namespace TH18 {
             }
         }
 
-#define ThEncrypt(data, size1, param1, param2, param3, size2) asm_call<0x401f50, Fastcall>(data, size1, param1, param2, param3, size2)
-#define ThDecrypt(data, size1, param1, param2, param3, size2) asm_call<0x401e40, Fastcall>(data, size1, param1, param2, param3, size2)
-#define ThUnlzss(dataBuffer, dataSize, outBuffer, outSize)    asm_call<0x46f840, Fastcall>(dataBuffer, dataSize, outBuffer, outSize)
-#define ThLzss(dataBuffer, dataSize, outSize)                 asm_call<0x46f5b0, Fastcall, void*>(dataBuffer, dataSize, outSize)
-#define _builtin_free(buffer)                                 asm_call<0x491a3f, Cdecl>(buffer)
+        // In the order they're undone when loading, encrypting goes the other way
+        static constexpr ReplayCipherLayer repCipher[] = {
+            { 0x5c, 0xe1, 0x400 },
+            { 0x7d, 0x3a, 0x100 },
+        };
 
         __declspec(noinline) void UnloadReplay()
         {
@@ -1340,12 +1341,13 @@ namespace TH18 {
             memcpy(repDataOutput, mRepDataDecoded, repHeader[8]);
             OverwriteReplayData(repDataOutput);
 
-            uint32_t repDataEncodedSize;
-            auto repDataEncoded = ThLzss(repDataOutput, repHeader[8], &repDataEncodedSize);
+            auto repDataEncoded = ReplayLzss((uint8_t*)repDataOutput, repHeader[8]);
+            uint32_t repDataEncodedSize = repDataEncoded.size();
             repHeader[7] = repDataEncodedSize;
             repHeader[3] = repDataEncodedSize + 0x24;
-            ThEncrypt(repDataEncoded, mRepHeader[7], 0x7d, 0x3a, 0x100, repHeader[7]);
-            ThEncrypt(repDataEncoded, mRepHeader[7], 0x5c, 0xe1, 0x400, repHeader[7]);
+            for (size_t i = elementsof(repCipher); i-- > 0;) {
+                ReplayEncrypt(repDataEncoded.data(), repDataEncodedSize, repCipher[i].key, repCipher[i].step, repCipher[i].block, repDataEncodedSize);
+            }
             free(repDataOutput);
 
             DWORD bytesProcessed;
@@ -1370,20 +1372,17 @@ namespace TH18 {
                 auto outputFile = CreateFileW(szFile, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
                 if (outputFile == INVALID_HANDLE_VALUE) {
                     MsgBox(MB_ICONERROR | MB_OK, S(TH14_ERROR), S(TH14_ERROR_DEST));
-                    goto end;
+                    return;
                 }
                 SetFilePointer(outputFile, 0, nullptr, FILE_BEGIN);
                 SetEndOfFile(outputFile);
                 WriteFile(outputFile, repHeader, sizeof(repHeader), &bytesProcessed, nullptr);
-                WriteFile(outputFile, repDataEncoded, repDataEncodedSize, &bytesProcessed, nullptr);
+                WriteFile(outputFile, repDataEncoded.data(), repDataEncodedSize, &bytesProcessed, nullptr);
                 WriteFile(outputFile, mRepExtraData, mRepExtraDataSize, &bytesProcessed, nullptr);
                 CloseHandle(outputFile);
 
                 MsgBox(MB_ICONINFORMATION | MB_OK, utf8_to_utf16(S(TH14_SUCCESS)).c_str(), utf8_to_utf16(S(TH14_SUCCESS_SAVED)).c_str(), szFile);
             }
-
-            end:
-            _builtin_free(repDataEncoded);
         }
         __declspec(noinline) void LoadReplay()
         {
@@ -1395,19 +1394,33 @@ namespace TH18 {
             mRepOriginalName = THGuiRep::singleton().mRepName;
             mRepOriginalPath = THGuiRep::singleton().mRepDir;
 
-            // Decode and copy data
-            void* mRepDataRaw = nullptr;
+            if (!file.fileMapView || file.fileSize < 0x24) {
+                return;
+            }
             memcpy(mRepHeader, file.fileMapView, 0x24);
-            mRepDataRaw = malloc(mRepHeader[7]);
+            // mRepHeader[3] is where the extra data starts, mRepHeader[7] the
+            // size of the encoded data before it
+            if (mRepHeader[3] < 0x24 || mRepHeader[3] > file.fileSize || mRepHeader[7] > mRepHeader[3] - 0x24) {
+                return;
+            }
+
+            // Decode straight out of the mapping and copy the rest
             mRepDataDecoded = malloc(mRepHeader[8]);
+            if (!mRepDataDecoded) {
+                return;
+            }
+            if (!ReplayDecodeStream((uint8_t*)file.fileMapView + 0x24, mRepHeader[7], repCipher, elementsof(repCipher), (uint8_t*)mRepDataDecoded, mRepHeader[8])) {
+                free(mRepDataDecoded);
+                mRepDataDecoded = nullptr;
+                return;
+            }
             mRepExtraDataSize = file.fileSize - mRepHeader[3];
             mRepExtraData = malloc(mRepExtraDataSize);
-            memcpy(mRepDataRaw, (void*)((uint32_t)file.fileMapView + 0x24), mRepHeader[7]);
+            if (!mRepExtraData && mRepExtraDataSize) {
+                UnloadReplay();
+                return;
+            }
             memcpy(mRepExtraData, (void*)((uint32_t)file.fileMapView + mRepHeader[3]), mRepExtraDataSize);
-            ThDecrypt(mRepDataRaw, mRepHeader[7], 0x5c, 0xe1, 0x400, mRepHeader[7]);
-            ThDecrypt(mRepDataRaw, mRepHeader[7], 0x7d, 0x3a, 0x100, mRepHeader[7]);
-            ThUnlzss(mRepDataRaw, mRepHeader[7], mRepDataDecoded, mRepHeader[8]);
-            free(mRepDataRaw);
 
             // Calc Hash
             mRepMetroHash[0] = 0;
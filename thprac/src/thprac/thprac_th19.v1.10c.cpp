@@ -1,6 +1,7 @@
 #include "thprac_utils.h"
 #include "thprac_th19.h"
 
+#include "thprac_hook_x86.h"
 #include "utils/wininternal.h"
 
 // Part of a fix to improve some performance issues
@@ -10,37 +11,27 @@
 // compilation of TH19, MSVC decided to make up calling conventions, that you
 // cannot explicitly tell MSVC to replicate.
 //
-// One of the functions I'm replacing has a calling convention where 4 float
-// parameters are taken in the first 4 XMM registers, and 4 more floats are on
-// the stack. This is easy enough to replicate with vectorcall. In vectorcall,
-// the first 6 float parameters are in the first 6 XMM registers, with the
-// remaining ones on the stack. To replicate that I can just declare my first 4
-// parameters, declare two dummy parameters, then declare the final 4.
-//
-// Problem: that function does caller stack cleanup (meaning that whoever calls
-// that function must clean the stack parameters off the stack themselves).
-// Vectorcall does callee cleanup, meaning that the function being called is
-// itself responsible for cleaning up the parameters that were passed on the
-// stack. Trying to do both callee and caller stack cleanup will crash
+// One of the functions I'm replacing takes 4 float parameters in the first 4
+// XMM registers, 5 more floats on the stack, and does caller stack cleanup
+// (meaning that whoever calls that function must clean the stack parameters
+// off the stack themselves). Vectorcall gets the registers right, but does
+// callee cleanup, and trying to do both callee and caller stack cleanup will
+// crash.
 //
 // It is impossible to explicitly tell MSVC to generate a function with a
-// calling convention like that. Before I found my workaround, the way that
-// builds with these performance improvements were made was by binhacking
-// thprac.exe manually after compilation.
-//
-// The workaround is: th19_fast_msvc.obj is precompiled, and binary hacked to
-// replace all ret 14 instructions with just ret. This is the only way to get
-// a function out of MSVC that takes parameters in XMM registers and does
-// caller stack cleanup.
+// calling convention like that. This used to be worked around by shipping a
+// precompiled .obj that was binary hacked to replace ret 14 with ret.
 //
-// This means that binary hacking a compiled file is still required to perform
-// a full rebuild of that code, however, developers will not need to binhack
-// thprac.exe every time they compile
+// Now th19_fast.cpp is compiled normally: the kernel is a plain cdecl
+// function, and THGuiCreate puts a thunk from X86EmitCdeclThunk in front of
+// it, which copies the register and stack parameters into a cdecl frame, calls
+// it and returns with a plain ret. thprac/tests/hook_x86_test.cpp checks that
+// thunk against the calling convention above.
 
 #ifndef _DEBUG
 extern "C" {
 uint32_t* __vectorcall CPUHitInf_CheckColliders(void*, int, uint32_t*, float, float, float);
-bool __vectorcall _RxD1E00_fast(uint32_t, uint32_t, float, float, float, float, float, float, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+bool __cdecl _RxD1E00_fast_kernel(int, float, float, float, float, float, float, float, float, float);
 }
 #endif
 
@@ -176,7 +167,9 @@ namespace V1_10c {
             if (BeginOptGroup<TH_PERFORMANCE>()) {
                 if (ImGui::Checkbox("Replace certain functions with faster variants", &this->perf_fix)) {
                     th19_patch_cpu_check_colliders.Toggle(this->perf_fix);
-                    th19_patch_RxD1E00.Toggle(this->perf_fix);
+                    // Not set up if there was no room for its thunk
+                    if (th19_patch_RxD1E00.setup)
+                        th19_patch_RxD1E00.Toggle(this->perf_fix);
                 }
                 EndOptGroup();
             }
@@ -830,10 +823,17 @@ namespace V1_10c {
 
         #ifndef _DEBUG
         *(uintptr_t*)((uintptr_t)th19_patch_cpu_check_colliders.data.buffer.ptr + 1) = (uintptr_t)&CPUHitInf_CheckColliders - RVA((uintptr_t)th19_patch_cpu_check_colliders.addr + 5);
-        *(uintptr_t*)((uintptr_t)th19_patch_RxD1E00.data.buffer.ptr + 1) = (uintptr_t)&_RxD1E00_fast - RVA((uintptr_t)th19_patch_RxD1E00.addr + 5);
-
         th19_patch_cpu_check_colliders.Setup();
-        th19_patch_RxD1E00.Setup();
+
+        // a1 in ECX, a2-a5 in XMM0-XMM3, a6-a10 on the stack
+        constexpr X86RegArgs RxD1E00_args = { .reg_count = 1, .regs = { X86_ECX }, .xmm_count = 4, .stack_count = 5 };
+        HookArenaBeginWrite();
+        uint8_t* RxD1E00_thunk = HookArenaAlloc(X86_THUNK_MAX_LEN);
+        if (RxD1E00_thunk && X86EmitCdeclThunk(RxD1E00_thunk, X86_THUNK_MAX_LEN, RxD1E00_args, (uintptr_t)&_RxD1E00_fast_kernel)) {
+            *(uintptr_t*)((uintptr_t)th19_patch_RxD1E00.data.buffer.ptr + 1) = (uintptr_t)RxD1E00_thunk - RVA((uintptr_t)th19_patch_RxD1E00.addr + 5);
+            th19_patch_RxD1E00.Setup();
+        }
+        HookArenaEndWrite();
         #endif
 
         th19_vs_mode_disable_movement.Setup();
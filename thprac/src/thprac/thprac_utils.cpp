@@ -2,6 +2,7 @@
 #include "thprac_licence.h"
 #include "thprac_launcher_main.h"
 #include "thprac_launcher_cfg.h"
+#include "utils/pe_view.h"
 #include <metrohash128.h>
 #include "../3rdParties/d3d8/include/d3d8.h"
 
@@ -227,38 +228,13 @@ DWORD WINAPI CheckDLLFunction(const wchar_t* path, const char* funcName)
 {
     MappedFile file(path);
 
-    auto exeSize = file.fileSize;
-    auto exeBuffer = file.fileMapView;
-    if (exeSize < 128)
+    if (file.fileSize < 128)
         return 0;
-    PIMAGE_DOS_HEADER pDosHeader = (PIMAGE_DOS_HEADER)exeBuffer;
-    if (!pDosHeader || pDosHeader->e_magic != 0x5a4d || (size_t)pDosHeader->e_lfanew + 512 >= exeSize)
+    PeView pe(file.fileMapView, file.fileSize);
+    if (!pe.valid() || (size_t)pe.dos()->e_lfanew + 512 >= file.fileSize)
         return 0;
-    PIMAGE_NT_HEADERS pNtHeader = (PIMAGE_NT_HEADERS)((DWORD)exeBuffer + pDosHeader->e_lfanew);
-    if (!pNtHeader || pNtHeader->Signature != 0x00004550)
-        return 0;
-    PIMAGE_SECTION_HEADER pSection = IMAGE_FIRST_SECTION(pNtHeader);
-    if (!pSection)
-        return 0;
-
-    if (pNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress != 0 && pNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size != 0) {
-        auto pExportSectionVA = pNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress;
-        for (DWORD i = 0; i < pNtHeader->FileHeader.NumberOfSections; i++, pSection++) {
-            if (pSection->VirtualAddress <= pExportSectionVA && pSection->VirtualAddress + pSection->SizeOfRawData > pExportSectionVA) {
-                auto pSectionBase = (DWORD)exeBuffer - pSection->VirtualAddress + pSection->PointerToRawData;
-                PIMAGE_EXPORT_DIRECTORY pExportDirectory = (PIMAGE_EXPORT_DIRECTORY)(pSectionBase + pExportSectionVA);
-                char** pExportNames = (char**)(pSectionBase + pExportDirectory->AddressOfNames);
-                for (DWORD j = 0; j < pExportDirectory->NumberOfNames; ++j) {
-                    auto pFunctionName = (char*)(pSectionBase + pExportNames[j]);
-                    if (!strcmp(pFunctionName, funcName)) {
-                        return true;
-                    }
-                }
-            }
-        }
-    }
 
-    return true;
+    return pe.HasExport(funcName);
 }
 
 }
@@ -48,12 +48,15 @@ struct MappedFile {
         fileMap = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, fileSize, nullptr);
         if (fileMap == nullptr) {
             CloseHandle(hFile);
+            hFile = INVALID_HANDLE_VALUE;
             return;
         }
         fileMapView = MapViewOfFile(fileMap, FILE_MAP_READ, 0, 0, fileSize);
         if (!fileMapView) {
             CloseHandle(hFile);
             CloseHandle(fileMap);
+            hFile = INVALID_HANDLE_VALUE;
+            fileMap = nullptr;
             return;
         }
     }
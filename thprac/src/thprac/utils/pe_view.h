@@ -0,0 +1,159 @@
+#pragma once
+#include <Windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <span>
+#include <string_view>
+
+namespace THPrac {
+
+// Read only view of a PE file that's already in memory, usually a MappedFile.
+// Every accessor checks offsets against the size of the view, and returns
+// nullptr or an empty span instead of reading past it, so malformed files are
+// safe to look at. A structure that isn't aligned for its type counts as
+// missing too, no linker writes one like that. Nothing is copied.
+class PeView {
+    const uint8_t* mBase = nullptr;
+    size_t mSize = 0;
+    const IMAGE_NT_HEADERS* mNt = nullptr;
+    const IMAGE_SECTION_HEADER* mSections = nullptr;
+    size_t mSectionCount = 0;
+
+public:
+    PeView(const void* data, size_t size)
+        : mBase((const uint8_t*)data)
+        , mSize(data ? size : 0)
+    {
+        auto dos = At<IMAGE_DOS_HEADER>(0);
+        if (!dos || dos->e_magic != IMAGE_DOS_SIGNATURE || dos->e_lfanew < 0)
+            return;
+        auto nt = At<IMAGE_NT_HEADERS>(dos->e_lfanew);
+        if (!nt || nt->Signature != IMAGE_NT_SIGNATURE)
+            return;
+        mNt = nt;
+
+        // Section headers that are cut off by the end of the file are left out
+        size_t sectionOffset = dos->e_lfanew + offsetof(IMAGE_NT_HEADERS, OptionalHeader) + nt->FileHeader.SizeOfOptionalHeader;
+        size_t count = nt->FileHeader.NumberOfSections;
+        if (sectionOffset < mSize)
+            count = (std::min)(count, (mSize - sectionOffset) / sizeof(IMAGE_SECTION_HEADER));
+        else
+            count = 0;
+        mSections = count ? At<IMAGE_SECTION_HEADER>(sectionOffset, count) : nullptr;
+        mSectionCount = mSections ? count : 0;
+    }
+
+    bool valid() const { return mNt != nullptr; }
+    size_t size() const { return mSize; }
+    const uint8_t* data() const { return mBase; }
+
+    template <typename T>
+    const T* At(size_t offset, size_t count = 1) const
+    {
+        if (offset > mSize || count > (mSize - offset) / sizeof(T) || (uintptr_t)(mBase + offset) % alignof(T))
+            return nullptr;
+        return (const T*)(mBase + offset);
+    }
+
+    std::span<const uint8_t> Bytes(size_t offset, size_t len) const
+    {
+        auto p = At<uint8_t>(offset, len);
+        return p ? std::span<const uint8_t>(p, len) : std::span<const uint8_t>();
+    }
+
+    // NUL terminated string at offset, or an empty one if it runs off the end
+    std::string_view String(size_t offset) const
+    {
+        if (offset >= mSize)
+            return {};
+        auto end = (const uint8_t*)memchr(mBase + offset, 0, mSize - offset);
+        return end ? std::string_view((const char*)mBase + offset, end - (mBase + offset)) : std::string_view();
+    }
+
+    const IMAGE_DOS_HEADER* dos() const { return mNt ? (const IMAGE_DOS_HEADER*)mBase : nullptr; }
+    const IMAGE_NT_HEADERS* nt() const { return mNt; }
+    std::span<const IMAGE_SECTION_HEADER> sections() const { return { mSections, mSectionCount }; }
+
+    static bool SectionNameIs(const IMAGE_SECTION_HEADER& section, const char* name)
+    {
+        return !strncmp((const char*)section.Name, name, IMAGE_SIZEOF_SHORT_NAME)
+            && (strlen(name) >= IMAGE_SIZEOF_SHORT_NAME || !section.Name[strlen(name)]);
+    }
+
+    const IMAGE_SECTION_HEADER* FindSection(const char* name) const
+    {
+        for (auto& section : sections()) {
+            if (SectionNameIs(section, name))
+                return &section;
+        }
+        return nullptr;
+    }
+
+    const IMAGE_DATA_DIRECTORY* Directory(size_t index) const
+    {
+        if (!mNt || index >= mNt->OptionalHeader.NumberOfRvaAndSizes || index >= IMAGE_NUMBEROF_DIRECTORY_ENTRIES)
+            return nullptr;
+        auto dir = &mNt->OptionalHeader.DataDirectory[index];
+        return dir->VirtualAddress && dir->Size ? dir : nullptr;
+    }
+
+    // File offset of an RVA, or SIZE_MAX if it isn't backed by the file
+    size_t RvaToOffset(DWORD rva) const
+    {
+        for (auto& section : sections()) {
+            if (rva >= section.VirtualAddress && rva - section.VirtualAddress < section.SizeOfRawData)
+                return (size_t)section.PointerToRawData + (rva - section.VirtualAddress);
+        }
+        return SIZE_MAX;
+    }
+
+    std::span<const uint8_t> EntryPointBytes(size_t len) const
+    {
+        if (!mNt)
+            return {};
+        size_t offset = RvaToOffset(mNt->OptionalHeader.AddressOfEntryPoint);
+        return offset == SIZE_MAX ? std::span<const uint8_t>() : Bytes(offset, len);
+    }
+
+    // Calls func(std::string_view name) for every named export, until it returns true
+    template <typename F>
+    bool ForEachExport(F&& func) const
+    {
+        auto dir = Directory(IMAGE_DIRECTORY_ENTRY_EXPORT);
+        if (!dir)
+            return false;
+        size_t exportOffset = RvaToOffset(dir->VirtualAddress);
+        auto exports = exportOffset != SIZE_MAX ? At<IMAGE_EXPORT_DIRECTORY>(exportOffset) : nullptr;
+        if (!exports)
+            return false;
+        size_t namesOffset = RvaToOffset(exports->AddressOfNames);
+        auto names = namesOffset != SIZE_MAX ? At<DWORD>(namesOffset, exports->NumberOfNames) : nullptr;
+        if (!names)
+            return false;
+        for (DWORD i = 0; i < exports->NumberOfNames; i++) {
+            size_t nameOffset = RvaToOffset(names[i]);
+            if (nameOffset != SIZE_MAX && func(String(nameOffset)))
+                return true;
+        }
+        return false;
+    }
+
+    bool HasExport(std::string_view name) const
+    {
+        return ForEachExport([&](std::string_view exportName) { return exportName == name; });
+    }
+
+    // Whatever comes after the raw data of the last section
+    std::span<const uint8_t> Overlay() const
+    {
+        size_t end = 0;
+        for (auto& section : sections()) {
+            if (section.SizeOfRawData)
+                end = (std::max)(end, (size_t)section.PointerToRawData + section.SizeOfRawData);
+        }
+        return end && end < mSize ? std::span<const uint8_t>(mBase + end, mSize - end) : std::span<const uint8_t>();
+    }
+};
+
+}
@@ -0,0 +1,250 @@
+// Checks CfgWriter from thprac_launcher_cfg_writer.cpp with a POSIX twin of
+// LauncherCfgWriteFile. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined cfg_writer_test.cpp ../src/thprac/thprac_launcher_cfg_writer.cpp -o cfg_writer_test
+//   ./cfg_writer_test [--bench] [dir]
+//
+// The debounce tests run with the windows scaled down 10x, --bench runs the
+// slider drag with the launcher's real 300ms and 2s. The kill test runs a
+// writer in a child process, SIGKILLs it at a random point and checks that
+// thprac.json is still one of the configs it was given. It does that for the
+// temp file plus rename LauncherCfgWriteFile does, which must never break the
+// file, and for an in place rewrite, which is only there for comparison.
+
+#include "../src/thprac/thprac_launcher_cfg_writer.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace THPrac;
+using namespace std::chrono_literals;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+// Same steps as LauncherCfgWriteFile: write a temp file, flush it, rename it
+// over the config
+static bool WriteAtomic(const std::string& path, const std::string& data)
+{
+    auto tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool written = write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(tmpPath.c_str(), path.c_str())) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// What the launcher did before, truncate and write in place. Written in
+// pieces like a buffered stream would.
+static bool WriteInPlace(const std::string& path, const std::string& data)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool written = true;
+    for (size_t i = 0; written && i < data.size(); i += 4096) {
+        size_t len = std::min<size_t>(4096, data.size() - i);
+        written = write(fd, data.data() + i, len) == (ssize_t)len;
+    }
+    close(fd);
+    return written;
+}
+
+static std::string ReadAll(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buf;
+    buf << file.rdbuf();
+    return buf.str();
+}
+
+// A config the size of a launcher with a few hundred games, numbered so a
+// reader can tell which one it got and whether all of it is there
+static std::string MakeConfig(uint32_t seq, size_t size)
+{
+    std::string config = "{\n    \"seq\": " + std::to_string(seq) + ",\n    \"pad\": \"";
+    config.append(size > config.size() + 8 ? size - config.size() - 8 : 0, (char)('a' + seq % 26));
+    config += "\"\n}\n";
+    return config;
+}
+
+static bool IsConfig(const std::string& data, size_t size)
+{
+    uint32_t seq;
+    if (sscanf(data.c_str(), "{\n    \"seq\": %u,", &seq) != 1)
+        return false;
+    return data == MakeConfig(seq, size);
+}
+
+// Dragging a slider submits every frame, then a few clicks come in a burst
+static void TestDebounce(const std::string& dir, std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay, bool print)
+{
+    auto path = dir + "/thprac.json";
+    auto frame = maxDelay / 120; // 60fps when maxDelay is 2s
+    auto drag = maxDelay * 2;
+    const size_t configSize = 32 << 10;
+
+    uint32_t seq = 0;
+    {
+        CfgWriter writer([&](const std::string& data) { return WriteAtomic(path, data); }, debounce, maxDelay);
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < drag) {
+            writer.Submit([s = ++seq, configSize]() { return MakeConfig(s, configSize); });
+            std::this_thread::sleep_for(frame);
+        }
+        std::this_thread::sleep_for(debounce * 2);
+        for (int i = 0; i < 10; i++) {
+            writer.Submit([s = ++seq, configSize]() { return MakeConfig(s, configSize); });
+            std::this_thread::sleep_for(debounce / 10);
+        }
+        std::this_thread::sleep_for(debounce * 2);
+        CHECK(ReadAll(path) == MakeConfig(seq, configSize));
+        auto stats = writer.GetStats();
+
+        CHECK(stats.submits == seq);
+        CHECK(stats.failures == 0);
+        // One per maxDelay while dragging, one after the drag and one for the burst
+        CHECK(stats.writes >= 2 && stats.writes <= (uint32_t)(drag / maxDelay) + 3);
+        if (print) {
+            printf("slider drag for %lldms + 10 clicks, %lldms debounce, %lldms max delay:\n",
+                (long long)drag.count(), (long long)debounce.count(), (long long)maxDelay.count());
+            printf("  %u submits, %u writes, %.1f KB written, %.1f KB writing every submit\n",
+                stats.submits, stats.writes, stats.bytes / 1024.0, seq * configSize / 1024.0);
+        }
+    }
+    unlink(path.c_str());
+}
+
+// Flush doesn't wait for the debounce, and the destructor writes what's left
+static void TestFlush(const std::string& dir)
+{
+    auto path = dir + "/thprac.json";
+    {
+        CfgWriter writer([&](const std::string& data) { return WriteAtomic(path, data); }, 10s, 10s);
+        auto start = std::chrono::steady_clock::now();
+        writer.Submit([]() { return MakeConfig(1, 100); });
+        writer.Submit([]() { return MakeConfig(2, 100); });
+        CHECK(writer.Flush());
+        CHECK(std::chrono::steady_clock::now() - start < 5s);
+        CHECK(ReadAll(path) == MakeConfig(2, 100));
+        CHECK(writer.GetStats().writes == 1);
+        // Nothing new, so nothing to wait for
+        CHECK(writer.Flush());
+        CHECK(writer.GetStats().writes == 1);
+
+        writer.Submit([]() { return MakeConfig(3, 100); });
+    }
+    CHECK(ReadAll(path) == MakeConfig(3, 100));
+    unlink(path.c_str());
+}
+
+// A failed write is retried after maxDelay
+static void TestRetry(const std::string& dir)
+{
+    auto path = dir + "/thprac.json";
+    std::atomic<int> failuresLeft = 2;
+    CfgWriter writer([&](const std::string& data) { return failuresLeft-- > 0 ? false : WriteAtomic(path, data); }, 5ms, 50ms);
+    writer.Submit([]() { return MakeConfig(1, 100); });
+    CHECK(!writer.Flush());
+    std::this_thread::sleep_for(500ms);
+    auto stats = writer.GetStats();
+    CHECK(stats.failures == 2 && stats.writes == 1);
+    CHECK(ReadAll(path) == MakeConfig(1, 100));
+    unlink(path.c_str());
+}
+
+// Returns how many of the kills left a broken config behind
+static int KillTest(const std::string& dir, bool atomic, int rounds)
+{
+    auto path = dir + "/thprac.json";
+    const size_t configSize = 512 << 10;
+    std::mt19937 rng(22);
+    int broken = 0;
+
+    for (int round = 0; round < rounds; round++) {
+        WriteAtomic(path, MakeConfig(0, configSize));
+        pid_t pid = fork();
+        if (pid == 0) {
+            CfgWriter writer([&](const std::string& data) { return atomic ? WriteAtomic(path, data) : WriteInPlace(path, data); }, 0ms, 0ms);
+            for (uint32_t seq = 1;; seq++) {
+                writer.Submit([seq, configSize]() { return MakeConfig(seq, configSize); });
+                writer.Flush();
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(2000 + rng() % 20000));
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        if (!IsConfig(ReadAll(path), configSize)) {
+            broken++;
+        }
+    }
+    unlink(path.c_str());
+    unlink((path + ".tmp").c_str());
+    return broken;
+}
+
+static void TestKill(const std::string& dir, int rounds)
+{
+    int atomicBroken = KillTest(dir, true, rounds);
+    int inPlaceBroken = KillTest(dir, false, rounds);
+    CHECK(atomicBroken == 0);
+    printf("killed mid write %d times: %d broken configs with temp file + rename, %d with an in place rewrite\n",
+        rounds, atomicBroken, inPlaceBroken);
+}
+
+int main(int argc, char** argv)
+{
+    bool bench = false;
+    const char* parent = "/tmp";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench")) {
+            bench = true;
+        } else {
+            parent = argv[i];
+        }
+    }
+    std::string dir = std::string(parent) + "/thprac_cfg_XXXXXX";
+    if (!mkdtemp(dir.data())) {
+        fprintf(stderr, "can't create a folder in %s\n", parent);
+        return 1;
+    }
+
+    TestFlush(dir);
+    TestRetry(dir);
+    TestDebounce(dir, 30ms, 200ms, false);
+    TestKill(dir, bench ? 200 : 50);
+    if (bench) {
+        TestDebounce(dir, 300ms, 2000ms, true);
+    }
+    rmdir(dir.c_str());
+
+    if (gFailures) {
+        fprintf(stderr, "cfg_writer_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("cfg_writer_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,417 @@
+// Checks the signature tables over the real gGameDefs and gKnownGames, and the
+// header prefilter the launcher's game scan uses to decide which executables
+// get hashed. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O2 -Wall -Wextra -Wno-unused-variable -Iwin32 -I../src/thprac -I../src/3rdParties/MetroHash exe_prefilter_test.cpp ../src/3rdParties/MetroHash/metrohash128.cpp -o exe_prefilter_test
+//   ./exe_prefilter_test [--bench [files] [dir]]
+//
+// --bench writes a tree of decoy executables, 32 and 64-bit and some that
+// aren't images at all, plus a copy of every game. It evicts the tree from the
+// page cache and scans it the way ScanExe does: hashing every image like the
+// scan used to, with the prefilter, and once more with every signature served
+// from a cache keyed by size and write time, like exe_cache.bin. It prints how
+// much of the tree was hashed and how much had to be read from disk, as
+// counted by mincore() with read ahead turned off. dir has to be on a disk
+// backed file system, not tmpfs.
+
+#include "thprac_exe_sig.h"
+#include "thprac_launcher_games_def.h"
+#include <metrohash128.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+// gGameDefs points at these, none of them are ever called
+#define STUB_INIT(name) \
+    void THPrac::name() { }
+STUB_INIT(TH06Init)
+STUB_INIT(TH07Init)
+STUB_INIT(TH08Init)
+STUB_INIT(TH09Init)
+STUB_INIT(TH095Init)
+STUB_INIT(TH10Init)
+STUB_INIT(AlcostgInit)
+STUB_INIT(TH11Init)
+STUB_INIT(TH12Init)
+STUB_INIT(TH125Init)
+STUB_INIT(TH128Init)
+STUB_INIT(TH13Init)
+STUB_INIT(TH14Init)
+STUB_INIT(TH143Init)
+STUB_INIT(TH15Init)
+STUB_INIT(TH16Init)
+STUB_INIT(TH165Init)
+STUB_INIT(TH17Init)
+STUB_INIT(TH18Init)
+STUB_INIT(TH185Init)
+STUB_INIT(TH19_v1_00a_Init)
+STUB_INIT(TH19_v1_10c_Init)
+
+static int gFailures;
+
+#define CHECK(cond, ...)                                                   \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                  \
+            fprintf(stderr, "\n");                                         \
+            gFailures++;                                                   \
+        }                                                                  \
+    } while (0)
+
+// The same lookups as ScanExeNeedsHash in thprac_launcher_games.cpp
+struct Prefilter {
+    SigTable<THGameSig, uint64_t, std::size(gGameDefs)> header;
+
+    Prefilter()
+    {
+        header.Build(gGameDefs, [](THGameSig& def) { return HeaderKey(def.exeSig); });
+    }
+    bool NeedsHash(const PeView& pe, const ExeSig& sig) const
+    {
+        return header.Find(HeaderKey(sig)) || pe.nt()->FileHeader.Machine == IMAGE_FILE_MACHINE_I386;
+    }
+    bool NeedsHash(const std::vector<uint8_t>& image) const
+    {
+        ExeSig sig = {};
+        PeView pe(image.data(), image.size());
+        if (!pe.valid())
+            return false;
+        GetExeHeaderInfo(pe, sig);
+        return NeedsHash(pe, sig);
+    }
+};
+
+struct ImageSpec {
+    uint32_t timeStamp;
+    uint32_t textSize;
+    uint32_t oepCode[10];
+    size_t fileSize;
+    uint16_t machine = IMAGE_FILE_MACHINE_I386;
+};
+
+// An image for spec.machine with a .text and a .data section, the entry point
+// somewhere in .text and everything that isn't a header filled with noise
+static std::vector<uint8_t> MakeImage(const ImageSpec& spec, std::mt19937& rng)
+{
+    const size_t textOffset = 0x400;
+    size_t fileSize = std::max(spec.fileSize, textOffset + spec.textSize + 0x200);
+    std::vector<uint8_t> image(fileSize);
+    for (size_t i = 0; i + 4 <= fileSize; i += 4) {
+        uint32_t r = rng();
+        memcpy(&image[i], &r, 4);
+    }
+    memset(image.data(), 0, textOffset);
+
+    auto dos = (IMAGE_DOS_HEADER*)image.data();
+    dos->e_magic = IMAGE_DOS_SIGNATURE;
+    dos->e_lfanew = 0x80;
+    auto nt = (IMAGE_NT_HEADERS*)&image[0x80];
+    nt->Signature = IMAGE_NT_SIGNATURE;
+    nt->FileHeader.Machine = spec.machine;
+    nt->FileHeader.NumberOfSections = 2;
+    nt->FileHeader.TimeDateStamp = spec.timeStamp;
+    nt->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER32);
+    nt->OptionalHeader.Magic = 0x10b;
+    nt->OptionalHeader.ImageBase = 0x400000;
+    nt->OptionalHeader.NumberOfRvaAndSizes = 16;
+
+    uint32_t entry = spec.textSize > 0x40 ? (rng() % (spec.textSize - 0x20)) & ~0xfu : 0;
+    nt->OptionalHeader.AddressOfEntryPoint = 0x1000 + entry;
+
+    auto sections = (IMAGE_SECTION_HEADER*)(nt + 1);
+    memcpy(sections[0].Name, ".text", 5);
+    sections[0].Misc.VirtualSize = spec.textSize;
+    sections[0].VirtualAddress = 0x1000;
+    sections[0].SizeOfRawData = spec.textSize;
+    sections[0].PointerToRawData = textOffset;
+    memcpy(sections[1].Name, ".data", 5);
+    sections[1].VirtualAddress = 0x1000 + ((spec.textSize + 0xfff) & ~0xfffu);
+    sections[1].SizeOfRawData = (uint32_t)(fileSize - textOffset - spec.textSize);
+    sections[1].Misc.VirtualSize = sections[1].SizeOfRawData;
+    sections[1].PointerToRawData = textOffset + spec.textSize;
+
+    for (unsigned int j = 0; j < 10; j++) {
+        uint16_t word = (uint16_t)(spec.oepCode[j] ^ ((j + 0x41) | ((j + 0x41) << 8)));
+        memcpy(&image[textOffset + entry + j * 2], &word, 2);
+    }
+    return image;
+}
+
+static ImageSpec GameSpec(const THGameSig& def, size_t fileSize)
+{
+    ImageSpec spec = { def.exeSig.timeStamp, def.exeSig.textSize, {}, fileSize };
+    std::copy(def.exeSig.oepCode, def.exeSig.oepCode + 10, spec.oepCode);
+    return spec;
+}
+
+static ImageSpec DecoySpec(std::mt19937& rng, size_t fileSize)
+{
+    ImageSpec spec = { (uint32_t)rng(), 0x1000 + (uint32_t)(rng() % (fileSize / 2)) / 0x200 * 0x200, {}, fileSize };
+    for (auto& code : spec.oepCode) {
+        code = rng() & 0xffff;
+    }
+    return spec;
+}
+
+static ExeSig HeaderInfo(const std::vector<uint8_t>& image)
+{
+    ExeSig sig = {};
+    PeView pe(image.data(), image.size());
+    if (pe.valid()) {
+        GetExeHeaderInfo(pe, sig);
+    }
+    return sig;
+}
+
+// FindGameDefByHeader's callers check the category of what they get back,
+// a definition that shares its key with an earlier one would never be found
+static void TestUniqueKeys()
+{
+    SigTable<THGameSig, uint64_t, std::size(gGameDefs)> header;
+    SigTable<THGameSig, std::array<uint32_t, 4>, std::size(gGameDefs)> hash;
+    SigTable<THKnownGame, std::array<uint32_t, 4>, std::size(gKnownGames)> knownHash;
+    header.Build(gGameDefs, [](THGameSig& def) { return HeaderKey(def.exeSig); });
+    hash.Build(gGameDefs, [](THGameSig& def) { return HashKey(def.exeSig.metroHash); });
+    knownHash.Build(gKnownGames, [](THKnownGame& known) { return HashKey(known.metroHash); });
+    CHECK(header.Unique(), "two games share their timestamp and .text size");
+    CHECK(hash.Unique(), "two games share their hash");
+    CHECK(knownHash.Unique(), "two known games share their hash");
+
+    for (auto& def : gGameDefs) {
+        CHECK(header.Find(HeaderKey(def.exeSig)) == &def, "%s: found another game by header", def.idStr);
+        CHECK(hash.Find(HashKey(def.exeSig.metroHash)) == &def, "%s: found another game by hash", def.idStr);
+    }
+}
+
+static void TestPrefilter()
+{
+    std::mt19937 rng(13);
+    Prefilter prefilter;
+
+    for (auto& def : gGameDefs) {
+        auto sig = HeaderInfo(MakeImage(GameSpec(def, 0), rng));
+        CHECK(sig.timeStamp == def.exeSig.timeStamp && sig.textSize == def.exeSig.textSize, "%s: header", def.idStr);
+        CHECK(std::equal(sig.oepCode, sig.oepCode + 10, def.exeSig.oepCode), "%s: entry point code", def.idStr);
+        CHECK(prefilter.NeedsHash(MakeImage(GameSpec(def, 0), rng)), "%s isn't hashed", def.idStr);
+
+        // Patched in place, same headers but different code at the entry point
+        auto modded = GameSpec(def, 0);
+        modded.oepCode[3] ^= 0x100;
+        CHECK(prefilter.NeedsHash(MakeImage(modded, rng)), "%s: modified build isn't hashed", def.idStr);
+
+        // Relinked translation, new headers and new entry point code, which
+        // gKnownGames can only recognize by its hash
+        auto translated = GameSpec(def, 0);
+        translated.timeStamp ^= 0x5a5a5a;
+        translated.textSize += 0x200;
+        translated.oepCode[0] ^= 0x1;
+        CHECK(prefilter.NeedsHash(MakeImage(translated, rng)), "%s: translated build isn't hashed", def.idStr);
+    }
+
+    // Any 32-bit x86 image could be a gKnownGames build, anything else can't
+    for (int i = 0; i < 10000; i++) {
+        auto spec = DecoySpec(rng, 0x1000 + rng() % 0x10000);
+        bool x86 = i % 2;
+        if (!x86)
+            spec.machine = IMAGE_FILE_MACHINE_AMD64;
+        CHECK(prefilter.NeedsHash(MakeImage(spec, rng)) == x86, "decoy %d", i);
+    }
+}
+
+/// Bench
+/// ------------------
+struct ScanStats {
+    size_t hashed = 0;
+    size_t hashedBytes = 0;
+    size_t residentBytes = 0;
+    double ms = 0;
+};
+
+enum ScanMode {
+    SCAN_EVERY_IMAGE,
+    SCAN_PREFILTER,
+    SCAN_CACHED,
+};
+
+// What exe_cache.bin keys a signature by, apart from the path
+struct CacheKey {
+    off_t size;
+    timespec writeTime;
+};
+
+static size_t ResidentBytes(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    void* view = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t pages = (st.st_size + pageSize - 1) / pageSize;
+    std::vector<unsigned char> resident(pages);
+    mincore(view, st.st_size, resident.data());
+    munmap(view, st.st_size);
+    size_t count = 0;
+    for (auto r : resident) {
+        count += r & 1;
+    }
+    return count * pageSize;
+}
+
+static void Evict(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// What the compute callback in ScanExe does, with MappedFile's 8MB limit. In
+// SCAN_CACHED, a file whose size and write time are in cache isn't opened.
+static ScanStats Scan(const std::vector<std::string>& paths, const Prefilter& prefilter, ScanMode mode, std::map<std::string, CacheKey>& cache)
+{
+    ScanStats stats;
+    for (auto& path : paths) {
+        Evict(path);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (auto& path : paths) {
+        struct stat st;
+        if (stat(path.c_str(), &st))
+            continue;
+        if (mode == SCAN_CACHED) {
+            auto it = cache.find(path);
+            if (it != cache.end() && it->second.size == st.st_size && it->second.writeTime.tv_sec == st.st_mtim.tv_sec
+                && it->second.writeTime.tv_nsec == st.st_mtim.tv_nsec)
+                continue;
+        }
+
+        int fd = open(path.c_str(), O_RDONLY);
+        size_t size = std::min<size_t>(st.st_size, 1 << 23);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        // Otherwise the first fault reads ahead by read_ahead_kb of the disk,
+        // which can be the whole file. This counts what the scan touches.
+        madvise(view, size, MADV_RANDOM);
+
+        ExeSig sig = {};
+        PeView pe(view, size);
+        if (size >= 128 && pe.valid()) {
+            GetExeHeaderInfo(pe, sig);
+            bool needsHash = mode == SCAN_EVERY_IMAGE || prefilter.NeedsHash(pe, sig);
+            if (needsHash && size < (1 << 23)) {
+                MetroHash128::Hash((uint8_t*)view, size, (uint8_t*)sig.metroHash);
+                stats.hashed++;
+                stats.hashedBytes += size;
+            }
+        }
+        munmap(view, size);
+        cache[path] = { st.st_size, st.st_mtim };
+    }
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (auto& path : paths) {
+        stats.residentBytes += ResidentBytes(path);
+    }
+    return stats;
+}
+
+static void Bench(int decoys, const char* parent)
+{
+    std::string dir = std::string(parent) + "/thprac_prefilter_XXXXXX";
+    if (!mkdtemp(dir.data())) {
+        fprintf(stderr, "can't create a folder in %s\n", parent);
+        gFailures++;
+        return;
+    }
+
+    std::mt19937 rng(7);
+    std::vector<std::string> paths;
+    size_t totalBytes = 0;
+    auto write = [&](const std::vector<uint8_t>& image) {
+        auto path = dir + "/" + std::to_string(paths.size()) + ".exe";
+        FILE* f = fopen(path.c_str(), "wb");
+        fwrite(image.data(), 1, image.size(), f);
+        fclose(f);
+        paths.push_back(path);
+        totalBytes += image.size();
+    };
+    for (auto& def : gGameDefs) {
+        write(MakeImage(GameSpec(def, 0x180000), rng));
+    }
+    // Half 32-bit, four in ten 64-bit, the rest not an image at all
+    size_t x86Decoys = 0;
+    for (int i = 0; i < decoys; i++) {
+        auto spec = DecoySpec(rng, 0x20000 + rng() % 0x3e0000);
+        unsigned kind = i % 10;
+        if (kind >= 5)
+            spec.machine = IMAGE_FILE_MACHINE_AMD64;
+        auto image = MakeImage(spec, rng);
+        if (kind == 9)
+            image[0] ^= 0xff;
+        x86Decoys += kind < 5;
+        write(image);
+    }
+
+    Prefilter prefilter;
+    size_t before = 0;
+    for (auto& path : paths) {
+        Evict(path);
+        before += ResidentBytes(path);
+    }
+    if (before) {
+        printf("%zu KB are still cached after eviction, is %s on tmpfs?\n", before >> 10, parent);
+    }
+
+    printf("%zu files, %.1f MB, %zu of them games\n", paths.size(), totalBytes / 1048576.0, std::size(gGameDefs));
+    std::map<std::string, CacheKey> cache;
+    const std::pair<ScanMode, const char*> modes[] = {
+        { SCAN_EVERY_IMAGE, "every image" },
+        { SCAN_PREFILTER, "prefilter" },
+        { SCAN_CACHED, "rescan, cached" },
+    };
+    for (auto [mode, name] : modes) {
+        auto stats = Scan(paths, prefilter, mode, cache);
+        printf("%-16s %4zu hashed  %7.1f MB hashed  %7.1f MB read  %8.1f ms\n", name,
+            stats.hashed, stats.hashedBytes / 1048576.0, stats.residentBytes / 1048576.0, stats.ms);
+        if (mode == SCAN_PREFILTER) {
+            CHECK(stats.hashed == std::size(gGameDefs) + x86Decoys, "%zu files hashed", stats.hashed);
+        } else if (mode == SCAN_CACHED) {
+            CHECK(stats.hashed == 0, "%zu files hashed", stats.hashed);
+        }
+    }
+
+    for (auto& path : paths) {
+        unlink(path.c_str());
+    }
+    rmdir(dir.c_str());
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    TestUniqueKeys();
+    TestPrefilter();
+    if (argc > 1 && !strcmp(argv[1], "--bench")) {
+        Bench(argc > 2 ? atoi(argv[2]) : 200, argc > 3 ? argv[3] : "/var/tmp");
+    }
+
+    if (gFailures) {
+        fprintf(stderr, "exe_prefilter_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("exe_prefilter_test: all passed\n");
+    return 0;
+}
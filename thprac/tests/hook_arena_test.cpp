@@ -0,0 +1,305 @@
+// Fuzzes HookArena from thprac_hook_arena.cpp on top of mmap and mprotect.
+// Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined hook_arena_test.cpp ../src/thprac/thprac_hook_arena.cpp -o hook_arena_test
+//   ./hook_arena_test [rounds]
+//
+// Every allocation is really written to, so a page that isn't writable when
+// it should be crashes the test, and the protection of every page is read
+// back from /proc/self/maps after each write session.
+
+#include "../src/thprac/thprac_hook_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+constexpr size_t PAGE = HookArena::OS_PAGE_SIZE;
+
+class MmapOs : public HookArenaOs {
+public:
+    std::mt19937& rng;
+    // Chance in 16 for Reserve or Seal to fail
+    unsigned reserveFailures = 0;
+    unsigned sealFailures = 0;
+
+    std::vector<uint8_t*> chunks;
+    std::map<uint8_t*, bool> sealed; // Per page
+    std::vector<std::pair<uint8_t*, size_t>> flushed;
+
+    MmapOs(std::mt19937& rng)
+        : rng(rng)
+    {
+    }
+    ~MmapOs()
+    {
+        for (uint8_t* chunk : chunks)
+            munmap(chunk, HookArena::CHUNK_SIZE);
+    }
+
+    uint8_t* Reserve(size_t size) override
+    {
+        CHECK(size == HookArena::CHUNK_SIZE);
+        if (rng() % 16 < reserveFailures)
+            return nullptr;
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+        chunks.push_back((uint8_t*)p);
+        for (size_t off = 0; off < size; off += PAGE)
+            sealed[(uint8_t*)p + off] = false;
+        return (uint8_t*)p;
+    }
+
+    bool Seal(uint8_t* ptr, size_t size) override
+    {
+        CHECK((uintptr_t)ptr % PAGE == 0);
+        CHECK(size && size % PAGE == 0);
+        for (size_t off = 0; off < size; off += PAGE) {
+            // Only ever pages that were never executable
+            CHECK(sealed.count(ptr + off));
+            CHECK(!sealed[ptr + off]);
+        }
+        if (rng() % 16 < sealFailures)
+            return false;
+        if (mprotect(ptr, size, PROT_READ | PROT_EXEC)) {
+            perror("mprotect");
+            return false;
+        }
+        for (size_t off = 0; off < size; off += PAGE)
+            sealed[ptr + off] = true;
+        return true;
+    }
+
+    void FlushCode(uint8_t* ptr, size_t size) override
+    {
+        flushed.push_back({ ptr, size });
+    }
+
+    bool IsSealed(const uint8_t* p)
+    {
+        return sealed[(uint8_t*)((uintptr_t)p & ~(PAGE - 1))];
+    }
+};
+
+// Page protections as the kernel sees them, like "rw-p"
+class Maps {
+    struct Range {
+        uintptr_t begin, end;
+        std::string perms;
+    };
+    std::vector<Range> mRanges;
+
+public:
+    Maps()
+    {
+        FILE* maps = fopen("/proc/self/maps", "r");
+        if (!maps)
+            return;
+        char line[512];
+        while (fgets(line, sizeof(line), maps)) {
+            unsigned long begin, end;
+            char perms[5];
+            if (sscanf(line, "%lx-%lx %4s", &begin, &end, perms) == 3)
+                mRanges.push_back({ begin, end, perms });
+        }
+        fclose(maps);
+    }
+
+    std::string At(const void* p) const
+    {
+        for (const auto& r : mRanges) {
+            if ((uintptr_t)p >= r.begin && (uintptr_t)p < r.end)
+                return r.perms;
+        }
+        return "?";
+    }
+};
+
+struct Allocation {
+    uint8_t* ptr;
+    size_t size;
+    uint8_t fill;
+    bool sealed;
+};
+
+static size_t RandomSize(std::mt19937& rng)
+{
+    switch (rng() % 16) {
+    case 0:
+        return HookArena::CHUNK_SIZE + 1 + rng() % 16;
+    case 1:
+        return HookArena::CHUNK_SIZE - rng() % 16;
+    case 2:
+    case 3:
+        return 1 + rng() % (4 * PAGE);
+    default:
+        // Codecaves, stubs and thunks
+        return 1 + rng() % 160;
+    }
+}
+
+static void FuzzRound(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    MmapOs os(rng);
+    os.reserveFailures = seed % 3 == 1 ? 2 : 0;
+    os.sealFailures = seed % 3 == 2 ? 4 : 0;
+    auto arena = std::make_unique<HookArena>(os);
+
+    // By address, to find overlaps
+    std::map<uint8_t*, Allocation> live;
+    size_t allocs = 0;
+    int sessions = 20 + rng() % 200;
+    for (int s = 0; s < sessions; s++) {
+        int depth = 1 + rng() % 3;
+        for (int d = 0; d < depth; d++)
+            arena->BeginWrite();
+
+        int count = rng() % 12;
+        for (int i = 0; i < count; i++) {
+            size_t size = RandomSize(rng);
+            size_t chunksBefore = os.chunks.size();
+            uint8_t* p = arena->Alloc(size);
+            if (!p) {
+                // Too big, or no chunk to put it in
+                CHECK(size > HookArena::CHUNK_SIZE || os.chunks.size() == chunksBefore);
+                continue;
+            }
+            CHECK(size <= HookArena::CHUNK_SIZE);
+            CHECK((uintptr_t)p % HookArena::ALIGN == 0);
+            allocs++;
+
+            // Sometimes give back the tail, like MakeCodecave does
+            if (rng() % 4 == 0) {
+                size = 1 + rng() % size;
+                arena->Shrink(p, size);
+            }
+            Allocation a = { p, size, (uint8_t)(1 + rng() % 255), false };
+            bool inChunk = false;
+            for (uint8_t* chunk : os.chunks)
+                inChunk |= p >= chunk && p + size <= chunk + HookArena::CHUNK_SIZE;
+            CHECK(inChunk);
+            auto next = live.lower_bound(p);
+            CHECK(next == live.end() || p + size <= next->first);
+            CHECK(next == live.begin() || std::prev(next)->first + std::prev(next)->second.size <= p);
+            // Written to while the session is open, which faults if the
+            // page isn't writable
+            CHECK(!os.IsSealed(p) && !os.IsSealed(p + size - 1));
+            memset(p, a.fill, size);
+            live[p] = a;
+        }
+
+        os.flushed.clear();
+        for (int d = 0; d < depth; d++) {
+            // Inner ends don't seal anything
+            if (d == depth - 1)
+                CHECK(os.flushed.empty());
+            arena->EndWrite();
+        }
+
+        Maps maps;
+        for (auto& [p, a] : live) {
+            bool sealed = os.IsSealed(a.ptr);
+            // Whole allocations get sealed at once
+            CHECK(os.IsSealed(a.ptr + a.size - 1) == sealed);
+            CHECK(maps.At(a.ptr) == (sealed ? "r-xp" : "rw-p"));
+            CHECK(maps.At(a.ptr + a.size - 1) == (sealed ? "r-xp" : "rw-p"));
+            // Without Seal failing, a finished session is executable
+            if (!os.sealFailures)
+                CHECK(sealed);
+            if (sealed && !a.sealed) {
+                // Flushed on the way
+                bool covered = false;
+                for (auto [ptr, size] : os.flushed)
+                    covered |= a.ptr >= ptr && a.ptr + a.size <= ptr + size;
+                CHECK(covered);
+            }
+            CHECK(sealed || !a.sealed);
+            a.sealed = sealed;
+        }
+    }
+
+    // Nothing got overwritten, by later allocations or anything else
+    for (auto& [p, a] : live) {
+        for (size_t i = 0; i < a.size; i++) {
+            if (a.ptr[i] != a.fill) {
+                CHECK(a.ptr[i] == a.fill);
+                break;
+            }
+        }
+    }
+
+    // A session that doesn't allocate doesn't seal
+    os.flushed.clear();
+    arena->BeginWrite();
+    arena->EndWrite();
+    if (!os.sealFailures)
+        CHECK(os.flushed.empty());
+
+    HookArenaStats stats = arena->Stats();
+    CHECK(stats.chunks == os.chunks.size());
+    CHECK(stats.chunks <= HookArena::MAX_CHUNKS);
+    CHECK(stats.allocations == allocs);
+    CHECK(stats.bytes_reserved == stats.chunks * HookArena::CHUNK_SIZE);
+    size_t liveBytes = 0;
+    for (auto& [p, a] : live)
+        liveBytes += a.size;
+    CHECK(stats.bytes_used >= liveBytes && stats.bytes_used <= stats.bytes_reserved);
+}
+
+// Keeps allocating until the arena is out of chunks
+static void TestFull()
+{
+    std::mt19937 rng(1);
+    MmapOs os(rng);
+    auto arena = std::make_unique<HookArena>(os);
+    size_t got = 0;
+    arena->BeginWrite();
+    while (arena->Alloc(HookArena::CHUNK_SIZE / 2))
+        got++;
+    arena->EndWrite();
+    CHECK(got == HookArena::MAX_CHUNKS * 2);
+    CHECK(os.chunks.size() == HookArena::MAX_CHUNKS);
+    arena->BeginWrite();
+    CHECK(arena->Alloc(1) == nullptr);
+    arena->EndWrite();
+}
+
+int main(int argc, char** argv)
+{
+    if (sysconf(_SC_PAGESIZE) != (long)PAGE) {
+        printf("hook_arena_test: skipped, page size isn't %zu\n", PAGE);
+        return 0;
+    }
+    unsigned rounds = argc > 1 ? (unsigned)atoi(argv[1]) : 60;
+
+    TestFull();
+    for (unsigned seed = 0; seed < rounds; seed++)
+        FuzzRound(seed);
+
+    if (gFailures) {
+        fprintf(stderr, "hook_arena_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("hook_arena_test: all passed, %u rounds\n", rounds);
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Checks the stack frames of the detour backend in thprac_hook_detour.h.
+// Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined hook_detour_test.cpp -o hook_detour_test
+//   ./hook_detour_test
+//
+// The frames hold 32 bit stack addresses, so the stack they're built on is
+// mapped below 4 GiB. What DetourEntry does in assembly is played out here
+// on that memory: the stub's push, pushfd/pushad, fxsave below the frame, and
+// popad/popfd/ret from the return frame.
+
+#include "../src/thprac/thprac_hook_detour.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <random>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+// The fields of CONTEXT that the detour backend touches
+struct Context {
+    uint32_t Edi, Esi, Ebx, Edx, Ecx, Eax;
+    uint32_t Ebp, Eip, EFlags, Esp;
+};
+
+static uint8_t* gStack;
+static const size_t STACK_SIZE = 0x10000;
+static const uint32_t FX_SIZE = 512;
+
+static uint32_t& Mem(uint32_t addr)
+{
+    return *(uint32_t*)(uintptr_t)addr;
+}
+
+struct Registers {
+    uint32_t Eax, Ecx, Edx, Ebx, Esp, Ebp, Esi, Edi;
+    uint32_t EFlags, Eip;
+};
+
+static Registers RandomRegisters(std::mt19937& rng)
+{
+    Registers r;
+    for (uint32_t* p : { &r.Eax, &r.Ecx, &r.Edx, &r.Ebx, &r.Ebp, &r.Esi, &r.Edi, &r.EFlags, &r.Eip })
+        *p = rng();
+    return r;
+}
+
+// What the game's stack looked like at the hook site, and where DetourEntry
+// left everything
+struct Entry {
+    uint32_t gameEsp;
+    DetourFrame* frame;
+    uint32_t fxState;
+};
+
+// The stub, then DetourEntry up to the call into DetourDispatch
+static Entry Enter(const Registers& r, uint32_t gameEsp, uint32_t hook)
+{
+    uint32_t esp = gameEsp;
+    esp -= 4; // push hook
+    Mem(esp) = hook;
+    esp -= DETOUR_RED_ZONE; // lea esp, [esp - DETOUR_RED_ZONE]
+    esp -= 4; // pushfd
+    Mem(esp) = r.EFlags;
+    uint32_t pushadEsp = esp;
+    for (uint32_t v : { r.Eax, r.Ecx, r.Edx, r.Ebx, pushadEsp, r.Ebp, r.Esi, r.Edi }) {
+        esp -= 4;
+        Mem(esp) = v;
+    }
+    Entry e;
+    e.gameEsp = gameEsp;
+    e.frame = (DetourFrame*)(uintptr_t)esp;
+    e.fxState = (esp - FX_SIZE) & ~15u; // sub esp, 512; and esp, -16
+    memset((void*)(uintptr_t)e.fxState, 0xFE, FX_SIZE);
+    return e;
+}
+
+// popad, popfd, ret from the frame DetourDispatch returned
+static Registers Leave(const DetourReturnFrame* ret)
+{
+    uint32_t esp = (uint32_t)(uintptr_t)ret;
+    Registers r;
+    for (uint32_t* p : { &r.Edi, &r.Esi, &r.Ebp, &r.Esp, &r.Ebx, &r.Edx, &r.Ecx, &r.Eax }) {
+        *p = Mem(esp);
+        esp += 4;
+    }
+    r.EFlags = Mem(esp);
+    esp += 4;
+    r.Eip = Mem(esp);
+    esp += 4;
+    // popad skips the saved Esp
+    r.Esp = esp;
+    return r;
+}
+
+static bool FxIntact(const Entry& e)
+{
+    const uint8_t* fx = (const uint8_t*)(uintptr_t)e.fxState;
+    for (uint32_t i = 0; i < FX_SIZE; i++) {
+        if (fx[i] != 0xFE)
+            return false;
+    }
+    return true;
+}
+
+// Runs one hook with a callback that changes every register, and moves Esp
+// by espDelta. If it moves it down, it pushes that many bytes.
+static void CheckDetour(std::mt19937& rng, uint32_t gameEsp, int espDelta)
+{
+    const uint32_t hook = 0x00C0FFEE;
+    Registers before = RandomRegisters(rng);
+    Entry e = Enter(before, gameEsp, hook);
+    // The game's own stack, which must survive except for what's popped
+    uint32_t gameStack[64];
+    for (auto& v : gameStack)
+        v = rng();
+    memcpy((void*)(uintptr_t)gameEsp, gameStack, sizeof(gameStack));
+
+    Context ctx = {};
+    DetourLoadContext(e.frame, ctx);
+    CHECK(e.frame->self == hook);
+    CHECK(ctx.Eax == before.Eax && ctx.Ecx == before.Ecx && ctx.Edx == before.Edx && ctx.Ebx == before.Ebx);
+    CHECK(ctx.Ebp == before.Ebp && ctx.Esi == before.Esi && ctx.Edi == before.Edi);
+    CHECK(ctx.EFlags == before.EFlags);
+    CHECK(ctx.Esp == gameEsp);
+
+    // The callback
+    Registers after = RandomRegisters(rng);
+    ctx.Eax = after.Eax;
+    ctx.Ecx = after.Ecx;
+    ctx.Edx = after.Edx;
+    ctx.Ebx = after.Ebx;
+    ctx.Ebp = after.Ebp;
+    ctx.Esi = after.Esi;
+    ctx.Edi = after.Edi;
+    ctx.EFlags = after.EFlags;
+    ctx.Eip = after.Eip;
+    ctx.Esp += espDelta;
+    uint32_t pushed[64];
+    uint32_t pushedCount = espDelta < 0 ? -espDelta / 4 : 0;
+    for (uint32_t i = 0; i < pushedCount; i++)
+        Mem(ctx.Esp + i * 4) = pushed[i] = rng();
+
+    DetourReturnFrame* ret = DetourStoreContext(e.frame, ctx);
+    if (espDelta < -DETOUR_RED_ZONE) {
+        CHECK(ret == nullptr);
+        return;
+    }
+    CHECK(ret != nullptr);
+    if (!ret)
+        return;
+
+    Registers out = Leave(ret);
+    CHECK(out.Eax == after.Eax && out.Ecx == after.Ecx && out.Edx == after.Edx && out.Ebx == after.Ebx);
+    CHECK(out.Ebp == after.Ebp && out.Esi == after.Esi && out.Edi == after.Edi);
+    CHECK(out.EFlags == after.EFlags);
+    CHECK(out.Eip == after.Eip);
+    CHECK(out.Esp == ctx.Esp);
+    // fxrstor runs after the return frame is built
+    CHECK(FxIntact(e));
+    for (uint32_t i = 0; i < pushedCount; i++)
+        CHECK(Mem(ctx.Esp + i * 4) == pushed[i]);
+    for (uint32_t i = 0; i < 64; i++) {
+        if (gameEsp + i * 4 >= ctx.Esp)
+            CHECK(Mem(gameEsp + i * 4) == gameStack[i]);
+    }
+}
+
+static void TestDetourFrames()
+{
+    std::mt19937 rng(6);
+    uint32_t top = (uint32_t)(uintptr_t)(gStack + STACK_SIZE / 2);
+    for (int align = 0; align < 16; align += 4) {
+        // Every alignment of the game's stack, since that decides how much
+        // padding there is between the frame and the x87/SSE state
+        uint32_t gameEsp = (top & ~15u) + align;
+        for (int delta = -DETOUR_RED_ZONE - 64; delta <= 64; delta += 4)
+            CheckDetour(rng, gameEsp, delta);
+        // Without padding, pushing the whole red zone is exactly what fits
+        CheckDetour(rng, gameEsp, -DETOUR_RED_ZONE);
+        CheckDetour(rng, gameEsp, -DETOUR_RED_ZONE - 4);
+    }
+}
+
+int main()
+{
+    // 32 bit addresses for the frames, like thprac sees them
+    void* stack = mmap(nullptr, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (stack == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    gStack = (uint8_t*)stack;
+
+    TestDetourFrames();
+
+    if (gFailures) {
+        fprintf(stderr, "hook_detour_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("hook_detour_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Checks HookTable, which maps breakpoint addresses to hooks in
+// thprac_hook.cpp, against std::unordered_map. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined hook_table_test.cpp -o hook_table_test
+//   ./hook_table_test [--bench]
+//
+// --bench times lookups in both, since VEHHandler does one on every int3 that
+// a hook hits.
+
+#include "../src/thprac/thprac_hook_table.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+struct Hook {
+    uintptr_t addr;
+};
+
+using Table = HookTable<Hook>;
+
+/// Address sets
+/// ------------------
+// Hooks as they are in a game: a few hundred addresses in .text, with
+// clusters where a function gets patched in several places
+static std::vector<uintptr_t> TextAddresses(std::mt19937& rng, size_t count)
+{
+    std::vector<uintptr_t> addrs;
+    uintptr_t at = 0x401000;
+    while (addrs.size() < count) {
+        at += rng() % 4 ? 1 + rng() % 0x40 : 0x100 + rng() % 0x8000;
+        addrs.push_back(at);
+    }
+    return addrs;
+}
+
+static std::vector<uintptr_t> RandomAddresses(std::mt19937& rng, size_t count)
+{
+    std::vector<uintptr_t> addrs;
+    while (addrs.size() < count) {
+        uintptr_t addr = rng();
+        if (addr && std::find(addrs.begin(), addrs.end(), addr) == addrs.end())
+            addrs.push_back(addr);
+    }
+    return addrs;
+}
+
+// Function starts, all 16 byte aligned
+static std::vector<uintptr_t> StridedAddresses(size_t count, uintptr_t stride)
+{
+    std::vector<uintptr_t> addrs;
+    for (size_t i = 0; i < count; i++)
+        addrs.push_back(0x401000 + i * stride);
+    return addrs;
+}
+
+struct AddressSet {
+    const char* name;
+    std::vector<uintptr_t> addrs;
+};
+
+static std::vector<AddressSet> AddressSets(size_t count)
+{
+    std::mt19937 rng((unsigned)count);
+    return {
+        { "text", TextAddresses(rng, count) },
+        { "random", RandomAddresses(rng, count) },
+        { "stride16", StridedAddresses(count, 16) },
+        { "stride4096", StridedAddresses(count, 4096) },
+        { "sequential", StridedAddresses(count, 1) },
+    };
+}
+/// ------------------
+
+static void CheckSet(const AddressSet& set)
+{
+    auto table = std::make_unique<Table>();
+    std::unordered_map<uintptr_t, Hook*> map;
+    std::vector<Hook> hooks(set.addrs.size());
+    for (size_t i = 0; i < set.addrs.size(); i++) {
+        hooks[i].addr = set.addrs[i];
+        CHECK(table->Insert(set.addrs[i], &hooks[i]));
+        map[set.addrs[i]] = &hooks[i];
+    }
+    CHECK(table->count == map.size());
+
+    for (uintptr_t addr : set.addrs)
+        CHECK(table->Find(addr) == map.at(addr));
+    // Misses, including addresses right next to hooks
+    std::mt19937 rng(1);
+    for (int i = 0; i < 10000; i++) {
+        uintptr_t addr = set.addrs[rng() % set.addrs.size()] + (rng() % 9) - 4;
+        if (rng() % 2)
+            addr = rng();
+        auto it = map.find(addr);
+        CHECK(table->Find(addr) == (it == map.end() ? nullptr : it->second));
+    }
+
+    // Hooking the same address again replaces its hook
+    Hook other = {};
+    CHECK(table->Insert(set.addrs[0], &other));
+    CHECK(table->Find(set.addrs[0]) == &other);
+    CHECK(table->count == map.size());
+}
+
+static void TestMatchesMap()
+{
+    for (size_t count : { (size_t)1, (size_t)7, (size_t)64, (size_t)300, Table::MAX_COUNT }) {
+        for (auto& set : AddressSets(count))
+            CheckSet(set);
+    }
+}
+
+static void TestFull()
+{
+    auto table = std::make_unique<Table>();
+    std::mt19937 rng(2);
+    auto addrs = TextAddresses(rng, Table::MAX_COUNT + 1);
+    std::vector<Hook> hooks(addrs.size());
+    for (size_t i = 0; i < Table::MAX_COUNT; i++)
+        CHECK(table->Insert(addrs[i], &hooks[i]));
+    CHECK(table->count == Table::MAX_COUNT);
+
+    // A new address doesn't fit, but an existing one can still be replaced
+    CHECK(!table->Insert(addrs.back(), &hooks.back()));
+    CHECK(table->Find(addrs.back()) == nullptr);
+    CHECK(table->Insert(addrs[0], &hooks.back()));
+    CHECK(table->Find(addrs[0]) == &hooks.back());
+    for (size_t i = 1; i < Table::MAX_COUNT; i++)
+        CHECK(table->Find(addrs[i]) == &hooks[i]);
+
+    // Lookups terminate even with the table as full as it gets
+    CHECK(table->Find(1) == nullptr);
+}
+
+static void TestEmpty()
+{
+    // Zero-initialized, like the static table in thprac_hook.cpp
+    static Table table;
+    CHECK(table.count == 0);
+    CHECK(table.Find(0x401000) == nullptr);
+    CHECK(table.Find(UINTPTR_MAX) == nullptr);
+}
+
+/// Benchmark
+/// ------------------
+template <typename F>
+static double NsPerLookup(const std::vector<uintptr_t>& queries, F find)
+{
+    double best = 1e9;
+    for (int pass = 0; pass < 20; pass++) {
+        auto begin = std::chrono::steady_clock::now();
+        uintptr_t sum = 0;
+        for (uintptr_t addr : queries)
+            sum += (uintptr_t)find(addr);
+        auto end = std::chrono::steady_clock::now();
+        // Keeps the lookups from being optimized out
+        if (sum == 1)
+            puts("");
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - begin).count() / queries.size());
+    }
+    return best;
+}
+
+static void Bench()
+{
+    printf("%-12s %6s %12s %12s\n", "set", "hooks", "HookTable", "unordered_map");
+    for (size_t count : { (size_t)16, (size_t)128, (size_t)512, Table::MAX_COUNT }) {
+        for (auto& set : AddressSets(count)) {
+            auto table = std::make_unique<Table>();
+            std::unordered_map<uintptr_t, Hook*> map;
+            std::vector<Hook> hooks(set.addrs.size());
+            for (size_t i = 0; i < set.addrs.size(); i++) {
+                table->Insert(set.addrs[i], &hooks[i]);
+                map[set.addrs[i]] = &hooks[i];
+            }
+            // Only hits, in a random order: the handler only runs for
+            // breakpoints we placed
+            std::mt19937 rng(3);
+            std::vector<uintptr_t> queries(100000);
+            for (auto& q : queries)
+                q = set.addrs[rng() % set.addrs.size()];
+
+            double tableNs = NsPerLookup(queries, [&](uintptr_t addr) { return table->Find(addr); });
+            double mapNs = NsPerLookup(queries, [&](uintptr_t addr) {
+                auto it = map.find(addr);
+                return it == map.end() ? nullptr : it->second;
+            });
+            printf("%-12s %6zu %9.2f ns %10.2f ns\n", set.name, count, tableNs, mapNs);
+        }
+    }
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    TestEmpty();
+    TestMatchesMap();
+    TestFull();
+
+    if (argc > 1 && !strcmp(argv[1], "--bench"))
+        Bench();
+
+    if (gFailures) {
+        fprintf(stderr, "hook_table_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("hook_table_test: all passed\n");
+    return 0;
+}
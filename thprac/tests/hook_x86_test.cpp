@@ -0,0 +1,483 @@
+// Checks the decoder and relocator in thprac_hook_x86.cpp against a corpus
+// of hook site code, and the x86 code it generates. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined -fno-sanitize=alignment hook_x86_test.cpp ../src/thprac/thprac_hook_x86.cpp -o hook_x86_test
+//   ./hook_x86_test
+//
+// The code is 32 bit and can't run here, so thunks are run through a small
+// interpreter instead. It only knows the handful of instructions that the
+// generator emits, and fails on anything else.
+
+#include "../src/thprac/thprac_hook_x86.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+static std::vector<uint8_t> Hex(const char* hex)
+{
+    std::vector<uint8_t> bytes;
+    for (; hex[0] && hex[1]; hex += 2) {
+        while (*hex == ' ')
+            hex++;
+        unsigned byte;
+        sscanf(hex, "%2x", &byte);
+        bytes.push_back((uint8_t)byte);
+    }
+    return bytes;
+}
+
+static uint32_t Read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/// Decoder and relocator corpus
+/// ------------------
+// Code as it sits at hook sites: MSVC prologues, calls, compares and the
+// branches that follow them, and the bytes thprac's own patches write into
+// the games, where hooks from other hook sets can land. Lengths were checked
+// against objdump, except that objdump folds fwait into the next x87
+// instruction. copy_len is the length of the relocated copy.
+struct CorpusEntry {
+    const char* name;
+    const char* hex;
+    std::vector<uint8_t> lens;
+    size_t copy_len;
+};
+
+static const CorpusEntry gCorpus[] = {
+    { "prologue, aligned frame", "558BEC 83E4F0 83EC18", { 1, 2, 3, 3 }, 9 },
+    { "prologue, SEH frame", "6AFF 68281E4A00 64A100000000 50 83EC24", { 2, 5, 6, 1, 3 }, 17 },
+    { "call, then stack cleanup", "E82F120000 83C40C", { 5, 3 }, 8 },
+    { "member load and test", "8B8134120000 85C0 740A", { 6, 2, 2 }, 14 },
+    { "float compare", "F30F104644 0F2F05E06E4B00 0F861A010000", { 5, 7, 6 }, 18 },
+    { "x87 argument", "D945F8 D91C24", { 3, 3 }, 6 },
+    { "global flag check", "833DF0CD4C0000 752E", { 7, 2 }, 13 },
+    { "word store, absolute", "66C70504D969000002", { 9 }, 9 },
+    { "th08 patch at 0x44abda", "B970A64E00 E8BC1F0000 E9C0020000", { 5, 5, 5 }, 15 },
+    { "th10_real_bullet_sprite", "0F8413050000", { 6 }, 6 },
+    { "th185 patch at 0x40ed5f, th18_pause_skip_2", "0F1F440000 0F1F8000000000 660F1F440000 662E0F1F840000000000", { 5, 7, 6, 10 }, 28 },
+    { "imul immediates", "69C0E8030000 6BC00C", { 6, 3 }, 9 },
+    { "SIB with disp32", "8B848E00100000 89442410", { 7, 4 }, 11 },
+    { "group 3 test", "F6401004 F70000000100 751E", { 4, 6, 2 }, 16 },
+    { "stack store imm32", "C74424100000803F 6A00 6834124B00", { 8, 2, 5 }, 15 },
+    { "0F38 and 0F3A", "660F3800C1 660F3A0AC101", { 5, 6 }, 11 },
+    { "VEX", "C5FA104644 C5FA58C1", { 5, 4 }, 9 },
+    { "16 bit address", "678B4610 83C001", { 4, 3 }, 7 },
+    { "movzx, cmov, lea", "0FB64604 0F4CC1 8D0440", { 4, 3, 3 }, 10 },
+    { "ret imm16", "C20800", { 3 }, 3 },
+    { "th11_disable_bg_2", "EB25", { 2 }, 5 },
+    { "th14_all_clear_bonus_1", "EB0C CC CC CC", { 2, 1, 1, 1 }, 8 },
+    { "th17 patch at 0x447b84", "31F6 90 90 90 90", { 2, 1, 1, 1, 1 }, 6 },
+    { "th13_disable_prac_menu_2", "83C404 6690", { 3, 2 }, 5 },
+    { "short branch inside", "85C0 7403 83C001 8906", { 2, 2, 3, 2 }, 13 },
+    { "short branch back inside", "49 89048F 75FA", { 1, 3, 2 }, 10 },
+    { "jecxz island", "49 E30E 8B06", { 1, 2, 2 }, 12 },
+    { "loop island", "83C604 E2DE", { 3, 2 }, 12 },
+    { "loopne island", "803E00 E03E", { 3, 2 }, 12 },
+    { "jecxz inside", "E302 8B06 31C0", { 2, 2, 2 }, 13 },
+    { "fwait between x87", "D93C24 9B D96C2402", { 3, 1, 4 }, 8 },
+    { "imm16 operand size", "66B83412 66833E40 6683C410", { 4, 4, 4 }, 12 },
+};
+
+static bool IsLoop(const X86Insn& insn)
+{
+    return !insn.two_byte && insn.opcode >= 0xE0 && insn.opcode <= 0xE3;
+}
+
+static uintptr_t BranchTarget(const uint8_t* p, const X86Insn& insn)
+{
+    if (insn.rel_size == 1)
+        return (uintptr_t)(p + insn.len) + (int8_t)p[insn.rel_offset];
+    return (uintptr_t)(p + insn.len) + (int32_t)Read32(p + insn.rel_offset);
+}
+
+static void CheckDecode(const CorpusEntry& e, const std::vector<uint8_t>& code)
+{
+    size_t off = 0;
+    std::vector<size_t> ends;
+    for (uint8_t len : e.lens) {
+        X86Insn insn = X86Decode(&code[off]);
+        if (insn.len != len) {
+            fprintf(stderr, "%s: instruction at +%zu decoded as %u bytes, expected %u\n", e.name, off, insn.len, len);
+            gFailures++;
+            return;
+        }
+        off += len;
+        ends.push_back(off);
+    }
+    CHECK(off == code.size());
+    // The shortest run of whole instructions that covers every length
+    for (size_t min = 1; min <= code.size(); min++) {
+        size_t expected = *std::find_if(ends.begin(), ends.end(), [&](size_t end) { return end >= min; });
+        CHECK(X86InsnBoundary(code.data(), min) == expected);
+    }
+}
+
+// Walks the relocated copy next to the original, and checks that every
+// instruction is either the same bytes, or a branch that still goes to the
+// same place. Targets inside the copied range have to go to the copy.
+static void CheckRelocated(const CorpusEntry& e, const uint8_t* src, size_t src_len, const uint8_t* dst, size_t dst_len)
+{
+    std::vector<size_t> src_starts;
+    for (size_t off = 0; off < src_len; off += X86Decode(src + off).len)
+        src_starts.push_back(off);
+    src_starts.push_back(src_len);
+
+    std::vector<const uint8_t*> copies;
+    std::vector<std::pair<uintptr_t, uintptr_t>> branches; // Original target, target in the copy
+    const uint8_t* c = dst;
+    for (size_t i = 0; i + 1 < src_starts.size(); i++) {
+        copies.push_back(c);
+        const uint8_t* in = src + src_starts[i];
+        X86Insn from = X86Decode(in);
+        X86Insn to = X86Decode(c);
+        if (c + to.len > dst + dst_len) {
+            fprintf(stderr, "%s: copy of instruction %zu runs past the end\n", e.name, i);
+            gFailures++;
+            return;
+        }
+        if (!from.rel_size) {
+            CHECK(to.len == from.len && !memcmp(c, in, from.len));
+            c += from.len;
+        } else if (IsLoop(from)) {
+            // loop +2; jmp +5; jmp rel32
+            CHECK(c[0] == in[0] && c[1] == 0x02 && c[2] == 0xEB && c[3] == 0x05 && c[4] == 0xE9);
+            branches.push_back({ BranchTarget(in, from), (uintptr_t)c + 9 + (int32_t)Read32(c + 5) });
+            c += 9;
+        } else {
+            // Widened to rel32, with the same condition
+            CHECK(to.rel_size == 4);
+            if (from.opcode == 0xEB)
+                CHECK(to.opcode == 0xE9);
+            else if (!from.two_byte && from.opcode >= 0x70 && from.opcode <= 0x7F)
+                CHECK(to.two_byte && to.opcode == (0x80 | (from.opcode & 0x0F)));
+            else
+                CHECK(to.len == from.len && !memcmp(c, in, from.rel_offset));
+            branches.push_back({ BranchTarget(in, from), BranchTarget(c, to) });
+            c += to.len;
+        }
+    }
+    CHECK(c == dst + dst_len);
+
+    // A branch to right past the range keeps going to the original, which
+    // is where the copy jumps back to anyway
+    for (auto [target, copied] : branches) {
+        uintptr_t expected = target;
+        for (size_t i = 0; i + 1 < src_starts.size(); i++) {
+            if (target == (uintptr_t)src + src_starts[i])
+                expected = (uintptr_t)copies[i];
+        }
+        if (copied != expected) {
+            fprintf(stderr, "%s: branch to %+td now goes to %+td\n", e.name,
+                (ptrdiff_t)(target - (uintptr_t)src), (ptrdiff_t)(copied - (uintptr_t)src));
+            gFailures++;
+        }
+    }
+}
+
+static void TestCorpus()
+{
+    std::vector<uint8_t> mem(0x4000, 0xCC);
+    for (const CorpusEntry& e : gCorpus) {
+        auto code = Hex(e.hex);
+        CheckDecode(e, code);
+
+        // Copied to before and after the original, at every alignment
+        for (size_t dst_off : { 0x100, 0x101, 0x102, 0x103, 0x3000, 0x3003 }) {
+            uint8_t* src = &mem[0x2000 + dst_off % 4];
+            uint8_t* dst = &mem[dst_off];
+            memset(mem.data(), 0xCC, mem.size());
+            memcpy(src, code.data(), code.size());
+
+            size_t len = X86Relocate(dst, 0x100, src, code.size());
+            CHECK(len == e.copy_len);
+            CHECK(dst[len] == 0xCC);
+            if (len)
+                CheckRelocated(e, src, code.size(), dst, len);
+
+            // The copy has to fit exactly, and isn't started otherwise
+            memset(dst, 0xCC, 0x100);
+            CHECK(X86Relocate(dst, e.copy_len - 1, src, code.size()) == 0);
+            CHECK(dst[0] == 0xCC);
+        }
+
+        // What MakeCodecave copies for a detour: the run covering 5 bytes,
+        // with whatever follows the entry in the game being int3 padding here
+        uint8_t* src = &mem[0x2000];
+        uint8_t* dst = &mem[0x3000];
+        memset(mem.data(), 0xCC, mem.size());
+        memcpy(src, code.data(), code.size());
+        size_t stolen = X86InsnBoundary(src, 5);
+        CHECK(stolen >= 5);
+        if (stolen) {
+            size_t len = X86Relocate(dst, 0x100, src, stolen);
+            CHECK(len >= stolen);
+            if (len)
+                CheckRelocated(e, src, stolen, dst, len);
+        }
+    }
+
+    // Not whole instructions
+    auto call = Hex("E82F120000");
+    uint8_t dst[64];
+    CHECK(X86Relocate(dst, sizeof(dst), call.data(), 3) == 0);
+    // rel16 branches truncate Eip
+    auto jmp16 = Hex("66E91000");
+    CHECK(X86Decode(jmp16.data()).len == 4);
+    CHECK(X86Relocate(dst, sizeof(dst), jmp16.data(), 4) == 0);
+}
+/// ------------------
+
+/// Thunk interpreter
+/// ------------------
+struct Machine {
+    uint32_t regs[8] = {};
+    uint32_t xmm[8] = {};
+    std::map<uint32_t, uint32_t> mem;
+    std::vector<uint32_t> callFrame; // What the callee found at [esp + 4 * i]
+    uint32_t callTarget = 0;
+    int calls = 0;
+};
+
+// [esp + disp] operand after a ModRM, returns its reg field or -1
+static int EspOperand(const uint8_t* p, size_t len, uint32_t& disp)
+{
+    uint8_t modrm = p[0];
+    if ((modrm & 7) != 4 || p[1] != 0x24)
+        return -1;
+    if ((modrm >> 6) == 0 && len == 2)
+        disp = 0;
+    else if ((modrm >> 6) == 1 && len == 3)
+        disp = p[2];
+    else
+        return -1;
+    return (modrm >> 3) & 7;
+}
+
+// Runs code from its first byte until the ret that leaves it. calleeFrame is
+// how many dwords the callee reads from its frame. Returns false on anything
+// the generator shouldn't have emitted.
+static bool Run(Machine& m, const uint8_t* code, size_t size, size_t calleeFrame, uint32_t calleeResult)
+{
+    uint32_t& esp = m.regs[X86_ESP];
+    size_t pc = 0;
+    while (pc < size) {
+        const uint8_t* p = code + pc;
+        X86Insn insn = X86Decode(p);
+        if (!insn.len || pc + insn.len > size)
+            return false;
+        uint32_t disp;
+        int reg;
+        if (p[0] == 0x83 && p[1] == 0xEC && insn.len == 3) {
+            esp -= p[2];
+        } else if (p[0] == 0x83 && p[1] == 0xC4 && insn.len == 3) {
+            esp += p[2];
+        } else if (p[0] == 0x89 && (reg = EspOperand(p + 1, insn.len - 1, disp)) >= 0) {
+            m.mem[esp + disp] = m.regs[reg];
+        } else if (p[0] == 0x8B && (reg = EspOperand(p + 1, insn.len - 1, disp)) >= 0) {
+            m.regs[reg] = m.mem[esp + disp];
+        } else if (p[0] == 0xF3 && p[1] == 0x0F && p[2] == 0x11 && (reg = EspOperand(p + 3, insn.len - 3, disp)) >= 0) {
+            m.mem[esp + disp] = m.xmm[reg];
+        } else if (p[0] == 0xE8 && insn.len == 5) {
+            // A cdecl callee: sees its arguments right above the return
+            // address, may clobber EAX/ECX/EDX and XMM, and leaves esp alone
+            m.calls++;
+            m.callTarget = (uint32_t)((uintptr_t)code + pc + 5 + Read32(p + 1));
+            m.callFrame.clear();
+            for (size_t i = 0; i < calleeFrame; i++)
+                m.callFrame.push_back(m.mem[esp + i * 4]);
+            m.regs[X86_EAX] = calleeResult;
+            m.regs[X86_ECX] = m.regs[X86_EDX] = 0xDEADDEAD;
+            for (auto& x : m.xmm)
+                x = 0xDEADDEAD;
+        } else if (p[0] == 0xC3 && insn.len == 1) {
+            esp += 4;
+            return true;
+        } else {
+            return false;
+        }
+        pc += insn.len;
+    }
+    return false;
+}
+
+// Calls the thunk the way the game would, and checks what the callee gets
+static void CheckThunk(const X86RegArgs& args, const uint8_t* thunk, size_t len, uintptr_t target)
+{
+    std::mt19937 rng(len);
+    Machine m;
+    const uint32_t stackTop = 0x100000;
+    const uint32_t retAddr = 0x00401234;
+
+    // Every argument gets a distinct value, and the callee saved registers
+    // get values that have to survive
+    std::vector<uint32_t> expected;
+    for (uint8_t i = 0; i < args.reg_count; i++)
+        expected.push_back(m.regs[args.regs[i]] = 0x10000000 | rng() % 0x1000000);
+    for (uint8_t i = 0; i < args.xmm_count; i++)
+        expected.push_back(m.xmm[i] = 0x20000000 | rng() % 0x1000000);
+    m.regs[X86_ESP] = stackTop;
+    m.mem[stackTop] = retAddr;
+    for (uint8_t i = 0; i < args.stack_count; i++)
+        expected.push_back(m.mem[stackTop + 4 + i * 4] = 0x30000000 | rng() % 0x1000000);
+    uint32_t saved[8];
+    for (int r : { X86_EBX, X86_EBP, X86_ESI, X86_EDI }) {
+        bool isArg = false;
+        for (uint8_t i = 0; i < args.reg_count; i++)
+            isArg |= args.regs[i] == r;
+        if (!isArg)
+            m.regs[r] = 0x40000000 | r;
+    }
+    memcpy(saved, m.regs, sizeof(saved));
+    auto callerArgs = m.mem;
+
+    CHECK(Run(m, thunk, len, expected.size(), 0x01));
+    CHECK(m.calls == 1);
+    CHECK(m.callTarget == (uint32_t)target);
+    CHECK(m.callFrame == expected);
+    CHECK(m.regs[X86_EAX] == 0x01);
+    // The caller pops its own arguments, so ret pops just the return address
+    CHECK(m.regs[X86_ESP] == stackTop + 4);
+    for (int r : { X86_EBX, X86_EBP, X86_ESI, X86_EDI })
+        CHECK(m.regs[r] == saved[r]);
+    // The caller's arguments are still where it left them
+    for (uint8_t i = 0; i <= args.stack_count; i++)
+        CHECK(m.mem[stackTop + i * 4] == callerArgs[stackTop + i * 4]);
+}
+
+static void TestCdeclThunk()
+{
+    // _RxD1E00_fast in TH19: a1 in ECX, a2-a5 in XMM0-XMM3, a6-a10 on the stack
+    const X86RegArgs rxd1e00 = { .reg_count = 1, .regs = { X86_ECX }, .xmm_count = 4, .stack_count = 5 };
+    // What the hand-written __asm thunk it replaces assembled to
+    auto golden = Hex(
+        "83EC28"
+        "890C24"
+        "F30F11442404 F30F114C2408 F30F1154240C F30F115C2410"
+        "8B44242C 89442414 8B442430 89442418 8B442434 8944241C 8B442438 89442420 8B44243C 89442424"
+        "E800000000"
+        "83C428"
+        "C3");
+
+    alignas(16) uint8_t buf[X86_THUNK_MAX_LEN * 2];
+    uint8_t* thunk = buf + 16;
+    uintptr_t target = (uintptr_t)buf + 0x1000;
+    size_t len = X86EmitCdeclThunk(thunk, X86_THUNK_MAX_LEN, rxd1e00, target);
+    CHECK(len == golden.size());
+    if (len == golden.size()) {
+        uint32_t rel = (uint32_t)(target - (uintptr_t)(thunk + 0x4B));
+        memcpy(&golden[0x47], &rel, 4);
+        CHECK(!memcmp(thunk, golden.data(), len));
+        CheckThunk(rxd1e00, thunk, len, target);
+    }
+
+    // Every other layout the generator takes
+    std::mt19937 rng(4);
+    const X86Reg usable[] = { X86_EAX, X86_ECX, X86_EDX, X86_EBX, X86_EBP, X86_ESI, X86_EDI };
+    int accepted = 0;
+    for (int it = 0; it < 2000; it++) {
+        X86RegArgs args = {};
+        args.reg_count = rng() % 5;
+        for (uint8_t i = 0; i < args.reg_count; i++) {
+            // Distinct registers
+            X86Reg r;
+            bool dup;
+            do {
+                r = usable[rng() % 7];
+                dup = false;
+                for (uint8_t j = 0; j < i; j++)
+                    dup |= args.regs[j] == r;
+            } while (dup);
+            args.regs[i] = r;
+        }
+        args.xmm_count = rng() % 9;
+        args.stack_count = rng() % 17;
+        size_t frame = (args.reg_count + args.xmm_count + args.stack_count) * 4;
+        bool fits = frame + 4 + args.stack_count * 4 <= 0x7F;
+
+        memset(buf, 0xCC, sizeof(buf));
+        len = X86EmitCdeclThunk(thunk, X86_THUNK_MAX_LEN, args, target);
+        CHECK((len != 0) == fits);
+        CHECK(len <= X86_THUNK_MAX_LEN);
+        // Nothing written past the end
+        for (size_t i = len; i < X86_THUNK_MAX_LEN; i++) {
+            if (thunk[i] != 0xCC) {
+                CHECK(thunk[i] == 0xCC);
+                break;
+            }
+        }
+        if (len) {
+            accepted++;
+            CheckThunk(args, thunk, len, target);
+            // Too small a buffer is refused, not overrun
+            memset(buf, 0xCC, sizeof(buf));
+            CHECK(X86EmitCdeclThunk(thunk, len - 1, args, target) == 0);
+            CHECK(thunk[0] == 0xCC);
+        }
+    }
+    CHECK(accepted > 500);
+
+    // ESP can't be an argument, the thunk moves it
+    X86RegArgs esp = { .reg_count = 1, .regs = { X86_ESP }, .xmm_count = 0, .stack_count = 0 };
+    CHECK(X86EmitCdeclThunk(thunk, X86_THUNK_MAX_LEN, esp, target) == 0);
+}
+
+static void TestDetourStub()
+{
+    alignas(16) uint8_t buf[64];
+    const uint32_t hook = 0x12345678;
+    uintptr_t entry = (uintptr_t)buf - 0x10000;
+
+    memset(buf, 0xCC, sizeof(buf));
+    CHECK(X86EmitDetourStub(buf, sizeof(buf), hook, entry) == X86_DETOUR_STUB_LEN);
+    auto golden = Hex("6878563412 E900000000");
+    uint32_t rel = (uint32_t)(entry - (uintptr_t)(buf + 10));
+    memcpy(&golden[6], &rel, 4);
+    CHECK(!memcmp(buf, golden.data(), golden.size()));
+    CHECK(buf[X86_DETOUR_STUB_LEN] == 0xCC);
+
+    // Two whole instructions, and the jmp lands on the entry
+    X86Insn push = X86Decode(buf);
+    X86Insn jmp = X86Decode(buf + 5);
+    CHECK(push.len == 5 && push.opcode == 0x68 && !push.rel_size);
+    CHECK(jmp.len == 5 && jmp.rel_offset == 1 && jmp.rel_size == 4);
+    CHECK((uintptr_t)buf + 10 + (int32_t)Read32(buf + 6) == entry);
+
+    memset(buf, 0xCC, sizeof(buf));
+    CHECK(X86EmitDetourStub(buf, X86_DETOUR_STUB_LEN - 1, hook, entry) == 0);
+    CHECK(buf[0] == 0xCC);
+}
+/// ------------------
+
+int main()
+{
+    TestCorpus();
+    TestCdeclThunk();
+    TestDetourStub();
+
+    if (gFailures) {
+        fprintf(stderr, "hook_x86_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("hook_x86_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Checks blobs/inject_pe.h, which INJECT_SHELLCODE is built from, against a
+// golden image. Builds and runs on Linux x86-64:
+//
+//   g++ -std=c++20 -O1 -Wall -fsanitize=address,undefined -fno-sanitize=alignment inject_pe_test.cpp -o inject_pe_test
+//   ./inject_pe_test fixtures
+//
+// fixtures/inject_pe_image.bin is a synthetic 32 bit image with an ImageBase
+// of 0x400000. It has 24 relocation blocks into pages 1-5, some that are only
+// padding and some with fixups that straddle two pages, and three import
+// descriptors with imports by name and by ordinal. One of the descriptors has
+// no OriginalFirstThunk and one has no imports.
+// fixtures/inject_pe_relocated.bin is the same image moved up by 0x1230000,
+// with its imports resolved by the fake GetProcAddress below. It was written
+// by the per-fixup loop InjectShellcode used before inject_pe.h.
+//
+// The image is mapped below 4GB and made read-only with mprotect, and the fake
+// VirtualProtect really changes the protection. So every write inject_pe.h
+// makes without unprotecting the page first crashes the test. Fixups and
+// import names aren't aligned in a PE file, hence -fno-sanitize=alignment.
+
+#include "pe_shim.h"
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
+#pragma GCC diagnostic ignored "-Wconversion-null"
+#include "../src/thprac/blobs/inject_pe.h"
+#pragma GCC diagnostic pop
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <string>
+#include <vector>
+
+constexpr DWORD IMAGE_SIZE = 0x8000;
+constexpr DWORD IMAGE_PAGES = IMAGE_SIZE / PE_PAGE_SIZE;
+constexpr DWORD FIXTURE_IMAGE_BASE = 0x400000;
+constexpr DWORD FIXTURE_DELTA = 0x1230000;
+
+static PUINT8 gImage;
+static DWORD gPageProtect[IMAGE_PAGES];
+static unsigned gProtectCalls;
+static const char* gFailDll;
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+static int ToProt(DWORD protect)
+{
+    return protect == PAGE_EXECUTE_READWRITE ? PROT_READ | PROT_WRITE : PROT_READ;
+}
+
+static BOOL WINAPI FakeVirtualProtect(LPVOID lpAddress, size_t dwSize, DWORD flNewProtect, PDWORD lpflOldProtect)
+{
+    gProtectCalls++;
+    DWORD first = (DWORD)((PUINT8)lpAddress - gImage) / PE_PAGE_SIZE;
+    DWORD last = (DWORD)((PUINT8)lpAddress + dwSize - 1 - gImage) / PE_PAGE_SIZE;
+    if (last >= IMAGE_PAGES)
+        return FALSE;
+    *lpflOldProtect = gPageProtect[first];
+    for (DWORD i = first; i <= last; i++)
+        gPageProtect[i] = flNewProtect;
+    mprotect(gImage + first * PE_PAGE_SIZE, (last - first + 1) * PE_PAGE_SIZE, ToProt(flNewProtect));
+    return TRUE;
+}
+
+static HMODULE WINAPI FakeLoadLibraryA(LPCSTR lpLibFileName)
+{
+    if (gFailDll && !strcmp(lpLibFileName, gFailDll))
+        return NULL;
+    DWORD h = 0;
+    for (; *lpLibFileName; lpLibFileName++)
+        h = h * 33 + (BYTE)*lpLibFileName;
+    return (HMODULE)(uintptr_t)(0x10000000 | (h & 0xFFFFFF));
+}
+
+static FARPROC WINAPI FakeGetProcAddress(HMODULE hModule, LPCSTR lpProcName)
+{
+    DWORD v = (DWORD)(uintptr_t)hModule * 31;
+    if ((uintptr_t)lpProcName < 0x10000)
+        return v + (DWORD)(uintptr_t)lpProcName;
+    for (; *lpProcName; lpProcName++)
+        v = v * 131 + (BYTE)*lpProcName;
+    return v;
+}
+
+static std::vector<UINT8> ReadFixture(const std::string& path)
+{
+    std::vector<UINT8> data;
+    if (FILE* f = fopen(path.c_str(), "rb")) {
+        data.resize(IMAGE_SIZE + 1);
+        data.resize(fread(data.data(), 1, data.size(), f));
+        fclose(f);
+    }
+    return data;
+}
+
+// Maps the fixture read-only, with its header moved so that the image is
+// FIXTURE_DELTA above its ImageBase
+static PIMAGE_NT_HEADERS LoadImage(const std::vector<UINT8>& fixture, DWORD delta)
+{
+    mprotect(gImage, IMAGE_SIZE, PROT_READ | PROT_WRITE);
+    memcpy(gImage, fixture.data(), IMAGE_SIZE);
+    PIMAGE_NT_HEADERS pNt = MakePointer(PIMAGE_NT_HEADERS, gImage, ((PIMAGE_DOS_HEADER)gImage)->e_lfanew);
+    pNt->OptionalHeader.ImageBase = (DWORD)(UINT_PTR)gImage - delta;
+    mprotect(gImage, IMAGE_SIZE, PROT_READ);
+    for (auto& p : gPageProtect)
+        p = PAGE_READONLY;
+    gProtectCalls = 0;
+    return pNt;
+}
+
+static bool ProtectionRestored()
+{
+    for (auto p : gPageProtect)
+        if (p != PAGE_READONLY)
+            return false;
+    return true;
+}
+
+static void TestRelocateAndImport(const std::vector<UINT8>& fixture, const std::vector<UINT8>& golden)
+{
+    PIMAGE_NT_HEADERS pNt = LoadImage(fixture, FIXTURE_DELTA);
+    CHECK(PeApplyRelocations((UINT_PTR)gImage, pNt, FakeVirtualProtect));
+    unsigned relocCalls = gProtectCalls;
+    CHECK(PeResolveImports((UINT_PTR)gImage, pNt, FakeLoadLibraryA, FakeGetProcAddress, FakeVirtualProtect) == NULL);
+    CHECK(ProtectionRestored());
+
+    mprotect(gImage, IMAGE_SIZE, PROT_READ | PROT_WRITE);
+    pNt->OptionalHeader.ImageBase = FIXTURE_IMAGE_BASE;
+    DWORD diffs = 0;
+    for (DWORD i = 0; i < IMAGE_SIZE; i++) {
+        if (gImage[i] != golden[i] && diffs++ < 8)
+            fprintf(stderr, "byte 0x%04X: 0x%02X, expected 0x%02X\n", i, gImage[i], golden[i]);
+    }
+    CHECK(diffs == 0);
+
+    // The old loop made 842 calls for the 421 fixups and 32 for the 16 imports
+    printf("VirtualProtect calls: %u for relocations, %u for imports\n", relocCalls, gProtectCalls - relocCalls);
+}
+
+static void TestLoadedAtImageBase(const std::vector<UINT8>& fixture)
+{
+    PIMAGE_NT_HEADERS pNt = LoadImage(fixture, 0);
+    CHECK(PeApplyRelocations((UINT_PTR)gImage, pNt, FakeVirtualProtect));
+    CHECK(gProtectCalls == 0);
+    mprotect(gImage, IMAGE_SIZE, PROT_READ | PROT_WRITE);
+    pNt->OptionalHeader.ImageBase = FIXTURE_IMAGE_BASE;
+    CHECK(memcmp(gImage, fixture.data(), IMAGE_SIZE) == 0);
+}
+
+static void TestMissingDll(const std::vector<UINT8>& fixture)
+{
+    PIMAGE_NT_HEADERS pNt = LoadImage(fixture, FIXTURE_DELTA);
+    gFailDll = "user32.dll";
+    PCHAR pDllName = PeResolveImports((UINT_PTR)gImage, pNt, FakeLoadLibraryA, FakeGetProcAddress, FakeVirtualProtect);
+    gFailDll = NULL;
+    CHECK(pDllName && !strcmp(pDllName, "user32.dll"));
+    CHECK(ProtectionRestored());
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir = argc > 1 ? argv[1] : "fixtures";
+    auto fixture = ReadFixture(dir + "/inject_pe_image.bin");
+    auto golden = ReadFixture(dir + "/inject_pe_relocated.bin");
+    if (fixture.size() != IMAGE_SIZE || golden.size() != IMAGE_SIZE) {
+        fprintf(stderr, "Can't read the fixtures in %s\n", dir.c_str());
+        return 2;
+    }
+
+    void* mem = mmap(NULL, IMAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return 2;
+    }
+    gImage = (PUINT8)mem;
+
+    TestRelocateAndImport(fixture, golden);
+    TestLoadedAtImageBase(fixture);
+    TestMissingDll(fixture);
+
+    if (gFailures) {
+        fprintf(stderr, "%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("inject_pe_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+// Just enough of Windows.h for the parts of thprac that only touch PE
+// structures through pointers, so they can be built and tested on other
+// platforms. The layouts are the 32 bit ones thprac deals with, independent
+// of the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WINAPI
+#define NTAPI
+#define __forceinline inline __attribute__((always_inline))
+
+typedef uint8_t BYTE, UINT8, *PUINT8;
+typedef uint16_t WORD, *PWORD;
+typedef uint32_t DWORD, *PDWORD;
+typedef int32_t LONG;
+typedef int BOOL;
+typedef uintptr_t UINT_PTR;
+typedef void* LPVOID;
+typedef void* HMODULE;
+typedef char CHAR, *PCHAR;
+typedef const char* LPCSTR;
+typedef const char16_t* LPCWSTR;
+// A DWORD rather than a function pointer, since the IAT only has room for 32 bits
+typedef DWORD FARPROC;
+
+#define TRUE 1
+#define FALSE 0
+#define PAGE_READONLY 0x02
+#define PAGE_EXECUTE_READWRITE 0x40
+#define IMAGE_DOS_SIGNATURE 0x5A4D
+#define IMAGE_NT_SIGNATURE 0x00004550
+#define IMAGE_FILE_MACHINE_I386 0x014c
+#define IMAGE_FILE_MACHINE_AMD64 0x8664
+#define IMAGE_SIZEOF_SHORT_NAME 8
+#define IMAGE_NUMBEROF_DIRECTORY_ENTRIES 16
+#define IMAGE_DIRECTORY_ENTRY_EXPORT 0
+#define IMAGE_DIRECTORY_ENTRY_IMPORT 1
+#define IMAGE_DIRECTORY_ENTRY_BASERELOC 5
+#define IMAGE_REL_BASED_ABSOLUTE 0
+#define IMAGE_REL_BASED_HIGHLOW 3
+#define IMAGE_ORDINAL_FLAG32 0x80000000
+#define IMAGE_SNAP_BY_ORDINAL(o) (((o) & IMAGE_ORDINAL_FLAG32) != 0)
+#define IMAGE_ORDINAL(o) ((o) & 0xffff)
+
+typedef struct {
+    WORD e_magic;
+    WORD e_unused[29];
+    LONG e_lfanew;
+} IMAGE_DOS_HEADER, *PIMAGE_DOS_HEADER;
+
+typedef struct {
+    DWORD VirtualAddress;
+    DWORD Size;
+} IMAGE_DATA_DIRECTORY, *PIMAGE_DATA_DIRECTORY;
+
+typedef struct {
+    WORD Machine;
+    WORD NumberOfSections;
+    DWORD TimeDateStamp;
+    DWORD PointerToSymbolTable;
+    DWORD NumberOfSymbols;
+    WORD SizeOfOptionalHeader;
+    WORD Characteristics;
+} IMAGE_FILE_HEADER;
+
+typedef struct {
+    WORD Magic;
+    BYTE MajorLinkerVersion, MinorLinkerVersion;
+    DWORD SizeOfCode, SizeOfInitializedData, SizeOfUninitializedData;
+    DWORD AddressOfEntryPoint, BaseOfCode, BaseOfData, ImageBase;
+    DWORD SectionAlignment, FileAlignment;
+    WORD MajorOperatingSystemVersion, MinorOperatingSystemVersion;
+    WORD MajorImageVersion, MinorImageVersion;
+    WORD MajorSubsystemVersion, MinorSubsystemVersion;
+    DWORD Win32VersionValue, SizeOfImage, SizeOfHeaders, CheckSum;
+    WORD Subsystem, DllCharacteristics;
+    DWORD SizeOfStackReserve, SizeOfStackCommit, SizeOfHeapReserve, SizeOfHeapCommit;
+    DWORD LoaderFlags, NumberOfRvaAndSizes;
+    IMAGE_DATA_DIRECTORY DataDirectory[16];
+} IMAGE_OPTIONAL_HEADER32;
+
+typedef struct {
+    DWORD Signature;
+    IMAGE_FILE_HEADER FileHeader;
+    IMAGE_OPTIONAL_HEADER32 OptionalHeader;
+} IMAGE_NT_HEADERS, *PIMAGE_NT_HEADERS;
+
+static_assert(offsetof(IMAGE_NT_HEADERS, OptionalHeader.ImageBase) == 0x34);
+static_assert(offsetof(IMAGE_NT_HEADERS, OptionalHeader.DataDirectory) == 0x78);
+static_assert(sizeof(IMAGE_NT_HEADERS) == 0xF8);
+
+typedef struct {
+    BYTE Name[IMAGE_SIZEOF_SHORT_NAME];
+    union {
+        DWORD PhysicalAddress;
+        DWORD VirtualSize;
+    } Misc;
+    DWORD VirtualAddress;
+    DWORD SizeOfRawData;
+    DWORD PointerToRawData;
+    DWORD PointerToRelocations;
+    DWORD PointerToLinenumbers;
+    WORD NumberOfRelocations;
+    WORD NumberOfLinenumbers;
+    DWORD Characteristics;
+} IMAGE_SECTION_HEADER, *PIMAGE_SECTION_HEADER;
+
+static_assert(sizeof(IMAGE_SECTION_HEADER) == 40);
+
+typedef struct {
+    DWORD Characteristics;
+    DWORD TimeDateStamp;
+    WORD MajorVersion;
+    WORD MinorVersion;
+    DWORD Name;
+    DWORD Base;
+    DWORD NumberOfFunctions;
+    DWORD NumberOfNames;
+    DWORD AddressOfFunctions;
+    DWORD AddressOfNames;
+    DWORD AddressOfNameOrdinals;
+} IMAGE_EXPORT_DIRECTORY;
+
+typedef struct {
+    DWORD VirtualAddress;
+    DWORD SizeOfBlock;
+} IMAGE_BASE_RELOCATION, *PIMAGE_BASE_RELOCATION;
+
+typedef struct {
+    DWORD OriginalFirstThunk;
+    DWORD TimeDateStamp;
+    DWORD ForwarderChain;
+    DWORD Name;
+    DWORD FirstThunk;
+} IMAGE_IMPORT_DESCRIPTOR, *PIMAGE_IMPORT_DESCRIPTOR;
+
+typedef struct {
+    union {
+        DWORD ForwarderString;
+        DWORD Function;
+        DWORD Ordinal;
+        DWORD AddressOfData;
+    } u1;
+} IMAGE_THUNK_DATA, *PIMAGE_THUNK_DATA;
+
+typedef struct {
+    WORD Hint;
+    CHAR Name[1];
+} IMAGE_IMPORT_BY_NAME, *PIMAGE_IMPORT_BY_NAME;
+
+// Only declared, for decltype()
+HMODULE WINAPI LoadLibraryA(LPCSTR lpLibFileName);
+BOOL WINAPI VirtualProtect(LPVOID lpAddress, size_t dwSize, DWORD flNewProtect, PDWORD lpflOldProtect);
+FARPROC WINAPI GetProcAddress(HMODULE hModule, LPCSTR lpProcName);
@@ -0,0 +1,462 @@
+// Fuzzes utils/pe_view.h with malformed images: truncated, with e_lfanew out
+// of range, with section tables that overlap the headers or run off the end,
+// and with random bytes flipped. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined -Iwin32 pe_view_test.cpp -o pe_view_test
+//   ./pe_view_test [iterations]
+//
+// Every image is copied into an allocation of exactly its size, so ASan
+// catches a read of even one byte past the end. Every accessor is called on
+// it and every byte it hands out is read.
+
+#include "../src/thprac/utils/pe_view.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+/// Image
+/// ------------------
+// A small but complete 32 bit image. Headers in the first 0x200 bytes, then
+// .text with the entry point, .rdata with an export directory and .data,
+// followed by an overlay.
+constexpr size_t LFANEW = 0x80;
+constexpr size_t SECTIONS_OFFSET = LFANEW + sizeof(IMAGE_NT_HEADERS);
+constexpr size_t SECTION_COUNT = 3;
+constexpr size_t FILE_ALIGN = 0x200;
+constexpr DWORD TEXT_RVA = 0x1000, RDATA_RVA = 0x2000, DATA_RVA = 0x3000;
+constexpr size_t TEXT_OFFSET = 0x200, RDATA_OFFSET = 0x400, DATA_OFFSET = 0x600;
+constexpr size_t OVERLAY_OFFSET = 0x800, OVERLAY_SIZE = 0x37;
+constexpr DWORD ENTRY_RVA = TEXT_RVA + 0x10;
+constexpr uint8_t ENTRY_CODE[] = { 0x55, 0x8B, 0xEC, 0x6A, 0xFF, 0x68 };
+constexpr const char* EXPORT_NAMES[] = { "thprac_init", "thprac_version", "z" };
+
+template <typename T>
+static T* Put(std::vector<uint8_t>& image, size_t offset)
+{
+    return (T*)&image[offset];
+}
+
+static std::vector<uint8_t> BuildImage()
+{
+    std::vector<uint8_t> image(OVERLAY_OFFSET + OVERLAY_SIZE);
+    auto dos = Put<IMAGE_DOS_HEADER>(image, 0);
+    dos->e_magic = IMAGE_DOS_SIGNATURE;
+    dos->e_lfanew = LFANEW;
+
+    auto nt = Put<IMAGE_NT_HEADERS>(image, LFANEW);
+    nt->Signature = IMAGE_NT_SIGNATURE;
+    nt->FileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+    nt->FileHeader.NumberOfSections = SECTION_COUNT;
+    nt->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER32);
+    nt->OptionalHeader.Magic = 0x10B;
+    nt->OptionalHeader.AddressOfEntryPoint = ENTRY_RVA;
+    nt->OptionalHeader.ImageBase = 0x400000;
+    nt->OptionalHeader.SectionAlignment = 0x1000;
+    nt->OptionalHeader.FileAlignment = FILE_ALIGN;
+    nt->OptionalHeader.SizeOfHeaders = FILE_ALIGN;
+    nt->OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+
+    const struct {
+        const char* name;
+        DWORD rva;
+        size_t offset;
+    } sections[SECTION_COUNT] = {
+        { ".text", TEXT_RVA, TEXT_OFFSET },
+        { ".rdata", RDATA_RVA, RDATA_OFFSET },
+        { ".data", DATA_RVA, DATA_OFFSET },
+    };
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        auto section = Put<IMAGE_SECTION_HEADER>(image, SECTIONS_OFFSET + i * sizeof(IMAGE_SECTION_HEADER));
+        strncpy((char*)section->Name, sections[i].name, IMAGE_SIZEOF_SHORT_NAME);
+        section->Misc.VirtualSize = FILE_ALIGN;
+        section->VirtualAddress = sections[i].rva;
+        section->SizeOfRawData = FILE_ALIGN;
+        section->PointerToRawData = (DWORD)sections[i].offset;
+    }
+    memcpy(&image[TEXT_OFFSET + (ENTRY_RVA - TEXT_RVA)], ENTRY_CODE, sizeof(ENTRY_CODE));
+
+    // Export directory, then the name table, then the names
+    auto exports = Put<IMAGE_EXPORT_DIRECTORY>(image, RDATA_OFFSET);
+    size_t namesOffset = RDATA_OFFSET + sizeof(IMAGE_EXPORT_DIRECTORY);
+    size_t stringOffset = namesOffset + std::size(EXPORT_NAMES) * sizeof(DWORD);
+    exports->NumberOfNames = std::size(EXPORT_NAMES);
+    exports->AddressOfNames = (DWORD)(RDATA_RVA + (namesOffset - RDATA_OFFSET));
+    for (size_t i = 0; i < std::size(EXPORT_NAMES); i++) {
+        Put<DWORD>(image, namesOffset)[i] = (DWORD)(RDATA_RVA + (stringOffset - RDATA_OFFSET));
+        strcpy((char*)&image[stringOffset], EXPORT_NAMES[i]);
+        stringOffset += strlen(EXPORT_NAMES[i]) + 1;
+    }
+    nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] = { RDATA_RVA, (DWORD)(stringOffset - RDATA_OFFSET) };
+
+    for (size_t i = 0; i < OVERLAY_SIZE; i++)
+        image[OVERLAY_OFFSET + i] = (uint8_t)(0xA0 + i);
+    return image;
+}
+
+// Keeps a copy in an allocation of exactly its size, so anything read past
+// the end lands in ASan's redzone
+class ExactCopy {
+    std::unique_ptr<uint8_t[]> mData;
+    size_t mSize;
+
+public:
+    ExactCopy(const uint8_t* data, size_t size)
+        : mData(size ? new uint8_t[size] : nullptr)
+        , mSize(size)
+    {
+        if (size)
+            memcpy(mData.get(), data, size);
+    }
+    const uint8_t* data() const { return mData.get(); }
+    size_t size() const { return mSize; }
+};
+/// ------------------
+
+/// Accessors
+/// ------------------
+static bool Inside(const PeView& view, const void* p, size_t len)
+{
+    auto begin = view.data();
+    auto q = (const uint8_t*)p;
+    return len == 0 || (begin && q >= begin && len <= view.size() && (size_t)(q - begin) <= view.size() - len);
+}
+
+static bool Inside(const PeView& view, std::span<const uint8_t> span)
+{
+    return Inside(view, span.data(), span.size());
+}
+
+// Reads every byte of a span, so ASan sees it
+static unsigned Touch(std::span<const uint8_t> span)
+{
+    unsigned sum = 0;
+    for (auto b : span)
+        sum += b;
+    return sum;
+}
+
+struct Seen {
+    size_t sections = 0;
+    size_t exports = 0;
+    bool hasInit = false;
+    size_t entryBytes = 0;
+    size_t overlay = 0;
+    unsigned sum = 0;
+};
+
+// Calls every accessor, checks that whatever it returns lies inside the
+// view, and reads it
+static Seen Exercise(const PeView& view, std::mt19937& rng)
+{
+    Seen seen;
+
+    auto dos = view.dos();
+    auto nt = view.nt();
+    CHECK(!dos == !view.valid());
+    CHECK(!nt == !view.valid());
+    if (nt) {
+        CHECK(Inside(view, dos, sizeof(*dos)));
+        CHECK(Inside(view, nt, sizeof(*nt)));
+        seen.sum += dos->e_magic + nt->FileHeader.Machine + nt->OptionalHeader.AddressOfEntryPoint;
+    }
+
+    auto sections = view.sections();
+    CHECK(Inside(view, sections.data(), sections.size_bytes()));
+    CHECK(nt || sections.empty());
+    seen.sections = sections.size();
+    for (auto& section : sections) {
+        seen.sum += section.VirtualAddress + section.SizeOfRawData + section.PointerToRawData;
+        PeView::SectionNameIs(section, ".text");
+        PeView::SectionNameIs(section, "12345678");
+        PeView::SectionNameIs(section, "123456789");
+    }
+    for (auto name : { ".text", ".rdata", ".data", ".reloc", "" }) {
+        auto section = view.FindSection(name);
+        CHECK(!section || (section >= sections.data() && section < sections.data() + sections.size()));
+    }
+
+    for (size_t i = 0; i <= IMAGE_NUMBEROF_DIRECTORY_ENTRIES; i++) {
+        auto dir = view.Directory(i);
+        CHECK(!dir || (nt && i < IMAGE_NUMBEROF_DIRECTORY_ENTRIES && Inside(view, dir, sizeof(*dir))));
+        if (dir)
+            seen.sum += view.RvaToOffset(dir->VirtualAddress) != SIZE_MAX;
+    }
+    const DWORD rvas[] = { 0, TEXT_RVA, ENTRY_RVA, DATA_RVA + FILE_ALIGN - 1, DATA_RVA + FILE_ALIGN, 0xFFFFFFFF, (DWORD)rng() };
+    for (auto rva : rvas) {
+        size_t offset = view.RvaToOffset(rva);
+        // Backed by a section header, not necessarily by the file
+        CHECK(offset == SIZE_MAX || nt);
+        seen.sum += Touch(view.Bytes(offset == SIZE_MAX ? 0 : offset, 4));
+    }
+
+    for (size_t len : { (size_t)0, (size_t)1, sizeof(ENTRY_CODE), (size_t)4096 }) {
+        auto entry = view.EntryPointBytes(len);
+        CHECK(Inside(view, entry));
+        CHECK(entry.empty() || entry.size() == len);
+        seen.sum += Touch(entry);
+        if (len == sizeof(ENTRY_CODE))
+            seen.entryBytes = entry.size() == len && !memcmp(entry.data(), ENTRY_CODE, len) ? len : 0;
+    }
+
+    view.ForEachExport([&](std::string_view name) {
+        CHECK(Inside(view, name.data(), name.size()));
+        for (char c : name)
+            seen.sum += (uint8_t)c;
+        seen.exports++;
+        return false;
+    });
+    seen.hasInit = view.HasExport("thprac_init");
+    view.HasExport("");
+
+    auto overlay = view.Overlay();
+    CHECK(Inside(view, overlay));
+    seen.overlay = overlay.size();
+    seen.sum += Touch(overlay);
+
+    // Raw accessors at the edges and at random spots
+    size_t size = view.size();
+    const size_t offsets[] = { 0, 1, size / 2, size ? size - 1 : 0, size, size + 1, SIZE_MAX - 1, SIZE_MAX, rng() % (size + 16) };
+    for (size_t offset : offsets) {
+        for (size_t len : { (size_t)0, (size_t)1, (size_t)8, size, SIZE_MAX / 2, SIZE_MAX }) {
+            auto bytes = view.Bytes(offset, len);
+            CHECK(Inside(view, bytes));
+            CHECK(bytes.empty() || bytes.size() == len);
+            seen.sum += Touch(bytes);
+        }
+        auto str = view.String(offset);
+        CHECK(Inside(view, str.data(), str.size()));
+        seen.sum += (unsigned)str.size();
+        auto word = view.At<WORD>(offset);
+        CHECK(!word || Inside(view, word, sizeof(WORD)));
+        auto headers = view.At<IMAGE_SECTION_HEADER>(offset, 2);
+        CHECK(!headers || Inside(view, headers, 2 * sizeof(IMAGE_SECTION_HEADER)));
+        CHECK(!view.At<DWORD>(offset, SIZE_MAX / 2));
+    }
+    return seen;
+}
+
+static Seen Exercise(const std::vector<uint8_t>& image, size_t size, std::mt19937& rng)
+{
+    ExactCopy copy(image.data(), size);
+    PeView view(copy.data(), copy.size());
+    return Exercise(view, rng);
+}
+/// ------------------
+
+/// Tests
+/// ------------------
+static void TestIntact()
+{
+    std::mt19937 rng(0);
+    auto image = BuildImage();
+    ExactCopy copy(image.data(), image.size());
+    PeView view(copy.data(), copy.size());
+    CHECK(view.valid());
+    CHECK(view.sections().size() == SECTION_COUNT);
+    CHECK(view.FindSection(".rdata") == &view.sections()[1]);
+    CHECK(!view.FindSection(".rdat"));
+    CHECK(view.RvaToOffset(ENTRY_RVA) == TEXT_OFFSET + (ENTRY_RVA - TEXT_RVA));
+    CHECK(view.RvaToOffset(DATA_RVA + FILE_ALIGN) == SIZE_MAX);
+    CHECK(view.HasExport("thprac_version"));
+    CHECK(!view.HasExport("thprac"));
+    CHECK(view.String(OVERLAY_OFFSET).empty());
+
+    Seen seen = Exercise(view, rng);
+    CHECK(seen.sections == SECTION_COUNT);
+    CHECK(seen.exports == std::size(EXPORT_NAMES));
+    CHECK(seen.hasInit);
+    CHECK(seen.entryBytes == sizeof(ENTRY_CODE));
+    CHECK(seen.overlay == OVERLAY_SIZE);
+    CHECK(Touch(view.Overlay()) == Touch(std::span<const uint8_t>(&image[OVERLAY_OFFSET], OVERLAY_SIZE)));
+
+    PeView empty(nullptr, 1234);
+    CHECK(!empty.valid() && empty.size() == 0);
+    Exercise(empty, rng);
+}
+
+// Cut at every length. Headers need their whole structure, sections that are
+// cut off are left out, and exports and the entry point disappear with the
+// bytes behind them.
+static void TestTruncated()
+{
+    std::mt19937 rng(1);
+    auto image = BuildImage();
+    for (size_t size = 0; size <= image.size(); size++) {
+        Seen seen = Exercise(image, size, rng);
+        ExactCopy copy(image.data(), size);
+        PeView view(copy.data(), copy.size());
+        bool hasHeaders = size >= LFANEW + sizeof(IMAGE_NT_HEADERS);
+        CHECK(view.valid() == hasHeaders);
+        if (hasHeaders) {
+            size_t fit = size > SECTIONS_OFFSET ? (size - SECTIONS_OFFSET) / sizeof(IMAGE_SECTION_HEADER) : 0;
+            CHECK(seen.sections == std::min(fit, SECTION_COUNT));
+        }
+        if (size < OVERLAY_OFFSET)
+            CHECK(seen.overlay == 0);
+        if (size < RDATA_OFFSET + sizeof(IMAGE_EXPORT_DIRECTORY))
+            CHECK(seen.exports == 0);
+        CHECK(seen.entryBytes == (size >= TEXT_OFFSET + (ENTRY_RVA - TEXT_RVA) + sizeof(ENTRY_CODE) ? sizeof(ENTRY_CODE) : 0));
+    }
+}
+
+static void TestLfanew()
+{
+    std::mt19937 rng(2);
+    auto image = BuildImage();
+    const LONG values[] = {
+        -1, INT_MIN, INT_MAX, 0, 2, 0x3C, (LONG)image.size() - (LONG)sizeof(IMAGE_NT_HEADERS) + 4,
+        (LONG)image.size() - 4, (LONG)image.size() - 1, (LONG)image.size(), (LONG)image.size() + 0x100,
+    };
+    for (LONG lfanew : values) {
+        auto bad = image;
+        Put<IMAGE_DOS_HEADER>(bad, 0)->e_lfanew = lfanew;
+        Seen seen = Exercise(bad, bad.size(), rng);
+        // None of them point at a PE signature
+        CHECK(seen.sections == 0);
+        ExactCopy copy(bad.data(), bad.size());
+        CHECK(!PeView(copy.data(), copy.size()).valid());
+    }
+    // The headers right at the end of the file, with nothing after them
+    auto tail = image;
+    tail.resize(LFANEW + sizeof(IMAGE_NT_HEADERS));
+    Seen seen = Exercise(tail, tail.size(), rng);
+    CHECK(seen.sections == 0);
+}
+
+// Section tables whose size or position doesn't add up, and sections whose
+// raw data overlaps the headers, each other, or wraps around
+static void TestSectionTables()
+{
+    std::mt19937 rng(3);
+    auto image = BuildImage();
+    auto mutate = [&](auto&& func) {
+        auto bad = image;
+        func(*Put<IMAGE_NT_HEADERS>(bad, LFANEW), Put<IMAGE_SECTION_HEADER>(bad, SECTIONS_OFFSET));
+        return Exercise(bad, bad.size(), rng);
+    };
+
+    Seen seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.FileHeader.NumberOfSections = 0xFFFF; });
+    CHECK(seen.sections == (image.size() - SECTIONS_OFFSET) / sizeof(IMAGE_SECTION_HEADER));
+    seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.FileHeader.NumberOfSections = 0; });
+    CHECK(seen.sections == 0 && seen.exports == 0 && seen.overlay == 0);
+    // Table past the end of the file
+    seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.FileHeader.SizeOfOptionalHeader = 0xFFFF; });
+    CHECK(seen.sections == 0);
+    // Table overlapping the optional header. One that isn't 4 byte aligned
+    // isn't there at all.
+    for (size_t optional : { (size_t)0, (size_t)1, (size_t)2, (size_t)0x40, sizeof(IMAGE_OPTIONAL_HEADER32) - 1 }) {
+        seen = mutate([&](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.FileHeader.SizeOfOptionalHeader = (WORD)optional; });
+        CHECK(seen.sections == (optional % 4 ? 0 : SECTION_COUNT));
+    }
+    seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) {
+        nt.FileHeader.SizeOfOptionalHeader = 0;
+        nt.FileHeader.NumberOfSections = 0xFFFF;
+    });
+    CHECK(seen.sections == (image.size() - (LFANEW + offsetof(IMAGE_NT_HEADERS, OptionalHeader))) / sizeof(IMAGE_SECTION_HEADER));
+
+    // Raw data that runs off the end, wraps around, or overlaps
+    for (DWORD pointer : { 0u, 0x7FFu, 0x836u, 0x837u, 0xFFFFFFFFu, 0x80000000u }) {
+        for (DWORD rawSize : { 0u, 1u, 0x200u, 0xFFFFFFFFu, 0x80000001u }) {
+            for (size_t i = 0; i < SECTION_COUNT; i++) {
+                mutate([&](IMAGE_NT_HEADERS&, IMAGE_SECTION_HEADER* sections) {
+                    sections[i].PointerToRawData = pointer;
+                    sections[i].SizeOfRawData = rawSize;
+                });
+            }
+        }
+    }
+    // Every section mapped onto the same bytes, and onto the headers
+    mutate([](IMAGE_NT_HEADERS&, IMAGE_SECTION_HEADER* sections) {
+        for (size_t i = 0; i < SECTION_COUNT; i++) {
+            sections[i].VirtualAddress = TEXT_RVA;
+            sections[i].PointerToRawData = 0;
+        }
+    });
+    // Entry point and export directory at the very end of a section
+    seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.OptionalHeader.AddressOfEntryPoint = DATA_RVA + FILE_ALIGN - 2; });
+    CHECK(seen.entryBytes == 0);
+    mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) {
+        nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress = DATA_RVA + FILE_ALIGN - 4;
+    });
+    mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.OptionalHeader.NumberOfRvaAndSizes = 0xFFFFFFFF; });
+    seen = mutate([](IMAGE_NT_HEADERS& nt, IMAGE_SECTION_HEADER*) { nt.OptionalHeader.NumberOfRvaAndSizes = 0; });
+    CHECK(seen.exports == 0);
+
+    // Export names that are too many, or point off the end
+    auto exportMutate = [&](auto&& func) {
+        auto bad = image;
+        func(*Put<IMAGE_EXPORT_DIRECTORY>(bad, RDATA_OFFSET), Put<DWORD>(bad, RDATA_OFFSET + sizeof(IMAGE_EXPORT_DIRECTORY)));
+        return Exercise(bad, bad.size(), rng);
+    };
+    seen = exportMutate([](IMAGE_EXPORT_DIRECTORY& exports, DWORD*) { exports.NumberOfNames = 0xFFFFFFFF; });
+    CHECK(seen.exports == 0);
+    // The last DWORD of .rdata holds an RVA of 0, which no section backs
+    seen = exportMutate([](IMAGE_EXPORT_DIRECTORY& exports, DWORD*) { exports.AddressOfNames = RDATA_RVA + FILE_ALIGN - 4; exports.NumberOfNames = 1; });
+    CHECK(seen.exports == 0);
+    seen = exportMutate([](IMAGE_EXPORT_DIRECTORY& exports, DWORD*) { exports.AddressOfNames = RDATA_RVA + FILE_ALIGN - 4; exports.NumberOfNames = 2; });
+    CHECK(seen.exports == 0);
+    seen = exportMutate([](IMAGE_EXPORT_DIRECTORY& exports, DWORD*) { exports.AddressOfNames++; });
+    CHECK(seen.exports == 0);
+    // A name at the last byte of the file, with no NUL after it
+    seen = exportMutate([](IMAGE_EXPORT_DIRECTORY&, DWORD* names) { names[0] = DATA_RVA + FILE_ALIGN - 1; names[1] = 0xFFFFFFFF; });
+    CHECK(seen.exports == 2);
+}
+
+// Random bytes flipped, mostly in the headers and the export data, with the
+// file cut short now and then
+static void TestFlips(unsigned iterations)
+{
+    std::mt19937 rng(4);
+    auto image = BuildImage();
+    for (unsigned i = 0; i < iterations; i++) {
+        auto bad = image;
+        unsigned flips = 1 + rng() % 8;
+        for (unsigned j = 0; j < flips; j++) {
+            size_t region = rng() % 4;
+            size_t offset = region == 0 ? rng() % bad.size()
+                : region == 1           ? RDATA_OFFSET + rng() % 0x60
+                                        : rng() % (SECTIONS_OFFSET + SECTION_COUNT * sizeof(IMAGE_SECTION_HEADER));
+            bad[offset] ^= (uint8_t)(1 << (rng() % 8));
+            if (rng() % 4 == 0)
+                bad[offset] = (uint8_t)rng();
+        }
+        size_t size = rng() % 8 ? bad.size() : rng() % (bad.size() + 1);
+        Exercise(bad, size, rng);
+    }
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    unsigned iterations = argc > 1 ? (unsigned)atoi(argv[1]) : 20000;
+
+    TestIntact();
+    TestTruncated();
+    TestLfanew();
+    TestSectionTables();
+    TestFlips(iterations);
+
+    if (gFailures) {
+        fprintf(stderr, "pe_view_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("pe_view_test: all passed, %u flipped images\n", iterations);
+    return 0;
+}
@@ -0,0 +1,396 @@
+// Checks the replay cipher and LZSS codec in thprac_replay.cpp. Builds and
+// runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined replay_codec_test.cpp ../src/thprac/thprac_replay.cpp -o replay_codec_test
+//   ./replay_codec_test
+//
+// There's no real replay in the tree to take vectors from, so the known
+// answers are a few worked out by hand from the format, and a second
+// implementation of the cipher and the decoder below, written pointer by
+// pointer the way threp does it, which the codec is compared against on
+// random data. Everything TH18 specific uses its two cipher layers.
+
+#include "../src/thprac/thprac_replay.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+// In the order SaveReplay encrypts with them, LoadReplay decrypts backwards
+static const ReplayCipherLayer TH18_LAYERS[] = { { 0x5c, 0xe1, 0x400 }, { 0x7d, 0x3a, 0x100 } };
+
+static std::vector<uint8_t> RandomBytes(std::mt19937& rng, size_t size)
+{
+    std::vector<uint8_t> ret(size);
+    for (auto& b : ret)
+        b = (uint8_t)rng();
+    return ret;
+}
+
+/// Reference
+/// ------------------
+static void ThrepCipher(uint8_t* buf, int length, int block, uint8_t base, uint8_t add, bool encrypt)
+{
+    std::vector<uint8_t> tbuf(buf, buf + length);
+    int left = length;
+    if (left % block < block / 4)
+        left -= left % block;
+    left -= length & 1;
+    int p = 0;
+    while (left > 0) {
+        if (left < block)
+            block = left;
+        int tp1 = p + block - 1;
+        int tp2 = p + block - 2;
+        int hf = (block + (block & 1)) / 2;
+        for (int i = 0; i < hf; i++, p++, tp1 -= 2) {
+            if (encrypt)
+                buf[p] = tbuf[tp1] ^ base;
+            else
+                buf[tp1] = tbuf[p] ^ base;
+            base += add;
+        }
+        hf = block / 2;
+        for (int i = 0; i < hf; i++, p++, tp2 -= 2) {
+            if (encrypt)
+                buf[p] = tbuf[tp2] ^ base;
+            else
+                buf[tp2] = tbuf[p] ^ base;
+            base += add;
+        }
+        left -= block;
+    }
+}
+
+static std::vector<uint8_t> ThrepUnlzss(const std::vector<uint8_t>& in, size_t out_size)
+{
+    std::vector<uint8_t> out;
+    uint8_t dict[0x2000] = {};
+    size_t dictPos = 1;
+    size_t bytePos = 0;
+    int bitMask = 0x80;
+    auto bit = [&]() -> int {
+        if (bytePos >= in.size())
+            return -1;
+        int ret = (in[bytePos] & bitMask) ? 1 : 0;
+        bitMask >>= 1;
+        if (!bitMask) {
+            bitMask = 0x80;
+            bytePos++;
+        }
+        return ret;
+    };
+    auto bits = [&](int n) -> int {
+        int ret = 0;
+        while (n--) {
+            int b = bit();
+            if (b < 0)
+                return -1;
+            ret = ret << 1 | b;
+        }
+        return ret;
+    };
+    while (out.size() < out_size) {
+        int flag = bit();
+        if (flag < 0)
+            break;
+        if (flag) {
+            int c = bits(8);
+            if (c < 0)
+                break;
+            out.push_back((uint8_t)c);
+            dict[dictPos] = (uint8_t)c;
+            dictPos = (dictPos + 1) % 0x2000;
+        } else {
+            int offset = bits(13);
+            if (offset <= 0)
+                break;
+            int len = bits(4);
+            if (len < 0)
+                break;
+            for (int i = 0; i < len + 3 && out.size() < out_size; i++) {
+                uint8_t c = dict[(offset + i) % 0x2000];
+                out.push_back(c);
+                dict[dictPos] = c;
+                dictPos = (dictPos + 1) % 0x2000;
+            }
+        }
+    }
+    return out;
+}
+/// ------------------
+
+/// Cipher
+/// ------------------
+static void TestCipherKnown()
+{
+    // One 4 byte block: the odd bytes from the end, then the even ones
+    uint8_t data[4] = { 0, 1, 2, 3 };
+    ReplayDecrypt(data, 4, 0x7d, 0x3a, 4, 4);
+    const uint8_t decrypted[4] = { 3 ^ 0x2b, 1 ^ 0xb7, 2 ^ 0xf1, 0 ^ 0x7d };
+    CHECK(!memcmp(data, decrypted, 4));
+    ReplayEncrypt(data, 4, 0x7d, 0x3a, 4, 4);
+    CHECK(data[0] == 0 && data[1] == 1 && data[2] == 2 && data[3] == 3);
+
+    // Shorter than a quarter of TH18's smaller block, so nothing is touched
+    uint8_t small[0x3f];
+    for (size_t i = 0; i < sizeof(small); i++)
+        small[i] = (uint8_t)i;
+    for (const auto& l : TH18_LAYERS)
+        ReplayDecrypt(small, sizeof(small), l.key, l.step, l.block, sizeof(small));
+    for (size_t i = 0; i < sizeof(small); i++)
+        CHECK(small[i] == i);
+
+    // The last byte of an odd sized buffer is left as is
+    std::vector<uint8_t> odd(0x401, 0xAA);
+    ReplayDecrypt(odd.data(), odd.size(), 0x5c, 0xe1, 0x400, odd.size());
+    CHECK(odd[0x400] == 0xAA);
+}
+
+static void TestCipherMatchesReference()
+{
+    std::mt19937 rng(10);
+    const uint32_t blocks[] = { 1, 2, 3, 4, 7, 0x100, 0x400, 0x1000 };
+    for (int round = 0; round < 3000; round++) {
+        size_t size = rng() % (round % 8 ? 0x900 : 0x4000);
+        uint32_t block = blocks[rng() % std::size(blocks)];
+        uint8_t key = (uint8_t)rng(), step = (uint8_t)rng();
+        std::vector<uint8_t> plain = RandomBytes(rng, size);
+
+        std::vector<uint8_t> got = plain, expected = plain;
+        ReplayEncrypt(got.data(), size, key, step, block, size);
+        ThrepCipher(expected.data(), (int)size, (int)block, key, step, true);
+        CHECK(got == expected);
+
+        ReplayDecrypt(got.data(), size, key, step, block, size);
+        CHECK(got == plain);
+
+        got = expected = plain;
+        ReplayDecrypt(got.data(), size, key, step, block, size);
+        ThrepCipher(expected.data(), (int)size, (int)block, key, step, false);
+        CHECK(got == expected);
+        if (gFailures) {
+            fprintf(stderr, "%zu bytes, block %u\n", size, block);
+            return;
+        }
+    }
+}
+
+// limit is the size the games pass, which can be less than the buffer
+static void TestCipherLimit()
+{
+    std::mt19937 rng(100);
+    for (int round = 0; round < 500; round++) {
+        size_t size = rng() % 0x1000;
+        size_t limit = rng() % (size + 1);
+        std::vector<uint8_t> plain = RandomBytes(rng, size);
+        std::vector<uint8_t> got = plain, expected = plain;
+        ReplayEncrypt(got.data(), size, 0x5c, 0xe1, 0x400, limit);
+        ThrepCipher(expected.data(), (int)limit, 0x400, 0x5c, 0xe1, true);
+        CHECK(got == expected);
+        ReplayDecrypt(got.data(), size, 0x5c, 0xe1, 0x400, limit);
+        CHECK(got == plain);
+    }
+}
+/// ------------------
+
+/// LZSS
+/// ------------------
+static void TestUnlzssKnown()
+{
+    // 'a', 'b', then 3 bytes from dictionary slot 1, which overlaps what
+    // it's writing, then the end marker
+    const uint8_t stream[] = { 0xb0, 0xd8, 0x80, 0x01, 0x00, 0x00, 0x00 };
+    uint8_t out[16] = {};
+    CHECK(ReplayUnlzss(stream, sizeof(stream), out, sizeof(out)) == 5);
+    CHECK(!memcmp(out, "ababa", 5));
+    // Stops at out_size
+    memset(out, 0, sizeof(out));
+    CHECK(ReplayUnlzss(stream, sizeof(stream), out, 4) == 4);
+    CHECK(!memcmp(out, "abab\0", 5));
+    // And at the end of the input
+    CHECK(ReplayUnlzss(stream, 2, out, sizeof(out)) == 1);
+    CHECK(ReplayUnlzss(stream, 0, out, sizeof(out)) == 0);
+
+    // The end marker on its own
+    const uint8_t empty[] = { 0x00, 0x00, 0x00 };
+    CHECK(ReplayUnlzss(empty, sizeof(empty), out, sizeof(out)) == 0);
+    CHECK(ReplayLzss(nullptr, 0) == std::vector<uint8_t>(empty, empty + 2));
+}
+
+static std::vector<std::pair<std::string, std::vector<uint8_t>>> LzssInputs(std::mt19937& rng)
+{
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> ret;
+    ret.push_back({ "empty", {} });
+    ret.push_back({ "one byte", { 0x42 } });
+    ret.push_back({ "zeros", std::vector<uint8_t>(100000) });
+    ret.push_back({ "random", RandomBytes(rng, 50000) });
+    // Repeats with a period around the dictionary size, so that matches
+    // sit right at the longest distance the encoder allows
+    for (size_t period : { 1, 2, 3, 17, 18, 19, 0x1000, 0x1fed, 0x1fee, 0x1fef, 0x2000, 0x2001 }) {
+        std::vector<uint8_t> unit = RandomBytes(rng, period);
+        std::vector<uint8_t> data;
+        while (data.size() < 3 * period + 1000)
+            data.insert(data.end(), unit.begin(), unit.end());
+        ret.push_back({ "period " + std::to_string(period), data });
+    }
+    // Something like replay frames: mostly the same, a few bytes differ
+    std::vector<uint8_t> frames;
+    uint8_t frame[12] = {};
+    for (int i = 0; i < 20000; i++) {
+        if (rng() % 8 == 0)
+            frame[rng() % sizeof(frame)] = (uint8_t)rng();
+        frames.insert(frames.end(), frame, frame + sizeof(frame));
+    }
+    ret.push_back({ "frames", frames });
+    return ret;
+}
+
+static void TestLzssRoundTrip()
+{
+    std::mt19937 rng(1010);
+    for (auto& [name, data] : LzssInputs(rng)) {
+        std::vector<uint8_t> packed = ReplayLzss(data.data(), data.size());
+        std::vector<uint8_t> out(data.size() + 64, 0xCC);
+        size_t n = ReplayUnlzss(packed.data(), packed.size(), out.data(), out.size());
+        bool ok = n == data.size() && std::equal(data.begin(), data.end(), out.begin());
+        // What the game's decoder would make of it
+        ok &= ThrepUnlzss(packed, data.size() + 64) == data;
+        if (!ok)
+            fprintf(stderr, "%s: %zu bytes back out of %zu\n", name.c_str(), n, data.size());
+        CHECK(ok);
+        // Worst case is 9 bits per byte, plus the end marker
+        CHECK(packed.size() <= data.size() * 9 / 8 + 3);
+        if (name == "zeros" || name == "frames" || name == "period 17")
+            CHECK(packed.size() < data.size() / 4);
+    }
+}
+
+static void TestUnlzssMatchesReference()
+{
+    // Any bit stream at all, decoded the same by both
+    std::mt19937 rng(10100);
+    for (int round = 0; round < 2000; round++) {
+        std::vector<uint8_t> in = RandomBytes(rng, rng() % 2000);
+        size_t out_size = rng() % 4000;
+        std::vector<uint8_t> out(out_size);
+        size_t n = ReplayUnlzss(in.data(), in.size(), out.data(), out_size);
+        out.resize(n);
+        CHECK(out == ThrepUnlzss(in, out_size));
+    }
+}
+/// ------------------
+
+/// Streaming decode
+/// ------------------
+// What SaveReplay writes
+static std::vector<uint8_t> EncodeTh18(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> ret = ReplayLzss(data.data(), data.size());
+    for (size_t i = std::size(TH18_LAYERS); i-- > 0;) {
+        const auto& l = TH18_LAYERS[i];
+        ReplayEncrypt(ret.data(), ret.size(), l.key, l.step, l.block, ret.size());
+    }
+    return ret;
+}
+
+static void TestDecodeStream()
+{
+    std::mt19937 rng(18);
+    for (auto& [name, data] : LzssInputs(rng)) {
+        std::vector<uint8_t> encoded = EncodeTh18(data);
+
+        // The old way, decrypting a copy and then decompressing it
+        std::vector<uint8_t> copy = encoded;
+        for (const auto& l : TH18_LAYERS)
+            ThrepCipher(copy.data(), (int)copy.size(), (int)l.block, l.key, l.step, false);
+        CHECK(ThrepUnlzss(copy, data.size()) == data);
+
+        std::vector<uint8_t> out(data.size());
+        bool ok = ReplayDecodeStream(encoded.data(), encoded.size(), TH18_LAYERS, std::size(TH18_LAYERS), out.data(), out.size());
+        if (!ok || out != data)
+            fprintf(stderr, "%s\n", name.c_str());
+        CHECK(ok);
+        CHECK(out == data);
+
+        // Asking for more than there is
+        out.resize(data.size() + 1);
+        CHECK(!ReplayDecodeStream(encoded.data(), encoded.size(), TH18_LAYERS, std::size(TH18_LAYERS), out.data(), out.size()));
+        // Or from a truncated file
+        if (data.size() > 100)
+            CHECK(!ReplayDecodeStream(encoded.data(), encoded.size() / 2, TH18_LAYERS, std::size(TH18_LAYERS), out.data(), data.size()));
+    }
+}
+
+// Any layers the stream supports, against decrypting the whole buffer first
+static void TestDecodeStreamLayers()
+{
+    std::mt19937 rng(180);
+    const uint32_t blocks[] = { 1, 2, 4, 0x80, 0x100, 0x400, 0x1000 };
+    for (int round = 0; round < 300; round++) {
+        std::vector<ReplayCipherLayer> layers(rng() % 5);
+        for (auto& l : layers)
+            l = { (uint8_t)rng(), (uint8_t)rng(), blocks[rng() % std::size(blocks)] };
+        std::vector<uint8_t> data = RandomBytes(rng, rng() % 0x3000);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] &= rng() % 4 ? 0x03 : 0xFF;
+        std::vector<uint8_t> encoded = ReplayLzss(data.data(), data.size());
+        for (size_t i = layers.size(); i-- > 0;)
+            ReplayEncrypt(encoded.data(), encoded.size(), layers[i].key, layers[i].step, layers[i].block, encoded.size());
+
+        std::vector<uint8_t> out(data.size());
+        CHECK(ReplayDecodeStream(encoded.data(), encoded.size(), layers.data(), layers.size(), out.data(), out.size()));
+        CHECK(out == data);
+    }
+}
+
+static void TestDecodeStreamRejects()
+{
+    std::vector<uint8_t> data(1000, 7);
+    std::vector<uint8_t> encoded = ReplayLzss(data.data(), data.size());
+    std::vector<uint8_t> out(data.size());
+    auto decode = [&](std::vector<ReplayCipherLayer> layers) {
+        return ReplayDecodeStream(encoded.data(), encoded.size(), layers.data(), layers.size(), out.data(), out.size());
+    };
+    CHECK(decode({}));
+    CHECK(!decode({ { 1, 1, 0 } }));
+    CHECK(!decode({ { 1, 1, REPLAY_CIPHER_MAX_BLOCK + 1 } }));
+    // Blocks would straddle chunks
+    CHECK(!decode({ { 1, 1, 0x300 }, { 1, 1, 0x400 } }));
+    CHECK(!decode(std::vector<ReplayCipherLayer>(5, { 1, 1, 0x100 })));
+}
+/// ------------------
+
+int main()
+{
+    TestCipherKnown();
+    TestCipherMatchesReference();
+    TestCipherLimit();
+    TestUnlzssKnown();
+    TestLzssRoundTrip();
+    TestUnlzssMatchesReference();
+    TestDecodeStream();
+    TestDecodeStreamLayers();
+    TestDecodeStreamRejects();
+
+    if (gFailures) {
+        fprintf(stderr, "replay_codec_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("replay_codec_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,584 @@
+// Checks the replay indexer and catalog in thprac_replay_index.cpp on top of
+// a file system in memory. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined -I../src/3rdParties/MetroHash -I../src/3rdParties/rapidjson/include replay_index_test.cpp ../src/thprac/thprac_replay_index.cpp ../src/thprac/thprac_replay.cpp ../src/thprac/thprac_launcher_scan.cpp ../src/3rdParties/MetroHash/metrohash128.cpp -o replay_index_test
+//   ./replay_index_test
+//
+// The replays are made up here, laid out the way the games and
+// ReplaySaveParam write them: a TH06 one with its encrypted header, a TH07 one
+// with its header compressed too, and later ones with USER chunks for the info
+// and the param.
+
+#include "../src/thprac/thprac_replay_index.h"
+#include "../src/thprac/thprac_replay.h"
+#include <metrohash128.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+// Paths are full paths joined with backslashes, directories are implied by
+// the files under them
+class MemoryFileSystem : public ReplayFileSystem {
+public:
+    struct File {
+        std::vector<uint8_t> data;
+        uint64_t writeTime;
+    };
+    std::map<std::wstring, File> files;
+    std::atomic<int> reads = 0;
+
+    bool List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry) override
+    {
+        std::wstring prefix = dir + L"\\";
+        std::set<std::wstring> dirs;
+        bool found = false;
+        for (auto it = files.lower_bound(prefix); it != files.end() && it->first.starts_with(prefix); ++it) {
+            found = true;
+            std::wstring rest = it->first.substr(prefix.size());
+            size_t sep = rest.find(L'\\');
+            if (sep != std::wstring::npos) {
+                if (!dirs.insert(rest.substr(0, sep)).second)
+                    continue;
+                if (!onEntry(rest.substr(0, sep), true))
+                    break;
+            } else if (!onEntry(rest, false)) {
+                break;
+            }
+        }
+        return found;
+    }
+
+    bool Stat(const std::wstring& path, uint64_t& size, uint64_t& writeTime) override
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+            return false;
+        size = it->second.data.size();
+        writeTime = it->second.writeTime;
+        return true;
+    }
+
+    bool Read(const std::wstring& path, const std::function<void(const uint8_t* data, size_t size)>& onData) override
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+            return false;
+        reads++;
+        onData(it->second.data.data(), it->second.data.size());
+        return true;
+    }
+};
+
+static void Put(std::vector<uint8_t>& rep, size_t offset, uint32_t v)
+{
+    memcpy(rep.data() + offset, &v, 4);
+}
+
+static void Append(std::vector<uint8_t>& rep, const void* data, size_t size)
+{
+    rep.insert(rep.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+static void AppendUserChunk(std::vector<uint8_t>& rep, uint32_t type, const std::string& body)
+{
+    size_t length = 12 + body.size() + 1;
+    while (length % 4)
+        length++;
+    uint32_t header[3] = { REPLAY_MAGIC_USER, (uint32_t)length, type };
+    Append(rep, header, sizeof(header));
+    Append(rep, body.data(), body.size());
+    rep.resize(rep.size() + length - 12 - body.size());
+}
+
+// TH10 onwards: header, body, then the USER chain
+static std::vector<uint8_t> ModernReplay(const char* magic, const std::string& info, const std::string& param)
+{
+    std::vector<uint8_t> rep(0x24 + 200, 0x11);
+    memcpy(rep.data(), magic, 4);
+    Put(rep, 12, (uint32_t)rep.size());
+    AppendUserChunk(rep, REPLAY_USER_INFO, info);
+    if (!param.empty())
+        AppendUserChunk(rep, REPLAY_USER_PARAM, param);
+    return rep;
+}
+
+// How TH06 and TH07 encrypt, thprac itself only ever decrypts
+static void LegacyEncrypt(uint8_t* data, size_t size, uint8_t key)
+{
+    for (size_t i = 0; i < size; i++) {
+        data[i] += key;
+        key += 7;
+    }
+}
+
+// What ReplaySaveParam appends to TH06 and TH07 replays
+static void AppendLegacyParam(std::vector<uint8_t>& rep, const std::string& param)
+{
+    if (param.empty())
+        return;
+    uint32_t length = (uint32_t)param.size() + 1;
+    while (length % 4)
+        length++;
+    size_t at = rep.size();
+    rep.resize(at + length);
+    memcpy(rep.data() + at, param.data(), param.size());
+    Append(rep, &length, 4);
+    uint32_t prac = REPLAY_USER_PARAM;
+    Append(rep, &prac, 4);
+}
+
+static std::vector<uint8_t> Th06Replay(uint8_t shot, uint8_t difficulty, const char* date, const char* name, uint32_t score, const std::string& param)
+{
+    std::vector<uint8_t> rep(0x200, 0);
+    Put(rep, 0, REPLAY_MAGIC_PR6T);
+    rep[6] = shot;
+    rep[7] = difficulty;
+    rep[REPLAY_PR6T_FORMAT.sum_start] = 0x5A;
+    strcpy((char*)rep.data() + 0x10, date);
+    strcpy((char*)rep.data() + 0x19, name);
+    Put(rep, 0x24, score);
+    LegacyEncrypt(rep.data() + REPLAY_PR6T_FORMAT.crypt_start, rep.size() - REPLAY_PR6T_FORMAT.crypt_start, rep[REPLAY_PR6T_FORMAT.sum_start]);
+    AppendLegacyParam(rep, param);
+    return rep;
+}
+
+// Encrypted from 0x10 like TH06, with the header and the rest of the body LZSS
+// compressed from 0x54
+static std::vector<uint8_t> Th07Replay(uint8_t shot, uint8_t difficulty, const char* date, const char* name, uint32_t score, const std::string& param)
+{
+    std::mt19937 rng(shot * 16 + difficulty);
+    std::vector<uint8_t> body(0x400);
+    for (auto& b : body)
+        b = rng() % 4;
+    memset(body.data(), 0, 0x20);
+    body[2] = shot;
+    body[3] = difficulty;
+    strcpy((char*)body.data() + 4, date);
+    strcpy((char*)body.data() + 0xA, name);
+    Put(body, 0x1C, score / 10);
+    auto packed = ReplayLzss(body.data(), body.size());
+
+    std::vector<uint8_t> rep(0x54, 0);
+    Put(rep, 0, REPLAY_MAGIC_PR7T);
+    rep[REPLAY_PR7T_FORMAT.sum_start] = 0xA7;
+    Put(rep, 0x14, (uint32_t)packed.size());
+    Put(rep, 0x18, (uint32_t)body.size());
+    Append(rep, packed.data(), packed.size());
+    LegacyEncrypt(rep.data() + REPLAY_PR7T_FORMAT.crypt_start, rep.size() - REPLAY_PR7T_FORMAT.crypt_start, rep[REPLAY_PR7T_FORMAT.sum_start]);
+    AppendLegacyParam(rep, param);
+    return rep;
+}
+
+static std::string Info(const char* name, const char* chara, const char* rank, const char* stage, uint64_t score)
+{
+    return std::string("\x93\x8c\x95\xfb replay\r\nName ") + name + "\r\nDate 24/01/02 12:34\r\nChara " + chara + "\r\nRank " + rank
+        + "\r\nStage " + stage + "\r\nScore " + std::to_string(score) + "\r\nSlow Rate 0.00\r\n";
+}
+
+static std::string Param(const char* game, int stage, int section)
+{
+    return "{\"game\":\"" + std::string(game) + "\",\"mode\":1,\"stage\":" + std::to_string(stage) + ",\"section\":" + std::to_string(section) + ",\"phase\":0}";
+}
+
+static void MakeLibrary(MemoryFileSystem& fs)
+{
+    fs.files[L"C:\\rep\\th06\\th6_01.rpy"] = { Th06Replay(2, 3, "01/02/24", "ALICE", 98765430, ""), 1 };
+    fs.files[L"C:\\rep\\th06\\th6_ud0001.rpy"] = { Th06Replay(0, 4, "01/03/24", "BOB", 1000, Param("th06", 7, 3)), 2 };
+    fs.files[L"C:\\rep\\th18\\th18_01.rpy"] = { ModernReplay("t18r", Info("Alice", "Reimu", "Lunatic", "All Clear", 1234567890), ""), 3 };
+    fs.files[L"C:\\rep\\th18\\th18_ud0002.rpy"] = { ModernReplay("t18r", Info("Bob", "Marisa", "Normal", "Stage 3", 55500), Param("th18", 3, 10)), 4 };
+    fs.files[L"C:\\rep\\th18\\nested\\th18_ud0003.rpy"] = { ModernReplay("t18r", Info("Carol", "Sakuya", "Hard", "Stage 6", 777), Param("th18", 6, 0)), 5 };
+    // TH14 shares TH13's magic, only the name tells them apart
+    fs.files[L"C:\\rep\\th14\\th14_01.rpy"] = { ModernReplay("t13r", Info("Dave", "ReimuA", "Easy", "All Clear", 42), ""), 6 };
+    fs.files[L"C:\\rep\\th13\\th13_01.rpy"] = { ModernReplay("t13r", Info("Erin", "Youmu", "Extra", "Extra", 43), ""), 7 };
+    // Not replays, the first one is still recorded
+    fs.files[L"C:\\rep\\junk.rpy"] = { std::vector<uint8_t>(100, 0xEE), 8 };
+    fs.files[L"C:\\rep\\notes.txt"] = { std::vector<uint8_t>(10, 'a'), 9 };
+}
+
+static std::vector<uint8_t> Build(MemoryFileSystem& fs, const ReplayCatalog& old, std::vector<std::wstring> roots = { L"C:\\rep" })
+{
+    ScanProgress progress;
+    std::atomic<bool> cancel = false;
+    return ReplayIndexBuild(fs, progress, cancel, roots, old);
+}
+
+static std::vector<std::string> Paths(const ReplayCatalog& catalog, const ReplayQuery& query)
+{
+    std::vector<std::string> ret;
+    catalog.Query(query, [&](const ReplayCatalogRecord& r) {
+        ret.push_back(std::string(catalog.Str(r.path)));
+        return true;
+    });
+    return ret;
+}
+
+/// Querying
+/// ------------------
+static void TestQuery()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    std::vector<uint8_t> data = Build(fs, ReplayCatalog());
+    ReplayCatalog catalog;
+    CHECK(catalog.Attach(data.data(), data.size()));
+    // Every .rpy, replay or not
+    CHECK(catalog.size() == 8);
+    CHECK(fs.reads == 8);
+    for (size_t i = 1; i < catalog.size(); i++)
+        CHECK(catalog.Str(catalog[i - 1].path) < catalog.Str(catalog[i].path));
+
+    auto th6 = catalog.Find("C:\\rep\\th06\\th6_01.rpy");
+    CHECK(th6 && catalog.Str(th6->game) == "th06");
+    if (th6) {
+        CHECK(catalog.Str(th6->shot) == "MarisaA");
+        CHECK(catalog.Str(th6->difficulty) == "Lunatic");
+        CHECK(catalog.Str(th6->date) == "01/02/24");
+        CHECK(catalog.Str(th6->name) == "ALICE");
+        CHECK(th6->score == 98765430);
+        CHECK(th6->param.size == 0 && th6->paramStage == -1);
+    }
+    auto th18 = catalog.Find("C:\\rep\\th18\\th18_01.rpy");
+    CHECK(th18 && catalog.Str(th18->game) == "th18");
+    if (th18) {
+        CHECK(catalog.Str(th18->name) == "Alice");
+        CHECK(catalog.Str(th18->shot) == "Reimu");
+        CHECK(catalog.Str(th18->difficulty) == "Lunatic");
+        CHECK(catalog.Str(th18->stage) == "All Clear");
+        CHECK(catalog.Str(th18->date) == "24/01/02 12:34");
+        CHECK(th18->score == 1234567890);
+    }
+    auto th14 = catalog.Find("C:\\rep\\th14\\th14_01.rpy");
+    CHECK(th14 && catalog.Str(th14->game) == "th14");
+    auto th13 = catalog.Find("C:\\rep\\th13\\th13_01.rpy");
+    CHECK(th13 && catalog.Str(th13->game) == "th13");
+    auto junk = catalog.Find("C:\\rep\\junk.rpy");
+    CHECK(junk && junk->game.size == 0);
+    CHECK(!catalog.Find("C:\\rep\\notes.txt"));
+    CHECK(!catalog.Find("C:\\rep\\th18"));
+    CHECK(!catalog.Find(""));
+
+    using Paths_ = std::vector<std::string>;
+    ReplayQuery any;
+    CHECK(Paths(catalog, any).size() == 7);
+    ReplayQuery th18Only;
+    th18Only.game = "th18";
+    CHECK(Paths(catalog, th18Only) == Paths_({ "C:\\rep\\th18\\nested\\th18_ud0003.rpy", "C:\\rep\\th18\\th18_01.rpy", "C:\\rep\\th18\\th18_ud0002.rpy" }));
+    ReplayQuery stage = th18Only;
+    stage.paramStage = 3;
+    CHECK(Paths(catalog, stage) == Paths_({ "C:\\rep\\th18\\th18_ud0002.rpy" }));
+    ReplayQuery section;
+    section.section = 3;
+    CHECK(Paths(catalog, section) == Paths_({ "C:\\rep\\th06\\th6_ud0001.rpy" }));
+    // 0 is a section like any other
+    section.section = 0;
+    CHECK(Paths(catalog, section) == Paths_({ "C:\\rep\\th18\\nested\\th18_ud0003.rpy" }));
+    ReplayQuery withParam;
+    withParam.withParamOnly = true;
+    CHECK(Paths(catalog, withParam).size() == 3);
+    ReplayQuery scores;
+    scores.minScore = 1000;
+    scores.maxScore = 55500;
+    CHECK(Paths(catalog, scores) == Paths_({ "C:\\rep\\th06\\th6_ud0001.rpy", "C:\\rep\\th18\\th18_ud0002.rpy" }));
+    ReplayQuery th19;
+    th19.game = "th19";
+    CHECK(Paths(catalog, th19).empty());
+
+    // The param wins over what the replay itself says
+    auto ud = catalog.Find("C:\\rep\\th18\\th18_ud0002.rpy");
+    CHECK(ud && ud->mode == 1 && ud->paramStage == 3 && ud->section == 10 && ud->phase == 0);
+    CHECK(ud && catalog.Str(ud->param) == Param("th18", 3, 10));
+
+    // Stops when told to
+    int calls = 0;
+    catalog.Query({}, [&](const ReplayCatalogRecord&) { return ++calls < 2; });
+    CHECK(calls == 2);
+
+    // Shared strings are stored once
+    CHECK(th18 && ud && th18->game.offset == ud->game.offset);
+}
+
+// TH07's header is only readable after decrypting and decompressing
+static void TestTh07()
+{
+    ReplayInfo info;
+    auto rep = Th07Replay(5, 5, "03/04", "CIRNO", 123456780, "");
+    CHECK(ReplayReadInfo(rep.data(), rep.size(), L"th7_01.rpy", info));
+    CHECK(info.game == "th07");
+    CHECK(info.shot == "SakuyaB");
+    CHECK(info.difficulty == "Phantasm");
+    CHECK(info.date == "03/04");
+    CHECK(info.name == "CIRNO");
+    CHECK(info.score == 123456780);
+    CHECK(info.param.empty() && info.paramStage == -1);
+
+    rep = Th07Replay(0, 1, "12/31", "12345678", 0, Param("th07", 4, 2));
+    CHECK(ReplayReadInfo(rep.data(), rep.size(), L"th7_ud0001.rpy", info));
+    CHECK(info.shot == "ReimuA" && info.difficulty == "Normal" && info.name == "12345678" && info.score == 0);
+    CHECK(info.paramStage == 4 && info.section == 2);
+
+    // Cut off anywhere, it's still TH07, and whatever the header says is
+    // either all there or not at all
+    rep = Th07Replay(3, 2, "07/07", "DAVE", 1000, "");
+    for (size_t size = 16; size < 0x54 + 0x40; size++) {
+        std::vector<uint8_t> cut(rep.begin(), rep.begin() + size);
+        CHECK(ReplayReadInfo(cut.data(), cut.size(), L"th7_01.rpy", info));
+        CHECK(info.game == "th07");
+        CHECK(info.name.empty() == info.shot.empty());
+    }
+}
+
+// Overlapping roots, and a root that doesn't exist
+static void TestRoots()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    std::vector<uint8_t> data = Build(fs, ReplayCatalog(), { L"C:\\rep", L"C:\\rep\\th18", L"D:\\nothing" });
+    ReplayCatalog catalog;
+    CHECK(catalog.Attach(data.data(), data.size()));
+    CHECK(catalog.size() == 8);
+
+    data = Build(fs, ReplayCatalog(), {});
+    CHECK(catalog.Attach(data.data(), data.size()));
+    CHECK(catalog.size() == 0);
+    CHECK(Paths(catalog, ReplayQuery()).empty());
+}
+
+static void TestCancel()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    ScanProgress progress;
+    std::atomic<bool> cancel = true;
+    CHECK(ReplayIndexBuild(fs, progress, cancel, { L"C:\\rep" }, ReplayCatalog()).empty());
+}
+/// ------------------
+
+/// Incremental rebuild
+/// ------------------
+static void TestIncremental()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    std::vector<uint8_t> first = Build(fs, ReplayCatalog());
+    ReplayCatalog old;
+    CHECK(old.Attach(first.data(), first.size()));
+
+    // Nothing changed, nothing is read, and the result is the same
+    fs.reads = 0;
+    std::vector<uint8_t> same = Build(fs, old);
+    CHECK(fs.reads == 0);
+    CHECK(same == first);
+
+    // One replay saved over, one touched without changing, one new, one gone
+    fs.reads = 0;
+    fs.files[L"C:\\rep\\th18\\th18_01.rpy"] = { ModernReplay("t18r", Info("Alice", "Reimu", "Lunatic", "All Clear", 2000000000), Param("th18", 1, 5)), 100 };
+    fs.files[L"C:\\rep\\th14\\th14_01.rpy"].writeTime = 101;
+    fs.files[L"C:\\rep\\th18\\th18_ud0009.rpy"] = { ModernReplay("t18r", Info("Frank", "Sanae", "Hard", "Stage 2", 9), ""), 102 };
+    fs.files.erase(L"C:\\rep\\th06\\th6_01.rpy");
+    // A different size is enough, file times can be coarse
+    fs.files[L"C:\\rep\\th18\\th18_ud0002.rpy"].data = ModernReplay("t18r", Info("Bob", "Marisa", "Normal", "Stage 3", 66600), "");
+    // The same size and time as before is trusted, even if the contents differ
+    fs.files[L"C:\\rep\\th13\\th13_01.rpy"].data[0x30] ^= 1;
+    std::vector<uint8_t> second = Build(fs, old);
+    CHECK(fs.reads == 4);
+
+    ReplayCatalog catalog;
+    CHECK(catalog.Attach(second.data(), second.size()));
+    CHECK(catalog.size() == 8);
+    CHECK(!catalog.Find("C:\\rep\\th06\\th6_01.rpy"));
+    auto changed = catalog.Find("C:\\rep\\th18\\th18_01.rpy");
+    CHECK(changed && changed->score == 2000000000 && changed->paramStage == 1 && changed->writeTime == 100);
+    auto resized = catalog.Find("C:\\rep\\th18\\th18_ud0002.rpy");
+    CHECK(resized && resized->score == 66600 && resized->param.size == 0 && resized->section == -1);
+    auto added = catalog.Find("C:\\rep\\th18\\th18_ud0009.rpy");
+    CHECK(added && catalog.Str(added->name) == "Frank");
+    // Copied over from the old catalog without being read
+    auto kept = catalog.Find("C:\\rep\\th06\\th6_ud0001.rpy");
+    CHECK(kept && catalog.Str(kept->name) == "BOB" && kept->section == 3);
+    auto junk = catalog.Find("C:\\rep\\junk.rpy");
+    CHECK(junk && junk->game.size == 0);
+
+    // The old catalog is untouched, it may still be mapped
+    CHECK(old.size() == 8 && old.Find("C:\\rep\\th06\\th6_01.rpy"));
+}
+
+// Something that isn't a catalog is as good as none: everything is read again
+static void TestRebuildFromBadCatalog()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    std::vector<uint8_t> data = Build(fs, ReplayCatalog());
+    data[data.size() - 1] ^= 0xFF;
+    ReplayCatalog bad;
+    CHECK(!bad.Attach(data.data(), data.size()));
+    fs.reads = 0;
+    std::vector<uint8_t> rebuilt = Build(fs, bad);
+    CHECK(fs.reads == 8);
+    ReplayCatalog catalog;
+    CHECK(catalog.Attach(rebuilt.data(), rebuilt.size()));
+    CHECK(catalog.size() == 8);
+}
+/// ------------------
+
+/// Corrupt catalogs
+/// ------------------
+// Header fields as ReplayCatalogHeader lays them out
+constexpr size_t HEADER_SIZE = 40;
+constexpr size_t COUNT_OFFSET = 12;
+constexpr size_t POOL_SIZE_OFFSET = 16;
+constexpr size_t CHECKSUM_OFFSET = 24;
+
+static void Rehash(std::vector<uint8_t>& data)
+{
+    MetroHash128::Hash(data.data() + HEADER_SIZE, data.size() - HEADER_SIZE, data.data() + CHECKSUM_OFFSET);
+}
+
+static bool Attaches(const std::vector<uint8_t>& data)
+{
+    ReplayCatalog catalog;
+    bool ok = catalog.Attach(data.data(), data.size());
+    // Failing leaves it empty
+    CHECK(ok || (catalog.size() == 0 && !catalog.Find("C:\\rep\\junk.rpy")));
+    return ok;
+}
+
+static void TestCorrupt()
+{
+    MemoryFileSystem fs;
+    MakeLibrary(fs);
+    const std::vector<uint8_t> good = Build(fs, ReplayCatalog());
+    CHECK(Attaches(good));
+    CHECK(!Attaches({}));
+    ReplayCatalog catalog;
+    CHECK(!catalog.Attach(nullptr, 100));
+
+    // Every truncation
+    for (size_t size = 0; size < good.size(); size++) {
+        if (Attaches(std::vector<uint8_t>(good.begin(), good.begin() + size))) {
+            fprintf(stderr, "truncated to %zu bytes\n", size);
+            CHECK(false);
+            break;
+        }
+    }
+    // Every single bit flip, in the header or under the checksum
+    for (size_t i = 0; i < good.size(); i++) {
+        std::vector<uint8_t> data = good;
+        data[i] ^= 1 << (i % 8);
+        if (Attaches(data)) {
+            fprintf(stderr, "bit flipped at %zu\n", i);
+            CHECK(false);
+            break;
+        }
+    }
+    // Trailing garbage
+    std::vector<uint8_t> longer = good;
+    longer.push_back(0);
+    CHECK(!Attaches(longer));
+
+    // Misaligned, the records are read in place
+    std::vector<uint8_t> shifted(good.size() + 1);
+    memcpy(shifted.data() + 1, good.data(), good.size());
+    CHECK(!catalog.Attach(shifted.data() + 1, good.size()));
+
+    // Counts that don't add up, even with a valid checksum
+    for (uint32_t count : { 0u, 7u, 9u, 0x10000000u, 0xFFFFFFFFu }) {
+        std::vector<uint8_t> data = good;
+        Put(data, COUNT_OFFSET, count);
+        Rehash(data);
+        CHECK(!Attaches(data));
+    }
+    for (uint32_t pool : { 0u, 0xFFFFFFFFu }) {
+        std::vector<uint8_t> data = good;
+        Put(data, POOL_SIZE_OFFSET, pool);
+        Rehash(data);
+        CHECK(!Attaches(data));
+    }
+
+    // A string that points out of the pool, with a valid checksum
+    std::mt19937 rng(20);
+    size_t strings = offsetof(ReplayCatalogRecord, path);
+    for (int round = 0; round < 2000; round++) {
+        std::vector<uint8_t> data = good;
+        size_t record = rng() % 8;
+        size_t field = rng() % 8;
+        size_t at = HEADER_SIZE + record * sizeof(ReplayCatalogRecord) + strings + field * sizeof(ReplayCatalogStr);
+        uint32_t pool;
+        memcpy(&pool, data.data() + POOL_SIZE_OFFSET, 4);
+        ReplayCatalogStr str;
+        memcpy(&str, data.data() + at, sizeof(str));
+        switch (rng() % 3) {
+        case 0:
+            str.offset = pool + 1 + rng() % 100;
+            break;
+        case 1:
+            str.size = pool - str.offset + 1 + rng() % 100;
+            break;
+        default:
+            // Fits on its own, but overflows when added up
+            str.offset = pool;
+            str.size = 0xFFFFFFFF - rng() % 4;
+            break;
+        }
+        memcpy(data.data() + at, &str, sizeof(str));
+        Rehash(data);
+        if (Attaches(data)) {
+            fprintf(stderr, "string %zu of record %zu at %u + %u\n", field, record, str.offset, str.size);
+            CHECK(false);
+            break;
+        }
+    }
+
+    // And one that sits right at the end of the pool is fine
+    std::vector<uint8_t> data = good;
+    uint32_t pool;
+    memcpy(&pool, data.data() + POOL_SIZE_OFFSET, 4);
+    ReplayCatalogStr edge = { pool, 0 };
+    memcpy(data.data() + HEADER_SIZE + strings + sizeof(ReplayCatalogStr), &edge, sizeof(edge));
+    Rehash(data);
+    CHECK(Attaches(data));
+}
+/// ------------------
+
+static void TestPathToUtf8()
+{
+    CHECK(ReplayPathToUtf8(L"C:\\rep\\th18_01.rpy") == "C:\\rep\\th18_01.rpy");
+    CHECK(ReplayPathToUtf8(L"\u00e9") == "\xc3\xa9");
+    CHECK(ReplayPathToUtf8(L"\u6771\u65b9") == "\xe6\x9d\xb1\xe6\x96\xb9");
+    CHECK(ReplayPathToUtf8(L"\U0001F600") == "\xf0\x9f\x98\x80");
+    CHECK(ReplayPathToUtf8(L"") == "");
+}
+
+int main()
+{
+    TestPathToUtf8();
+    TestQuery();
+    TestTh07();
+    TestRoots();
+    TestCancel();
+    TestIncremental();
+    TestRebuildFromBadCatalog();
+    TestCorrupt();
+
+    if (gFailures) {
+        fprintf(stderr, "replay_index_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("replay_index_test: all passed\n");
+    return 0;
+}
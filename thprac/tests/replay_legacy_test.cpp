@@ -0,0 +1,273 @@
+// Checks the PR6T/PR7T decryption and checksum in thprac_replay.cpp against
+// plain byte loops. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -msse2 -fsanitize=address,undefined replay_legacy_test.cpp ../src/thprac/thprac_replay.cpp -o replay_legacy_test
+//   ./replay_legacy_test [--bench]
+//
+// The SSE2 loops do 16 bytes at a time and leave the rest to a scalar tail,
+// so every key is tried with every length up to a few vectors and every
+// alignment of the data. --bench times both on a replay sized buffer, and
+// is best built with -O2 and without the sanitizers. Only the games encrypt,
+// so ReferenceEncrypt stands in for them.
+//
+// ReplayLegacyChecksumAdd is checked against recomputing the checksum of
+// the whole file, for any way of cutting the file into pieces.
+
+#include "../src/thprac/thprac_replay.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+// How TH06 and TH07 do it
+static void ReferenceDecrypt(uint8_t* data, size_t size, uint8_t key)
+{
+    for (size_t i = 0; i < size; i++) {
+        data[i] -= key;
+        key += 7;
+    }
+}
+
+static void ReferenceEncrypt(uint8_t* data, size_t size, uint8_t key)
+{
+    for (size_t i = 0; i < size; i++) {
+        data[i] += key;
+        key += 7;
+    }
+}
+
+// Seed plus every byte from sum_start on, decrypted with the key at sum_start
+static uint32_t ReferenceChecksum(const std::vector<uint8_t>& rep, const ReplayLegacyFormat& fmt)
+{
+    uint32_t sum = REPLAY_LEGACY_CHECKSUM_SEED;
+    for (size_t i = fmt.sum_start; i < rep.size(); i++) {
+        if (i < fmt.crypt_start)
+            sum += rep[i];
+        else
+            sum += (uint8_t)(rep[i] - rep[fmt.sum_start] - 7 * (i - fmt.crypt_start));
+    }
+    return sum;
+}
+
+/// Cipher
+/// ------------------
+static void TestMatchesReference()
+{
+    constexpr size_t MAX_LEN = 100;
+    constexpr size_t MAX_MISALIGN = 16;
+    // Guard bytes on both sides, to catch a vector store past the end
+    constexpr size_t GUARD = 16;
+    std::mt19937 rng(18);
+    alignas(16) uint8_t plain[MAX_LEN];
+    alignas(16) uint8_t buf[GUARD + MAX_MISALIGN + MAX_LEN + GUARD];
+    uint8_t expected[MAX_LEN];
+
+    for (unsigned key = 0; key < 256; key++) {
+        for (size_t len = 0; len <= MAX_LEN; len++) {
+            for (size_t misalign = 0; misalign < MAX_MISALIGN; misalign++) {
+                for (auto& b : plain)
+                    b = (uint8_t)rng();
+                memset(buf, 0xCC, sizeof(buf));
+                uint8_t* data = buf + GUARD + misalign;
+
+                memcpy(expected, plain, len);
+                ReferenceDecrypt(expected, len, (uint8_t)key);
+                memcpy(data, plain, len);
+                ReplayLegacyDecrypt(data, len, (uint8_t)key);
+                bool decrypted = !memcmp(data, expected, len);
+
+                memcpy(data, plain, len);
+                ReferenceEncrypt(data, len, (uint8_t)key);
+                ReplayLegacyDecrypt(data, len, (uint8_t)key);
+                bool roundTrip = !memcmp(data, plain, len);
+
+                bool guarded = std::all_of(buf, data, [](uint8_t b) { return b == 0xCC; })
+                    && std::all_of(data + len, buf + sizeof(buf), [](uint8_t b) { return b == 0xCC; });
+
+                if (!decrypted || !roundTrip || !guarded) {
+                    fprintf(stderr, "key %u, length %zu, misaligned by %zu\n", key, len, misalign);
+                    CHECK(decrypted);
+                    CHECK(roundTrip);
+                    CHECK(guarded);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Replays are far longer than the lengths above, so the keystream has to
+// stay in step over many vectors, and wrap around correctly
+static void TestLong()
+{
+    std::mt19937 rng(7);
+    std::vector<uint8_t> plain(0x10000 + 13);
+    for (auto& b : plain)
+        b = (uint8_t)rng();
+    for (unsigned key : { 0u, 0x5Au, 0xFFu }) {
+        std::vector<uint8_t> data = plain, expected = plain;
+        ReplayLegacyDecrypt(data.data(), data.size(), (uint8_t)key);
+        ReferenceDecrypt(expected.data(), expected.size(), (uint8_t)key);
+        CHECK(data == expected);
+        data = plain;
+        ReferenceEncrypt(data.data(), data.size(), (uint8_t)key);
+        ReplayLegacyDecrypt(data.data(), data.size(), (uint8_t)key);
+        CHECK(data == plain);
+    }
+}
+/// ------------------
+
+/// Checksum
+/// ------------------
+static std::vector<uint8_t> RandomReplay(std::mt19937& rng, const ReplayLegacyFormat& fmt)
+{
+    size_t size = fmt.crypt_start + rng() % (rng() % 4 ? 64 : 4096);
+    std::vector<uint8_t> rep(size);
+    for (auto& b : rep)
+        b = (uint8_t)rng();
+    return rep;
+}
+
+// The file in pieces, each added at its own offset. Pieces can start before
+// sum_start, straddle sum_start and crypt_start, or be empty.
+static uint32_t ChecksumInPieces(std::mt19937& rng, const std::vector<uint8_t>& rep, const ReplayLegacyFormat& fmt)
+{
+    std::vector<size_t> cuts = { 0, rep.size() };
+    size_t count = rng() % 6;
+    for (size_t i = 0; i < count; i++) {
+        // Cuts near the two boundaries are the interesting ones
+        switch (rng() % 3) {
+        case 0:
+            cuts.push_back(std::min(rep.size(), fmt.sum_start - 1 + rng() % 3));
+            break;
+        case 1:
+            cuts.push_back(std::min(rep.size(), fmt.crypt_start - 1 + rng() % 3));
+            break;
+        default:
+            cuts.push_back(rng() % (rep.size() + 1));
+            break;
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+    uint32_t sum = REPLAY_LEGACY_CHECKSUM_SEED;
+    for (size_t i = 0; i + 1 < cuts.size(); i++)
+        sum = ReplayLegacyChecksumAdd(sum, rep[fmt.sum_start], cuts[i], rep.data() + cuts[i], cuts[i + 1] - cuts[i], fmt);
+    return sum;
+}
+
+static void TestChecksumPieces()
+{
+    std::mt19937 rng(17);
+    for (const ReplayLegacyFormat& fmt : { REPLAY_PR6T_FORMAT, REPLAY_PR7T_FORMAT }) {
+        for (int round = 0; round < 5000; round++) {
+            std::vector<uint8_t> rep = RandomReplay(rng, fmt);
+            uint32_t expected = ReferenceChecksum(rep, fmt);
+            uint32_t got = ChecksumInPieces(rng, rep, fmt);
+            if (got != expected) {
+                fprintf(stderr, "sum_start %zu, %zu bytes: %08x, expected %08x\n", fmt.sum_start, rep.size(), got, expected);
+                CHECK(got == expected);
+                return;
+            }
+        }
+    }
+}
+
+// What ReplaySaveParam does: append plain bytes and extend the stored
+// checksum with only the header and the new bytes
+static void TestChecksumAppend()
+{
+    std::mt19937 rng(170);
+    for (const ReplayLegacyFormat& fmt : { REPLAY_PR6T_FORMAT, REPLAY_PR7T_FORMAT }) {
+        for (int round = 0; round < 2000; round++) {
+            std::vector<uint8_t> rep = RandomReplay(rng, fmt);
+            uint32_t checksum = ReferenceChecksum(rep, fmt);
+            for (int save = 0; save < 3; save++) {
+                std::vector<uint8_t> param(rng() % 600);
+                for (auto& b : param)
+                    b = (uint8_t)rng();
+                checksum = ReplayLegacyChecksumAdd(checksum, rep[fmt.sum_start], rep.size(), param.data(), param.size(), fmt);
+                rep.insert(rep.end(), param.begin(), param.end());
+            }
+            CHECK(checksum == ReferenceChecksum(rep, fmt));
+        }
+    }
+}
+
+// Every byte before sum_start is left out, whatever it is
+static void TestChecksumIgnoresHeader()
+{
+    std::mt19937 rng(1700);
+    for (const ReplayLegacyFormat& fmt : { REPLAY_PR6T_FORMAT, REPLAY_PR7T_FORMAT }) {
+        std::vector<uint8_t> rep = RandomReplay(rng, fmt);
+        uint32_t sum = ReplayLegacyChecksumAdd(REPLAY_LEGACY_CHECKSUM_SEED, rep[fmt.sum_start], 0, rep.data(), rep.size(), fmt);
+        for (size_t i = 0; i < fmt.sum_start; i++)
+            rep[i] ^= 0xFF;
+        CHECK(ReplayLegacyChecksumAdd(REPLAY_LEGACY_CHECKSUM_SEED, rep[fmt.sum_start], 0, rep.data(), rep.size(), fmt) == sum);
+        // Nothing at all past the end of the header
+        CHECK(ReplayLegacyChecksumAdd(sum, rep[fmt.sum_start], 0, rep.data(), fmt.sum_start, fmt) == sum);
+    }
+}
+/// ------------------
+
+/// Benchmark
+/// ------------------
+template <typename F>
+static double MBPerSecond(std::vector<uint8_t>& data, F cipher)
+{
+    double best = 1e9;
+    for (int pass = 0; pass < 50; pass++) {
+        auto begin = std::chrono::steady_clock::now();
+        cipher(data.data(), data.size(), (uint8_t)pass);
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - begin).count());
+    }
+    // Keeps the work from being optimized out
+    if (data[0] == 1 && data[1] == 2)
+        puts("");
+    return data.size() / best / 1e6;
+}
+
+static void Bench()
+{
+    printf("%-10s %8s %12s %12s\n", "", "bytes", "kernel", "byte loop");
+    for (size_t size : { (size_t)0x1000, (size_t)0x10000, (size_t)0x100000 }) {
+        std::vector<uint8_t> data(size);
+        double kernel = MBPerSecond(data, ReplayLegacyDecrypt);
+        double scalar = MBPerSecond(data, ReferenceDecrypt);
+        printf("%-10s %8zu %7.0f MB/s %7.0f MB/s\n", "decrypt", size, kernel, scalar);
+    }
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    TestMatchesReference();
+    TestLong();
+    TestChecksumPieces();
+    TestChecksumAppend();
+    TestChecksumIgnoresHeader();
+
+    if (argc > 1 && !strcmp(argv[1], "--bench"))
+        Bench();
+
+    if (gFailures) {
+        fprintf(stderr, "replay_legacy_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("replay_legacy_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,326 @@
+// Fuzzes ReplayFindParam from thprac_replay.cpp with truncated and corrupt
+// replays. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined replay_param_test.cpp ../src/thprac/thprac_replay.cpp -o replay_param_test
+//   ./replay_param_test [rounds]
+//
+// Every replay is handed over in a heap block of exactly its size, so a read
+// past the end is caught by the address sanitizer. What comes back is
+// compared against a reference that does its offset math in 64 bits, where
+// nothing read from a 32 bit field can overflow.
+
+#include "../src/thprac/thprac_replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+constexpr uint32_t MAGIC_PR6T = 0x50523654;
+constexpr uint32_t MAGIC_PR7T = 0x50523754;
+constexpr uint32_t MAGIC_T18RP = 0x50523831;
+constexpr uint32_t MAGIC_USER = 0x52455355;
+constexpr uint32_t MAGIC_PRAC = 0x43415250;
+
+static uint32_t Get(const std::vector<uint8_t>& rep, uint64_t offset)
+{
+    uint32_t v;
+    memcpy(&v, rep.data() + offset, 4);
+    return v;
+}
+
+static void Put(std::vector<uint8_t>& rep, size_t offset, uint32_t v)
+{
+    memcpy(rep.data() + offset, &v, 4);
+}
+
+static void Append(std::vector<uint8_t>& rep, uint32_t v)
+{
+    rep.resize(rep.size() + 4);
+    Put(rep, rep.size() - 4, v);
+}
+
+/// Reference
+/// ------------------
+// Returns false if there's no param
+static bool Reference(const std::vector<uint8_t>& rep, uint64_t& begin, uint64_t& length)
+{
+    int64_t size = rep.size();
+    if (size < 4)
+        return false;
+    uint32_t magic = Get(rep, 0);
+    if (magic == MAGIC_PR6T || magic == MAGIC_PR7T) {
+        if (size < 8 || Get(rep, size - 4) != MAGIC_PRAC)
+            return false;
+        int64_t len = Get(rep, size - 8);
+        if (len == 0 || len >= 512 || 4 + len + 8 > size)
+            return false;
+        begin = size - 8 - len;
+        length = len;
+    } else {
+        if (size < 16)
+            return false;
+        int64_t offset = Get(rep, 12);
+        for (;;) {
+            if (offset + 12 > size || Get(rep, offset) != MAGIC_USER)
+                return false;
+            int64_t len = Get(rep, offset + 4);
+            if (len < 12 || offset + len > size)
+                return false;
+            if (Get(rep, offset + 8) == MAGIC_PRAC) {
+                begin = offset + 12;
+                length = len - 12;
+                break;
+            }
+            offset += len;
+        }
+    }
+    const uint8_t* nul = (const uint8_t*)memchr(rep.data() + begin, 0, length);
+    if (nul)
+        length = nul - (rep.data() + begin);
+    return length != 0;
+}
+/// ------------------
+
+// Runs ReplayFindParam on a copy of rep that ends exactly where rep does
+static void Check(const std::vector<uint8_t>& rep, const char* what)
+{
+    std::unique_ptr<uint8_t[]> copy(new uint8_t[rep.size() ? rep.size() : 1]);
+    std::copy(rep.begin(), rep.end(), copy.get());
+    std::string_view got = ReplayFindParam(copy.get(), rep.size());
+
+    const uint8_t* begin = (const uint8_t*)got.data();
+    bool inBounds = got.empty() || (begin >= copy.get() && begin + got.size() <= copy.get() + rep.size());
+    CHECK(inBounds);
+    uint64_t refBegin = 0, refLength = 0;
+    bool found = Reference(rep, refBegin, refLength);
+    bool same = found ? inBounds && !got.empty() && (uint64_t)(begin - copy.get()) == refBegin && got.size() == refLength : got.empty();
+    if (!inBounds || !same) {
+        fprintf(stderr, "%s, %zu bytes: got %zu bytes, expected %s\n", what, rep.size(), got.size(), found ? std::to_string(refLength).c_str() : "none");
+        CHECK(same);
+        // One is plenty
+        exit(1);
+    }
+}
+
+static std::string RandomParam(std::mt19937& rng)
+{
+    std::string ret = "{\"version\":\"2.2\"";
+    size_t extra = rng() % 300;
+    for (size_t i = 0; i < extra; i++)
+        ret += (char)('a' + rng() % 26);
+    return ret + "}";
+}
+
+// Laid out like ReplaySaveParam leaves a PR6T/PR7T replay
+static std::vector<uint8_t> LegacyReplay(std::mt19937& rng, const std::string& param)
+{
+    std::vector<uint8_t> rep(16 + rng() % 2000);
+    for (auto& b : rep)
+        b = (uint8_t)rng();
+    Put(rep, 0, rng() % 2 ? MAGIC_PR6T : MAGIC_PR7T);
+    size_t length = param.size() + 1;
+    while (length % 4)
+        length++;
+    size_t at = rep.size();
+    rep.resize(at + length);
+    memcpy(rep.data() + at, param.data(), param.size());
+    Append(rep, (uint32_t)length);
+    Append(rep, MAGIC_PRAC);
+    return rep;
+}
+
+// A later replay, with a chain of USER chunks after the body and the PRAC one
+// last, the way ReplaySaveParam appends it
+static std::vector<uint8_t> UserReplay(std::mt19937& rng, const std::string& param)
+{
+    std::vector<uint8_t> rep(0x24 + rng() % 2000);
+    for (auto& b : rep)
+        b = (uint8_t)rng();
+    Put(rep, 0, MAGIC_T18RP);
+    Put(rep, 12, (uint32_t)rep.size());
+    size_t chunks = rng() % 4;
+    for (size_t i = 0; i < chunks; i++) {
+        size_t length = 12 + rng() % 200;
+        Append(rep, MAGIC_USER);
+        Append(rep, (uint32_t)length);
+        Append(rep, rng() % 2);
+        for (size_t j = 12; j < length; j++)
+            rep.push_back((uint8_t)rng());
+    }
+    size_t length = param.size() + 12 + 1;
+    while (length % 4)
+        length++;
+    size_t at = rep.size();
+    rep.resize(at + length);
+    Put(rep, at, MAGIC_USER);
+    Put(rep, at + 4, (uint32_t)length);
+    Put(rep, at + 8, MAGIC_PRAC);
+    memcpy(rep.data() + at + 12, param.data(), param.size());
+    return rep;
+}
+
+// Offsets of every 32 bit field the parser reads
+static std::vector<size_t> Fields(const std::vector<uint8_t>& rep)
+{
+    std::vector<size_t> ret = { 0 };
+    if (rep.size() >= 8)
+        ret.insert(ret.end(), { rep.size() - 4, rep.size() - 8 });
+    if (rep.size() >= 16 && Get(rep, 0) != MAGIC_PR6T && Get(rep, 0) != MAGIC_PR7T) {
+        ret.push_back(12);
+        for (uint64_t offset = Get(rep, 12); offset + 12 <= rep.size() && Get(rep, offset) == MAGIC_USER;) {
+            ret.insert(ret.end(), { (size_t)offset + 4, (size_t)offset + 8 });
+            uint32_t length = Get(rep, offset + 4);
+            if (length < 12)
+                break;
+            offset += length;
+        }
+    }
+    return ret;
+}
+
+static uint32_t InterestingValue(std::mt19937& rng, const std::vector<uint8_t>& rep)
+{
+    const uint32_t size = (uint32_t)rep.size();
+    const uint32_t values[] = {
+        0, 1, 4, 11, 12, 13, 511, 512,
+        size - 12, size - 8, size - 4, size, size + 1,
+        0x7FFFFFFF, 0x80000000, 0xFFFFFFF4, 0xFFFFFFF8, 0xFFFFFFFF,
+        MAGIC_USER, MAGIC_PRAC,
+    };
+    return rng() % 4 ? values[rng() % std::size(values)] : (uint32_t)rng();
+}
+
+/// Tests
+/// ------------------
+static void TestValid()
+{
+    std::mt19937 rng(19);
+    for (int round = 0; round < 200; round++) {
+        std::string param = RandomParam(rng);
+        for (auto& rep : { LegacyReplay(rng, param), UserReplay(rng, param) }) {
+            std::unique_ptr<uint8_t[]> copy(new uint8_t[rep.size()]);
+            memcpy(copy.get(), rep.data(), rep.size());
+            CHECK(ReplayFindParam(copy.get(), rep.size()) == param);
+        }
+    }
+    CHECK(ReplayFindParam(nullptr, 0).empty());
+    CHECK(ReplayFindParam(nullptr, 100).empty());
+}
+
+// Cut off at every length, like a replay that was still being written
+static void TestTruncated()
+{
+    std::mt19937 rng(190);
+    for (int round = 0; round < 20; round++) {
+        std::string param = RandomParam(rng);
+        for (auto& rep : { LegacyReplay(rng, param), UserReplay(rng, param) }) {
+            for (size_t size = 0; size <= rep.size(); size++)
+                Check(std::vector<uint8_t>(rep.begin(), rep.begin() + size), "truncated");
+        }
+    }
+}
+
+static void TestCorrupt(unsigned rounds)
+{
+    std::mt19937 rng(1900);
+    for (unsigned round = 0; round < rounds; round++) {
+        std::string param = RandomParam(rng);
+        std::vector<uint8_t> rep = round % 2 ? LegacyReplay(rng, param) : UserReplay(rng, param);
+        int edits = 1 + rng() % 3;
+        for (int i = 0; i < edits; i++) {
+            switch (rng() % 4) {
+            case 0:
+                rep[rng() % rep.size()] = (uint8_t)rng();
+                break;
+            case 1:
+                rep.resize(rng() % (rep.size() + 1));
+                break;
+            default: {
+                // One of the fields that's actually looked at
+                std::vector<size_t> fields = Fields(rep);
+                size_t at = fields[rng() % fields.size()];
+                if (at + 4 <= rep.size())
+                    Put(rep, at, InterestingValue(rng, rep));
+                break;
+            }
+            }
+            if (rep.empty())
+                break;
+        }
+        Check(rep, "corrupt");
+    }
+}
+
+// Small headers with nothing but the magic right
+static void TestTiny()
+{
+    std::mt19937 rng(19000);
+    for (uint32_t magic : { MAGIC_PR6T, MAGIC_PR7T, MAGIC_T18RP }) {
+        for (size_t size = 0; size <= 48; size++) {
+            for (int round = 0; round < 200; round++) {
+                std::vector<uint8_t> rep(size);
+                for (auto& b : rep)
+                    b = (uint8_t)rng();
+                if (size >= 4)
+                    Put(rep, 0, magic);
+                if (size >= 16 && rng() % 2)
+                    Put(rep, 12, rng() % 48);
+                if (size >= 8 && rng() % 2)
+                    Put(rep, size - 4, MAGIC_PRAC);
+                if (size >= 8 && rng() % 2)
+                    Put(rep, size - 8, InterestingValue(rng, rep));
+                Check(rep, "tiny");
+            }
+        }
+    }
+}
+
+// A chain of nothing but empty USER chunks has to end, and in linear time
+static void TestLongChain()
+{
+    std::vector<uint8_t> rep(16);
+    Put(rep, 0, MAGIC_T18RP);
+    Put(rep, 12, 16);
+    for (int i = 0; i < 100000; i++) {
+        Append(rep, MAGIC_USER);
+        Append(rep, 12);
+        Append(rep, 0);
+    }
+    Check(rep, "long chain");
+    CHECK(ReplayFindParam(rep.data(), rep.size()).empty());
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    unsigned rounds = argc > 1 ? (unsigned)atoi(argv[1]) : 20000;
+
+    TestValid();
+    TestTruncated();
+    TestCorrupt(rounds);
+    TestTiny();
+    TestLongChain();
+
+    if (gFailures) {
+        fprintf(stderr, "replay_param_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("replay_param_test: all passed, %u corrupt replays\n", rounds);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Builds and runs the tests that don't need Windows. Every test's own build
+# line is at the top of its source file.
+#   ./run_tests.sh [build dir]
+set -e
+cd "$(dirname "$0")"
+out=${1:-/tmp/thprac_tests}
+mkdir -p "$out"
+CXX=${CXX:-g++}
+CXXFLAGS="-std=c++20 -O1 -Wall -Wextra -Wno-unknown-pragmas -fsanitize=address,undefined"
+
+$CXX $CXXFLAGS -fno-sanitize=alignment inject_pe_test.cpp -o "$out/inject_pe_test"
+"$out/inject_pe_test" fixtures
+
+# Needs optimizations to finish in reasonable time, and has to see the same
+# floating point semantics as the code it compares against
+$CXX -std=c++20 -O2 -Wall -Wextra -msse2 th19_fast_test.cpp -o "$out/th19_fast_test"
+"$out/th19_fast_test" fixtures
+
+# And built the way thprac ships th19_fast.cpp, 32 bit with fast math. Without
+# 32 bit libraries, fast math alone is as close as it gets.
+m32="-m32 -mfpmath=sse"
+if ! echo 'int main() { return 0; }' | $CXX $m32 -x c++ - -o "$out/m32_probe" 2>/dev/null; then
+    echo "no 32 bit toolchain, building th19_fast_test with fast math as 64 bit"
+    m32=
+fi
+$CXX -std=c++20 -O2 -Wall -Wextra -msse2 $m32 -ffast-math th19_fast_test.cpp -o "$out/th19_fast_test_fast_math"
+"$out/th19_fast_test_fast_math" fixtures
+
+$CXX $CXXFLAGS -fno-sanitize=alignment hook_x86_test.cpp ../src/thprac/thprac_hook_x86.cpp -o "$out/hook_x86_test"
+
+$CXX $CXXFLAGS hook_table_test.cpp -o "$out/hook_table_test"
+
+$CXX $CXXFLAGS hook_detour_test.cpp -o "$out/hook_detour_test"
+
+$CXX $CXXFLAGS hook_arena_test.cpp ../src/thprac/thprac_hook_arena.cpp -o "$out/hook_arena_test"
+"$out/hook_arena_test"
+"$out/hook_detour_test"
+"$out/hook_table_test"
+"$out/hook_x86_test"
+
+$CXX $CXXFLAGS -Iwin32 pe_view_test.cpp -o "$out/pe_view_test"
+"$out/pe_view_test"
+
+# gGameDefs and friends are static arrays, not every one of them gets used
+$CXX $CXXFLAGS -Wno-unused-variable -Iwin32 -I../src/thprac -I../src/3rdParties/MetroHash exe_prefilter_test.cpp ../src/3rdParties/MetroHash/metrohash128.cpp -o "$out/exe_prefilter_test"
+"$out/exe_prefilter_test"
+
+# Run from the build dir, so a failing input isn't written next to the sources
+$CXX $CXXFLAGS vdf_reader_test.cpp ../src/thprac/thprac_launcher_steam.cpp -o "$out/vdf_reader_test"
+fixtures="$PWD/fixtures"
+(cd "$out" && ./vdf_reader_test "$fixtures" 50000)
+
+$CXX $CXXFLAGS cfg_writer_test.cpp ../src/thprac/thprac_launcher_cfg_writer.cpp -o "$out/cfg_writer_test"
+"$out/cfg_writer_test" "$out"
+
+$CXX $CXXFLAGS -msse2 replay_legacy_test.cpp ../src/thprac/thprac_replay.cpp -o "$out/replay_legacy_test"
+"$out/replay_legacy_test"
+
+$CXX $CXXFLAGS replay_codec_test.cpp ../src/thprac/thprac_replay.cpp -o "$out/replay_codec_test"
+"$out/replay_codec_test"
+
+$CXX $CXXFLAGS replay_param_test.cpp ../src/thprac/thprac_replay.cpp -o "$out/replay_param_test"
+"$out/replay_param_test"
+
+$CXX $CXXFLAGS -I../src/3rdParties/MetroHash -I../src/3rdParties/rapidjson/include replay_index_test.cpp ../src/thprac/thprac_replay_index.cpp ../src/thprac/thprac_replay.cpp ../src/thprac/thprac_launcher_scan.cpp ../src/3rdParties/MetroHash/metrohash128.cpp -o "$out/replay_index_test"
+"$out/replay_index_test"
+
+$CXX $CXXFLAGS scan_walker_test.cpp ../src/thprac/thprac_launcher_scan.cpp -o "$out/scan_walker_test"
+"$out/scan_walker_test"
@@ -0,0 +1,484 @@
+// Runs ScanWalker from thprac_launcher_scan.cpp over directory trees kept in
+// memory. Builds and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined scan_walker_test.cpp ../src/thprac/thprac_launcher_scan.cpp -o scan_walker_test
+//   ./scan_walker_test [--bench]
+//
+// Every walk has to hand each candidate to onFile exactly once, whatever the
+// number of walkers and hashers, and has to stop soon after cancel is set,
+// even with every thread blocked on the file queue. Reading the progress
+// while it's being published must never see a half written path. --bench times one tree
+// with 1 to 16 walkers, with a delay on every listing standing in for disk.
+
+#include "../src/thprac/thprac_launcher_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <future>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+constexpr unsigned INLINE = ScanWalker::SCAN_HASHERS_INLINE;
+constexpr size_t QUEUE_SIZE = ScanWalker::SCAN_FILE_QUEUE_SIZE;
+
+class MemoryFileSystem : public ScanFileSystem {
+public:
+    struct Entry {
+        std::wstring name;
+        bool isDir;
+    };
+    std::map<std::wstring, std::vector<Entry>> dirs;
+    // Per listing, like the round trips of FindFirstFile and FindNextFile
+    std::chrono::microseconds latency { 0 };
+    // Called before every listing, from the walker doing it
+    std::function<void(const std::wstring& dir)> onList;
+    std::atomic<unsigned> lists = 0;
+
+    bool List(const std::wstring& dir, const std::function<bool(const std::wstring& name, bool isDir)>& onEntry) override
+    {
+        lists++;
+        if (onList)
+            onList(dir);
+        if (latency.count())
+            std::this_thread::sleep_for(latency);
+        auto it = dirs.find(dir);
+        if (it == dirs.end())
+            return false;
+        for (auto& entry : it->second) {
+            if (!onEntry(entry.name, entry.isDir))
+                break;
+        }
+        return true;
+    }
+};
+
+// What a tree holds, to compare a walk against
+struct Tree {
+    std::vector<std::wstring> candidates; // Sorted
+    std::set<std::wstring> dirs;
+    uint32_t files = 0;
+};
+
+static bool IsExe(const std::wstring& name)
+{
+    return name.size() > 4 && !name.compare(name.size() - 4, 4, L".exe");
+}
+
+// Every directory gets up to maxDirs subdirectories until depth runs out and
+// up to maxFiles files, about a quarter of them candidates. A few
+// directories are listed by their parent but can't be opened.
+static void Grow(MemoryFileSystem& fs, Tree& tree, std::mt19937& rng, const std::wstring& dir,
+    unsigned depth, unsigned maxDirs, unsigned maxFiles)
+{
+    tree.dirs.insert(dir);
+    if (rng() % 32 == 0 && tree.dirs.size() > 1)
+        return;
+    auto& entries = fs.dirs[dir];
+    unsigned files = rng() % (maxFiles + 1);
+    for (unsigned i = 0; i < files; i++) {
+        std::wstring name = L"f" + std::to_wstring(i) + (rng() % 4 ? L".dat" : L".exe");
+        entries.push_back({ name, false });
+        tree.files++;
+        if (IsExe(name))
+            tree.candidates.push_back(fs.Join(dir, name));
+    }
+    // The root always gets all of them, so no tree comes out tiny
+    unsigned subdirs = depth ? tree.dirs.size() == 1 ? maxDirs : rng() % (maxDirs + 1) : 0;
+    for (unsigned i = 0; i < subdirs; i++) {
+        std::wstring name = L"d" + std::to_wstring(i);
+        // Directories and files mixed, the way a listing returns them
+        entries.insert(entries.begin() + rng() % (entries.size() + 1), { name, true });
+        Grow(fs, tree, rng, fs.Join(dir, name), depth - 1, maxDirs, maxFiles);
+    }
+}
+
+static Tree BuildTree(MemoryFileSystem& fs, unsigned seed, unsigned depth, unsigned maxDirs, unsigned maxFiles)
+{
+    std::mt19937 rng(seed);
+    Tree tree;
+    Grow(fs, tree, rng, L"C:\\Games", depth, maxDirs, maxFiles);
+    std::sort(tree.candidates.begin(), tree.candidates.end());
+    return tree;
+}
+
+// Gives up on the whole test if Run doesn't return within limit, since the
+// walker threads can't be stopped any other way
+static std::chrono::milliseconds RunWithin(ScanWalker& walker, std::chrono::milliseconds limit)
+{
+    auto begin = std::chrono::steady_clock::now();
+    auto run = std::async(std::launch::async, [&] { walker.Run(L"C:\\Games"); });
+    if (run.wait_for(limit) == std::future_status::timeout) {
+        fprintf(stderr, "scan_walker_test: Run still going after %lld ms\n", (long long)limit.count());
+        fflush(stderr);
+        _Exit(1);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+}
+
+// onFile for the tests, keeps every path it's given
+struct Collector {
+    std::mutex lock;
+    std::vector<std::wstring> seen;
+
+    ScanWalker::FileFunc Func()
+    {
+        return [this](const std::wstring& path) {
+            std::lock_guard<std::mutex> guard(lock);
+            seen.push_back(path);
+        };
+    }
+    std::vector<std::wstring> Sorted()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<std::wstring> ret = seen;
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+};
+
+/// Completion
+/// ------------------
+static void TestComplete()
+{
+    const std::pair<unsigned, unsigned> configs[] = {
+        { 1, INLINE }, { 1, 1 }, { 2, 1 }, { 4, 2 }, { 8, INLINE }, { 16, 4 }, { 3, 16 },
+    };
+    for (unsigned seed = 0; seed < 8; seed++) {
+        MemoryFileSystem fs;
+        // Deep and narrow on even seeds, shallow and wide on odd ones
+        Tree tree = seed % 2 ? BuildTree(fs, seed, 3, 12, 30) : BuildTree(fs, seed, 10, 3, 8);
+        for (auto [walkers, hashers] : configs) {
+            ScanProgress progress;
+            std::atomic<bool> cancel = false;
+            Collector collector;
+            ScanWalker walker(fs, progress, cancel, IsExe, collector.Func(), walkers, hashers);
+            RunWithin(walker, std::chrono::milliseconds(20000));
+
+            bool same = collector.Sorted() == tree.candidates;
+            if (!same)
+                fprintf(stderr, "seed %u, %u walkers, %u hashers: %zu files, expected %zu\n", seed, walkers, hashers, collector.seen.size(), tree.candidates.size());
+            CHECK(same);
+            CHECK(progress.dirs == tree.dirs.size());
+            CHECK(progress.files == tree.files);
+            CHECK(progress.candidates == tree.candidates.size());
+            CHECK(progress.processed == tree.candidates.size());
+            // Listed once each, including the ones that can't be opened
+            CHECK(fs.lists.exchange(0) == tree.dirs.size());
+            std::wstring current;
+            CHECK(progress.Current(current) && (tree.dirs.count(current) || std::binary_search(tree.candidates.begin(), tree.candidates.end(), current)));
+        }
+    }
+}
+
+static void TestEdges()
+{
+    // A root that can't be opened
+    {
+        MemoryFileSystem fs;
+        ScanProgress progress;
+        std::atomic<bool> cancel = false;
+        Collector collector;
+        ScanWalker walker(fs, progress, cancel, IsExe, collector.Func(), 4, 2);
+        RunWithin(walker, std::chrono::milliseconds(5000));
+        CHECK(collector.seen.empty());
+        CHECK(progress.dirs == 1);
+        CHECK(progress.files == 0);
+    }
+    // Cancelled before it starts, nothing is even listed
+    {
+        MemoryFileSystem fs;
+        BuildTree(fs, 100, 4, 4, 4);
+        ScanProgress progress;
+        std::atomic<bool> cancel = true;
+        Collector collector;
+        ScanWalker walker(fs, progress, cancel, IsExe, collector.Func(), 4, 2);
+        RunWithin(walker, std::chrono::milliseconds(5000));
+        CHECK(collector.seen.empty());
+        CHECK(fs.lists == 0);
+    }
+    // A filter that takes nothing
+    {
+        MemoryFileSystem fs;
+        Tree tree = BuildTree(fs, 101, 4, 4, 10);
+        ScanProgress progress;
+        std::atomic<bool> cancel = false;
+        Collector collector;
+        ScanWalker walker(fs, progress, cancel, [](const std::wstring&) { return false; }, collector.Func(), 4, 2);
+        RunWithin(walker, std::chrono::milliseconds(5000));
+        CHECK(collector.seen.empty());
+        CHECK(progress.files == tree.files);
+        CHECK(progress.candidates == 0);
+    }
+}
+/// ------------------
+
+/// Cancellation
+/// ------------------
+// Cancelled by onFile after a few candidates, or by a walker partway into
+// the tree. Run has to come back without walking the rest, and nothing may
+// call onFile after it did.
+static void TestCancelMidWalk()
+{
+    for (unsigned hashers : { INLINE, 1u, 4u }) {
+        for (bool fromHasher : { true, false }) {
+            MemoryFileSystem fs;
+            Tree tree = BuildTree(fs, 200 + hashers, 4, 10, 20);
+            ScanProgress progress;
+            std::atomic<bool> cancel = false;
+            std::atomic<bool> returned = false;
+            std::atomic<unsigned> late = 0;
+            std::atomic<unsigned> calls = 0;
+            if (!fromHasher) {
+                fs.onList = [&](const std::wstring&) {
+                    if (fs.lists >= 20)
+                        cancel = true;
+                };
+            }
+            ScanWalker walker(fs, progress, cancel, IsExe, [&](const std::wstring&) {
+                if (returned)
+                    late++;
+                if (++calls == 10 && fromHasher)
+                    cancel = true;
+            }, 8, hashers);
+
+            auto took = RunWithin(walker, std::chrono::milliseconds(5000));
+            returned = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            if (took > std::chrono::milliseconds(1000))
+                fprintf(stderr, "%u hashers: cancelling took %lld ms\n", hashers, (long long)took.count());
+            CHECK(took < std::chrono::milliseconds(1000));
+            CHECK(late == 0);
+            CHECK(calls < tree.candidates.size());
+            CHECK(fs.lists < tree.dirs.size());
+            CHECK(progress.processed == calls);
+        }
+    }
+}
+/// ------------------
+
+/// Back-pressure
+/// ------------------
+// onFile blocks until the gate opens, or until cancel is set
+struct Gate {
+    std::mutex lock;
+    std::condition_variable changed;
+    bool open = false;
+    std::atomic<unsigned> waiting = 0;
+
+    void Wait(const std::atomic<bool>& cancel)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        waiting++;
+        while (!open && !cancel)
+            changed.wait_for(guard, std::chrono::milliseconds(10));
+        waiting--;
+    }
+    void Open()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        open = true;
+        changed.notify_all();
+    }
+};
+
+// Waits until the walkers stop finding candidates, which they only do once
+// the queue is full and every one of them is blocked pushing to it
+static uint32_t WaitForStall(ScanProgress& progress)
+{
+    uint32_t last = progress.candidates;
+    int quiet = 0;
+    for (int i = 0; i < 500 && quiet < 15; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint32_t now = progress.candidates;
+        quiet = now == last ? quiet + 1 : 0;
+        last = now;
+    }
+    return last;
+}
+
+static void TestBackPressure()
+{
+    constexpr unsigned WALKERS = 4;
+    constexpr unsigned HASHERS = 3;
+
+    for (bool cancelled : { false, true }) {
+        // Thousands of candidates, far more than the queue holds
+        MemoryFileSystem fs;
+        Tree tree = BuildTree(fs, 300, 3, 12, 40);
+        CHECK(tree.candidates.size() > 10 * QUEUE_SIZE);
+
+        ScanProgress progress;
+        std::atomic<bool> cancel = false;
+        Gate gate;
+        Collector collector;
+        auto collect = collector.Func();
+        ScanWalker walker(fs, progress, cancel, IsExe, [&](const std::wstring& path) {
+            gate.Wait(cancel);
+            collect(path);
+        }, WALKERS, HASHERS);
+
+        auto run = std::async(std::launch::async, [&] { walker.Run(L"C:\\Games"); });
+        uint32_t candidates = WaitForStall(progress);
+        // Every hasher holds one and the queue is full. Each walker has
+        // counted the one it's stuck trying to push.
+        uint32_t inFlight = candidates - progress.processed;
+        if (inFlight < QUEUE_SIZE + HASHERS || inFlight > QUEUE_SIZE + HASHERS + WALKERS)
+            fprintf(stderr, "%u candidates in flight with a queue of %zu\n", inFlight, QUEUE_SIZE);
+        CHECK(gate.waiting == HASHERS);
+        CHECK(progress.processed == 0);
+        CHECK(inFlight >= QUEUE_SIZE + HASHERS);
+        CHECK(inFlight <= QUEUE_SIZE + HASHERS + WALKERS);
+        CHECK(fs.lists < tree.dirs.size());
+
+        auto begin = std::chrono::steady_clock::now();
+        if (cancelled) {
+            cancel = true;
+        } else {
+            gate.Open();
+        }
+        if (run.wait_for(std::chrono::milliseconds(20000)) == std::future_status::timeout) {
+            fprintf(stderr, "scan_walker_test: Run still going after the queue was %s\n", cancelled ? "cancelled" : "opened");
+            fflush(stderr);
+            _Exit(1);
+        }
+        auto took = std::chrono::steady_clock::now() - begin;
+
+        if (cancelled) {
+            // Blocked walkers and hashers see it within a poll, and the
+            // hashers finish what they hold but take nothing more
+            CHECK(took < std::chrono::milliseconds(1000));
+            CHECK(progress.processed == HASHERS);
+            CHECK(collector.seen.size() == HASHERS);
+        } else {
+            CHECK(collector.Sorted() == tree.candidates);
+            CHECK(progress.processed == tree.candidates.size());
+        }
+    }
+}
+/// ------------------
+
+/// Progress
+/// ------------------
+// Writers publish paths long enough to live on the heap, without the
+// interval, while the reader copies them as fast as it can. A path is one character repeated a length
+// that depends on it, so a copy of a slot that was being rewritten shows.
+static void TestProgressRing()
+{
+    constexpr unsigned WRITERS = 8;
+    ScanProgress progress;
+    std::wstring path;
+    CHECK(!progress.Current(path));
+
+    std::vector<ScanProgress::Writer*> writers;
+    for (unsigned i = 0; i < WRITERS; i++)
+        writers.push_back(&progress.NewWriter(std::chrono::steady_clock::duration::zero()));
+
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < WRITERS; i++) {
+        threads.emplace_back([&, i]() {
+            std::mt19937 rng(i);
+            while (!stop) {
+                wchar_t c = (wchar_t)(L'A' + rng() % 26);
+                writers[i]->Publish(std::wstring(64 + (c - L'A') * 8, c));
+                if (rng() % 64 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    unsigned reads = 0;
+    unsigned torn = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < end) {
+        if (!progress.Current(path))
+            continue;
+        reads++;
+        wchar_t c = path[0];
+        if (c < L'A' || c > L'Z' || path.size() != 64 + (size_t)(c - L'A') * 8 || path.find_first_not_of(c) != std::wstring::npos)
+            torn++;
+    }
+    stop = true;
+    for (auto& t : threads)
+        t.join();
+
+    CHECK(reads > 0);
+    CHECK(torn == 0);
+
+    progress.Reset();
+    CHECK(!progress.Current(path));
+}
+/// ------------------
+
+/// Benchmark
+/// ------------------
+static double Milliseconds(MemoryFileSystem& fs, unsigned walkers, unsigned hashers)
+{
+    double best = 1e9;
+    for (int pass = 0; pass < 3; pass++) {
+        ScanProgress progress;
+        std::atomic<bool> cancel = false;
+        ScanWalker walker(fs, progress, cancel, IsExe, [](const std::wstring&) {}, walkers, hashers);
+        auto begin = std::chrono::steady_clock::now();
+        walker.Run(L"C:\\Games");
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+    return best;
+}
+
+static void Bench()
+{
+    MemoryFileSystem fs;
+    Tree tree = BuildTree(fs, 400, 4, 9, 20);
+    printf("%zu directories, %u files, %zu candidates\n", tree.dirs.size(), tree.files, tree.candidates.size());
+    printf("%-8s %12s %12s %12s\n", "walkers", "no delay", "50us delay", "speedup");
+    double base = 0;
+    for (unsigned walkers : { 1u, 2u, 4u, 8u, 12u, 16u }) {
+        fs.latency = std::chrono::microseconds(0);
+        double cpu = Milliseconds(fs, walkers, 2);
+        fs.latency = std::chrono::microseconds(50);
+        double io = Milliseconds(fs, walkers, 2);
+        if (walkers == 1)
+            base = io;
+        printf("%-8u %9.1f ms %9.1f ms %11.2fx\n", walkers, cpu, io, base / io);
+    }
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    TestComplete();
+    TestEdges();
+    TestCancelMidWalk();
+    TestBackPressure();
+    TestProgressRing();
+
+    if (argc > 1 && !strcmp(argv[1], "--bench"))
+        Bench();
+
+    if (gFailures) {
+        fprintf(stderr, "scan_walker_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("scan_walker_test: all passed\n");
+    return 0;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+// The scalar TH19 kernels that blobs/th19_fast.h replaced, as they were
+// before being vectorized, for th19_fast_test.cpp to compare against.
+// Include blobs/th19_fast.h first.
+
+template <typename T>
+T __forceinline square(T val)
+{
+    return val * val;
+}
+
+inline uint32_t* CPUHitInf_CheckColliders_ref(CPUHitInf* self, uint32_t* hit_flags_ptr, float radius)
+{
+    __m128 temp = _mm_mul_ps(
+        _mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)&self->game_side_ptr->player_ptr->unfocused_linear_speed)),
+        _mm_set1_ps(1.0f / 128.0f));
+    float unfocused_linear_px = A(temp)[0];
+    float focused_linear_px = A(temp)[1];
+    float unfocused_diagonal_px = A(temp)[2];
+    float focused_diagonal_px = A(temp)[3];
+
+    Float2 check_pos_list[18];
+    for (size_t i = 0; i < elementsof(check_pos_list); i++)
+        check_pos_list[i] = Float2 { self->pos.x, self->pos.y };
+    check_pos_list[1].y = check_pos_list[1].y - unfocused_linear_px;
+    check_pos_list[2].y = check_pos_list[2].y + unfocused_linear_px;
+    check_pos_list[3].x = check_pos_list[3].x - unfocused_linear_px;
+    check_pos_list[4].x = check_pos_list[4].x + unfocused_linear_px;
+    check_pos_list[5].x = check_pos_list[5].x - unfocused_diagonal_px;
+    check_pos_list[5].y = check_pos_list[5].y - unfocused_diagonal_px;
+    check_pos_list[6].x = check_pos_list[6].x + unfocused_diagonal_px;
+    check_pos_list[6].y = check_pos_list[6].y - unfocused_diagonal_px;
+    check_pos_list[7].x = check_pos_list[7].x - unfocused_diagonal_px;
+    check_pos_list[7].y = check_pos_list[7].y + unfocused_diagonal_px;
+    check_pos_list[8].x = check_pos_list[8].x + unfocused_diagonal_px;
+    check_pos_list[8].y = check_pos_list[8].y + unfocused_diagonal_px;
+    check_pos_list[10].y = check_pos_list[10].y - focused_linear_px;
+    check_pos_list[11].y = check_pos_list[11].y + focused_linear_px;
+    check_pos_list[12].x = check_pos_list[12].x - focused_linear_px;
+    check_pos_list[13].x = check_pos_list[13].x + focused_linear_px;
+    check_pos_list[14].x = check_pos_list[14].x - focused_diagonal_px;
+    check_pos_list[14].y = check_pos_list[14].y - focused_diagonal_px;
+    check_pos_list[15].x = check_pos_list[15].x + focused_diagonal_px;
+    check_pos_list[15].y = check_pos_list[15].y - focused_diagonal_px;
+    check_pos_list[16].x = check_pos_list[16].x - focused_diagonal_px;
+    check_pos_list[16].y = check_pos_list[16].y + focused_diagonal_px;
+    check_pos_list[17].x = check_pos_list[17].x + focused_diagonal_px;
+    check_pos_list[17].y = check_pos_list[17].y + focused_diagonal_px;
+    for (size_t i = 0; i < elementsof(check_pos_list); i++) {
+        check_pos_list[i].x = std::clamp(check_pos_list[i].x, -140.0f, 140.0f);
+        check_pos_list[i].y = std::clamp(check_pos_list[i].y, 32.0f, 448.0f - 16.0f);
+    }
+    uint32_t hit_flags = 0;
+    float radius_sq = radius * radius;
+    for (int32_t i = 0; i < self->collider_count; i++) {
+        CPUCollider* collider = &self->colliders1[i];
+        if (collider->flags & 1) {
+            float total_dist = (collider->radius * collider->radius) + radius_sq;
+            for (size_t j = 0; j < elementsof(check_pos_list); j++) {
+                if ((hit_flags >> j) & 1)
+                    continue;
+                float x_diff = check_pos_list[j].x - collider->pos.x;
+                float y_diff = check_pos_list[j].y - collider->pos.y;
+                if (total_dist > (y_diff * y_diff) + (x_diff * x_diff))
+                    hit_flags |= 1 << j;
+            }
+        } else {
+            auto angle_sincos = sincos(-collider->angle);
+            float half_size_x = collider->size.x * 0.5f;
+            float half_size_y = collider->size.y * 0.5f;
+            for (size_t j = 0; j < elementsof(check_pos_list); j++) {
+                if ((hit_flags >> j) & 1)
+                    continue;
+                float x_diff = check_pos_list[j].x - collider->pos.x;
+                float y_diff = check_pos_list[j].y - collider->pos.y;
+                float rot_x = (A(angle_sincos)[1] * x_diff) - (A(angle_sincos)[0] * y_diff);
+                float rot_y = (A(angle_sincos)[1] * y_diff) + (A(angle_sincos)[0] * x_diff);
+                float x_sq1 = square(rot_x - half_size_x);
+                float x_sq2 = square(half_size_x + rot_x);
+                float y_sq1 = square(rot_y - half_size_y);
+                float y_sq2 = square(half_size_y + rot_y);
+                if (((half_size_x + radius) >= fabsf(rot_x) && half_size_y >= fabsf(rot_y))
+                    || (half_size_x >= fabsf(rot_x) && (half_size_y + radius) >= fabsf(rot_y))
+                    || radius_sq > x_sq1 + y_sq1
+                    || radius_sq > x_sq2 + y_sq1
+                    || radius_sq > x_sq1 + y_sq2
+                    || radius_sq > x_sq2 + y_sq2) {
+                    hit_flags |= 1 << j;
+                }
+            }
+        }
+    }
+    *hit_flags_ptr = hit_flags;
+    return hit_flags_ptr;
+}
+
+inline bool _RxD1E00_ref(
+    int a1,
+    float a2, float a3, float a4, float a5,
+    float a6, float a7, float a8, float a9,
+    float a10)
+{
+    __m128 sincos_a10_2 = sincos(a10);
+
+    for (int i = 0; i < a1 * 2; ++i) {
+        float v13 = a8;
+        if (i & 1)
+            v13 = a9;
+
+        __m128 sincos_a10_1 = sincos_a10_2;
+
+        a10 = angle_normalize(a10 + ZUN_PI / a1);
+
+        sincos_a10_2 = sincos(a10);
+
+        if (line_segments_intersect_2d(
+                (A(sincos_a10_1)[1] * v13) + a6,
+                (A(sincos_a10_1)[0] * v13) + a7,
+
+                (A(sincos_a10_2)[1] * v13) + a6,
+                (A(sincos_a10_2)[0] * v13) + a7,
+                a2, a3, a4, a5)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,464 @@
+// Checks the TH19 kernels in blobs/th19_fast.h bit for bit against the scalar
+// code they replaced (th19_fast_reference.h), and benchmarks them. Builds and
+// runs on Linux:
+//
+//   g++ -std=c++20 -O2 -Wall -msse2 th19_fast_test.cpp -o th19_fast_test
+//   ./th19_fast_test [fixtures]            (golden values and fuzz)
+//   ./th19_fast_test [fixtures] --bench    (then benchmark)
+//
+// thprac builds th19_fast.cpp as 32 bit code with fast math, so run_tests.sh
+// also builds this with -m32 -mfpmath=sse -ffast-math, or just -ffast-math
+// when there are no 32 bit libraries.
+//
+// The game's sincos isn't available here, so both sides use sinf/cosf. That
+// doesn't match TH19's values, but both sides get the same ones, which is all
+// that comparing them needs.
+
+#include <emmintrin.h>
+#include <math.h>
+
+static inline __m128 sincos(float x)
+{
+    return _mm_setr_ps(sinf(x), cosf(x), 0.0f, 0.0f);
+}
+
+#include "../src/thprac/blobs/th19_fast.h"
+#include "th19_fast_reference.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::mt19937 gRng(19);
+static int gFailures;
+
+static float Uniform(float lo, float hi)
+{
+    return std::uniform_real_distribution<float>(lo, hi)(gRng);
+}
+
+static bool Chance(int percent)
+{
+    return (int)(gRng() % 100) < percent;
+}
+
+// Built with -ffast-math, like the game's copy, the compiler may assume that
+// there are no NaNs or infinities, on both sides. Feeding them in would only
+// test what it made of that assumption.
+#ifdef __FAST_MATH__
+constexpr bool NON_FINITE = false;
+#else
+constexpr bool NON_FINITE = true;
+#endif
+
+// Mostly ordinary values. Sometimes snapped to a coarse grid, so that
+// distances and edges line up exactly, and sometimes something nasty.
+static float FuzzFloat(float lo, float hi)
+{
+    uint32_t kind = gRng() % 64;
+    if (kind == 0 && NON_FINITE)
+        return NAN;
+    if (kind == 1 && NON_FINITE)
+        return Chance(50) ? INFINITY : -INFINITY;
+    if (kind == 2)
+        return 0.0f;
+    if (kind == 3)
+        return -0.0f;
+    float v = Uniform(lo, hi);
+    if (kind < 40)
+        v = roundf(v * 4.0f) / 4.0f;
+    return v;
+}
+
+/// Colliders
+/// ------------------
+static float Quarter(float lo, float hi)
+{
+    return roundf(Uniform(lo, hi) * 4.0f) / 4.0f;
+}
+
+// Puts the collider exactly on the edge of hitting probe 0, which is at the
+// player's own (clamped) position. Everything is a multiple of 1/4 and the
+// rectangle isn't rotated, so all the arithmetic is exact and the result only
+// depends on whether each comparison includes equality.
+static void PlaceOnEdge(CPUCollider* c, const CPUHitInf* hitInf, float radius)
+{
+    float px = std::clamp(hitInf->pos.x, -140.0f, 140.0f);
+    float py = std::clamp(hitInf->pos.y, 32.0f, 448.0f - 16.0f);
+    float dx, dy;
+    if (c->flags & 1) {
+        // total_dist == dist
+        c->radius = Quarter(0.0f, 16.0f);
+        dx = c->radius;
+        dy = radius;
+        if (Chance(50))
+            std::swap(dx, dy);
+    } else {
+        c->size.x = Quarter(0.0f, 32.0f) * 2.0f;
+        c->size.y = Quarter(0.0f, 32.0f) * 2.0f;
+        c->angle = 0.0f;
+        float hx = c->size.x * 0.5f, hy = c->size.y * 0.5f;
+        switch (gRng() % 4) {
+        case 0: // half_size_x + radius == |rot_x|
+            dx = hx + radius;
+            dy = Quarter(-hy, hy);
+            break;
+        case 1: // half_size_y + radius == |rot_y|
+            dx = Quarter(-hx, hx);
+            dy = hy + radius;
+            break;
+        case 2: // On a corner, radius_sq == the distance to it
+            dx = hx + radius;
+            dy = hy;
+            break;
+        default: // half_size_x == |rot_x|, half_size_y == |rot_y|
+            dx = hx;
+            dy = hy;
+            break;
+        }
+    }
+    c->pos.x = px - (Chance(50) ? dx : -dx);
+    c->pos.y = py - (Chance(50) ? dy : -dy);
+}
+
+static void FillHitInf(CPUHitInf* hitInf, Player* player, int colliderCount, float spread, float radius)
+{
+    hitInf->pos.x = FuzzFloat(-180.0f, 180.0f);
+    hitInf->pos.y = FuzzFloat(0.0f, 480.0f);
+    player->unfocused_linear_speed = Chance(90) ? (int32_t)(gRng() % 1024) : (int32_t)gRng();
+    player->focused_linear_speed = Chance(90) ? (int32_t)(gRng() % 512) : (int32_t)gRng();
+    player->unfocused_diagonal_speed = Chance(90) ? (int32_t)(gRng() % 1024) : (int32_t)gRng();
+    player->focused_diagonal_speed = Chance(90) ? (int32_t)(gRng() % 512) : (int32_t)gRng();
+
+    hitInf->collider_count = colliderCount;
+    for (int i = 0; i < colliderCount; i++) {
+        CPUCollider* c = &hitInf->colliders1[i];
+        memset(c, 0, sizeof(*c));
+        bool near = Chance(50) && isfinite(hitInf->pos.x) && isfinite(hitInf->pos.y);
+        c->pos.x = near ? hitInf->pos.x + FuzzFloat(-spread, spread) : FuzzFloat(-200.0f, 200.0f);
+        c->pos.y = near ? hitInf->pos.y + FuzzFloat(-spread, spread) : FuzzFloat(0.0f, 480.0f);
+        c->flags = gRng() % 4;
+        c->radius = FuzzFloat(-2.0f, 24.0f);
+        c->size.x = FuzzFloat(-4.0f, 64.0f);
+        c->size.y = FuzzFloat(-4.0f, 64.0f);
+        // Unrotated rectangles make their edges exact
+        c->angle = Chance(25) ? 0.0f : FuzzFloat(-7.0f, 7.0f);
+        if (near && isfinite(radius) && Chance(25))
+            PlaceOnEdge(c, hitInf, radius);
+    }
+}
+
+static void TestColliders(int iterations)
+{
+    auto hitInf = std::make_unique<CPUHitInf>();
+    Player player {};
+    GameSide side {};
+    side.player_ptr = &player;
+    hitInf->game_side_ptr = &side;
+
+    int mismatches = 0;
+    for (int it = 0; it < iterations; it++) {
+        // Few colliders leave most probes unhit, so each one has to get every probe right.
+        // Many colliders exercise the early exit.
+        int count;
+        if (Chance(60))
+            count = 1 + gRng() % 4;
+        else if (Chance(95))
+            count = gRng() % 400;
+        else
+            count = gRng() % 30000;
+        float radius = FuzzFloat(-1.0f, 6.0f);
+        FillHitInf(hitInf.get(), &player, count, Chance(50) ? 8.0f : 48.0f, radius);
+
+        uint32_t expected = 0xDEADBEEF, actual = 0xDEADBEEF;
+        CPUHitInf_CheckColliders_ref(hitInf.get(), &expected, radius);
+        uint32_t* ret = CPUHitInf_CheckColliders_impl(hitInf.get(), &actual, radius);
+        if (ret != &actual || expected != actual) {
+            if (mismatches++ < 8)
+                fprintf(stderr, "colliders: iteration %d: 0x%05X, expected 0x%05X\n", it, actual, expected);
+        }
+    }
+    if (mismatches) {
+        fprintf(stderr, "colliders: %d of %d iterations differ\n", mismatches, iterations);
+        gFailures++;
+    }
+}
+
+template <typename F>
+static double NsPerCall(int calls, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+        f();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / calls;
+}
+
+// A full CPU vs CPU screen: 30000 colliders over the whole playfield, half of
+// them rectangles. With clearing set, none come within 48 pixels of the
+// player, so nothing is hit and every collider has to be looked at.
+static void BenchColliders(bool clearing)
+{
+    auto hitInf = std::make_unique<CPUHitInf>();
+    Player player {};
+    player.unfocused_linear_speed = 4 * 128;
+    player.focused_linear_speed = 2 * 128;
+    player.unfocused_diagonal_speed = 362;
+    player.focused_diagonal_speed = 181;
+    GameSide side {};
+    side.player_ptr = &player;
+    hitInf->game_side_ptr = &side;
+    hitInf->pos = { { 0.0f, 400.0f }, 0.0f };
+    hitInf->collider_count = 30000;
+    for (int i = 0; i < 30000; i++) {
+        CPUCollider* c = &hitInf->colliders1[i];
+        memset(c, 0, sizeof(*c));
+        do {
+            c->pos.x = Uniform(-192.0f, 192.0f);
+            c->pos.y = Uniform(0.0f, 448.0f);
+        } while (clearing && fabsf(c->pos.x - hitInf->pos.x) < 48.0f && fabsf(c->pos.y - hitInf->pos.y) < 48.0f);
+        c->flags = i & 1;
+        c->radius = Uniform(2.0f, 12.0f);
+        c->size = { Uniform(4.0f, 32.0f), Uniform(4.0f, 32.0f) };
+        c->angle = Uniform(-3.14f, 3.14f);
+    }
+
+    uint32_t ref_flags, fast_flags;
+    double ref = NsPerCall(50, [&] { CPUHitInf_CheckColliders_ref(hitInf.get(), &ref_flags, 2.5f); });
+    double fast = NsPerCall(50, [&] { CPUHitInf_CheckColliders_impl(hitInf.get(), &fast_flags, 2.5f); });
+    printf("CPUHitInf_CheckColliders, 30000 colliders%s: %.1f us scalar, %.1f us fast, hits 0x%05X/0x%05X\n",
+        clearing ? " around a clearing" : "", ref / 1000.0, fast / 1000.0, ref_flags, fast_flags);
+}
+
+/// Polygon edges
+/// ------------------
+static_assert(std::bit_cast<uint32_t>(ZUN_PI) == 0x40490FDB);
+
+// Coordinates from a small integer grid make collinear and touching segments,
+// which take the branches that random floats almost never reach
+static float EdgeCoord(int mode)
+{
+    switch (mode) {
+    case 0:
+        return (float)((int)(gRng() % 7) - 3);
+    case 1:
+        return FuzzFloat(-500.0f, 500.0f);
+    default:
+        return Uniform(-1.0f, 1.0f);
+    }
+}
+
+static void TestEdgeLanes(int iterations)
+{
+    int mismatches = 0;
+    for (int it = 0; it < iterations; it++) {
+        int mode = it % 3;
+        alignas(16) float x1[4], y1[4], x2[4], y2[4];
+        for (int l = 0; l < 4; l++) {
+            x1[l] = EdgeCoord(mode);
+            y1[l] = EdgeCoord(mode);
+            x2[l] = Chance(5) ? x1[l] : EdgeCoord(mode);
+            y2[l] = Chance(5) ? y1[l] : EdgeCoord(mode);
+        }
+        float a5 = EdgeCoord(mode), a6 = EdgeCoord(mode);
+        float a7 = Chance(5) ? a5 : EdgeCoord(mode), a8 = Chance(5) ? a6 : EdgeCoord(mode);
+
+        int actual = line_segments_intersect_2d_x4(
+            _mm_load_ps(x1), _mm_load_ps(y1), _mm_load_ps(x2), _mm_load_ps(y2), a5, a6, a7, a8);
+        for (int l = 0; l < 4; l++) {
+            bool expected = line_segments_intersect_2d(x1[l], y1[l], x2[l], y2[l], a5, a6, a7, a8);
+            if (expected != (((actual >> l) & 1) != 0) && mismatches++ < 8) {
+                fprintf(stderr, "edges: (%a, %a)-(%a, %a) vs (%a, %a)-(%a, %a): %d, expected %d\n",
+                    x1[l], y1[l], x2[l], y2[l], a5, a6, a7, a8, !expected, expected);
+            }
+        }
+    }
+    if (mismatches) {
+        fprintf(stderr, "edges: %d lanes differ\n", mismatches);
+        gFailures++;
+    }
+}
+
+struct RxD1E00Args {
+    int a1;
+    float a2, a3, a4, a5, a6, a7, a8, a9, a10;
+};
+
+static bool RxD1E00Fast(const RxD1E00Args& a)
+{
+    return _RxD1E00_fast_impl(a.a1, a.a2, a.a3, a.a4, a.a5, a.a6, a.a7, a.a8, a.a9, a.a10);
+}
+
+static bool RxD1E00Ref(const RxD1E00Args& a)
+{
+    return _RxD1E00_ref(a.a1, a.a2, a.a3, a.a4, a.a5, a.a6, a.a7, a.a8, a.a9, a.a10);
+}
+
+static RxD1E00Args FuzzPolygon()
+{
+    RxD1E00Args a;
+    // Odd edge counts leave the last group of 4 partly empty
+    a.a1 = Chance(95) ? (int)(gRng() % 24) : (int)(gRng() % 200) - 20;
+    a.a6 = FuzzFloat(-200.0f, 200.0f);
+    a.a7 = FuzzFloat(0.0f, 450.0f);
+    a.a8 = FuzzFloat(0.0f, 64.0f);
+    a.a9 = Chance(50) ? a.a8 : FuzzFloat(0.0f, 64.0f);
+    // An infinite angle never gets normalized, in the game too
+    do
+        a.a10 = Chance(90) ? FuzzFloat(-4.0f, 4.0f) : FuzzFloat(-1000.0f, 1000.0f);
+    while (isinf(a.a10));
+    // The query segment, usually close enough to the polygon to matter
+    float reach = isfinite(a.a8) ? fabsf(a.a8) * 1.5f + 1.0f : 100.0f;
+    a.a2 = a.a6 + FuzzFloat(-reach, reach);
+    a.a3 = a.a7 + FuzzFloat(-reach, reach);
+    a.a4 = Chance(10) ? a.a2 : a.a6 + FuzzFloat(-reach, reach);
+    a.a5 = Chance(10) ? a.a3 : a.a7 + FuzzFloat(-reach, reach);
+    return a;
+}
+
+static void TestPolygons(int iterations)
+{
+    int mismatches = 0, hits = 0;
+    for (int it = 0; it < iterations; it++) {
+        RxD1E00Args a = FuzzPolygon();
+        bool expected = RxD1E00Ref(a);
+        hits += expected;
+        if (RxD1E00Fast(a) != expected && mismatches++ < 8) {
+            fprintf(stderr, "polygons: %d, %a, %a, %a, %a, %a, %a, %a, %a, %a: %d, expected %d\n",
+                a.a1, a.a2, a.a3, a.a4, a.a5, a.a6, a.a7, a.a8, a.a9, a.a10, !expected, expected);
+        }
+    }
+    if (mismatches) {
+        fprintf(stderr, "polygons: %d of %d differ\n", mismatches, iterations);
+        gFailures++;
+    }
+    // Both outcomes need to be common for the comparison to mean anything
+    if (hits < iterations / 10 || hits > iterations * 9 / 10) {
+        fprintf(stderr, "polygons: %d of %d hit\n", hits, iterations);
+        gFailures++;
+    }
+}
+
+static void BenchPolygons()
+{
+    std::vector<RxD1E00Args> polygons(4096);
+    for (auto& a : polygons) {
+        a = FuzzPolygon();
+        a.a1 = 4 + gRng() % 12;
+        // Far away, so every edge is tested
+        a.a2 = a.a4 = a.a6 + 1000.0f;
+    }
+    // A pass takes about a millisecond, so take the best of many, alternating
+    // between the two so that neither gets a quieter machine
+    int sink = 0;
+    double ref = INFINITY, fast = INFINITY;
+    for (int pass = 0; pass < 50; pass++) {
+        ref = std::min(ref, NsPerCall(polygons.size(), [&, i = 0]() mutable { sink += RxD1E00Ref(polygons[i++]); }));
+        fast = std::min(fast, NsPerCall(polygons.size(), [&, i = 0]() mutable { sink += RxD1E00Fast(polygons[i++]); }));
+    }
+    printf("_RxD1E00_fast, 8-30 edges, no hit: %.0f ns scalar, %.0f ns fast (%d)\n", ref, fast, sink);
+}
+
+/// Golden values
+/// ------------------
+static void TestGolden(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "golden: can't open %s\n", path);
+        gFailures++;
+        return;
+    }
+
+    auto hitInf = std::make_unique<CPUHitInf>();
+    Player player {};
+    GameSide side {};
+    side.player_ptr = &player;
+    hitInf->game_side_ptr = &side;
+
+    int cases = 0, mismatches = 0;
+    char kind;
+    while (fscanf(f, " %c", &kind) == 1) {
+        if (kind == '#') {
+            fscanf(f, "%*[^\n]");
+            continue;
+        }
+        bool ok = false, expected_matches = false;
+        if (kind == 'C') {
+            float radius;
+            uint32_t expected;
+            ok = fscanf(f, "%a %a %d %d %d %d %a %d", &hitInf->pos.x, &hitInf->pos.y,
+                     &player.unfocused_linear_speed, &player.focused_linear_speed,
+                     &player.unfocused_diagonal_speed, &player.focused_diagonal_speed,
+                     &radius, &hitInf->collider_count) == 8
+                && hitInf->collider_count >= 0 && hitInf->collider_count <= 30000;
+            for (int i = 0; ok && i < hitInf->collider_count; i++) {
+                CPUCollider* c = &hitInf->colliders1[i];
+                ok = fscanf(f, "%u %a %a %a %a %a %a", &c->flags, &c->pos.x, &c->pos.y,
+                         &c->radius, &c->size.x, &c->size.y, &c->angle) == 7;
+            }
+            ok = ok && fscanf(f, "%x", &expected) == 1;
+            if (ok) {
+                uint32_t actual, reference;
+                CPUHitInf_CheckColliders_impl(hitInf.get(), &actual, radius);
+                CPUHitInf_CheckColliders_ref(hitInf.get(), &reference, radius);
+                expected_matches = actual == expected && reference == expected;
+            }
+        } else if (kind == 'P') {
+            RxD1E00Args a;
+            int expected;
+            ok = fscanf(f, "%d %a %a %a %a %a %a %a %a %a %d", &a.a1, &a.a2, &a.a3, &a.a4, &a.a5,
+                     &a.a6, &a.a7, &a.a8, &a.a9, &a.a10, &expected) == 11;
+            if (ok)
+                expected_matches = RxD1E00Fast(a) == (expected != 0) && RxD1E00Ref(a) == (expected != 0);
+        }
+        if (!ok) {
+            fprintf(stderr, "golden: can't parse case %d in %s\n", cases + 1, path);
+            gFailures++;
+            break;
+        }
+        cases++;
+        if (!expected_matches && mismatches++ < 8)
+            fprintf(stderr, "golden: case %d (%c) doesn't match\n", cases, kind);
+    }
+    fclose(f);
+
+    if (mismatches || cases < 100) {
+        fprintf(stderr, "golden: %d of %d cases differ\n", mismatches, cases);
+        gFailures++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool bench = false;
+    std::string fixtures = "fixtures";
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bench"))
+            bench = true;
+        else
+            fixtures = argv[i];
+    }
+
+    TestGolden((fixtures + "/th19_fast_golden.txt").c_str());
+    TestColliders(20000);
+    TestEdgeLanes(300000);
+    TestPolygons(100000);
+
+    if (gFailures) {
+        fprintf(stderr, "th19_fast_test: %d tests failed\n", gFailures);
+        return 1;
+    }
+    printf("th19_fast_test: all passed\n");
+
+    if (bench) {
+        BenchColliders(false);
+        BenchColliders(true);
+        BenchPolygons();
+    }
+    return 0;
+}
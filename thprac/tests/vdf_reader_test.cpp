@@ -0,0 +1,280 @@
+// Runs the Steam library parsers in thprac_launcher_steam.cpp over the files
+// in fixtures/vdf, then fuzzes them with mutated copies of those files. Builds
+// and runs on Linux:
+//
+//   g++ -std=c++20 -O1 -Wall -Wextra -fsanitize=address,undefined vdf_reader_test.cpp ../src/thprac/thprac_launcher_steam.cpp -o vdf_reader_test
+//   ./vdf_reader_test fixtures [iterations]
+//
+// Every call to VdfReader::Next that doesn't end the file has to consume at
+// least a byte, so a reader that returns more tokens than its input has bytes
+// is stuck. The parsers loop until the reader ends, so they're run under an
+// alarm instead. Whatever input broke it is written to vdf_failure.bin.
+//
+// With clang, -DVDF_LIBFUZZER -fsanitize=fuzzer,address builds a libFuzzer
+// target instead, which can be pointed at fixtures/vdf as its corpus.
+
+#include "../src/thprac/thprac_launcher_steam.h"
+#include <dirent.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace THPrac;
+
+static int gFailures;
+static std::string gCurrent;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            gFailures++;                                                     \
+        }                                                                    \
+    } while (0)
+
+static void SaveFailure(const std::string& text)
+{
+    if (FILE* f = fopen("vdf_failure.bin", "wb")) {
+        fwrite(text.data(), 1, text.size(), f);
+        fclose(f);
+    }
+}
+
+#ifndef VDF_LIBFUZZER
+// libFuzzer has its own timeout, which uses SIGALRM too
+static void OnAlarm(int)
+{
+    static const char msg[] = "vdf_reader_test: timed out, input written to vdf_failure.bin\n";
+    SaveFailure(gCurrent);
+    write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    _exit(1);
+}
+#endif
+
+// Reads the whole input with a bounded number of tokens, then again with
+// SkipSection after every section start, then through every parser
+static bool RunInput(const std::string& text)
+{
+    gCurrent = text;
+#ifndef VDF_LIBFUZZER
+    alarm(5);
+#endif
+
+    bool ok = true;
+    for (bool skip : { false, true }) {
+        VdfReader reader(text);
+        size_t tokens = 0;
+        VdfReader::Token token;
+        while ((token = reader.Next()) != VdfReader::VDF_EOF && token != VdfReader::VDF_ERROR) {
+            if (++tokens > text.size()) {
+                ok = false;
+                break;
+            }
+            if (skip && token == VdfReader::VDF_BEGIN && !reader.SkipSection()) {
+                break;
+            }
+        }
+        // Once done, the reader stays done
+        if (ok && reader.Next() != token && !(skip && token == VdfReader::VDF_BEGIN)) {
+            ok = false;
+        }
+    }
+    if (!ok) {
+#ifndef VDF_LIBFUZZER
+        alarm(0);
+#endif
+        SaveFailure(text);
+        return false;
+    }
+
+    std::vector<SteamLibrary> libraries;
+    SteamParseLibraryFolders(text, libraries);
+    std::string appId, installDir;
+    SteamParseAppManifest(text, appId, installDir);
+    auto files = [&](const std::string& path, std::string& out) {
+        if (path.find("libraryfolders") != std::string::npos || path.find("appmanifest") != std::string::npos) {
+            out = text;
+            return true;
+        }
+        return false;
+    };
+    SteamResolveApps("C:\\Steam", { "1100140", "937580" }, files);
+
+#ifndef VDF_LIBFUZZER
+    alarm(0);
+#endif
+    return true;
+}
+
+static bool ReadFile(const std::string& path, std::string& text)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::stringstream buf;
+    buf << file.rdbuf();
+    text = buf.str();
+    return true;
+}
+
+static std::vector<std::pair<std::string, std::string>> LoadCorpus(const std::string& dir)
+{
+    std::vector<std::pair<std::string, std::string>> corpus;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (auto entry = readdir(d)) {
+            std::string text;
+            if (entry->d_name[0] != '.' && ReadFile(dir + "/" + entry->d_name, text)) {
+                corpus.emplace_back(entry->d_name, text);
+            }
+        }
+        closedir(d);
+    }
+    std::sort(corpus.begin(), corpus.end());
+    return corpus;
+}
+
+static const std::string& Find(const std::vector<std::pair<std::string, std::string>>& corpus, const char* name)
+{
+    static const std::string empty;
+    for (auto& [n, text] : corpus) {
+        if (n == name)
+            return text;
+    }
+    fprintf(stderr, "fixture %s is missing\n", name);
+    gFailures++;
+    return empty;
+}
+
+static void TestCorpus(const std::vector<std::pair<std::string, std::string>>& corpus)
+{
+    for (auto& [name, text] : corpus) {
+        if (!RunInput(text)) {
+            fprintf(stderr, "%s: reader never ends\n", name.c_str());
+            gFailures++;
+        }
+    }
+
+    std::vector<SteamLibrary> libraries;
+    CHECK(SteamParseLibraryFolders(Find(corpus, "libraryfolders.vdf"), libraries));
+    CHECK(libraries.size() == 2);
+    if (libraries.size() == 2) {
+        CHECK(libraries[0].path == "C:\\Program Files (x86)\\Steam");
+        CHECK(libraries[0].listsApps && libraries[0].apps == std::vector<std::string>({ "228980", "1100140" }));
+        CHECK(libraries[1].path == "D:\\SteamLibrary");
+        CHECK(libraries[1].apps == std::vector<std::string>({ "937580", "1100150" }));
+    }
+
+    libraries.clear();
+    CHECK(SteamParseLibraryFolders(Find(corpus, "libraryfolders_old.vdf"), libraries));
+    CHECK(libraries.size() == 2);
+    if (libraries.size() == 2) {
+        CHECK(libraries[0].path == "D:\\SteamLibrary" && !libraries[0].listsApps);
+        CHECK(libraries[1].path == "E:\\Games\\Steam");
+    }
+
+    std::string appId, installDir;
+    CHECK(SteamParseAppManifest(Find(corpus, "appmanifest_1100140.acf"), appId, installDir));
+    CHECK(appId == "1100140" && installDir == "Touhou Kishinjou ~ Double Dealing Character");
+    CHECK(SteamParseAppManifest(Find(corpus, "appmanifest_quirks.acf"), appId, installDir));
+    CHECK(appId == "937580" && installDir == "th17");
+
+    VdfReader quirks(Find(corpus, "appmanifest_quirks.acf"));
+    CHECK(quirks.Next() == VdfReader::VDF_BEGIN && quirks.key() == "AppState");
+    CHECK(quirks.Next() == VdfReader::VDF_VALUE && quirks.value() == "Say \"hi\"\tthere\\ \\q");
+    CHECK(quirks.Next() == VdfReader::VDF_VALUE && quirks.key() == "unquoted" && quirks.value() == "value");
+
+    // A NUL right where a value should be used to be an empty token that
+    // never moved on
+    VdfReader nul(Find(corpus, "nul_after_key.acf"));
+    CHECK(nul.Next() == VdfReader::VDF_BEGIN);
+    CHECK(nul.Next() == VdfReader::VDF_ERROR);
+    CHECK(nul.Next() == VdfReader::VDF_ERROR);
+}
+
+// Byte level mutations, biased towards the characters the reader cares about
+static std::string Mutate(const std::string& seed, std::mt19937& rng)
+{
+    static const char special[] = { '\0', '"', '\\', '{', '}', '/', '[', ']', ' ', '\n', '\t', 'n', '$' };
+    std::string text = seed;
+    int count = 1 + rng() % 6;
+    for (int i = 0; i < count; i++) {
+        size_t pos = text.empty() ? 0 : rng() % (text.size() + 1);
+        char c = rng() % 4 ? special[rng() % sizeof(special)] : (char)rng();
+        switch (rng() % 5) {
+        case 0:
+            if (pos < text.size())
+                text[pos] = c;
+            break;
+        case 1:
+            text.insert(text.begin() + pos, c);
+            break;
+        case 2:
+            if (pos < text.size())
+                text.erase(pos, 1 + rng() % 8);
+            break;
+        case 3:
+            text.resize(pos);
+            break;
+        case 4: {
+            // Copy a random slice somewhere else, which makes nesting deeper
+            if (text.empty())
+                break;
+            size_t from = rng() % text.size();
+            size_t len = std::min<size_t>(1 + rng() % 64, text.size() - from);
+            text.insert(pos, text.substr(from, len));
+            break;
+        }
+        }
+    }
+    return text;
+}
+
+static void Fuzz(const std::vector<std::pair<std::string, std::string>>& corpus, int iterations)
+{
+    if (corpus.empty())
+        return;
+    std::mt19937 rng(21);
+    for (int i = 0; i < iterations; i++) {
+        auto& seed = corpus[rng() % corpus.size()].second;
+        if (!RunInput(Mutate(seed, rng))) {
+            fprintf(stderr, "fuzz iteration %d: reader never ends, input written to vdf_failure.bin\n", i);
+            gFailures++;
+            return;
+        }
+    }
+}
+
+#ifdef VDF_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (!RunInput(std::string((const char*)data, size)))
+        abort();
+    return 0;
+}
+#else
+int main(int argc, char** argv)
+{
+    signal(SIGALRM, OnAlarm);
+    std::string fixtures = argc > 1 ? argv[1] : "fixtures";
+    int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+
+    auto corpus = LoadCorpus(fixtures + "/vdf");
+    TestCorpus(corpus);
+    Fuzz(corpus, iterations);
+
+    if (gFailures) {
+        fprintf(stderr, "vdf_reader_test: %d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("vdf_reader_test: all passed, %d fuzzed inputs\n", iterations);
+    return 0;
+}
+#endif
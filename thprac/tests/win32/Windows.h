@@ -0,0 +1,5 @@
+#pragma once
+// Lets headers that include <Windows.h> only for the PE structures, like
+// utils/pe_view.h, be built against pe_shim.h. Add this folder to the include
+// path for that.
+#include "../pe_shim.h"
@@ -0,0 +1,1045 @@
+// Generates thprac_locale_def.h and thprac_locale_def.cpp from
+// thprac_games_def.json. Needs nothing but the standard library and the
+// rapidjson that comes with thprac, so it builds and runs anywhere:
+//
+//   g++ -std=c++20 -O2 -I ../src/3rdParties/rapidjson/include thprac_locale_gen.cpp -o thprac_locale_gen
+//   ./thprac_locale_gen ../src/thprac/thprac_games_def.json ../src/thprac
+//
+// Every string of every language goes into one pool, once. A string that is
+// the tail end of another one points into that one instead of getting its own
+// copy. The glossary and section tables only hold 32 bit offsets into the
+// pool, so unlike tables of char pointers they need no relocations and cost 4
+// bytes per entry instead of a pointer plus a literal each.
+//
+// The font glyph ranges for each language come from the same strings, so
+// every character a table holds is in the font atlas, and with
+// render_only_used_glyphs nothing else is.
+//
+// After writing, the .cpp is read back. Every string is compared against the
+// JSON, and every glyph range table against the codepoints it should cover.
+// "--check <json> <dir>" only does that, for files that already exist.
+
+#include <rapidjson/document.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+constexpr int LANGUAGES = 3;
+constexpr int DIFFICULTIES = 4;
+constexpr char DIFFICULTY_CHARS[] = "ENHL";
+constexpr const char* LANGUAGE_NAMES[LANGUAGES] = { "zh", "en", "ja" };
+// MSVC caps a string literal at 64K, so the pool is split into rows. The last
+// one is padded out to the full size, hence not going all the way up to 64K.
+constexpr uint32_t POOL_ROW = 0x4000;
+// MSVC also caps the pieces a literal is concatenated from at 16K each
+constexpr size_t PIECE_MAX = 16000;
+
+// What each language gets when the font isn't limited to the glyphs the strings
+// use, as pairs of first and last codepoint. Chinese is ImGui's full Chinese set.
+static const uint32_t BASE_GLYPHS_ZH[] = {
+    0x0020, 0x00FF, // Basic Latin + Latin Supplement
+    0x2000, 0x206F, // General Punctuation
+    0x3000, 0x30FF, // CJK Symbols and Punctuations, Hiragana, Katakana
+    0x31F0, 0x31FF, // Katakana Phonetic Extensions
+    0xFF00, 0xFFEF, // Half-width characters
+    0x4E00, 0x9FAF, // CJK Ideograms
+};
+static const uint32_t BASE_GLYPHS_EN[] = {
+    0x0020, 0x00FF, // Basic Latin + Latin Supplement
+};
+static const uint32_t BASE_GLYPHS_JA[] = {
+    0x0020, 0x00FF, // Basic Latin + Latin Supplement
+    0x3000, 0x30FF, // Punctuations, Hiragana, Katakana
+    0x31F0, 0x31FF, // Katakana Phonetic Extensions
+    0xFF00, 0xFFEF, // Half-width characters
+    0x2191, 0x2191, // Upwards arrow
+    0x2193, 0x2193, // Downwards arrow
+};
+// Japanese also gets these kanji. Each one is the previous one plus 1 plus its
+// entry, starting from 0x4E00.
+static const short JA_KANJI_FROM_0x4E00[] = {
+    -1, 0, 1, 3, 0, 0, 0, 0, 1, 0, 1, 0, 2, 1, 1, 0, 4, 2, 4, 3, 2, 4, 5, 0, 1, 0, 6, 0, 0, 2, 2, 1,
+    0, 0, 6, 0, 0, 0, 3, 0, 0, 17, 1, 10, 1, 1, 3, 1, 0, 1, 0, 1, 2, 0, 1, 0, 2, 0, 1, 0, 1, 2, 0, 1,
+    0, 0, 1, 2, 0, 0, 0, 4, 6, 0, 4, 0, 2, 1, 0, 2, 0, 1, 1, 4, 0, 0, 0, 0, 0, 3, 0, 0, 3, 0, 0, 7,
+    0, 1, 1, 3, 4, 5, 7, 0, 2, 0, 0, 0, 0, 8, 1, 0, 17, 0, 3, 1, 1, 1, 1, 0, 5, 2, 0, 5, 0, 0, 0, 0,
+    1, 1, 1, 1, 0, 0, 0, 0, 0, 10, 5, 0, 2, 1, 0, 4, 0, 2, 3, 2, 1, 2, 1, 1, 1, 6, 2, 1, 2, 0, 9, 1,
+    0, 0, 5, 0, 8, 2, 0, 0, 5, 3, 0, 0, 0, 5, 0, 1, 0, 1, 1, 0, 0, 1, 0, 0, 8, 0, 3, 1, 2, 1, 10, 0,
+    2, 1, 1, 4, 1, 1, 1, 0, 0, 1, 2, 1, 1, 0, 0, 0, 1, 0, 0, 0, 1, 8, 2, 9, 3, 0, 0, 5, 3, 1, 0, 3,
+    1, 8, 6, 5, 1, 0, 0, 1, 4, 2, 4, 7, 3, 6, 0, 0, 17, 0, 4, 0, 0, 0, 1, 6, 3, 2, 4, 2, 1, 1, 3, 4,
+    8, 1, 1, 5, 0, 6, 3, 1, 4, 0, 0, 1, 13, 1, 0, 2, 1, 3, 0, 1, 8, 7, 4, 2, 0, 0, 2, 0, 0, 1, 0, 0,
+    0, 0, 0, 0, 1, 0, 0, 0, 1, 3, 5, 1, 5, 2, 2, 1, 0, 0, 0, 3, 3, 0, 0, 0, 3, 3, 1, 2, 0, 2, 0, 1,
+    0, 1, 1, 0, 2, 0, 0, 1, 6, 1, 1, 0, 0, 1, 1, 1, 3, 0, 0, 1, 0, 0, 0, 5, 6, 1, 2, 0, 0, 0, 0, 13,
+    0, 0, 2, 0, 4, 0, 1, 0, 2, 2, 0, 4, 1, 0, 0, 2, 0, 1, 2, 2, 0, 0, 1, 3, 2, 0, 3, 0, 5, 6, 0, 3,
+    0, 3, 1, 2, 2, 0, 0, 0, 0, 0, 7, 0, 2, 2, 0, 0, 0, 6, 0, 0, 0, 3, 1, 5, 0, 0, 4, 4, 0, 1, 0, 0,
+    0, 7, 1, 3, 3, 0, 4, 4, 0, 7, 3, 0, 2, 5, 0, 0, 5, 2, 4, 4, 2, 1, 1, 1, 1, 8, 2, 2, 0, 3, 0, 0,
+    2, 1, 1, 0, 10, 7, 3, 0, 1, 0, 2, 0, 1, 4, 1, 0, 4, 0, 0, 1, 0, 1, 3, 0, 1, 6, 6, 6, 0, 0, 0, 3,
+    0, 0, 1, 1, 0, 0, 0, 0, 0, 2, 3, 0, 0, 0, 2, 0, 1, 1, 3, 5, 2, 4, 0, 0, 0, 1, 0, 0, 2, 6, 2, 1,
+    17, 1, 1, 4, 0, 4, 0, 1, 0, 3, 4, 0, 0, 6, 6, 0, 4, 0, 0, 0, 0, 0, 0, 5, 1, 0, 1, 1, 3, 1, 0, 0,
+    0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 1, 6, 1, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9, 1,
+    0, 0, 0, 5, 4, 0, 0, 0, 7, 1, 0, 1, 0, 0, 0, 3, 3, 1, 0, 0, 2, 0, 2, 13, 8, 1, 6, 1, 1, 0, 0, 3,
+    0, 0, 2, 3, 1, 5, 1, 3, 3, 5, 7, 0, 2, 2, 0, 5, 0, 4, 4, 2, 0, 2, 2, 0, 0, 23, 3, 2, 0, 3, 0, 3,
+    7, 9, 1, 0, 6, 1, 5, 24, 1, 1, 4, 5, 1, 3, 1, 8, 3, 2, 5, 1, 4, 23, 0, 1, 1, 2, 0, 2, 1, 0, 0, 12,
+    0, 0, 1, 0, 0, 0, 7, 0, 0, 0, 0, 0, 1, 1, 5, 13, 0, 1, 1, 10, 5, 1, 2, 3, 0, 4, 15, 3, 0, 7, 1, 0,
+    10, 1, 0, 0, 2, 13, 5, 1, 0, 1, 1, 1, 8, 0, 9, 1, 4, 7, 8, 3, 1, 0, 0, 2, 4, 3, 1, 5, 5, 0, 2, 4,
+    4, 4, 6, 1, 2, 6, 1, 13, 3, 0, 0, 0, 4, 0, 0, 6, 1, 3, 2, 0, 2, 1, 2, 10, 1, 1, 0, 5, 0, 2, 2, 2,
+    0, 6, 3, 2, 0, 1, 0, 1, 6, 7, 0, 4, 2, 15, 1, 2, 1, 2, 3, 0, 0, 0, 15, 2, 1, 2, 0, 12, 10, 8, 7, 8,
+    3, 1, 0, 0, 30, 2, 4, 2, 3, 0, 0, 7, 2, 0, 19, 0, 1, 1, 0, 1, 3, 1, 2, 0, 3, 0, 9, 3, 3, 3, 2, 5,
+    4, 0, 0, 2, 0, 4, 5, 0, 8, 1, 4, 0, 1, 2, 2, 3, 2, 2, 4, 1, 9, 3, 4, 4, 15, 3, 4, 0, 1, 8, 0, 9,
+    6, 0, 2, 2, 3, 1, 2, 1, 1, 2, 3, 6, 2, 11, 0, 1, 1, 0, 0, 4, 1, 0, 0, 0, 0, 11, 0, 4, 4, 0, 0, 2,
+    0, 1, 5, 2, 1, 1, 0, 0, 1, 0, 2, 5, 6, 5, 2, 0, 0, 4, 0, 0, 0, 2, 0, 1, 2, 5, 1, 2, 1, 0, 1, 3,
+    4, 0, 3, 4, 3, 0, 0, 0, 5, 2, 5, 2, 2, 9, 1, 2, 3, 12, 1, 2, 7, 2, 1, 4, 0, 1, 0, 4, 2, 8, 0, 0,
+    2, 0, 15, 3, 1, 1, 13, 6, 3, 2, 0, 4, 3, 5, 5, 0, 5, 3, 0, 4, 2, 16, 7, 3, 3, 1, 18, 18, 7, 0, 23, 8,
+    0, 0, 2, 0, 6, 1, 0, 9, 0, 9, 1, 2, 2, 11, 19, 1, 0, 21, 2, 4, 1, 3, 1, 3, 7, 1, 0, 1, 12, 0, 2, 0,
+    1, 0, 1, 1, 0, 1, 3, 0, 1, 2, 1, 4, 2, 1, 2, 1, 2, 2, 4, 1, 0, 0, 1, 0, 0, 1, 5, 1, 0, 0, 0, 0,
+    0, 0, 1, 2, 0, 0, 0, 0, 7, 1, 2, 0, 0, 0, 1, 0, 5, 2, 0, 0, 0, 0, 0, 4, 3, 1, 0, 0, 6, 1, 0, 0,
+    1, 3, 0, 0, 0, 0, 1, 2, 4, 1, 0, 1, 1, 3, 0, 1, 0, 1, 1, 0, 0, 0, 0, 0, 2, 0, 1, 4, 3, 5, 1, 1,
+    3, 4, 3, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 1, 1, 0, 1, 0, 0, 1, 1, 1, 8, 1, 0, 0, 1, 0, 2, 3,
+    2, 1, 7, 18, 3, 16, 6, 0, 2, 6, 4, 32, 6, 0, 6, 4, 1, 0, 5, 4, 1, 9, 6, 7, 0, 3, 13, 34, 3, 24, 2, 2,
+    20, 2, 3, 34, 11, 1, 0, 11, 1, 0, 0, 5, 2, 4, 1, 0, 2, 1, 1, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 1, 3, 1,
+    0, 3, 0, 2, 5, 4, 4, 2, 0, 0, 1, 7, 5, 1, 1, 0, 2, 2, 0, 0, 4, 2, 3, 0, 1, 4, 7, 0, 9, 1, 0, 0,
+    14, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 2, 2, 4, 5, 0, 0, 2, 1, 3, 5, 0, 3, 1, 7, 0, 0, 0,
+    8, 0, 0, 4, 0, 0, 4, 0, 2, 6, 4, 0, 1, 0, 4, 0, 2, 7, 1, 0, 2, 0, 0, 2, 1, 2, 4, 0, 0, 0, 2, 0,
+    0, 1, 0, 0, 0, 0, 0, 2, 3, 5, 0, 0, 1, 3, 1, 1, 3, 1, 4, 0, 0, 11, 1, 1, 2, 1, 3, 1, 3, 3, 0, 3,
+    2, 1, 0, 0, 2, 0, 1, 3, 1, 2, 2, 0, 0, 2, 0, 1, 0, 0, 0, 0, 0, 3, 1, 0, 3, 0, 0, 2, 1, 2, 6, 0,
+    0, 2, 0, 4, 0, 4, 3, 5, 0, 0, 3, 2, 0, 8, 0, 0, 0, 2, 0, 2, 10, 4, 4, 2, 2, 1, 1, 15, 2, 3, 2, 2,
+    0, 2, 0, 3, 1, 0, 0, 0, 0, 3, 1, 8, 8, 7, 1, 2, 1, 2, 3, 0, 4, 2, 0, 0, 0, 2, 0, 0, 0, 0, 0, 1,
+    0, 4, 14, 4, 1, 0, 0, 4, 1, 1, 3, 0, 3, 0, 2, 2, 0, 1, 0, 7, 1, 1, 1, 3, 0, 7, 1, 9, 6, 1, 1, 2,
+    1, 1, 3, 0, 7, 0, 1, 2, 0, 0, 0, 1, 5, 6, 0, 3, 0, 0, 2, 2, 4, 0, 3, 7, 12, 9, 3, 1, 2, 0, 1, 0,
+    0, 1, 6, 3, 0, 4, 0, 1, 0, 1, 1, 0, 2, 2, 1, 2, 0, 1, 0, 6, 3, 7, 3, 1, 0, 2, 1, 3, 9, 2, 1, 1,
+    0, 1, 3, 3, 3, 3, 4, 3, 0, 0, 0, 5, 18, 2, 11, 3, 0, 0, 1, 1, 1, 1, 7, 1, 1, 0, 0, 1, 0, 0, 3, 3,
+    0, 2, 0, 2, 3, 3, 3, 0, 0, 1, 1, 3, 2, 3, 0, 0, 5, 0, 0, 1, 1, 5, 1, 2, 2, 2, 1, 2, 4, 5, 2, 4,
+    2, 2, 2, 0, 2, 0, 4, 0, 6, 0, 0, 0, 0, 1, 0, 2, 0, 1, 12, 5, 3, 3, 2, 0, 7, 0, 0, 0, 0, 2, 0, 1,
+    0, 1, 0, 3, 0, 0, 1, 0, 0, 2, 0, 10, 0, 0, 2, 1, 1, 0, 0, 4, 1, 0, 1, 0, 4, 0, 0, 2, 4, 6, 0, 5,
+    8, 2, 3, 5, 4, 2, 0, 0, 9, 2, 0, 1, 0, 4, 1, 4, 8, 1, 0, 0, 4, 3, 4, 2, 0, 7, 4, 0, 2, 2, 2, 3,
+    1, 2, 3, 0, 0, 0, 0, 1, 1, 0, 0, 0, 1, 5, 1, 6, 7, 0, 1, 2, 5, 0, 1, 3, 3, 0, 5, 1, 10, 5, 1, 3,
+    18, 1, 4, 2, 10, 3, 1, 3, 0, 12, 3, 3, 14, 6, 14, 1, 5, 6, 1, 0, 0, 8, 4, 9, 0, 6, 3, 5, 0, 3, 1, 1,
+    0, 1, 1, 6, 1, 0, 4, 0, 2, 7, 4, 5, 1, 5, 0, 0, 0, 0, 1, 5, 2, 1, 0, 7, 2, 0, 1, 23, 10, 5, 0, 0,
+    0, 2, 2, 1, 0, 1, 1, 1, 2, 0, 5, 7, 1, 1, 5, 1, 3, 4, 0, 2, 5, 3, 1, 1, 0, 1, 0, 9, 0, 3, 1, 4,
+    1, 0, 5, 1, 1, 0, 2, 1, 2, 0, 1, 3, 0, 0, 1, 0, 6, 1, 2, 0, 3, 3, 0, 4, 0, 2, 2, 4, 1, 1, 4, 1,
+    2, 0, 0, 0, 0, 2, 0, 3, 8, 7, 3, 0, 4, 1, 0, 3, 0, 10, 0, 4, 1, 0, 4, 1, 4, 0, 5, 0, 5, 0, 7, 3,
+    2, 10, 6, 1, 0, 0, 0, 4, 0, 0, 3, 1, 3, 6, 5, 0, 0, 7, 4, 0, 5, 4, 3, 4, 2, 5, 4, 13, 1, 12, 2, 0,
+    1, 0, 2, 8, 6, 1, 0, 0, 3, 0, 2, 0, 0, 0, 0, 2, 4, 0, 1, 1, 6, 0, 1, 3, 1, 1, 6, 0, 0, 1, 0, 0,
+    0, 0, 2, 2, 1, 3, 2, 8, 2, 4, 0, 0, 0, 1, 2, 2, 2, 1, 0, 0, 0, 0, 2, 4, 2, 0, 0, 1, 1, 1, 1, 4,
+    1, 0, 7, 1, 1, 4, 4, 1, 0, 1, 1, 0, 2, 0, 0, 12, 3, 2, 0, 0, 0, 1, 7, 0, 5, 4, 0, 0, 1, 0, 3, 1,
+    2, 0, 3, 6, 2, 1, 0, 1, 0, 0, 0, 0, 3, 1, 2, 0, 2, 0, 0, 14, 2, 0, 6, 2, 7, 0, 7, 1, 3, 0, 2, 0,
+    2, 0, 0, 0, 2, 1, 5, 1, 0, 1, 0, 4, 1, 0, 0, 1, 7, 3, 6, 1, 1, 0, 7, 1, 0, 0, 1, 9, 3, 0, 2, 0,
+    2, 1, 1, 0, 1, 0, 3, 0, 4, 1, 0, 0, 0, 0, 1, 0, 3, 0, 8, 3, 0, 0, 0, 1, 4, 2, 1, 0, 1, 4, 0, 2,
+    3, 6, 3, 6, 0, 5, 4, 2, 2, 1, 0, 0, 2, 6, 0, 0, 0, 6, 4, 1, 5, 3, 1, 2, 3, 1, 2, 7, 8, 0, 0, 4,
+    2, 0, 1, 0, 0, 0, 0, 5, 0, 1, 0, 0, 2, 0, 1, 1, 0, 3, 0, 0, 1, 1, 7, 3, 2, 2, 0, 5, 0, 3, 6, 0,
+    5, 2, 0, 1, 6, 2, 2, 1, 3, 3, 0, 0, 2, 2, 4, 0, 13, 0, 4, 4, 2, 5, 1, 1, 2, 2, 5, 3, 2, 0, 3, 1,
+    3, 1, 1, 1, 5, 0, 0, 9, 2, 0, 0, 2, 6, 0, 1, 0, 0, 1, 12, 0, 5, 1, 0, 28, 0, 3, 4, 3, 0, 1, 6, 4,
+    0, 0, 4, 7, 0, 1, 4, 4, 2, 6, 0, 13, 1, 6, 0, 2, 0, 7, 0, 1, 15, 0, 8, 0, 9, 2, 3, 6, 2, 0, 1, 3,
+    10, 4, 1, 0, 2, 0, 8, 1, 2, 1, 4, 0, 10, 2, 0, 0, 1, 2, 0, 4, 3, 0, 3, 0, 1, 3, 3, 0, 1, 2, 0, 0,
+    10, 11, 7, 2, 1, 1, 0, 0, 0, 0, 1, 2, 0, 0, 2, 0, 4, 5, 1, 0, 3, 1, 2, 0, 2, 3, 11, 0, 1, 0, 3, 20,
+    6, 0, 0, 1, 3, 11, 16, 0, 1, 0, 5, 1, 0, 0, 11, 1, 6, 2, 2, 0, 0, 0, 7, 1, 5, 1, 7, 2, 3, 1, 4, 3,
+    3, 1, 0, 2, 2, 1, 5, 0, 8, 2, 2, 1, 4, 0, 1, 0, 0, 0, 0, 1, 2, 4, 0, 1, 8, 5, 1, 3, 0, 0, 1, 2,
+    1, 0, 4, 2, 23, 6, 4, 3, 2, 0, 5, 3, 0, 6, 0, 2, 2, 2, 1, 0, 2, 2, 0, 19, 0, 1, 6, 2, 2, 0, 1, 1,
+    5, 2, 0, 12, 1, 0, 3, 1, 5, 0, 3, 1, 0, 18, 2, 2, 2, 3, 3, 5, 4, 5, 0, 5, 0, 7, 4, 3, 0, 0, 4, 1,
+    1, 1, 1, 0, 0, 9, 1, 0, 0, 0, 0, 7, 1, 3, 0, 0, 3, 0, 0, 1, 1, 0, 2, 1, 0, 0, 1, 8, 1, 3, 4, 6,
+    2, 8, 1, 2, 11, 6, 0, 2, 11, 0, 0, 1, 9, 3, 5, 1, 3, 0, 1, 2, 7, 4, 2, 3, 0, 2, 2, 4, 1, 0, 5, 0,
+    4, 1, 0, 8, 0, 19, 1, 2, 0, 5, 0, 1, 0, 3, 2, 5, 1, 1, 0, 0, 10, 1, 0, 7, 0, 4, 0, 5, 6, 5, 11, 2,
+    3, 2, 0, 2, 4, 8, 0, 1, 9, 6, 2, 1, 7, 8, 12, 5, 6, 1, 5, 6, 0, 1, 20, 2, 3, 0, 0, 2, 6, 3, 3, 2,
+    3, 3, 7, 2, 5, 1, 3, 2, 1, 0, 1, 0, 0, 6, 0, 4, 3, 13, 13, 4, 6, 18, 0, 2, 0, 7, 3, 0, 11, 0, 3, 3,
+    6, 18, 0, 0, 0, 7, 0, 0, 0, 0, 12, 6, 9, 3, 1, 17, 7, 3, 11, 10, 4, 0, 1, 4, 4, 7, 1, 5, 5, 9, 2, 2,
+    1, 6, 0, 2, 6, 1, 1, 0, 1, 1, 4, 14, 6, 2, 2, 4, 4, 0, 3, 5, 8, 3, 4, 1, 10, 4, 4, 5, 1, 1, 1, 0,
+    1, 8, 4, 0, 0, 4, 0, 7, 3, 1, 0, 2, 6, 20, 12, 1, 1, 3, 1, 2, 0, 3, 0, 0, 0, 0, 0, 0, 5, 0, 0, 3,
+    5, 3, 1, 0, 1, 0, 0, 1, 1, 0, 4, 1, 8, 1, 4, 3, 0, 1, 1, 4, 10, 13, 1, 9, 2, 0, 5, 11, 1, 1, 7, 1,
+    1, 4, 1, 1, 5, 0, 6, 2, 0, 5, 3, 0, 3, 0, 12, 11, 0, 3, 0, 2, 5, 2, 0, 0, 0, 2, 5, 1, 7, 0, 4, 0,
+    9, 7, 11, 2, 1, 1, 5, 0, 0, 5, 1, 9, 2, 1, 1, 10, 18, 8, 0, 7, 4, 1, 5, 1, 2, 0, 15, 1, 4, 4, 2, 0,
+    15, 4, 2, 2, 24, 2, 12, 0, 0, 0, 0, 3, 4, 1, 19, 3, 0, 0, 0, 1, 0, 0, 2, 6, 4, 3, 2, 7, 4, 2, 4, 18,
+    8, 3, 4, 12, 12, 4, 4, 7, 3, 1, 0, 0, 1, 2, 1, 2, 2, 0, 3, 12, 8, 0, 3, 3, 2, 1, 1, 1, 0, 3, 1, 0,
+    1, 2, 4, 0, 0, 0, 3, 0, 1, 0, 16, 2, 1, 2, 4, 0, 1, 0, 2, 1, 2, 0, 3, 5, 2, 2, 0, 0, 6, 6, 0, 2,
+    0, 2, 0, 1, 0, 1, 5, 2, 5, 1, 5, 5, 0, 0, 1, 2, 0, 2, 0, 0, 1, 1, 2, 1, 5, 4, 1, 0, 2, 0, 1, 2,
+    3, 0, 0, 4, 6, 1, 0, 0, 5, 1, 1, 2, 9, 1, 11, 6, 0, 0, 1, 1, 0, 5, 2, 3, 6, 6, 3, 0, 0, 2, 0, 5,
+    3, 1, 3, 4, 0, 1, 2, 1, 0, 1, 0, 2, 1, 3, 1, 1, 0, 0, 0, 0, 1, 0, 2, 1, 0, 6, 1, 2, 5, 20, 1, 3,
+    3, 0, 0, 4, 2, 0, 2, 1, 1, 7, 4, 3, 0, 1, 0, 1, 1, 0, 0, 1, 2, 3, 3, 1, 3, 5, 2, 2, 2, 0, 0, 1,
+    0, 14, 2, 0, 0, 4, 0, 2, 10, 2, 0, 1, 1, 3, 6, 18, 0, 5, 1, 1, 0, 1, 2, 14, 3, 0, 11, 5, 12, 0, 0, 4,
+    6, 0, 2, 2, 7, 0, 0, 1, 7, 5, 13, 0, 3, 1, 0, 1, 1, 1, 3, 0, 0, 3, 14, 9, 4, 0, 1, 0, 15, 0, 0, 8,
+    1, 1, 5, 10, 23, 10, 2, 0, 1, 0, 4, 7, 4, 5, 4, 0, 3, 1, 1, 1, 11, 3, 1, 5, 0, 9, 1, 1, 2, 3, 2, 1,
+    0, 4, 0, 2, 5, 9, 2, 0, 3, 2, 2, 10, 3, 12, 2, 0, 6, 12, 3, 0, 0, 13, 1, 1, 1, 6, 0, 0, 6, 2, 2, 0,
+    2, 2, 0, 0, 0, 1, 2, 2, 4, 9, 7, 0, 0, 2, 0, 4, 2, 0, 0, 22, 3, 3, 1, 0, 7, 3, 0, 0, 0, 0, 7, 1,
+    5, 0, 2, 2, 6, 1, 1, 0, 1, 0, 1, 3, 2, 10, 4, 2, 4, 2, 1, 0, 5, 2, 2, 1, 2, 0, 12, 0, 3, 4, 3, 0,
+    0, 1, 0, 1, 3, 6, 0, 0, 7, 9, 0, 0, 7, 4, 3, 1, 2, 0, 2, 1, 1, 1, 0, 3, 9, 0, 1, 0, 0, 0, 6, 0,
+    8, 0, 3, 0, 6, 3, 4, 3, 0, 0, 2, 2, 1, 1, 5, 3, 2, 2, 0, 2, 1, 0, 3, 2, 1, 6, 2, 0, 2, 1, 4, 1,
+    1, 1, 0, 3, 1, 7, 1, 2, 1, 4, 0, 1, 3, 12, 11, 0, 1, 0, 1, 0, 0, 1, 0, 0, 0, 1, 1, 6, 7, 1, 4, 1,
+    0, 5, 4, 11, 0, 3, 1, 1, 2, 1, 0, 1, 1, 2, 0, 3, 8, 2, 3, 2, 1, 1, 7, 0, 2, 1, 0, 1, 0, 0, 0, 2,
+    13, 2, 3, 0, 0, 2, 3, 5, 2, 0, 8, 6, 6, 2, 0, 0, 0, 2, 6, 0, 1, 1, 3, 2, 0, 7, 2, 0, 5, 0, 0, 0,
+    2, 8, 0, 2, 8, 5, 0, 0, 2, 0, 6, 6, 1, 3, 4, 2, 1, 5, 1, 1, 4, 1, 0, 1, 0, 2, 3, 4, 0, 1, 0, 5,
+    2, 0, 0, 9, 0, 1, 1, 7, 3, 3, 2, 0, 0, 4, 0, 0, 0, 0, 1, 4, 3, 3, 2, 1, 0, 0, 1, 1, 0, 2, 1, 3,
+    0, 0, 0, 2, 0, 1, 2, 3, 0, 1, 0, 0, 0, 0, 4, 0, 0, 8, 0, 1, 0, 0, 1, 0, 5, 0, 6, 0, 0, 0, 1, 5,
+    1, 0, 0, 5, 4, 2, 2, 0, 0, 2, 1, 5, 2, 0, 2, 0, 2, 3, 11, 5, 3, 5, 0, 0, 0, 2, 2, 8, 0, 0, 0, 0,
+    0, 0, 0, 1, 0, 2, 1, 0, 1, 0, 0, 7, 2, 0, 3, 1, 0, 5, 1, 1, 0, 0, 1, 0, 6, 0, 2, 2, 2, 1, 6, 5,
+    2, 0, 3, 0, 0, 5, 0, 8, 2, 0, 1, 0, 0, 2, 4, 2, 3, 2, 1, 1, 0, 0, 1, 0, 2, 1, 2, 3, 0, 1, 6, 0,
+    0, 2, 0, 2, 0, 2, 4, 0, 1, 1, 1, 2, 8, 1, 1, 4, 5, 4, 0, 0, 0, 1, 0, 0, 6, 0, 153, 3, 10, 6, 0, 0,
+    1, 3, 11, 7, 0, 0, 0, 2, 1, 1, 2, 1, 1, 8, 0, 1, 0, 0, 0, 1, 1, 1, 5, 2, 2, 2, 0, 5, 3, 0, 4, 0,
+    6, 1, 0, 3, 3, 3, 4, 1, 5, 1, 0, 10, 0, 4, 2, 1, 4, 2, 5, 1, 0, 3, 0, 1, 0, 0, 0, 5, 3, 1, 2, 1,
+    0, 3, 9, 1, 10, 2, 4, 1, 8, 3, 11, 1, 1, 3, 0, 1, 0, 12, 0, 0, 0, 0, 0, 2, 5, 0, 0, 6, 0, 1, 1, 0,
+    6, 2, 1, 1, 0, 1, 3, 0, 2, 3, 0, 2, 1, 1, 0, 1, 5, 8, 0, 1, 5, 1, 7, 2, 0, 0, 1, 0, 2, 2, 0, 7,
+    1, 1, 2, 3, 3, 0, 4, 2, 0, 0, 0, 0, 0, 15, 0, 7, 5, 5, 1, 1, 5, 4, 6, 5, 2, 1, 0, 1, 0, 0, 9, 5,
+    0, 4, 1, 0, 1, 0, 2, 3, 0, 0, 4, 0, 1, 0, 4, 1, 4, 5, 4, 1, 0, 2, 2, 4, 0, 6, 2, 1, 4, 3, 0, 0,
+    1, 3, 1, 4, 3, 1, 4, 0, 0, 4, 0, 2, 1, 1, 0, 1, 2, 5, 0, 5, 1, 1, 2, 0, 2, 1, 0, 1, 1, 0, 0, 1,
+    6, 0, 2, 0, 1, 0, 9, 0, 0, 0, 6, 1, 0, 0, 0, 0, 6, 6, 16, 0, 5, 4, 1, 1, 1, 0, 2, 0, 1, 0, 3, 0,
+    0, 0, 4, 8, 3, 1, 0, 3, 6, 3, 1, 5, 0, 4, 0, 0, 1, 1, 1, 3, 0, 0, 1, 1, 7, 11, 0, 0, 0, 2, 3, 0,
+    1, 0, 3, 1, 0, 0, 3, 5, 1, 0, 4, 0, 3, 3, 1, 0, 3, 4, 8, 0, 2, 0, 6, 4, 2, 3, 1, 0, 1, 0, 0, 1,
+    0, 15, 0, 4, 2, 5, 26, 1, 1, 3, 0, 12, 4, 4, 2, 3, 3, 0, 2, 4, 0, 1, 0, 5, 11, 2, 0, 3, 4, 1, 1, 4,
+    2, 1, 3, 0, 1, 0, 8, 1, 3, 0, 0, 0, 1, 8, 5, 0, 7, 0, 0, 17, 8, 2, 4, 3, 2, 3, 0, 10, 0, 4, 8, 3,
+    0, 4, 1, 2, 2, 1, 0, 0, 1, 1, 3, 1, 1, 0, 9, 0, 10, 3, 4, 2, 2, 1, 11, 4, 1, 3, 2, 0, 2, 4, 1, 2,
+    0, 0, 1, 2, 0, 4, 2, 0, 17, 1, 5, 7, 2, 0, 11, 4, 1, 0, 0, 1, 0, 1, 4, 4, 1, 5, 0, 7, 7, 3, 1, 4,
+    0, 0, 0, 2, 4, 3, 1, 10, 3, 0, 0, 2, 9, 2, 3, 1, 3, 2, 0, 1, 5, 0, 2, 4, 10, 1, 1, 0, 0, 0, 0, 1,
+    0, 9, 0, 6, 7, 1, 1, 1, 0, 4, 6, 0, 6, 0, 0, 2, 0, 12, 1, 0, 0, 3, 2, 3, 0, 2, 11, 0, 2, 3, 14, 17,
+    14, 1, 3, 0, 4, 1, 1, 0, 7, 3, 0, 2, 1, 7, 1, 14, 0, 0, 6, 1, 6, 6, 0, 4, 0, 0, 3, 0, 5, 10, 2, 1,
+    0, 1, 1, 1, 0, 2, 2, 4, 1, 2, 0, 4, 4, 2, 0, 0, 0, 8, 0, 0, 0, 2, 1, 1, 0, 2, 1, 0, 0, 2, 3, 0,
+    0, 4, 1, 1, 8, 3, 7, 2, 2, 3, 2, 0, 9, 1, 0, 1, 4, 1, 1, 1, 5, 0, 2, 0, 0, 0, 1, 5, 2, 0, 1, 1,
+    1, 6, 2, 5, 4, 17, 0, 1, 8, 1, 1, 3, 6, 0, 1, 2, 3, 1, 0, 3, 2, 1, 1, 3, 8, 0, 11, 2, 2, 3, 0, 1,
+    1, 2, 4, 1, 0, 3, 2, 0, 0, 1, 2, 0, 0, 8, 2, 0, 3, 9, 4, 9, 3, 1, 5, 0, 4, 0, 3, 1, 1, 1, 3, 0,
+    0, 4, 2, 4, 4, 1, 5, 0, 0, 2, 5, 2, 1, 4, 3, 0, 0, 0, 4, 3, 1, 6, 5, 2, 0, 1, 7, 1, 0, 0, 0, 0,
+    8, 0, 1, 2, 0, 2, 0, 2, 0, 1, 1, 6, 9, 0, 4, 0, 2, 0, 0, 5, 2, 2, 1, 3, 1, 0, 10, 6, 4, 0, 10, 1,
+    2, 5, 2, 0, 16, 7, 0, 0, 3, 1, 8, 2, 1, 2, 7, 1, 4, 0, 0, 1, 0, 3, 6, 0, 0, 1, 6, 5, 2, 4, 2, 0,
+    6, 2, 1, 0, 17, 7, 1, 0, 5, 2, 13, 11, 1, 0, 4, 1, 1, 1, 4, 3, 0, 2, 1, 1, 3, 1, 4, 2, 3, 1, 0, 1,
+    3, 0, 0, 4, 6, 7, 0, 2, 0, 5, 2, 1, 1, 0, 2, 2, 1, 1, 0, 1, 0, 0, 0, 14, 2, 1, 1, 2, 0, 3, 1, 1,
+    2, 5, 1, 0, 1, 0, 1, 1, 3, 0, 2, 1, 4, 1, 2, 2, 2, 1, 2, 3, 0, 0, 1, 2, 3, 3, 0, 0, 3, 0, 0, 1,
+    1, 0, 3, 1, 0, 2, 1, 3, 0, 1, 3, 1, 0, 0, 1, 9, 1, 3, 2, 1, 0, 0, 1, 3, 4, 1, 2, 0, 6, 5, 7, 1,
+    5, 4, 0, 8, 1, 1, 2, 6, 4, 0, 3, 1, 1, 2, 8, 2, 6, 1, 1, 1, 1, 0, 2, 3, 156, 2, 4, 1, 4, 0, 0, 0,
+    0, 1, 1, 6, 4, 6, 8, 1, 11, 0, 0, 1, 5, 2, 3, 2, 0, 10, 2, 1, 0, 1, 0, 0, 4, 0, 0, 0, 0, 0, 1, 0,
+    0, 2, 0, 1, 0, 0, 2, 0, 0, 1, 0, 1, 0, 0, 2, 2, 2, 0, 2, 1, 6, 0, 0, 1, 1, 1, 0, 0, 1, 3, 2, 12,
+    1, 0, 6, 0, 2, 2, 1, 1, 0, 2, 0, 1, 77, 1, 0, 3, 1, 2, 2, 0, 2, 13, 4, 24, 4, 10, 6, 3, 3, 3, 4, 0,
+    1, 0, 1, 4, 3, 0, 1, 1, 1, 1, 4, 1, 0, 3, 3, 1, 6, 12, 0, 4, 0, 12, 0, 1, 9, 5, 4, 12, 1, 2, 0, 0,
+    0, 0, 0, 3, 4, 3, 5, 0, 2, 0, 13, 1, 1, 5, 4, 2, 0, 1, 2, 2, 3, 1, 5, 7, 8, 0, 0, 2, 0, 0, 12, 1,
+    7, 1, 0, 0, 0, 4, 8, 3, 2, 8, 12, 2, 0, 0, 5, 5, 0, 1, 5, 0, 0, 6, 0, 0, 8, 2, 0, 2, 1, 3, 4, 2,
+    2, 0, 2, 1, 0, 0, 2, 2, 0, 9, 7, 1, 0, 1, 54, 0, 1, 0, 3, 2, 1, 4, 0, 0, 0, 0, 0, 2, 0, 0, 2, 0,
+    0, 2, 2, 1, 0, 8, 2, 2, 5, 11, 3, 0, 1, 1, 0, 6, 0, 0, 0, 2, 2, 0, 1, 1, 0, 6, 1, 0, 0, 1, 0, 0,
+    1, 1, 0, 2, 0, 0, 0, 0, 0, 0, 8, 1, 2, 0, 5, 0, 2, 4, 0, 2, 1, 1, 0, 0, 1, 0, 0, 1, 1, 0, 0, 0,
+    2, 2, 3, 0, 1, 1, 3, 3, 0, 0, 2, 2, 1, 0, 1, 1, 0, 1, 0, 0, 0, 0, 0, 2, 0, 1, 1, 2, 1, 17, 2, 3,
+    4, 8, 8, 8, 3, 18, 0, 5, 4, 7, 1, 5, 4, 22, 19, 2, 1, 22, 0, 0, 0, 0, 0, 3, 1, 1, 4, 6, 0, 1, 3, 0,
+    1, 8, 1, 0, 9, 4, 3, 1, 2, 1, 4, 4, 5, 1, 3, 1, 1, 2, 4, 0, 0, 1, 1, 1, 4, 4, 0, 0, 0, 2, 0, 0,
+    0, 0, 0, 6, 3, 0, 5, 2, 0, 13, 9, 7, 5, 0, 2, 2, 0, 8, 21, 2, 1, 5, 4, 3, 0, 1, 3, 7, 3, 2, 3, 1,
+    1, 10, 6, 5, 1, 2, 1, 11, 1, 4, 1, 0, 0, 16, 9, 1, 21, 2, 6, 10, 4, 0, 2, 4, 0, 4, 1, 1, 9, 8, 0, 7,
+    1, 5, 1, 0, 2, 1, 2, 0, 1, 0, 2, 7, 0, 15, 1, 6, 6, 16, 1, 1, 4, 6, 1, 13, 7, 1, 0, 2, 12, 4, 1, 10,
+    0, 8, 4, 8, 4, 0, 0, 4, 3, 2, 3, 43, 3, 0, 0, 16, 9, 0, 1, 1, 9, 12, 0, 0, 6, 0, 2, 1, 1, 13, 4, 1,
+    4, 0, 1, 247, 8, 1, 0, 3, 1, 0, 0, 3, 1, 1, 0, 3, 9, 0, 0, 0, 0, 1, 4, 4, 6, 1, 0, 1, 4, 3, 0, 1,
+    0, 0, 0, 6, 0, 0, 1, 3, 4, 0, 2, 54, 4, 6, 1, 3, 3, 8, 3, 0, 3, 6, 0, 0, 2, 10, 2, 0, 2, 0, 0, 0,
+    4, 1, 3, 2, 1, 0, 1, 1, 2, 7, 0, 1, 1, 0, 1, 0, 0, 4, 0, 1, 0, 0, 1, 0, 3, 2, 3, 0, 8, 2, 2, 1,
+    1, 0, 3, 0, 2, 0, 0, 0, 1, 1, 0, 0, 0, 2, 3, 0, 2, 1, 6, 0, 4, 1, 0, 4, 1, 3, 0, 1, 1, 4, 3, 1,
+    0, 2, 2, 1, 1, 1, 2, 2, 2, 1, 8, 8, 1, 6, 3, 0, 3, 1, 1, 1, 0, 8, 3, 2, 1, 0, 1, 1, 0, 0, 5, 0,
+    1, 1, 3, 2, 5, 1, 7, 0, 0, 4, 1, 1, 0, 7, 3, 3, 2, 2, 1, 2, 1, 5, 0, 5, 8, 2, 4, 7, 4, 2, 0, 16,
+    0, 3, 0, 7, 3, 1, 0, 0, 1, 0, 1, 3, 2, 0, 0, 0, 0, 3, 0, 1, 6, 2, 7, 0, 2, 6, 0, 2, 0, 0, 8, 4,
+    0, 0, 0, 0, 4, 0, 0, 1, 1, 0, 2, 8, 3, 0, 3, 0, 1, 0, 51, 1, 4, 1, 4, 13, 22, 0, 2, 2, 6, 3, 0, 0,
+    2, 0, 0, 7, 0, 0, 4, 1, 3, 0, 1, 3, 1, 0, 4, 2, 1, 0, 1, 0, 0, 1, 3, 3, 1, 12, 2, 3, 2, 3, 1, 0,
+    3, 0, 0, 2, 1, 62, 0, 0, 0, 11, 2, 3, 0, 0, 4, 0, 12, 1, 0, 0, 0, 1, 7, 0, 0, 2, 2, 4, 1, 13, 0, 2,
+    6, 2, 3, 14, 0, 2, 0, 5, 6, 7, 7, 6, 0, 5, 1, 12, 0, 6, 4, 0, 3, 2, 1, 0, 3, 0, 61, 4, 2, 5, 1, 3,
+    3, 3, 10, 1, 2, 3, 0, 8, 0, 6, 2, 0, 0, 1, 2, 2, 3, 10, 17, 1, 4, 2, 0, 1, 1, 0, 0, 4, 2, 0, 8, 0,
+    4, 0, 0, 0, 0, 7, 0, 0, 1, 2, 3, 1, 0, 2, 4, 4, 3, 2, 3, 0, 4, 9, 0, 9, 1, 0, 0, 0, 3, 6, 0, 0,
+    7, 1, 0, 0, 0, 0, 2, 2, 3, 0, 7, 7, 0, 3, 0, 1, 0, 1, 1, 4, 1, 3, 0, 0, 0, 0, 1, 0, 6, 0, 0, 3,
+    2, 1, 11, 1, 0, 0, 1, 0, 2, 1, 0, 1, 0, 2, 4, 2, 1, 0, 0, 1, 1, 3, 0, 0, 0, 0, 4, 0, 1, 0, 0, 2,
+    8, 0, 6, 2, 0, 3, 0, 1, 0, 0, 0, 1, 0, 6, 0, 1, 0, 2, 1, 1, 2, 0, 1, 108, 1, 1, 6, 1, 0, 0, 1, 12,
+    2, 0, 0, 0, 4, 3, 2, 5, 3, 3, 2, 1, 2, 0, 14, 2, 0, 4, 1, 9, 0, 7, 2, 0, 0, 0, 0, 0, 2, 7, 2, 2,
+    4, 2, 1, 10, 1, 3, 1, 10, 14, 1, 3, 2, 1, 0, 2, 1, 0, 5, 0, 1, 4, 9, 3, 14, 6, 1, 2, 1, 3, 0, 0, 2,
+    12, 15, 0, 2, 86, 2, 0, 2, 0, 1, 1, 5, 0, 2, 6, 0, 1, 1, 5, 0, 0, 5, 0, 1, 0, 0, 1, 0, 7, 2, 0, 0,
+    0, 2, 0, 4, 7, 0, 0, 0, 0, 1, 1, 4, 1, 0, 0, 0, 1, 4, 9, 4, 1, 6, 1, 8, 5, 4, 1, 10, 0, 10, 2, 9,
+    0, 0, 2, 11, 3, 3, 12, 1, 0, 0, 2, 0, 2, 1, 5, 3, 0, 21, 7, 1, 4,
+};
+
+static void Fail(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fputs("thprac_locale_gen: ", stderr);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    exit(1);
+}
+
+// printf onto the end of out, plus a newline
+static void Append(std::string& out, const char* format, ...)
+{
+    va_list args, copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    auto len = vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    auto pos = out.size();
+    out.resize(pos + len + 1);
+    vsnprintf(out.data() + pos, len + 1, format, args);
+    va_end(args);
+    out.back() = '\n';
+}
+
+/// Definitions
+/// ------------------
+struct Group {
+    std::string name;
+    std::vector<std::string> items;
+};
+
+struct Section {
+    std::string name;
+    int bgm;
+    int spell;
+    int appearance[3];
+    // Bytes as they end up in the pool
+    std::string text[LANGUAGES][DIFFICULTIES];
+};
+
+struct Game {
+    std::string ns;
+    std::vector<Section> sections;
+    std::vector<Group> groups;
+};
+
+struct LocaleDef {
+    // A0000ERROR_C first, then every key in byte order, same as the enum
+    std::vector<std::string> glossaryNames;
+    std::vector<std::string> glossary[LANGUAGES];
+    std::vector<Group> launcherGroups;
+    std::vector<Group> commonGroups;
+    std::vector<Game> games;
+};
+
+// In the JSON, "\0" stands for a NUL byte, which is how combo item lists are
+// written. Any other backslash is literal.
+static std::string DecodeText(const rapidjson::Value& value, const char* what)
+{
+    if (!value.IsString()) {
+        Fail("%s is not a string", what);
+    }
+    std::string_view str(value.GetString(), value.GetStringLength());
+    std::string bytes;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '\\' && i + 1 < str.size() && str[i + 1] == '0') {
+            bytes += '\0';
+            i++;
+        } else {
+            bytes += str[i];
+        }
+    }
+    return bytes;
+}
+
+static void ReadGroups(const rapidjson::Value& obj, std::vector<Group>& groups)
+{
+    auto it = obj.FindMember("groups");
+    if (it == obj.MemberEnd()) {
+        return;
+    }
+    if (!it->value.IsObject()) {
+        Fail("\"groups\" is not an object");
+    }
+    for (auto& member : it->value.GetObject()) {
+        if (!member.value.IsArray()) {
+            Fail("group %s is not an array", member.name.GetString());
+        }
+        auto& group = groups.emplace_back();
+        group.name = member.name.GetString();
+        for (auto& item : member.value.GetArray()) {
+            if (!item.IsString()) {
+                Fail("group %s has an item that is not a string", group.name.c_str());
+            }
+            group.items.push_back(item.GetString());
+        }
+    }
+}
+
+static void ReadDef(const char* path, LocaleDef& def)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        Fail("can't open %s", path);
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    auto json = ss.str();
+    if (json.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        json.erase(0, 3);
+    }
+
+    rapidjson::Document doc;
+    doc.Parse(json.c_str(), json.size());
+    if (doc.HasParseError() || !doc.IsObject()) {
+        Fail("%s is not a valid JSON object (offset %zu)", path, doc.GetErrorOffset());
+    }
+
+    // The glossary comes first, sections may refer to any entry of it
+    std::unordered_map<std::string, std::vector<std::string>> glossary;
+    std::set<std::string> names;
+    for (auto& part : doc.GetObject()) {
+        auto it = part.value.FindMember("glossary");
+        if (it == part.value.MemberEnd()) {
+            continue;
+        }
+        for (auto& entry : it->value.GetObject()) {
+            if (!entry.value.IsArray() || entry.value.Size() != LANGUAGES) {
+                Fail("glossary entry %s doesn't have %d languages", entry.name.GetString(), LANGUAGES);
+            }
+            auto& texts = glossary[entry.name.GetString()];
+            texts.clear();
+            for (int l = 0; l < LANGUAGES; l++) {
+                texts.push_back(DecodeText(entry.value[l], entry.name.GetString()));
+            }
+            names.insert(entry.name.GetString());
+        }
+    }
+    def.glossaryNames.push_back("A0000ERROR_C");
+    for (int l = 0; l < LANGUAGES; l++) {
+        def.glossary[l].push_back("");
+    }
+    for (auto& name : names) {
+        def.glossaryNames.push_back(name);
+        for (int l = 0; l < LANGUAGES; l++) {
+            def.glossary[l].push_back(glossary[name][l]);
+        }
+    }
+
+    for (auto& part : doc.GetObject()) {
+        std::string_view partName = part.name.GetString();
+        if (partName == "launcher") {
+            ReadGroups(part.value, def.launcherGroups);
+        } else if (partName == "common") {
+            ReadGroups(part.value, def.commonGroups);
+        }
+
+        auto ns = part.value.FindMember("namespace");
+        if (ns == part.value.MemberEnd()) {
+            continue;
+        }
+        auto& game = def.games.emplace_back();
+        game.ns = ns->value.GetString();
+        ReadGroups(part.value, game.groups);
+
+        auto sections = part.value.FindMember("sections");
+        if (sections == part.value.MemberEnd()) {
+            continue;
+        }
+        for (auto& member : sections->value.GetObject()) {
+            auto& section = game.sections.emplace_back();
+            section.name = member.name.GetString();
+            auto& obj = member.value;
+            auto bgm = obj.FindMember("bgm");
+            auto spell = obj.FindMember("spell");
+            auto appearance = obj.FindMember("appearance");
+            if (bgm == obj.MemberEnd() || !bgm->value.IsInt()
+                || spell == obj.MemberEnd() || !spell->value.IsInt()
+                || appearance == obj.MemberEnd() || !appearance->value.IsArray() || appearance->value.Size() != 3) {
+                Fail("section %s::%s is missing bgm, spell or appearance", game.ns.c_str(), section.name.c_str());
+            }
+            section.bgm = bgm->value.GetInt();
+            section.spell = spell->value.GetInt();
+            for (int i = 0; i < 3; i++) {
+                section.appearance[i] = appearance->value[i].GetInt();
+            }
+            if (section.appearance[0] < 1 || section.appearance[1] < 1) {
+                Fail("section %s::%s has no stage or type", game.ns.c_str(), section.name.c_str());
+            }
+
+            // "!X" names it for every difficulty, otherwise the letters after
+            // the ! say which ones. A later key overrides an earlier one.
+            for (auto& key : obj.GetObject()) {
+                std::string_view keyName = key.name.GetString();
+                if (keyName.empty() || keyName[0] != '!') {
+                    continue;
+                }
+                std::string texts[LANGUAGES];
+                if (key.value.IsArray()) {
+                    if (key.value.Size() != LANGUAGES) {
+                        Fail("section %s::%s doesn't have %d languages", game.ns.c_str(), section.name.c_str(), LANGUAGES);
+                    }
+                    for (int l = 0; l < LANGUAGES; l++) {
+                        texts[l] = DecodeText(key.value[l], section.name.c_str());
+                    }
+                } else if (key.value.IsString()) {
+                    auto ref = glossary.find(key.value.GetString());
+                    if (ref == glossary.end()) {
+                        Fail("section %s::%s refers to unknown glossary entry %s", game.ns.c_str(), section.name.c_str(), key.value.GetString());
+                    }
+                    for (int l = 0; l < LANGUAGES; l++) {
+                        texts[l] = ref->second[l];
+                    }
+                } else {
+                    Fail("section %s::%s has a name that is neither text nor a glossary entry", game.ns.c_str(), section.name.c_str());
+                }
+                for (int d = 0; d < DIFFICULTIES; d++) {
+                    if (keyName == "!X" || keyName.find(DIFFICULTY_CHARS[d]) != std::string_view::npos) {
+                        for (int l = 0; l < LANGUAGES; l++) {
+                            section.text[l][d] = texts[l];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Every pooled string in the order the tables list them: the glossary per
+// language, then for each game its sections per language and difficulty, each
+// of those led by the empty A0000ERROR entry
+static std::vector<const std::string*> TableStrings(const LocaleDef& def)
+{
+    static const std::string empty;
+    std::vector<const std::string*> strings;
+    for (int l = 0; l < LANGUAGES; l++) {
+        for (auto& text : def.glossary[l]) {
+            strings.push_back(&text);
+        }
+    }
+    for (auto& game : def.games) {
+        for (int l = 0; l < LANGUAGES; l++) {
+            for (int d = 0; d < DIFFICULTIES; d++) {
+                strings.push_back(&empty);
+                for (auto& section : game.sections) {
+                    strings.push_back(&section.text[l][d]);
+                }
+            }
+        }
+    }
+    return strings;
+}
+/// ------------------
+
+/// Pool
+/// ------------------
+// Offsets are row * POOL_ROW + column, a string never crosses into the next row
+class StringPool {
+public:
+    void Add(const std::string& str)
+    {
+        if (mIds.emplace(str, (uint32_t)mStrings.size()).second) {
+            mStrings.push_back(str);
+        }
+    }
+
+    void Build()
+    {
+        // Sorted by their reversed bytes, a string that is a suffix of others
+        // comes right before the first of them. Going backwards, each one takes
+        // the host of the next one if it's a suffix of it.
+        auto n = mStrings.size();
+        std::vector<std::string> reversed(n);
+        std::vector<uint32_t> order(n);
+        for (uint32_t i = 0; i < n; i++) {
+            reversed[i].assign(mStrings[i].rbegin(), mStrings[i].rend());
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return reversed[a] < reversed[b]; });
+        mHost.resize(n);
+        for (size_t i = n; i-- > 0;) {
+            auto id = order[i];
+            mHost[id] = id;
+            if (i + 1 < n) {
+                auto& next = reversed[order[i + 1]];
+                if (next.compare(0, reversed[id].size(), reversed[id]) == 0) {
+                    mHost[id] = mHost[order[i + 1]];
+                }
+            }
+        }
+
+        // Hosts are laid out in the order they first appeared, so each table
+        // ends up reading mostly from the same part of the pool
+        mOffset.resize(n);
+        uint32_t used = POOL_ROW;
+        for (uint32_t id = 0; id < n; id++) {
+            if (mHost[id] != id) {
+                continue;
+            }
+            auto size = (uint32_t)mStrings[id].size() + 1;
+            if (size > POOL_ROW - 1) {
+                Fail("a string of %u bytes doesn't fit into a pool row", size);
+            }
+            // Each row's literal brings its own NUL on top
+            if (used + size > POOL_ROW - 1) {
+                mRows.emplace_back();
+                used = 0;
+            }
+            mOffset[id] = (uint32_t)(mRows.size() - 1) * POOL_ROW + used;
+            mRows.back().push_back(id);
+            used += size;
+        }
+        for (uint32_t id = 0; id < n; id++) {
+            auto host = mHost[id];
+            mOffset[id] = mOffset[host] + (uint32_t)(mStrings[host].size() - mStrings[id].size());
+        }
+    }
+
+    uint32_t Offset(const std::string& str) const { return mOffset[mIds.at(str)]; }
+    size_t RowCount() const { return mRows.size(); }
+    const std::vector<uint32_t>& Row(size_t row) const { return mRows[row]; }
+    const std::string& String(uint32_t id) const { return mStrings[id]; }
+
+private:
+    std::unordered_map<std::string, uint32_t> mIds;
+    std::vector<std::string> mStrings;
+    std::vector<uint32_t> mHost;
+    std::vector<uint32_t> mOffset;
+    std::vector<std::vector<uint32_t>> mRows;
+};
+
+// The bytes plus an explicit NUL, as a C++ string literal. UTF-8 is written
+// as is, the sources are compiled with /utf-8.
+static std::string Literal(const std::string& bytes)
+{
+    std::string out = "\"";
+    for (size_t i = 0; i < bytes.size(); i++) {
+        auto c = (unsigned char)bytes[i];
+        char next = i + 1 < bytes.size() ? bytes[i + 1] : '\\';
+        if (c == '\0') {
+            // An octal digit right after would be read as part of the escape
+            out += next >= '0' && next <= '7' ? "\\000" : "\\0";
+        } else if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c < 0x20 || c == 0x7F) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\%03o", c);
+            out += buf;
+        } else {
+            out += (char)c;
+        }
+    }
+    out += "\\0\"";
+    if (out.size() > PIECE_MAX) {
+        Fail("a string is too long for a single literal");
+    }
+    return out;
+}
+/// ------------------
+
+/// Output
+/// ------------------
+static const char* FILE_COMMENT = "// THIS FILE IS AUTOGENERATED\n"
+                                  "// If you want to edit this file, edit thprac_games_def.json\n"
+                                  "// Then, use thprac/tools/thprac_locale_gen to regenerate this file\n"
+                                  "\n";
+
+static void WriteGroups(std::string& h, std::string& c, const std::vector<Group>& groups)
+{
+    for (auto& group : groups) {
+        Append(h, "extern const th_glossary_t %s[%zu];\n", group.name.c_str(), group.items.size() + 1);
+        Append(c, "const th_glossary_t %s[%zu]\n{", group.name.c_str(), group.items.size() + 1);
+        for (auto& item : group.items) {
+            Append(c, "    %s,", item.c_str());
+        }
+        Append(c, "};\n");
+    }
+}
+
+// Each list ends in A0000ERROR, minLen only matters for games without sections
+static void WriteSectionLists(std::string& h, std::string& c, const char* name, const std::vector<std::vector<std::vector<const Section*>>>& lists, size_t inner, size_t minLen)
+{
+    size_t len = minLen;
+    for (auto& stage : lists) {
+        for (auto& list : stage) {
+            len = std::max(len, list.size() + 1);
+        }
+    }
+    Append(h, "extern const th_sections_t %s[%zu][%zu][%zu];\n", name, lists.size(), inner, len);
+    Append(c, "const th_sections_t %s[%zu][%zu][%zu]\n{", name, lists.size(), inner, len);
+    for (auto& stage : lists) {
+        Append(c, "    {");
+        for (auto& list : stage) {
+            std::string line = "        { ";
+            for (auto section : list) {
+                line += section->name + ", ";
+            }
+            Append(c, "%s},", line.c_str());
+        }
+        Append(c, "    },");
+    }
+    Append(c, "};\n");
+}
+
+static void WriteGame(std::string& h, std::string& c, const Game& game, const StringPool& pool)
+{
+    auto m = game.sections.size() + 1;
+    Append(h, "namespace %s {\n\nenum th_sections_t : uint8_t\n{\n    A0000ERROR,", game.ns.c_str());
+    for (auto& section : game.sections) {
+        Append(h, "    %s,", section.name.c_str());
+    }
+    Append(h, "};\n");
+    Append(c, "namespace %s {\n", game.ns.c_str());
+
+    Append(h, "extern const uint32_t th_sections_ofs[%d][%d][%zu];\n", LANGUAGES, DIFFICULTIES, m);
+    Append(c, "const uint32_t th_sections_ofs[%d][%d][%zu]\n{", LANGUAGES, DIFFICULTIES, m);
+    for (int l = 0; l < LANGUAGES; l++) {
+        Append(c, "    {");
+        for (int d = 0; d < DIFFICULTIES; d++) {
+            Append(c, "        {\n            0x%08x, // A0000ERROR", pool.Offset(""));
+            for (auto& section : game.sections) {
+                Append(c, "            0x%08x, // %s", pool.Offset(section.text[l][d]), section.name.c_str());
+            }
+            Append(c, "        },");
+        }
+        Append(c, "    },");
+    }
+    Append(c, "};\n");
+
+    Append(h, "extern const uint8_t th_sections_bgm[%zu];\n", m);
+    Append(c, "const uint8_t th_sections_bgm[%zu]\n{\n    0,", m);
+    for (auto& section : game.sections) {
+        Append(c, "    %d,", section.bgm);
+    }
+    Append(c, "};\n");
+
+    // Sections by stage and type, in the order they appear in...
+    int stages = 1, types = 1;
+    for (auto& section : game.sections) {
+        stages = std::max(stages, section.appearance[0]);
+        types = std::max(types, section.appearance[1]);
+    }
+    std::vector<std::vector<std::vector<const Section*>>> cba(stages, std::vector<std::vector<const Section*>>(types));
+    for (auto& section : game.sections) {
+        cba[section.appearance[0] - 1][section.appearance[1] - 1].push_back(&section);
+    }
+    for (auto& stage : cba) {
+        for (auto& list : stage) {
+            std::stable_sort(list.begin(), list.end(), [](const Section* a, const Section* b) { return a->appearance[2] < b->appearance[2]; });
+        }
+    }
+    // ...and by stage, non-spells and spells apart
+    std::vector<std::vector<std::vector<const Section*>>> cbt(stages, std::vector<std::vector<const Section*>>(2));
+    for (int st = 0; st < stages; st++) {
+        for (int sp = 0; sp < 2; sp++) {
+            for (auto& list : cba[st]) {
+                for (auto section : list) {
+                    if (section->spell == sp) {
+                        cbt[st][sp].push_back(section);
+                    }
+                }
+            }
+        }
+    }
+    WriteSectionLists(h, c, "th_sections_cba", cba, types, 2);
+    WriteSectionLists(h, c, "th_sections_cbt", cbt, 2, 1);
+    WriteGroups(h, c, game.groups);
+
+    Append(h, "}\n");
+    Append(c, "}\n");
+}
+
+// Latin-1 plus every codepoint the language's strings use. ImWchar is 16 bit
+// in thprac, so anything above U+FFFF can't be drawn and is turned away.
+static std::set<uint32_t> UsedGlyphs(const LocaleDef& def, int lang)
+{
+    std::set<uint32_t> used;
+    for (uint32_t cp = 0x20; cp <= 0xFF; cp++) {
+        used.insert(cp);
+    }
+    auto add = [&](const std::string& str) {
+        for (size_t i = 0; i < str.size();) {
+            auto c = (unsigned char)str[i];
+            int len = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+            uint32_t cp = len == 1 ? c : c & (0x7F >> len);
+            for (int j = 1; j < len && i + j < str.size(); j++) {
+                cp = cp << 6 | (str[i + j] & 0x3F);
+            }
+            if (cp > 0xFFFF) {
+                Fail("U+%X in \"%s\" doesn't fit into an ImWchar", cp, str.c_str());
+            }
+            if (cp >= 0x20) {
+                used.insert(cp);
+            }
+            i += len;
+        }
+    };
+    for (auto& text : def.glossary[lang]) {
+        add(text);
+    }
+    for (auto& game : def.games) {
+        for (auto& section : game.sections) {
+            for (int d = 0; d < DIFFICULTIES; d++) {
+                add(section.text[lang][d]);
+            }
+        }
+    }
+    return used;
+}
+
+// The used glyphs plus the language's base set
+static std::set<uint32_t> AllGlyphs(const LocaleDef& def, int lang)
+{
+    auto glyphs = UsedGlyphs(def, lang);
+    auto addRanges = [&](const uint32_t* ranges, size_t count) {
+        for (size_t i = 0; i < count; i += 2) {
+            for (auto cp = ranges[i]; cp <= ranges[i + 1]; cp++) {
+                glyphs.insert(cp);
+            }
+        }
+    };
+    switch (lang) {
+    case 0:
+        addRanges(BASE_GLYPHS_ZH, std::size(BASE_GLYPHS_ZH));
+        break;
+    case 1:
+        addRanges(BASE_GLYPHS_EN, std::size(BASE_GLYPHS_EN));
+        break;
+    case 2: {
+        addRanges(BASE_GLYPHS_JA, std::size(BASE_GLYPHS_JA));
+        uint32_t cp = 0x4E00;
+        for (auto offset : JA_KANJI_FROM_0x4E00) {
+            cp += offset + 1;
+            glyphs.insert(cp);
+        }
+        break;
+    }
+    }
+    return glyphs;
+}
+
+// Fewest pairs that cover exactly the set, in order
+static std::vector<std::pair<uint32_t, uint32_t>> GlyphRanges(const std::set<uint32_t>& glyphs)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    for (auto cp : glyphs) {
+        if (!ranges.empty() && ranges.back().second + 1 == cp) {
+            ranges.back().second = cp;
+        } else {
+            ranges.emplace_back(cp, cp);
+        }
+    }
+    return ranges;
+}
+
+static void WriteGlyphRanges(std::string& h, std::string& c, const std::string& name, const std::set<uint32_t>& glyphs)
+{
+    auto ranges = GlyphRanges(glyphs);
+    Append(h, "extern const uint16_t %s[%zu];\n", name.c_str(), ranges.size() * 2 + 1);
+    Append(c, "const uint16_t %s[%zu]\n{", name.c_str(), ranges.size() * 2 + 1);
+    for (auto& range : ranges) {
+        Append(c, "    0x%04x, 0x%04x,", range.first, range.second);
+    }
+    Append(c, "    0,\n};\n");
+}
+
+static void WriteFile(const std::string& path, const std::string& content)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(content.data(), content.size())) {
+        Fail("can't write %s", path.c_str());
+    }
+}
+
+static void WriteDef(const LocaleDef& def, const std::string& dir)
+{
+    StringPool pool;
+    for (auto str : TableStrings(def)) {
+        pool.Add(*str);
+    }
+    pool.Build();
+
+    std::string h = FILE_COMMENT, c = FILE_COMMENT;
+    Append(h, "#pragma once\n#include <cstdint>\n\nnamespace THPrac {\n\nenum th_glossary_t\n{");
+    for (auto& name : def.glossaryNames) {
+        Append(h, "    %s,", name.c_str());
+    }
+    Append(h, "};\n");
+    Append(c, "#include \"thprac_locale_def.h\"\n\nnamespace THPrac {\n");
+
+    // Strings are only ever reached through the offset tables below
+    Append(h, "constexpr uint32_t TH_LOCALE_POOL_ROW = 0x%x;", POOL_ROW);
+    Append(h, "extern const char th_locale_pool[%zu][TH_LOCALE_POOL_ROW];\n", pool.RowCount());
+    Append(h, "inline const char* th_locale_str(uint32_t offset)\n{");
+    Append(h, "    return &th_locale_pool[offset / TH_LOCALE_POOL_ROW][offset %% TH_LOCALE_POOL_ROW];\n}\n");
+    Append(c, "const char th_locale_pool[%zu][TH_LOCALE_POOL_ROW]\n{", pool.RowCount());
+    for (size_t r = 0; r < pool.RowCount(); r++) {
+        auto& row = pool.Row(r);
+        for (size_t i = 0; i < row.size(); i++) {
+            Append(c, "    %s%s", Literal(pool.String(row[i])).c_str(), i + 1 == row.size() ? "," : "");
+        }
+    }
+    Append(c, "};\n");
+
+    Append(h, "extern const uint32_t th_glossary_ofs[%d][%zu];\n", LANGUAGES, def.glossaryNames.size());
+    Append(c, "const uint32_t th_glossary_ofs[%d][%zu]\n{", LANGUAGES, def.glossaryNames.size());
+    for (int l = 0; l < LANGUAGES; l++) {
+        Append(c, "    {");
+        for (size_t i = 0; i < def.glossaryNames.size(); i++) {
+            Append(c, "        0x%08x, // %s", pool.Offset(def.glossary[l][i]), def.glossaryNames[i].c_str());
+        }
+        Append(c, "    },");
+    }
+    Append(c, "};\n");
+
+    WriteGroups(h, c, def.launcherGroups);
+    WriteGroups(h, c, def.commonGroups);
+    for (auto& game : def.games) {
+        WriteGame(h, c, game, pool);
+    }
+
+    // Zero terminated pairs of first and last codepoint, as ImFontConfig wants
+    // them. th_glyph_ranges_used_* is exactly what the strings above use plus
+    // Latin-1, th_glyph_ranges_* is the language's usual set plus anything the
+    // strings use beyond it.
+    for (int l = 0; l < LANGUAGES; l++) {
+        WriteGlyphRanges(h, c, std::string("th_glyph_ranges_used_") + LANGUAGE_NAMES[l], UsedGlyphs(def, l));
+    }
+    for (int l = 0; l < LANGUAGES; l++) {
+        WriteGlyphRanges(h, c, std::string("th_glyph_ranges_") + LANGUAGE_NAMES[l], AllGlyphs(def, l));
+    }
+
+    h += "}\n";
+    c += "}\n";
+    WriteFile(dir + "/thprac_locale_def.h", h);
+    WriteFile(dir + "/thprac_locale_def.cpp", c);
+}
+/// ------------------
+
+/// Check
+/// ------------------
+// Reads the pool and the offset tables back out of the generated .cpp the way
+// a compiler would, and makes sure every table entry reads as the JSON says
+static void CheckDef(const LocaleDef& def, const std::string& dir)
+{
+    auto path = dir + "/thprac_locale_def.cpp";
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        Fail("can't open %s", path.c_str());
+    }
+
+    std::vector<std::string> rows;
+    std::vector<uint32_t> offsets;
+    std::map<std::string, std::vector<uint32_t>> glyphTables;
+    std::vector<uint32_t>* glyphs = nullptr;
+    std::string line;
+    bool inPool = false, inTable = false;
+    while (std::getline(file, line)) {
+        if (line.starts_with("const char th_locale_pool[")) {
+            inPool = true;
+            rows.emplace_back();
+            continue;
+        }
+        if (line.starts_with("const uint32_t ")) {
+            inTable = true;
+            continue;
+        }
+        if (line.starts_with("const uint16_t ")) {
+            glyphs = &glyphTables[line.substr(15, line.find('[') - 15)];
+            continue;
+        }
+        if (line == "};") {
+            inPool = inTable = false;
+            glyphs = nullptr;
+            continue;
+        }
+        if (glyphs) {
+            for (const char* p = line.c_str(); *p;) {
+                char* end;
+                auto value = strtoul(p, &end, 0);
+                if (end == p) {
+                    p++;
+                } else {
+                    glyphs->push_back((uint32_t)value);
+                    p = end;
+                }
+            }
+            continue;
+        }
+
+        size_t i = line.find_first_not_of(' ');
+        if (inTable && i != std::string::npos && line.compare(i, 2, "0x") == 0) {
+            offsets.push_back((uint32_t)strtoul(line.c_str() + i, nullptr, 16));
+        }
+        if (!inPool || i == std::string::npos || line[i] != '"') {
+            continue;
+        }
+        auto& row = rows.back();
+        for (i++; i < line.size() && line[i] != '"'; i++) {
+            if (line[i] != '\\') {
+                row += line[i];
+                continue;
+            }
+            char e = line[++i];
+            if (e >= '0' && e <= '7') {
+                int value = 0;
+                for (int digits = 0; digits < 3 && line[i] >= '0' && line[i] <= '7'; digits++, i++) {
+                    value = value * 8 + (line[i] - '0');
+                }
+                i--;
+                row += (char)value;
+            } else {
+                row += e == 'n' ? '\n' : e;
+            }
+        }
+        if (line.back() == ',') {
+            if (row.size() > POOL_ROW - 1) {
+                Fail("pool row %zu is %zu bytes", rows.size() - 1, row.size());
+            }
+            row.resize(POOL_ROW, '\0');
+            rows.emplace_back();
+        }
+    }
+    if (rows.empty()) {
+        Fail("%s has no string pool", path.c_str());
+    }
+    rows.pop_back();
+
+    auto strings = TableStrings(def);
+    if (offsets.size() != strings.size()) {
+        Fail("%s has %zu table entries, expected %zu", path.c_str(), offsets.size(), strings.size());
+    }
+    for (size_t i = 0; i < strings.size(); i++) {
+        auto row = offsets[i] / POOL_ROW, column = offsets[i] % POOL_ROW;
+        auto& expected = *strings[i];
+        if (row >= rows.size() || column + expected.size() >= POOL_ROW
+            || rows[row].compare(column, expected.size() + 1, expected.c_str(), expected.size() + 1) != 0) {
+            Fail("table entry %zu at 0x%08x doesn't read as expected", i, offsets[i]);
+        }
+    }
+
+    // The glyph ranges have to be sorted, apart from each other, and cover
+    // exactly the expected codepoints. Nothing missing, nothing extra.
+    for (int l = 0; l < LANGUAGES; l++) {
+        for (int all = 0; all < 2; all++) {
+            auto name = std::string(all ? "th_glyph_ranges_" : "th_glyph_ranges_used_") + LANGUAGE_NAMES[l];
+            auto it = glyphTables.find(name);
+            if (it == glyphTables.end()) {
+                Fail("%s has no %s", path.c_str(), name.c_str());
+            }
+            auto& table = it->second;
+            if (table.size() % 2 != 1 || table.back() != 0) {
+                Fail("%s doesn't end in a single 0", name.c_str());
+            }
+            std::set<uint32_t> covered;
+            for (size_t i = 0; i + 1 < table.size(); i += 2) {
+                if (!table[i] || table[i] > table[i + 1] || (i && table[i] <= table[i - 1] + 1)) {
+                    Fail("%s has a misplaced range at %zu", name.c_str(), i);
+                }
+                for (auto cp = table[i]; cp <= table[i + 1]; cp++) {
+                    covered.insert(cp);
+                }
+            }
+            if (covered != (all ? AllGlyphs(def, l) : UsedGlyphs(def, l))) {
+                Fail("%s doesn't cover the glyphs it should", name.c_str());
+            }
+        }
+    }
+}
+/// ------------------
+
+int main(int argc, char** argv)
+{
+    bool checkOnly = argc == 4 && !strcmp(argv[1], "--check");
+    if (argc != 3 && !checkOnly) {
+        fprintf(stderr, "usage: thprac_locale_gen [--check] <thprac_games_def.json> <output dir>\n");
+        return 2;
+    }
+    const char* json = argv[argc - 2];
+    std::string dir = argv[argc - 1];
+
+    LocaleDef def;
+    ReadDef(json, def);
+    if (!checkOnly) {
+        WriteDef(def, dir);
+    }
+    CheckDef(def, dir);
+    return 0;
+}